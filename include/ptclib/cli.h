@@ -446,6 +446,15 @@ class PCLI : public PObject
       return SetCommand(command, PRefVar<TYPE>(value), name, minValue, maxValue, help, notifier);
     }
 
+    /**Register a command to control and display the lock contention profile.
+       The command takes an optional argument of "enable", "disable", "reset"
+       or "html"; with no argument the profile is displayed as text.
+       See PProfiling::EnableLockProfiling() for more information.
+      */
+    bool SetLockProfilingCommand(
+      const char * command = "lock profile" ///< Command(s) to register
+    );
+
     /**Show help for registered commands to the context.
       */
     virtual void ShowHelp(
@@ -843,6 +852,7 @@ class PCLI : public PObject
 
     virtual void OnSetBooleanCommand(Arguments & args, const InternalCommand & cmd);
     virtual void OnSetIntegerCommand(Arguments & args, const InternalCommand & cmd);
+    PDECLARE_NOTIFIER(Arguments, PCLI, LockProfilingCommand);
 
     typedef std::list<Context *> ContextList_t;
     ContextList_t  m_contextList;
@@ -48,6 +48,8 @@
 // PHTTPSpace
 
 class PHTTPResource;
+class PHTTPRequest;
+class PHTTPConnectionInfo;
 
 /** This class describes a name space that a Universal Resource Locator operates
    in. Each section of the hierarchy field of the URL points to a leg in the
@@ -105,6 +107,74 @@ class PHTTPSpace : public PContainer
       const PURL & url   ///< URL to search for in the name space.
     );
 
+    /** Set the limits for the response cache. The cache keeps the fully
+       rendered body and headers of responses from resources that indicate
+       they may be cached, e.g. <code>PHTTPFile</code>, so that subsequent
+       requests do not need to reload the resource. Entries are validated
+       against the modification time and size of the file they came from,
+       and the least recently used entries are discarded when the limits
+       are reached. The cache also answers "If-None-Match" and
+       "If-Modified-Since" with a 304 Not Modified without loading the
+       resource.
+
+       The cache is disabled by default, and \p maxBytes of zero disables it.
+     */
+    void SetCacheLimits(
+      PINDEX maxBytes,          ///< Maximum total bytes for all cached bodies
+      PINDEX maxEntrySize = 256*1024  ///< Maximum size of a single cached body
+    );
+
+    /// Statistics for the response cache.
+    struct CacheStatistics {
+      CacheStatistics();
+
+      unsigned m_hits;        ///< Number of requests answered from the cache
+      unsigned m_notModified; ///< Number of hits that were answered with 304
+      unsigned m_misses;      ///< Number of cacheable requests not in the cache
+      unsigned m_evictions;   ///< Number of entries discarded or invalidated
+      PINDEX   m_entries;     ///< Number of entries currently in the cache
+      PINDEX   m_bytes;       ///< Total size of bodies currently in the cache
+    };
+
+    /// Get the statistics for the response cache.
+    CacheStatistics GetCacheStatistics() const;
+
+    /// Discard all entries in the response cache.
+    void FlushCache();
+
+    /** Get a response from the cache, if there is a valid entry for the
+       request. This is used by <code>PHTTPResource</code>, after the
+       authorisation has been checked. The <code>code</code>,
+       <code>outMIME</code> and <code>contentSize</code> members of
+       \p request are set, and \p body is set to the data to send. The
+       code is <code>PHTTP::NotModified</code> if the request had an
+       "If-None-Match" or "If-Modified-Since" that matched the entry.
+
+       @return
+       true if the response was found in the cache.
+     */
+    bool GetCachedResponse(
+      PHTTPRequest & request,   ///< Request for resource
+      PBYTEArray & body         ///< Body of response
+    );
+
+    /** Determine if the response to the request could be added to the
+       cache, given it will have the specified size.
+     */
+    bool IsCacheable(
+      const PHTTPConnectionInfo & connectInfo,  ///< Connection information
+      PINDEX size                               ///< Expected size of body
+    ) const;
+
+    /** Add a response to the cache. This is used by <code>PHTTPResource</code>
+       and adds the "ETag" and "Last-Modified" headers to the
+       <code>outMIME</code> of the request.
+     */
+    void AddToCache(
+      PHTTPRequest & request,       ///< Request with loaded headers
+      const PBYTEArray & body       ///< Body of response
+    );
+
     /** This function attempts to acquire the mutex for reading.
      */
     void StartRead() const
@@ -129,6 +199,9 @@ class PHTTPSpace : public PContainer
   protected:
     PReadWriteMutex * mutex;
 
+    class ResponseCache;
+    ResponseCache * m_cache;
+
     class Node;
     PSORTED_LIST(ChildList, Node);
     class Node : public PString
@@ -208,6 +281,8 @@ class PHTTP : public PInternetProtocol
       Gone,                        ///< 410 - resource gone away
       LengthRequired,              ///< 411 - no Content-Length
       UnlessTrue,                  ///< 412 - no Range header for true Unless
+      RequestedRangeNotSatisfiable = 416, ///< 416 - Range header outside of resource
+      RequestHeaderFieldsTooLarge = 431,  ///< 431 - request headers exceed server limit
       InternalServerError = 500,   ///< 500 - server has encountered an unexpected error
       NotImplemented,              ///< 501 - server does not implement request
       BadGateway,                  ///< 502 - error whilst acting as gateway
@@ -220,14 +295,21 @@ class PHTTP : public PInternetProtocol
     static const PCaselessString & AllowTag();
     static const PCaselessString & AuthorizationTag();
     static const PCaselessString & ContentEncodingTag();
+    static const PCaselessString & AcceptEncodingTag();
     static const PCaselessString & ContentLengthTag();
     static const PCaselessString & ContentTypeTag() { return PMIMEInfo::ContentTypeTag(); }
     static const PCaselessString & DateTag();
     static const PCaselessString & ExpiresTag();
     static const PCaselessString & FromTag();
     static const PCaselessString & IfModifiedSinceTag();
+    static const PCaselessString & IfNoneMatchTag();
+    static const PCaselessString & ETagTag();
     static const PCaselessString & LastModifiedTag();
     static const PCaselessString & LocationTag();
+    static const PCaselessString & RangeTag();
+    static const PCaselessString & ContentRangeTag();
+    static const PCaselessString & AcceptRangesTag();
+    static const PCaselessString & VaryTag();
     static const PCaselessString & PragmaTag();
     static const PCaselessString & PragmaNoCacheTag();
     static const PCaselessString & RefererTag();
@@ -524,6 +606,15 @@ class PHTTPClient : public PHTTP
       const PURL & url
     );
 
+    /** Connect at transport level to remote, based on URL, using an already
+        resolved address. The URL host name is still used for TLS server name
+        indication and certificate checks.
+      */
+    bool ConnectURL(
+      const PURL & url,
+      const PIPSocket::Address & address
+    );
+
     /// Call back to process the body of the HTTP command
     typedef PHTTPContentProcessor ContentProcessor;
 
@@ -569,7 +660,11 @@ class PHTTPClient : public PHTTP
       PMIMEInfo & replyMIME
     );
 
-    /// Read the body of the HTTP command
+    /** Read the body of the HTTP command.
+        If the reply has a gzip or deflate Content-Encoding, and content
+        decoding is enabled, the processor receives the decoded body and the
+        Content-Encoding is removed from \p replyMIME.
+      */
     bool ReadContentBody(
       PMIMEInfo & replyMIME,        ///< Reply MIME from server
       ContentProcessor & processor  ///< Processor for received body
@@ -808,6 +903,18 @@ class PHTTPClient : public PHTTP
     /// Get persistent connection mode. Zero disables following redirects.
     bool GetPersistent() const { return m_persist; }
 
+    /** Set content decoding mode.
+        When enabled, and the library has zlib support, "Accept-Encoding" is
+        added to requests and gzip/deflate encoded bodies are decoded
+        transparently. Default is enabled.
+      */
+    void SetContentDecoding(
+      bool decode = true
+    ) { m_contentDecoding = decode; }
+
+    /// Get content decoding mode.
+    bool GetContentDecoding() const { return m_contentDecoding; }
+
     /// Set max redirects on operation
     void SetMaxRedirects(
       unsigned maxRedirects
@@ -821,8 +928,14 @@ class PHTTPClient : public PHTTP
 #endif
 
   protected:
+    bool InternalReadContentBody(
+      PMIMEInfo & replyMIME,
+      ContentProcessor & processor
+    );
+
     PString  m_userAgentName;
     bool     m_persist;
+    bool     m_contentDecoding;
     unsigned m_maxRedirects;
     PString  m_userName;
     PString  m_password;
@@ -840,6 +953,11 @@ class PHTTPClient : public PHTTP
 
 /**A class for a pool of PHTTPClient instances/threads for efficient high
    volume access. e.g. for REST API access.
+
+   Requests to the same host and port reuse persistent connections, up to
+   the maxParallel connections per host. If the pipeline depth is greater
+   than one, several requests are written to a connection before the
+   responses are read, matching responses to requests in order.
  */
 class PHTTPClientPool : public PObject
 {
@@ -854,9 +972,11 @@ class PHTTPClientPool : public PObject
       )
       : m_maxConnections(maxConnections)
       , m_maxParallel(maxParallel)
+      , m_maxPipeline(1)
       , m_timeToLive(timeToLive)
       , m_connectTimeout(connectTimeout)
       , m_readTimeout(readTimeout)
+      , m_dnsCacheTime(0, 0, 1)
     { }
     ~PHTTPClientPool() { ShutDown(); }
 
@@ -870,13 +990,72 @@ class PHTTPClientPool : public PObject
 
     void ShutDown();
 
+    /** Set the maximum number of requests in flight on a connection.
+        A value of one disables pipelining, and each request is executed
+        in turn, with redirections and authentication handled.
+
+        With pipelining, if a connection fails, requests that had been sent
+        but not answered are retried on a new connection, up to three times,
+        except for non-idempotent commands, e.g. POST, which fail with
+        PHTTP::TransportReadError, as it is unknown if the server acted on
+        them. Redirections and authentication challenges are returned to
+        the notifier as is.
+      */
+    void SetMaxPipeline(unsigned depth) { m_maxPipeline = std::max(depth, 1U); }
+
+    /// Get the maximum number of requests in flight on a connection.
+    unsigned GetMaxPipeline() const { return m_maxPipeline; }
+
+    /** Set the time a host name resolution is cached by the pool.
+        A value of zero uses the system wide name cache only.
+      */
+    void SetDNSCacheTime(const PTimeInterval & time) { m_dnsCacheTime = time; }
+
+    /// Get the time a host name resolution is cached by the pool.
+    const PTimeInterval & GetDNSCacheTime() const { return m_dnsCacheTime; }
+
     struct Response
     {
+      Response() : m_code(PHTTP::TransportReadError) { }
+
       PHTTP::StatusCode m_code;
       PMIMEInfo         m_headers;
       PString           m_body;
+      PTimeInterval     m_connectTime;    ///< Time to connect, zero if connection reused
+      PTimeInterval     m_firstByteTime;  ///< Time from sending request to response header
+      PTimeInterval     m_totalTime;      ///< Time from queuing request to notification
     };
 
+    /* Statistics on the pool. The latency histograms have bucket i counting
+       times less than LatencyBucketLimits[i] ms, and the final bucket
+       counting everything longer than that.
+     */
+    struct Statistics
+    {
+      Statistics();
+
+      enum { NumLatencyBuckets = 12 };
+      static const unsigned LatencyBucketLimits[NumLatencyBuckets-1];
+
+      uint64_t m_requests;        // Total requests completed
+      uint64_t m_failures;        // Requests that failed at transport level
+      uint64_t m_retries;         // Requests resent after a connection failed
+      uint64_t m_pipelined;       // Requests sent while another was in flight
+      uint64_t m_connects;        // Connections established
+      uint64_t m_reused;          // Requests sent on an already open connection
+      uint64_t m_dnsHits;         // Host resolutions from pool cache
+      uint64_t m_dnsMisses;       // Host resolutions from system
+      unsigned m_connections;     // Current number of connections
+      uint64_t m_connectHistogram[NumLatencyBuckets];
+      uint64_t m_firstByteHistogram[NumLatencyBuckets];
+      uint64_t m_totalHistogram[NumLatencyBuckets];
+
+      friend ostream & operator<<(ostream & strm, const Statistics & stats);
+    };
+
+    /// Get current statistics on the pool.
+    void GetStatistics(Statistics & stats) const;
+
     typedef PNotifierTemplate<Response> Notifier;
     #define PDECLARE_HttpPoolNotifier(cls, fn) PDECLARE_NOTIFIER2(PHTTPClientPool, cls, fn, PHTTPClientPool::Response)
 
@@ -887,9 +1066,12 @@ class PHTTPClientPool : public PObject
       PMIMEInfo       m_headers;
       PString         m_body;
       Notifier        m_notifier;
+      PTime           m_queued;
+      unsigned        m_retries;
 
       Request()
         : m_command(PHTTP::NumCommands)
+        , m_retries(0)
       { }
       Request(
         PHTTP::Commands command,
@@ -901,7 +1083,10 @@ class PHTTPClientPool : public PObject
         , m_url(url)
         , m_body(body)
         , m_notifier(notifier)
+        , m_retries(0)
       { }
+
+      bool IsIdempotent() const;
     };
 
     void QueueRequest(
@@ -916,11 +1101,17 @@ class PHTTPClientPool : public PObject
     );
 
   protected:
+    bool ResolveHost(const PURL & url, PIPSocket::Address & address);
+    void AddLatency(uint64_t * histogram, const PTimeInterval & time);
+    void OnResponse(Request & request, Response & response);
+
     unsigned      m_maxConnections;
     unsigned      m_maxParallel;
+    unsigned      m_maxPipeline;
     PTimeInterval m_timeToLive;
     PTimeInterval m_connectTimeout;
     PTimeInterval m_readTimeout;
+    PTimeInterval m_dnsCacheTime;
 #if P_SSL
     PString  m_authority;    // Directory, file or data
     PString  m_certificate;  // File or data
@@ -929,17 +1120,49 @@ class PHTTPClientPool : public PObject
 
     PDECLARE_MUTEX(m_mutex);
 
+    struct DNSEntry
+    {
+      PIPSocket::Address m_address;
+      PTime              m_expiry;
+    };
+    std::map<PCaselessString, DNSEntry> m_dnsCache;
+    PDECLARE_MUTEX(m_dnsMutex);
+
+    Statistics               m_statistics;
+    mutable PCriticalSection m_statisticsMutex;
+
     struct Connection
     {
       PHTTPClientPool   & m_owner;
       PSyncQueue<Request> m_requests;
       PHTTPClient         m_http;
       PThread           * m_thread;
+      atomic<unsigned>    m_outstanding;  // Queued or in flight
       PTime               m_lastUse;
+      PDECLARE_MUTEX(     m_lastUseMutex);
+
+      struct InFlight
+      {
+        InFlight(const Request & request) : m_request(request) { }
+        Request  m_request;
+        Response m_response;
+        PTime    m_sent;
+      };
+      std::deque<Request>  m_pending;   // Retries, sent before anything in m_requests
+      std::deque<InFlight> m_inFlight;
 
       Connection(PHTTPClientPool & owner, const Request & request);
       ~Connection();
       void Main();
+      bool IsExpired(const PTimeInterval & timeToLive);
+      bool Connect(const PURL & url, Response & response);
+      void ExecuteSerial(Request & request);
+      void ExecutePipelined();
+      void SendPipelined(const Request & request);
+      bool ReadPipelined();
+      void ConnectionLost();
+      void ReadBody(const Request & request, Response & response);
+      void Completed(Request & request, Response & response);
     };
     friend struct Connection;
     typedef std::multimap<PString, Connection *> ConnectionMap;
@@ -1009,6 +1232,21 @@ class PWebSocket : public PIndirectChannel
       PBYTEArray & msg
     );
 
+    /** Read a complete WebSocket message into a reusable buffer.
+        All the fragments of the message are reassembled into \p msg, which
+        is only ever grown, never shrunk, so a buffer kept by the caller
+        across calls stops allocating once it has reached the size of the
+        largest message. The message is the first \p length bytes of \p msg.
+
+        Control frames (ping, pong, close) are handled internally as for
+        Read().
+      */
+    virtual bool ReadMessage(
+      PBYTEArray & msg,   ///< Buffer to receive message, may be larger than message
+      PINDEX & length,    ///< Length of the message in \p msg
+      bool & binary       ///< Message was binary, rather than text
+    );
+
     // Read complete WebSocket text message
     virtual bool ReadText(
       PString & msg
@@ -1047,7 +1285,22 @@ class PWebSocket : public PIndirectChannel
   ///  Set maximum possible frame size. Defaults to 1GB.
     void SetMaxFrameSize(
       uint64_t maxFrameSize  ///< New maximum size.
-    ) { maxFrameSize = m_maxFrameSize; }
+    ) { m_maxFrameSize = maxFrameSize; }
+
+    /// Get maximum possible frame size.
+    uint64_t GetMaxFrameSize() const { return m_maxFrameSize; }
+
+    /**Set the SIMD instructions used to mask and unmask frames, as a bit mask
+       of PCPUFeatures::Features. The default is the best the CPU supports, so
+       this is mainly for testing and benchmarking.
+       @return The features actually used, which is limited by the CPU.
+      */
+    static unsigned SetMaskAcceleration(
+      unsigned features
+    );
+
+    /// Get the SIMD instructions used to mask and unmask frames.
+    static unsigned GetMaskAcceleration();
 
   protected:
     enum OpCodes
@@ -1060,6 +1313,8 @@ class PWebSocket : public PIndirectChannel
       Pong = 0xA
     };
 
+    enum { MaxHeaderSize = 14 };
+
     virtual bool ReadHeader(
       OpCodes  & opCode,
       bool     & fragment,
@@ -1074,11 +1329,21 @@ class PWebSocket : public PIndirectChannel
       int64_t  masking
     );
 
+    static PINDEX EncodeHeader(
+      BYTE * header,  ///< Buffer of at least MaxHeaderSize bytes
+      OpCodes  opCode,
+      bool     fragment,
+      uint64_t payloadLength,
+      int64_t  masking
+    );
+
     bool InternalRead(void * buf, PINDEX len);
+    bool ReadDataHeader();
     bool ReadMasked(void * buf, PINDEX len);
 
     bool InternalWrite(OpCodes  opCode, bool fragmenting, const void * data, PINDEX len);
-    bool WriteMasked(const uint32_t * data, PINDEX len, uint32_t mask);
+    bool WriteMasked(const BYTE * header, PINDEX headerLen, const BYTE * data, PINDEX len, uint32_t mask);
+    bool WriteGathered(const BYTE * header, PINDEX headerLen, const void * data, PINDEX len);
 
     bool     m_client;
     bool     m_fragmentingWrite;
@@ -1089,9 +1354,12 @@ class PWebSocket : public PIndirectChannel
     uint64_t m_remainingPayload;
     int64_t  m_currentMask;
     bool     m_fragmentedRead;
+    bool     m_binaryRead;
 
     bool     m_recursiveRead;
 
+    PBYTEArray m_writeBuffer;
+
     PString  m_authority;    // Directory, file or data
     PString  m_certificate;  // File or data
     PString  m_privateKey;   // File or data
@@ -1568,20 +1836,27 @@ public:
     */
   virtual void OnHTTPEnded(PHTTPServer & server);
 
+  class Connection; // Internal state for event-driven mode
+
   struct Worker
   {
     Worker(PHTTPListener & listener, PTCPSocket * socket);
+    Worker(PHTTPListener & listener, Connection * connection);
     ~Worker();
     void Work();
 
     PHTTPListener & m_listener;
     PTCPSocket    * m_socket;
     PHTTPServer   * m_httpServer; 
+    Connection    * m_connection;
     PTime           m_queuedTime;
   };
-  typedef PQueuedThreadPool<Worker> ThreadPool;
+  typedef PWorkStealingThreadPool<Worker> ThreadPool;
 
-  /// Get the thread pool in use for this HTTP listener.
+  /** Get the thread pool in use for this HTTP listener.
+      Work stealing is off by default, use GetThreadPool().SetWorkStealing()
+      to let idle workers take connections queued behind a slow one.
+    */
   const ThreadPool & GetThreadPool() const { return m_threadPool; }
         ThreadPool & GetThreadPool()       { return m_threadPool; }
 
@@ -1589,8 +1864,63 @@ public:
   const PHTTPSpace & GetSpace() const { return m_httpNameSpace; }
         PHTTPSpace & GetSpace()       { return m_httpNameSpace; }
 
+  /** Set flag to use a persistent PSocketEventLoop, rather than
+      PSocket::Select(), to wait for incoming connections.
+      Must be called before ListenForHTTP().
+    */
+  void SetUseEventLoop(bool use) { m_useEventLoop = use; }
+
+  /// Get flag to use a persistent PSocketEventLoop for incoming connections.
+  bool GetUseEventLoop() const { return m_useEventLoop; }
+
+  /** Set the number of reactor threads for the event-driven mode.
+      In the default mode, zero reactor threads, a pool thread is dedicated
+      to a connection for its entire lifetime, including while waiting for
+      the next request on a persistent connection.
+
+      In event-driven mode, connections waiting for a request are handed to
+      one of \p count reactor threads. These accumulate the request without
+      blocking, and only pass complete requests to the thread pool. Thus idle
+      persistent connections, and WebSockets, do not consume pool threads.
+
+      Note, connections where CreateChannelForHTTP() returns a channel other
+      than the socket, e.g. TLS, continue to use the default mode.
+
+      Must be called before ListenForHTTP().
+    */
+  void SetReactorThreads(unsigned count) { m_reactorThreads = count; }
+
+  /// Get the number of reactor threads for the event-driven mode.
+  unsigned GetReactorThreads() const { return m_reactorThreads; }
+
+  /// Get the number of connections waiting in the reactor threads.
+  PINDEX GetIdleConnectionCount() const;
+
+  /** Callback in event-driven mode, when a connection that has switched to
+      the WebSocket protocol has data available. This occurs when the
+      WebSocket notifier for the PHTTPServer, or PHTTPResource::OnWebSocket(),
+      returns without closing the channel.
+
+      This is called from a pool thread and should process the data already
+      available, e.g. by a PWebSocket attached to the servers channel, and
+      return, rather than waiting for more. It is called again when more
+      data arrives.
+
+      The default behaviour returns false.
+
+      @return false if the connection is to be closed.
+    */
+  virtual bool OnWebSocketData(PHTTPServer & server);
+
 protected:
   void ListenMain();
+  void AcceptHTTP(PSocket & listener);
+  PDECLARE_SocketEventNotifier(PHTTPListener, OnListenerReady);
+  void WaitForRequest(Connection * connection);
+  void DispatchConnection(Connection * connection);
+  void ProcessConnection(Connection * connection);
+  void EndConnection(Connection * connection);
+  PDECLARE_NOTIFIER(PTimer, PHTTPListener, OnIdleTimer);
 
   PHTTPSpace         m_httpNameSpace;
   PString            m_listenerInterfaces;
@@ -1600,6 +1930,15 @@ protected:
   PList<PHTTPServer> m_httpServers;
   PDECLARE_MUTEX(    m_httpServersMutex);
   ThreadPool         m_threadPool;
+  bool               m_useEventLoop;
+  PSocketEventLoop   m_eventLoop;
+
+  unsigned                        m_reactorThreads;
+  std::vector<PSocketEventLoop *> m_reactors;
+  atomic<unsigned>                m_nextReactor;
+  std::set<Connection *>          m_connections;
+  PDECLARE_MUTEX(                 m_connectionsMutex);
+  PTimer                          m_idleTimer;
 };
 
 
@@ -1670,6 +2009,8 @@ class PHTTPRequest : public PHTTPConnectionInfo
     PIPSocket::Address localAddr;     ///< IP address of local interface for request
     WORD               localPort;     ///< Port number of local server for request
     PTime              m_arrivalTime; ///< Time of arrival of the HTTP request
+    bool               m_cacheable;   ///< Response may be kept in the PHTTPSpace cache
+    PFilePath          m_cacheDependency; ///< File whose change invalidates the cached response
 };
 
 
@@ -2227,6 +2568,19 @@ class PHTTPResource : public PObject
     const PStringOptions & GetCORSHeaders() const { return m_corsHeaders; }
           PStringOptions & GetCORSHeaders()       { return m_corsHeaders; }
 
+    /** Set flag for resource responses may be compressed with gzip or deflate
+        content encoding, if the client indicates it accepts them. Only
+        textual content types, e.g. text/html, application/json etc, of a
+        reasonable size are ever compressed. Default is true.
+      */
+    void SetCompressible(
+      bool compressible = true  ///< Compression is allowed
+    ) { m_compressible = compressible; }
+
+    /** Get flag for resource responses may be compressed.
+      */
+    bool IsCompressible() const { return m_compressible; }
+
   protected:
     /** See if the resource is authorised given the mime info
      */
@@ -2243,6 +2597,25 @@ class PHTTPResource : public PObject
     );
 
 
+    /** Load all the data for the request, add it to the response cache of
+       the <code>PHTTPSpace</code> and send it.
+     */
+    bool SendCacheableData(
+      PHTTPRequest & request    ///< request state information
+    );
+
+    /** Send the data with gzip or deflate content encoding, if the client
+       accepts it and the content is suitable.
+
+       @return
+       false if no encoding was done and the data still needs to be sent.
+     */
+    bool SendEncodedData(
+      PHTTPRequest & request,   ///< request state information
+      PCharArray & data,        ///< First block of data from <code>LoadData()</code>
+      bool more                 ///< <code>LoadData()</code> indicated more to come
+    );
+
     /** common code for GET and HEAD commands */
     virtual bool InternalOnCommand(
       PHTTPServer & server,       ///<  HTTP server that received the request
@@ -2256,6 +2629,7 @@ class PHTTPResource : public PObject
     PHTTPAuthority * m_authority;   ///< Authorisation method for the resource
     PStringOptions   m_corsHeaders; ///< Cross-Origin Resource Sharing (CORS) headers
     atomic<unsigned> m_hitCount;    ///< Count of number of times resource was accessed. 
+    bool             m_compressible; ///< Responses may use gzip/deflate content encoding
 
     P_REMOVE_VIRTUAL(PBoolean,OnGET(PHTTPServer&,const PURL&,const PMIMEInfo&,const PHTTPConnectionInfo&),false);
     P_REMOVE_VIRTUAL(PBoolean,OnHEAD(PHTTPServer&,const PURL&,const PMIMEInfo&,const PHTTPConnectionInfo &),false);
@@ -2424,6 +2798,25 @@ class PHTTPFile : public PHTTPResource
       PHTTPRequest & request    // Information on this request.
     );
 
+    /** Send the data associated with a GET command.
+
+       For files that are not of a "text/" content type, this supports a
+       single byte range in a "Range" header, and transmits the file without
+       going through <code>LoadData()</code>. If the server is directly on a
+       TCP socket, <code>PTCPSocket::WriteFromFile()</code> is used so the
+       operating system can send the file without user space copies, for
+       other channels, e.g. TLS, the file is memory mapped.
+
+       Text files go through the normal <code>LoadText()</code> and
+       <code>OnLoadedText()</code> mechanism.
+
+       @return
+       true if the connection may persist, false if it should close.
+     */
+    virtual PBoolean OnGETData(
+      PHTTPRequest & request    ///< request state information
+    );
+
     /** Get a block of data that the resource contains.
 
        @return
@@ -2454,6 +2847,8 @@ class PHTTPFile : public PHTTPResource
     );
     // Constructor used by PHTTPDirectory
 
+    bool IsTextFile(const PFile & file) const;
+
 
     PFilePath m_filePath;
 };
@@ -365,7 +365,7 @@ class PServiceHTML : public PHTML
 class PServiceMacro : public PObject
 {
   public:
-    PServiceMacro(const char * name, PBoolean isBlock);
+    PServiceMacro(const char * name, PBoolean isBlock, bool cacheable = false);
     PServiceMacro(const PCaselessString & name, PBoolean isBlock);
     Comparison Compare(const PObject & obj) const;
     virtual PString Translate(
@@ -373,9 +373,16 @@ class PServiceMacro : public PObject
       const PString & args,
       const PString & block
     ) const;
+
+    /** Indicate the translation only depends on the URL and the process
+       configuration, so a page using it may be kept in the response cache.
+      */
+    bool IsCacheable() const { return m_cacheable; }
+
   protected:
     const char * macroName;
     PBoolean isMacroBlock;
+    bool m_cacheable;
     PServiceMacro * link;
     static PServiceMacro * list;
   friend class PServiceMacros_list;
@@ -384,25 +391,28 @@ class PServiceMacro : public PObject
 
 #define P_EMPTY
 
-#define PCREATE_SERVICE_MACRO(name, request, args) \
+#define PCREATE_SERVICE_MACRO_EXT(name, request, args, block, isBlock, cacheable) \
   class PServiceMacro_##name : public PServiceMacro { \
     public: \
-      PServiceMacro_##name() : PServiceMacro(#name, false) { } \
+      PServiceMacro_##name() : PServiceMacro(#name, isBlock, cacheable) { } \
       PString Translate(PHTTPRequest &, const PString &, const PString &) const; \
   }; \
   static const PServiceMacro_##name serviceMacro_##name; \
-  PString PServiceMacro_##name::Translate(PHTTPRequest & request, const PString & args, const PString &) const
-
+  PString PServiceMacro_##name::Translate(PHTTPRequest & request, const PString & args, const PString & block) const
 
+#define PCREATE_SERVICE_MACRO(name, request, args) \
+        PCREATE_SERVICE_MACRO_EXT(name, request, args, P_EMPTY, false, false)
 
 #define PCREATE_SERVICE_MACRO_BLOCK(name, request, args, block) \
-  class PServiceMacro_##name : public PServiceMacro { \
-    public: \
-      PServiceMacro_##name() : PServiceMacro(#name, true) { } \
-      PString Translate(PHTTPRequest &, const PString &, const PString &) const; \
-  }; \
-  static const PServiceMacro_##name serviceMacro_##name; \
-  PString PServiceMacro_##name::Translate(PHTTPRequest & request, const PString & args, const PString & block) const
+        PCREATE_SERVICE_MACRO_EXT(name, request, args, block, true, false)
+
+/// As PCREATE_SERVICE_MACRO, but result does not vary with time, connection or other files
+#define PCREATE_CACHEABLE_SERVICE_MACRO(name, request, args) \
+        PCREATE_SERVICE_MACRO_EXT(name, request, args, P_EMPTY, false, true)
+
+/// As PCREATE_SERVICE_MACRO_BLOCK, but result does not vary with time, connection or other files
+#define PCREATE_CACHEABLE_SERVICE_MACRO_BLOCK(name, request, args, block) \
+        PCREATE_SERVICE_MACRO_EXT(name, request, args, block, true, true)
 
 
 
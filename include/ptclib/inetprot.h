@@ -185,6 +185,9 @@ class PInternetProtocol : public PIndirectChannel
        two consecutive '.' characters. A line that has is exclusively a '.'
        character will make the function return false.
 
+       The line is located by scanning the read ahead buffer in bulk, so
+       there is no per character function call overhead.
+
        Note this function will block for the time specified by the
        <A>PChannel::SetReadTimeout()</A> function for only the first character
        in the line. The rest of the characters must each arrive within the time
@@ -213,6 +216,11 @@ class PInternetProtocol : public PIndirectChannel
       PINDEX len            ///< Number of characters to be returned.
     );
 
+    /** Get the number of characters already read from the channel, or put
+       back via <A>UnRead()</A>, that have not yet been consumed.
+     */
+    PINDEX GetReadAheadCount() const { return readBufferEnd - readBufferStart; }
+
     /** Write a single line for a command. The command name for the command
        number is output, then a space, the the <CODE>param</CODE> string
        followed at the end with a CR/LF pair.
@@ -381,11 +389,15 @@ class PInternetProtocol : public PIndirectChannel
     PStringArray commandNames;
     // Names of each of the command codes.
 
-    PCharArray unReadBuffer;
-    // Buffer for characters put back into the data stream.
+    PCharArray readBuffer;
+    // Read ahead buffer, also holds characters put back into the data stream.
+
+    PINDEX readBufferStart;
+    PINDEX readBufferEnd;
+    // Range of unread characters in readBuffer, in stream order.
 
-    PINDEX unReadCount;
-    // Buffer count for characters put back into the data stream.
+    bool FillReadBuffer();
+    // Read ahead from the channel, if readBuffer is empty.
 
     PTimeInterval readLineTimeout;
     // Time for characters in a line to be received.
@@ -115,6 +115,12 @@ class PMIMEInfo : public PStringOptions
     bool AddMIME(
       const PString & line
     );
+    bool AddMIME(
+      const PStringView & line
+    );
+    // Avoid ambiguity between the PString and PStringView overloads
+    bool AddMIME(const char * line) { return AddMIME(PStringView(line)); }
+    bool AddMIME(const std::string & line) { return AddMIME(PStringView(line)); }
     bool AddMIME(
       const PString & fieldName, ///< MIME field name
       const PString & fieldValue ///< MIME field value
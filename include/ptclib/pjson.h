@@ -232,10 +232,22 @@ class PJSON : public PObject
     virtual void ReadFrom(istream & strm);
     virtual void PrintOn(ostream & strm) const;
 
+    /**Parse the string.
+       This uses PJSONParser directly on the string memory, which is much
+       faster than ReadFrom() on a stream.
+      */
     bool FromString(
       const PString & str
     );
 
+    /**Parse the contiguous buffer.
+       As for FromString() but need not be null terminated.
+      */
+    bool FromString(
+      const char * data,
+      size_t length
+    );
+
     PString AsString(
       std::streamsize initialIndent = 0,
       std::streamsize subsequentIndent = 0
@@ -265,6 +277,413 @@ class PJSON : public PObject
     bool   m_valid;
 };
 
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**Pull parser for JSON in a contiguous buffer.
+   Each call to Next() returns the next event, e.g. the start of an object,
+   a member name, or a value, without building any tree, so very large
+   payloads may be processed in constant memory.
+
+   Strings without escapes are returned as a pointer into the original
+   buffer, which must remain valid while the parser is in use. Strings with
+   escapes are decoded into an internal buffer that is reused, so the
+   pointer is only valid until the next call to Next().
+
+   The buffer is scanned with SSE2, where available, for the end of strings
+   and runs of white space.
+  */
+class PJSONParser
+{
+  public:
+    enum Events {
+      e_Error,
+      e_EndOfData,
+      e_StartObject,
+      e_EndObject,
+      e_StartArray,
+      e_EndArray,
+      e_MemberName,   ///< Name of object member, value is next event
+      e_String,
+      e_Number,
+      e_Boolean,
+      e_Null
+    };
+
+    /// Maximum nesting of objects and arrays
+    enum { MaxDepth = 1000 };
+
+    PJSONParser(
+      const char * data,  ///< Buffer containing JSON
+      size_t length       ///< Length of buffer
+    );
+    explicit PJSONParser(
+      const PString & str  ///< String containing JSON, a reference is kept
+    );
+
+    /**Get the next event.
+       Once e_Error or e_EndOfData is returned, it is always returned.
+      */
+    Events Next();
+
+    /**Skip the rest of the value of the last event.
+       If the last event was e_StartObject or e_StartArray, then all events
+       up to and including the matching end are skipped. If it was
+       e_MemberName, then the members value is skipped.
+       @return false if an error occurred.
+      */
+    bool Skip();
+
+    /// Get the last event returned by Next().
+    Events GetEvent() const { return m_event; }
+
+    /// Get current nesting depth of objects and arrays.
+    size_t GetDepth() const { return m_containers.size(); }
+
+    /// Get offset into the buffer, e.g. where the error occurred.
+    size_t GetOffset() const { return m_position - m_data; }
+
+    /**Get the string for e_MemberName or e_String, or the text for e_Number.
+       This is not null terminated.
+      */
+    const char * GetStringPtr() const { return m_string; }
+
+    /// Get the length of string for e_MemberName, e_String or e_Number.
+    size_t GetStringLength() const { return m_stringLength; }
+
+    /// Indicate the string is in the original buffer, not the internal one.
+    bool IsStringInBuffer() const { return m_stringInBuffer; }
+
+    /// Get copy of the string for e_MemberName or e_String.
+    PString GetString() const { return PString(m_string, m_stringLength); }
+
+    /// Compare the string for e_MemberName or e_String, without a copy.
+    bool IsString(const char * str) const;
+
+    /// Get value for e_Number.
+    long double GetNumber() const;
+
+    /// Get value for e_Boolean.
+    bool GetBoolean() const { return m_boolean; }
+
+    /**Convert JSON number text to a value.
+       Integers are converted directly, anything else uses strtold().
+      */
+    static long double ConvertNumber(const char * text, size_t length);
+
+  protected:
+    void Construct();
+    Events SetEvent(Events event) { return m_event = event; }
+    Events Fail(const char * reason);
+    Events ValueDone(Events event);
+    Events ParseValue();
+    Events ParseMemberName();
+    Events ParseClose();
+    bool ParseString();
+    bool ParseEscape(const char * & ptr);
+    bool ParseNumber();
+    bool ParseLiteral(const char * literal, size_t length);
+    void SkipWhiteSpace();
+
+    enum Expecting {
+      e_ExpectValue,
+      e_ExpectValueOrClose,
+      e_ExpectNameOrClose,
+      e_ExpectCommaOrClose,
+      e_ExpectEndOfData
+    };
+
+    PString      m_source;
+    const char * m_data;
+    const char * m_position;
+    const char * m_end;
+    Events       m_event;
+    Expecting    m_expecting;
+    std::vector<char> m_containers;
+
+    const char * m_string;
+    size_t       m_stringLength;
+    bool         m_stringInBuffer;
+    std::string  m_decoded;
+    bool         m_boolean;
+};
+
+
+/**JSON document held in a memory arena.
+   Unlike PJSON, which has a heap allocated object for every value, this
+   allocates all values in large blocks which are freed in one go. Objects and
+   arrays have their children contiguous in memory, and strings without
+   escapes are not copied at all, they point into the original buffer, which
+   must therefore remain valid for the life of the document.
+
+   The document is read only, and is built from a PJSONParser. When output,
+   numbers are written as their original text, so they round trip exactly,
+   unless that text is not strictly valid JSON, e.g. "007" or ".5", which
+   the parser accepts.
+  */
+class PJSONDocument : public PObject
+{
+    PCLASSINFO(PJSONDocument, PObject);
+  public:
+    class Value
+    {
+      public:
+        Value()
+          : m_type(PJSON::e_Null)
+          , m_nameLength(0)
+          , m_name("")
+          , m_size(0)
+          , m_text(NULL)
+        { }
+
+        PJSON::Types GetType() const { return m_type; }
+        bool IsType(PJSON::Types type) const { return m_type == type; }
+
+        /// Get name of value when it is a member of an object.
+        PString GetName() const { return PString(m_name, m_nameLength); }
+        const char * GetNamePtr() const { return m_name; }
+        size_t GetNameLength() const { return m_nameLength; }
+
+        /// Get string, which may be zero length, if not e_String.
+        PString GetString() const;
+        const char * GetStringPtr() const { return m_type == PJSON::e_String ? m_text : ""; }
+        size_t GetStringLength() const { return m_type == PJSON::e_String ? m_size : 0; }
+
+        /// Get numeric value, zero if not e_Number
+        PJSON::NumberType GetNumber() const;
+        int GetInteger() const;
+        int64_t GetInteger64() const;
+        unsigned GetUnsigned() const;
+        uint64_t GetUnsigned64() const;
+
+        /// Get boolean value, false if not e_Boolean
+        bool GetBoolean() const { return m_type == PJSON::e_Boolean && m_boolean; }
+
+        /// Get the number of members of an object, or elements of an array.
+        size_t GetSize() const { return m_type == PJSON::e_Object || m_type == PJSON::e_Array ? m_size : 0; }
+
+        /// Iterate members of an object or elements of an array.
+        const Value * begin() const { return GetSize() > 0 ? m_children : NULL; }
+        const Value * end() const { return GetSize() > 0 ? m_children + m_size : NULL; }
+
+        /// Get element of an array, or member of object, by position, null value if out of range.
+        const Value & operator[](size_t index) const;
+
+        /// Get member of an object by name, NULL if not present.
+        const Value * Find(const char * name) const;
+
+        /// Get member of an object by name, null value if not present.
+        const Value & operator[](const char * name) const;
+
+        /// Convert to a PJSON tree of the same structure
+        PJSON::Base * CreateJSON() const;
+
+      protected:
+        PJSON::Types m_type;
+        unsigned     m_nameLength;
+        const char * m_name;
+        size_t       m_size;  // String length, number text length, or count of children
+        union {
+          const char  * m_text;
+          const Value * m_children;
+          bool          m_boolean;
+        };
+
+      friend class PJSONDocument;
+      friend class PJSONWriter;
+    };
+
+    PJSONDocument();
+    ~PJSONDocument();
+
+    /**Parse the buffer, which must remain valid for the life of the document.
+       Any previous document is discarded, the memory arena is retained.
+      */
+    bool Parse(
+      const char * data,
+      size_t length
+    );
+
+    /// Parse the string, a reference to the string is kept.
+    bool Parse(
+      const PString & str
+    );
+
+    /// Release all values in one go.
+    void Clear();
+
+    /// Indicate last Parse() was successful.
+    bool IsValid() const { return m_valid; }
+
+    /// Get root value, which is null value if not valid.
+    const Value & GetRoot() const { return m_root; }
+
+    /// Get offset in buffer of error from last Parse()
+    size_t GetErrorOffset() const { return m_errorOffset; }
+
+    /// Get the total memory used by the arena.
+    size_t GetArenaSize() const;
+
+    virtual void PrintOn(ostream & strm) const;
+
+  protected:
+    bool InternalParse(PJSONParser & parser);
+    void * Allocate(size_t size);
+    const char * SaveString(const PJSONParser & parser);
+
+    PString m_source;
+    Value   m_root;
+    bool    m_valid;
+    size_t  m_errorOffset;
+
+    struct Block {
+      Block * m_next;
+      size_t  m_size;
+    };
+    Block * m_blocks;
+    char  * m_nextFree;
+    size_t  m_freeSize;
+
+    std::vector<Value>  m_valueStack;
+    std::vector<size_t> m_containerStack;
+
+  private:
+    PJSONDocument(const PJSONDocument &) { }
+    void operator=(const PJSONDocument &) { }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**Fast JSON output to a memory buffer.
+   Values are formatted directly into a growable buffer, without ostream.
+   Integers have a fast path, and floating point uses the Grisu2 algorithm,
+   giving short text that always reads back to the same value.
+
+   Clear() keeps the buffer memory, so a writer kept across calls will stop
+   allocating once the buffer has reached the size of the largest output.
+   Alternatively, a buffer supplied by the caller may be used.
+
+   The output is always null terminated.
+  */
+class PJSONWriter
+{
+  public:
+    /**Create writer using its own buffer.
+       If \p initialIndent or \p increment are non-zero, then the output
+       is "pretty", in the same style as PJSON::AsString().
+      */
+    PJSONWriter(
+      unsigned initialIndent = 0,
+      unsigned increment = 0
+    );
+
+    /// Create writer using the callers buffer.
+    PJSONWriter(
+      PCharArray & buffer,
+      unsigned initialIndent = 0,
+      unsigned increment = 0
+    );
+
+    /// Set the pretty print mode.
+    void SetPretty(
+      unsigned initialIndent,
+      unsigned increment = 2
+    );
+
+    /// Set compact mode, with no white space at all.
+    void SetCompact() { m_pretty = false; }
+
+    /// Reset to empty output, keeping the buffer memory.
+    void Clear();
+
+    /// Get pointer to output
+    const char * GetData() const { return m_data; }
+
+    /// Get length of output.
+    size_t GetLength() const { return m_length; }
+
+    /// Get output as a string.
+    PString GetString() const { return PString(GetData(), m_length); }
+
+    PJSONWriter & StartObject();
+    PJSONWriter & EndObject();
+    PJSONWriter & StartArray();
+    PJSONWriter & EndArray();
+
+    /// Output name of next member, when in an object.
+    PJSONWriter & Name(const char * name, size_t length);
+    PJSONWriter & Name(const char * name) { return Name(name, strlen(name)); }
+    PJSONWriter & Name(const PString & name) { return Name(name, name.GetLength()); }
+
+    PJSONWriter & String(const char * str, size_t length);
+    PJSONWriter & String(const char * str) { return String(str, strlen(str)); }
+    PJSONWriter & String(const PString & str) { return String(str, str.GetLength()); }
+
+    PJSONWriter & Number(int value) { return Number((long long)value); }
+    PJSONWriter & Number(unsigned value) { return Number((unsigned long long)value); }
+    PJSONWriter & Number(long value) { return Number((long long)value); }
+    PJSONWriter & Number(unsigned long value) { return Number((unsigned long long)value); }
+    PJSONWriter & Number(long long value);
+    PJSONWriter & Number(unsigned long long value);
+    PJSONWriter & Number(float value);
+    PJSONWriter & Number(double value);
+    PJSONWriter & Number(long double value);
+
+    PJSONWriter & Boolean(bool value);
+    PJSONWriter & Null();
+
+    /// Output the value, and all its children.
+    PJSONWriter & Write(const PJSON::Base & value);
+    PJSONWriter & Write(const PJSON & json) { return Write(json.GetAs<PJSON::Base>()); }
+    PJSONWriter & Write(const PJSONDocument::Value & value);
+
+    /// Output the value, as text of a JSON number, which is not checked.
+    PJSONWriter & RawNumber(const char * text, size_t length);
+
+    /// Size of buffer needed for FormatNumber() etc.
+    enum { MaxNumberSize = 32 };
+
+    /**Format a number into the buffer, of at least MaxNumberSize bytes.
+       Integral values are output as integers, non-finite values as "null",
+       and others as the shortest text that reads back to the same value.
+       @return length of text, which is not null terminated.
+      */
+    static size_t FormatNumber(char * buffer, long double value);
+    static size_t FormatNumber(char * buffer, double value);
+    static size_t FormatNumber(char * buffer, float value);
+    static size_t FormatNumber(char * buffer, long long value);
+    static size_t FormatNumber(char * buffer, unsigned long long value);
+
+  protected:
+    void Construct(unsigned initialIndent, unsigned increment);
+    char * Reserve(size_t length);
+    void Append(const char * data, size_t length);
+    void Append(char c);
+    void AppendIndent(unsigned indent);
+    void AppendQuoted(const char * str, size_t length);
+    void BeginValue(bool container);
+    void EndValue() { m_first = false; }
+    PJSONWriter & OpenContainer(char open);
+    PJSONWriter & CloseContainer(char close);
+
+    PCharArray   m_ownBuffer;
+    PCharArray & m_buffer;
+    char       * m_data;
+    size_t       m_capacity;
+    size_t       m_length;
+    bool         m_pretty;
+    unsigned     m_initialIndent;
+    unsigned     m_increment;
+    unsigned     m_depth;
+    bool         m_first;
+    bool         m_afterName;
+
+  private:
+    PJSONWriter(const PJSONWriter & other) : m_buffer(other.m_buffer) { }
+    void operator=(const PJSONWriter &) { }
+};
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 class PJSONWrapMember;
@@ -300,6 +719,13 @@ public:
   void AsJSON(
     PJSON & json
   ) const;
+
+  /**Output directly to the writer, without building a PJSON tree.
+     The writer, and its buffer, may be reused across calls.
+    */
+  void AsJSON(
+    PJSONWriter & writer
+  ) const;
 };
 
 class PJSONWrapMember
@@ -313,6 +739,7 @@ public:
   virtual PJSON::Types GetType() const = 0;
   virtual bool FromJSON(const PJSON::Base & field) = 0;
   virtual void AsJSON(PJSON::Base & field) const = 0;
+  virtual void AsJSON(PJSONWriter & writer) const;
 
 protected:
   PString m_memberName;
@@ -335,6 +762,7 @@ public:
   virtual PJSON::Types GetType() const { return PJSON::e_String; }
   virtual bool FromJSON(const PJSON::Base & field) { PStringStream s(dynamic_cast<const PJSON::String &>(field)); s >> m_value; return s.good(); }
   virtual void AsJSON(PJSON::Base & field) const { dynamic_cast<PJSON::String &>(field) = PSTRSTRM(m_value); }
+  virtual void AsJSON(PJSONWriter & writer) const { writer.String(PSTRSTRM(m_value)); }
 
 protected:
   TYPE m_value;
@@ -352,6 +780,7 @@ public:
   virtual PJSON::Types GetType() const { return PJSON::e_String; }
   virtual bool FromJSON(const PJSON::Base & field) { m_value = dynamic_cast<const PJSON::String &>(field); return true; }
   virtual void AsJSON(PJSON::Base & field) const { dynamic_cast<PJSON::String &>(field) = m_value; }
+  virtual void AsJSON(PJSONWriter & writer) const { writer.String(m_value); }
 protected:
   PString m_value;
 };
@@ -366,6 +795,7 @@ public:
   virtual PJSON::Types GetType() const { return PJSON::e_String; }
   virtual bool FromJSON(const PJSON::Base & field) { return m_value.Parse(dynamic_cast<const PJSON::String &>(field)); }
   virtual void AsJSON(PJSON::Base & field) const { dynamic_cast<PJSON::String &>(field) = m_value.AsString(PTime::LongISO8601); }
+  virtual void AsJSON(PJSONWriter & writer) const { writer.String(m_value.AsString(PTime::LongISO8601)); }
 protected:
   PTime m_value;
 };
@@ -380,6 +810,7 @@ public:
   virtual PJSON::Types GetType() const { return PJSON::e_Boolean; }
   virtual bool FromJSON(const PJSON::Base & field) { m_value = dynamic_cast<const PJSON::Boolean &>(field).GetValue(); return true; }
   virtual void AsJSON(PJSON::Base & field) const { dynamic_cast<PJSON::Boolean &>(field).SetValue(m_value); }
+  virtual void AsJSON(PJSONWriter & writer) const { writer.Boolean(m_value); }
 protected:
   bool m_value;
 };
@@ -392,6 +823,7 @@ public:
   virtual PJSON::Types GetType() const { return PJSON::e_Number; }
   virtual bool FromJSON(const PJSON::Base & field) { m_value = static_cast<TYPE>(dynamic_cast<const PJSON::Number &>(field).GetValue()); return true; }
   virtual void AsJSON(PJSON::Base & field) const { dynamic_cast<PJSON::Number &>(field).SetValue(static_cast<PJSON::NumberType>(m_value)); }
+  virtual void AsJSON(PJSONWriter & writer) const { writer.Number(m_value); }
 protected:
   TYPE m_value;
 };
@@ -429,6 +861,7 @@ public:
   virtual PJSON::Types GetType() const { return PJSON::e_Object; }
   virtual bool FromJSON(const PJSON::Base & field) { return TYPE::FromJSON(dynamic_cast<const PJSON::Object &>(field)); }
   virtual void AsJSON(PJSON::Base & field) const { TYPE::AsJSON(dynamic_cast<PJSON::Object &>(field)); }
+  virtual void AsJSON(PJSONWriter & writer) const { TYPE::AsJSON(writer); }
 };
 
 template <typename TYPE, typename WRAP = PJSONMember<TYPE> > class PJSONMemberArray : public PJSONWrapMember, public std::vector<TYPE>
@@ -461,6 +894,15 @@ public:
       wrap.AsJSON(*arr.back());
     }
   }
+  virtual void AsJSON(PJSONWriter & writer) const
+  {
+    writer.StartArray();
+    for (size_t i = 0; i < this->size(); ++i) {
+      WRAP const wrap(NULL, this->at(i));
+      wrap.AsJSON(writer);
+    }
+    writer.EndArray();
+  }
 };
 
 template <typename TYPE> class PJSONMemberArrayRecord : public PJSONMemberArray<TYPE, PJSONMemberRecord<TYPE> >
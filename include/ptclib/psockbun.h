@@ -265,6 +265,8 @@ class PMonitoredSockets : public PSafeObject
         , m_lastCount(0)
         , m_errorCode(PChannel::NoError)
         , m_errorNumber(0)
+        , m_datagrams(NULL)
+        , m_datagramCount(0)
       { }
 
       void * m_buffer;              ///< Data to read/write
@@ -276,6 +278,14 @@ class PMonitoredSockets : public PSafeObject
       PTimeInterval m_timeout;      ///< Time to wait for data
       PChannel::Errors m_errorCode; ///< Error code for read/write
       int m_errorNumber;            ///< Error number (OS specific) for read/write
+
+      /** If not NULL, a read drains up to m_datagramCount datagrams from the
+          socket in one call, and m_buffer/m_length are not used. On success
+          m_datagramCount is set to the number actually read, m_lastCount is
+          the total bytes, and m_addr/m_port are from the first datagram.
+        */
+      PIPDatagramSocket::Datagram * m_datagrams;
+      PINDEX m_datagramCount;       ///< Number of entries in m_datagrams
     };
 
     /** Write to the remote address/port using the socket(s) available. If the
@@ -371,6 +381,10 @@ class PMonitoredSockets : public PSafeObject
       PUDPSocket * & socket,
       BundleParams & param
     );
+    void ReadFromSocket(
+      PUDPSocket & socket,
+      BundleParams & param
+    );
 
     WORD          m_localPort;
     bool          m_reuseAddress;
@@ -586,6 +600,15 @@ class PMonitoredSocketBundle : public PMonitoredSockets
       BundleParams & param ///< Info on data to read
     );
 
+    /** Set flag to use a persistent PSocketEventLoop, rather than building
+        a PSocket::SelectList on every call, when reading from any interface
+        in ReadFromBundle().
+      */
+    void SetUseEventLoop(bool use);
+
+    /// Get flag to use a persistent PSocketEventLoop in ReadFromBundle().
+    bool GetUseEventLoop() const { return m_eventLoop != NULL; }
+
   protected:
     PDECLARE_InterfaceNotifier(PMonitoredSocketBundle, OnInterfaceChange);
     PInterfaceMonitor::Notifier m_onInterfaceChange;
@@ -594,10 +617,18 @@ class PMonitoredSocketBundle : public PMonitoredSockets
 
     void OpenSocket(const PString & iface);
     void CloseSocket(SocketInfoMap_T::iterator iterSocket);
+    void ReadFromEventLoop(BundleParams & param);
+
+    PDECLARE_SocketEventNotifier(PMonitoredSocketBundle, OnSocketReady);
 
     SocketInfoMap_T m_socketInfoMap;
     PCaselessString m_fixedInterface;
     unsigned        m_ipVersion;
+
+    PSocketEventLoop      * m_eventLoop;
+    bool                    m_eventLoopInUse;
+    std::list<PUDPSocket *> m_readySockets;
+    PDECLARE_MUTEX(         m_readySocketsMutex);
 };
 
 
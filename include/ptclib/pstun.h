@@ -770,6 +770,8 @@ class PTURNUDPSocket : public PSTUNUDPSocket, public PSTUN
     bool InternalGetLocalAddress(PIPSocketAddressAndPort & addr);
     bool InternalWriteTo(const Slice * slices, size_t sliceCount, const PIPSocketAddressAndPort & ipAndPort);
     bool InternalReadFrom(Slice * slices, size_t sliceCount, PIPSocketAddressAndPort & ipAndPort);
+    PINDEX ReadFromMulti(Datagram * datagrams, PINDEX count);
+    PINDEX WriteToMulti(Datagram * datagrams, PINDEX count);
     bool InternalSetSendAddress(const PIPSocketAddressAndPort & addr, int mtuDiscovery = -1);
     void InternalGetSendAddress(PIPSocketAddressAndPort & addr);
 
@@ -44,6 +44,7 @@ class PSTUNServer : public PObject, public PSTUN
   PCLASSINFO(PSTUNServer, PObject)
   public:
     PSTUNServer();
+    ~PSTUNServer();
     
     bool Open(WORD port = DefaultPort);
     bool Open(PUDPSocket * socket1, PUDPSocket * socket2 = NULL);
@@ -71,6 +72,14 @@ class PSTUNServer : public PObject, public PSTUN
 
     virtual bool Process();
 
+    /** Set flag to use a persistent PSocketEventLoop, rather than
+        PSocket::Select(), to wait for incoming requests in Read().
+      */
+    void SetUseEventLoop(bool use);
+
+    /// Get flag to use a persistent PSocketEventLoop for incoming requests.
+    bool GetUseEventLoop() const { return m_eventLoop != NULL; }
+
     virtual bool OnReceiveMessage(
       const PSTUNMessage & message,
       const SocketInfo & socketInfo
@@ -96,6 +105,9 @@ class PSTUNServer : public PObject, public PSTUN
              PUDPSocket * alternatePortSocket, PUDPSocket * alternateAddressSocket, PUDPSocket * alternateAddressAndPortSocket);
 
     SocketInfo * CreateAndAddSocket(const PIPSocket::Address & addess, WORD port);
+    void AddSocket(PUDPSocket * socket);
+
+    PDECLARE_SocketEventNotifier(PSTUNServer, OnSocketReady);
 
     typedef std::map<PUDPSocket *, SocketInfo> SocketToSocketInfoMap;
     SocketToSocketInfoMap m_socketToSocketInfoMap;
@@ -103,6 +115,7 @@ class PSTUNServer : public PObject, public PSTUN
     PSocket::SelectList   m_selectList;
 
     bool m_autoDelete;
+    PSocketEventLoop * m_eventLoop;
 
     PTRACE_THROTTLE(m_throttleReceivedPacket, 3, 30000, 5);
 };
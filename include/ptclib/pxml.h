@@ -55,7 +55,7 @@ class PXMLBase : public PObject
 
     P_DECLARE_BITWISE_ENUM_EX(
       Options,
-      8,
+      9,
       (
         NoOptions,
         Indent,
@@ -65,9 +65,10 @@ class PXMLBase : public PObject
         CloseExtended,
         WithNS,
         FragmentOnly,
-        ExpandEntities
+        ExpandEntities,
+        IndexElements
       ),
-      AllOptions = (1<<8)-1
+      AllOptions = (1<<9)-1
     );
 
     enum StandAloneType {
@@ -403,6 +404,11 @@ class PXMLElement : public PXMLObject
   public:
     PXMLElement(const char * name = NULL, const char * data = NULL);
 
+    ~PXMLElement();
+
+    /// Assign element, the child index is not shared, it is rebuilt on use.
+    PXMLElement & operator=(const PXMLElement & other);
+
     virtual PINDEX GetObjectCount() const;
 
     PBoolean IsElement() const { return true; }
@@ -413,8 +419,7 @@ class PXMLElement : public PXMLObject
     const PCaselessString & GetName() const
       { return m_name; }
 
-    void SetName(const PString & v)
-      { m_name = v; }
+    void SetName(const PString & v);
 
     /**
         Get the completely qualified name for the element inside the
@@ -476,7 +481,21 @@ class PXMLElement : public PXMLObject
     PCaselessString PrependNamespace(const PCaselessString & name) const;
     bool GetURIForNamespace(const PCaselessString & prefix, PCaselessString & uri) const;
 
+    /**Enable an index of the child elements by name.
+       This makes GetElement() constant time for elements with many children,
+       at the cost of some memory. The index is built on first use, and any
+       element added to an indexed element is indexed as well. If
+       \p recursive is true, all existing descendants are also indexed.
+      */
+    void EnableIndex(bool recursive = true);
+    bool IsIndexed() const { return m_indexed; }
+
   protected:
+    struct ChildIndex;
+    const ChildIndex * GetChildIndex() const;
+    void InvalidateIndex();
+    const std::vector<PXMLElement *> & GetElementList(const PCaselessString & name, std::vector<PXMLElement *> & scratch) const;
+
     PCaselessString m_name;
     PStringToString m_attributes;
     PStringToString m_nameSpaces;
@@ -484,9 +503,14 @@ class PXMLElement : public PXMLObject
 
     PArray<PXMLObject> m_subObjects;
 
+    bool                 m_indexed;
+    mutable atomic<ChildIndex *> m_childIndex; // Built on first use by const functions, so published atomically
+
 #if PTRACING
     virtual void InternalPrintTrace(ostream & strm) const;
 #endif
+
+  friend class PXMLPath;
 };
 
 
@@ -514,6 +538,77 @@ class PXMLRootElement : public PXMLElement
 };
 
 
+////////////////////////////////////////////////////////////
+
+/**Compiled path query for locating elements.
+   This is a small subset of XPath, compiled once, so repeated lookups of
+   the same path do not re-parse it. The path is a '/' separated list of
+   steps, each being an element name or "*" for any element, optionally
+   followed by a predicate of "[n]", the n'th match counting from 1,
+   "[@attr]" for having an attribute or "[@attr='value']" for an attribute
+   value. The last step may be "@attr" to select an attribute, for use by
+   GetString(). A leading '/' makes the path absolute, where the first step
+   must match the root element, otherwise the path is relative to the
+   element supplied.
+
+   For example "/methodResponse/params/param[2]/value" or
+   "form[@id='main']/field/@name".
+
+   Lookups use the index of child elements, see PXMLElement::EnableIndex().
+  */
+class PXMLPath : public PObject
+{
+    PCLASSINFO(PXMLPath, PObject);
+  public:
+    explicit PXMLPath(const PString & path = PString::Empty());
+
+    /// Compile the path, returning false if it has a syntax error.
+    bool Compile(const PString & path);
+
+    bool IsValid() const { return !m_steps.empty(); }
+    const PString & GetPath() const { return m_path; }
+
+    virtual void PrintOn(ostream & strm) const;
+
+    /// Find the first element matching the path.
+    PXMLElement * Find(const PXMLElement & context) const;
+    PXMLElement * Find(const PXML & xml) const;
+
+    /// Find all elements matching the path, in document order.
+    bool FindAll(const PXMLElement & context, std::vector<PXMLElement *> & elements) const;
+    bool FindAll(const PXML & xml, std::vector<PXMLElement *> & elements) const;
+
+    /**Get the value the path selects.
+       If the last step is an attribute this is the attribute value,
+       otherwise it is the data of the element.
+      */
+    PString GetString(const PXMLElement & context, const PString & dflt = PString::Empty()) const;
+    PString GetString(const PXML & xml, const PString & dflt = PString::Empty()) const;
+
+  protected:
+    struct Step
+    {
+      Step() : m_position(0), m_hasValue(false) { }
+
+      PCaselessString m_name;      // Empty is wildcard
+      PINDEX          m_position;  // Zero is all matches
+      PCaselessString m_attribute; // Predicate attribute, if not empty
+      PString         m_value;     // Predicate attribute value, if m_hasValue
+      bool            m_hasValue;
+    };
+
+    bool Matches(const PXMLElement & element, const Step & step) const;
+    PXMLElement * FindFirst(const PXMLElement & parent, size_t stepIndex) const;
+    void FindAll(const PXMLElement & parent, size_t stepIndex, std::vector<PXMLElement *> & elements) const;
+    const PXMLElement * GetStart(const PXMLElement & context, size_t & stepIndex) const;
+
+    PString           m_path;
+    bool              m_absolute;
+    std::vector<Step> m_steps;
+    PCaselessString   m_selectAttribute;
+};
+
+
 ////////////////////////////////////////////////////////////
 
 class PXMLParserBase
@@ -610,6 +705,149 @@ class PXMLStreamParser : public PXMLParser
 };
 
 
+////////////////////////////////////////////////////////////
+
+/**Pull parser for XML.
+   This produces a sequence of events as the document is read, without
+   building any PXMLElement tree, so very large documents, or documents of
+   which only a small part is of interest, may be processed quickly. The
+   expat parser is suspended after each element, so only the text for the
+   current event is held in memory.
+
+   Character data is delivered as a single e_Data event between the element
+   events, with leading white space ignored, as for PXML, unless the
+   NoIgnoreWhiteSpace option is used.
+
+   Example:
+   <pre><code>
+     PXMLReader reader(xmlText);
+     while (reader.Next() > PXMLReader::e_EndOfData) {
+       if (reader.GetEvent() == PXMLReader::e_StartElement && reader.GetName() == "member") {
+         PAutoPtr<PXMLElement> member(reader.ReadElement());
+         ...
+       }
+     }
+   </code></pre>
+  */
+class PXMLReader : public PXMLBase, public PXMLParserBase
+{
+    PCLASSINFO(PXMLReader, PXMLBase);
+  public:
+    /// Read from a string.
+    PXMLReader(
+      const PString & data,
+      Options options = NoOptions,
+      const char * encoding = NULL
+    );
+
+    /// Read from a stream, as needed.
+    PXMLReader(
+      istream & strm,
+      Options options = NoOptions,
+      const char * encoding = NULL
+    );
+
+    /**Read the text written to a string stream.
+       Needed as PStringStream is both a PString and an istream.
+      */
+    PXMLReader(
+      PStringStream & strm,
+      Options options = NoOptions,
+      const char * encoding = NULL
+    );
+
+    /// Read from a channel, as needed.
+    PXMLReader(
+      PChannel & channel,
+      Options options = NoOptions,
+      const char * encoding = NULL
+    );
+
+    enum Event {
+      e_Error,
+      e_EndOfData,
+      e_StartElement,
+      e_EndElement,
+      e_Data
+    };
+
+    /**Move to the next event.
+       @return e_Error on malformed XML or I/O error, e_EndOfData after the
+               root element is closed, otherwise the new event.
+      */
+    Event Next();
+
+    /**Skip the rest of the current element.
+       Must be called when the current event is e_StartElement, and leaves
+       the reader at the matching e_EndElement.
+      */
+    bool Skip();
+
+    /**Read the rest of the current element as a tree.
+       Must be called when the current event is e_StartElement, and leaves
+       the reader at the matching e_EndElement. This allows only parts of a
+       document to be loaded as PXMLElement objects.
+       @return new element, which the caller must delete, or NULL on error.
+      */
+    PXMLElement * ReadElement();
+
+    Event GetEvent() const { return m_event.m_type; }
+
+    /// Get the depth of element nesting, root element is 1.
+    unsigned GetDepth() const { return m_depth; }
+
+    /// Get the element name, for e_StartElement or e_EndElement, empty for e_Data.
+    const PCaselessString & GetName() const { return m_event.m_name; }
+
+    /// Get the element attributes, for e_StartElement.
+    const PStringToString & GetAttributes() const;
+    PString GetAttribute(const PCaselessString & key) const;
+    bool HasAttribute(const PCaselessString & key) const;
+
+    /// Get the character data, for e_Data.
+    const PString & GetData() const { return m_event.m_data; }
+
+    virtual void StartElement(const char * name, const char **attrs);
+    virtual void EndElement(const char * name);
+    virtual void AddCharacterData(const char * data, int len);
+
+  protected:
+    void Construct();
+    bool ParseMore();
+    void FlushData();
+    void Suspend();
+
+    struct EventInfo
+    {
+      EventInfo() : m_type(e_EndOfData) { }
+
+      Event                m_type;
+      PCaselessString      m_name;
+      std::vector<PString> m_attributes; // Name/value pairs
+      PString              m_data;
+    };
+
+    PString     m_string;
+    istream   * m_stream;
+    PChannel  * m_channel;
+    bool        m_finalChunk;
+    char        m_buffer[4096];
+
+    EventInfo & NewEvent(Event type);
+
+    EventInfo              m_event;
+    std::vector<EventInfo> m_pending; // Entries are reused to avoid allocations
+    size_t                 m_pendingIndex;
+    size_t                 m_pendingCount;
+    std::string            m_pendingData;
+    mutable PStringToString m_attributes;
+    mutable bool           m_attributesValid;
+    unsigned               m_depth;
+    unsigned               m_parseDepth;
+    bool                   m_failed;
+};
+
+
 #else
 
 namespace PXML {
@@ -0,0 +1,143 @@
+/*
+ * pzlib.h
+ *
+ * zlib compression wrapper
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef PTLIB_PZLIB_H
+#define PTLIB_PZLIB_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <ptlib.h>
+
+#if P_ZLIB
+
+
+/**Streaming deflate/gzip compression and decompression.
+   This is a thin wrapper around a zlib stream, so that the zlib headers do
+   not need to be included by users, e.g. the HTTP content encoding.
+ */
+class PZLib : public PObject
+{
+    PCLASSINFO(PZLib, PObject)
+  public:
+    enum Direction {
+      e_Compress,
+      e_Decompress
+    };
+
+    enum Format {
+      e_Deflate,    ///< RFC1950 zlib format, as used by HTTP "deflate" encoding
+      e_GZip,       ///< RFC1952 gzip format
+      e_AutoDetect  ///< Decompression only, zlib, gzip or raw deflate
+    };
+
+    enum Flush {
+      e_NoFlush,    ///< Stream may buffer data to improve compression
+      e_SyncFlush,  ///< All data so far is output, stream continues
+      e_Finish      ///< All data is output and the stream terminated
+    };
+
+    /**Create a compression or decompression stream.
+       The \p level is 0 to 9, or -1 for the zlib default, and is ignored for
+       decompression.
+      */
+    PZLib(
+      Direction direction,
+      Format format = e_GZip,
+      int level = -1
+    );
+
+    ~PZLib();
+
+    /**Process a block of data through the stream.
+       The \p output is set to the data produced, which may be empty, as the
+       stream may buffer internally, depending on \p flush. For
+       decompression \p flush is ignored.
+
+       @return false if the stream is corrupt or was not initialised.
+      */
+    bool Process(
+      const void * data,
+      PINDEX length,
+      PBYTEArray & output,
+      Flush flush = e_NoFlush
+    );
+
+    /**Indicate the end of the compressed stream was reached.
+      */
+    bool IsFinished() const { return m_finished; }
+
+    /**Compress a block of memory in one go.
+      */
+    static bool Compress(
+      const void * data,
+      PINDEX length,
+      PBYTEArray & output,
+      Format format = e_GZip,
+      int level = -1
+    );
+
+    /**Decompress a block of memory in one go.
+      */
+    static bool Decompress(
+      const void * data,
+      PINDEX length,
+      PBYTEArray & output,
+      Format format = e_AutoDetect
+    );
+
+    /**Get the format for a HTTP content encoding name.
+       @return false if the name is not a supported encoding.
+      */
+    static bool GetFormat(
+      const PCaselessString & encoding,
+      Format & format
+    );
+
+    /**Get the HTTP content encoding name for the format.
+      */
+    static const char * GetEncoding(
+      Format format
+    );
+
+  protected:
+    bool Initialise(bool raw);
+
+    struct Stream;
+    Stream  * m_stream;
+    Direction m_direction;
+    Format    m_format;
+    int       m_level;
+    bool      m_initialised;
+    bool      m_started;
+    bool      m_finished;
+
+  private:
+    PZLib(const PZLib &) { }
+    void operator=(const PZLib &) { }
+};
+
+
+#endif // P_ZLIB
+
+#endif  // PTLIB_PZLIB_H
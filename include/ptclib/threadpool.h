@@ -40,6 +40,7 @@
 #include <ptlib/safecoll.h>
 #include <map>
 #include <queue>
+#include <deque>
 
 
 #define PThreadPoolTraceModule "ThreadPool"
@@ -197,6 +198,9 @@ class PThreadPoolBase : public PObject
       unsigned count
     ) { m_maxWorkUnitCount = count; }
 
+    /// Get the total work units queued or executing across all workers.
+    unsigned GetWorkSize() const;
+
   protected:
     PThreadPoolBase(
       unsigned maxWorkerCount,
@@ -565,6 +569,199 @@ class PQueuedThreadPool : public PThreadPool<Work_T>
 };
 
 
+/** High Level (queued work item) thread pool with work stealing.
+    This has the same interface as PQueuedThreadPool, but work that is added
+    without a group may be executed by any idle worker thread, rather than
+    waiting behind a long job on the thread it was originally queued to.
+
+    Work with a group is handled exactly as for PQueuedThreadPool, it is never
+    stolen, so all work for a group is still executed in order on one thread.
+
+    Stealing may be switched off with SetWorkStealing(), the pool then behaves
+    as a PQueuedThreadPool. The library's own pools, e.g. in PTimer::List and
+    PHTTPListener, are of this type but start with stealing off, it is never
+    enabled implicitly.
+  */
+template <class Work_T>
+class PWorkStealingThreadPool : public PQueuedThreadPool<Work_T>
+{
+    typedef PQueuedThreadPool<Work_T> BaseClass;
+  public:
+    //
+    //  constructor
+    //
+    PWorkStealingThreadPool(
+      unsigned maxWorkers = std::max(PThread::GetNumProcessors(), 10U),
+      unsigned maxWorkUnits = 0,
+      const char * threadName = NULL,
+      PThread::Priority priority = PThread::NormalPriority,
+      const PTimeInterval & workerIncreaseLatency = PMaxTimeInterval,
+      unsigned workerIncreaseLimit = 0,
+      bool workStealing = true
+    ) : BaseClass(maxWorkers, maxWorkUnits, threadName, priority, workerIncreaseLatency, workerIncreaseLimit)
+      , m_workStealing(workStealing)
+    {
+    }
+
+    /// Get flag for idle workers taking ungrouped work from busy ones.
+    bool GetWorkStealing() const { return m_workStealing; }
+
+    /// Set flag for idle workers taking ungrouped work from busy ones.
+    void SetWorkStealing(bool enable) { m_workStealing = enable; }
+
+    class StealingWorkerThread : public BaseClass::QueuedWorkerThread
+    {
+      public:
+        typedef typename BaseClass::QueuedWorkerThread::QueuedWork QueuedWork;
+        typedef std::deque<QueuedWork> WorkQueue;
+
+        StealingWorkerThread(PWorkStealingThreadPool & pool,
+                             PThread::Priority priority = PThread::NormalPriority,
+                             const char * threadName = NULL)
+          : BaseClass::QueuedWorkerThread(pool, priority, threadName)
+          , m_available(0, INT_MAX)
+        {
+        }
+
+        ~StealingWorkerThread()
+        {
+          this->WaitForTermination();
+
+          for (typename WorkQueue::iterator it = m_groupedQueue.begin(); it != m_groupedQueue.end(); ++it)
+            delete it->m_work;
+          for (typename WorkQueue::iterator it = m_stealableQueue.begin(); it != m_stealableQueue.end(); ++it)
+            delete it->m_work;
+        }
+
+        void AddWork(Work_T * work, const string & group)
+        {
+          if (PAssertNULL(work) == NULL)
+            return;
+
+          m_queueMutex.Wait();
+          (group.empty() ? m_stealableQueue : m_groupedQueue).push_back(QueuedWork(work, group));
+          m_queueMutex.Signal();
+
+          m_available.Signal();
+        }
+
+        unsigned GetWorkSize() const
+        {
+          PWaitAndSignal lock(m_queueMutex);
+          unsigned work = m_groupedQueue.size() + m_stealableQueue.size();
+          if (this->m_working)
+            ++work;
+          return work;
+        }
+
+        virtual bool Work()
+        {
+          PWorkStealingThreadPool & pool = dynamic_cast<PWorkStealingThreadPool &>(this->m_pool);
+
+          QueuedWork item;
+          while (!DequeueWork(item) && !pool.StealWork(*this, item)) {
+            if (this->m_shutdown)
+              return false;
+            m_available.Wait();
+          }
+
+          if (this->m_shutdown) {
+            delete item.m_work;
+            return false;
+          }
+
+          this->m_working = true;
+
+          PTimeInterval latency = item.m_time.GetElapsed();
+
+          item.m_work->Work();
+
+          if (!pool.RemoveWork(item.m_work))
+            this->RemoveWork(item.m_work);
+
+          this->m_working = false;
+
+          if (latency > pool.m_workerIncreaseLatency)
+            pool.OnMaxWaitTime(*this, latency, item.m_group);
+          return true;
+        }
+
+        void Shutdown()
+        {
+          this->m_shutdown = true;
+          m_available.Signal();
+        }
+
+        /// Take the newest ungrouped work, if any, on behalf of another worker.
+        bool StealWork(QueuedWork & item)
+        {
+          PWaitAndSignal lock(m_queueMutex);
+          if (m_stealableQueue.empty())
+            return false;
+          item = m_stealableQueue.back();
+          m_stealableQueue.pop_back();
+          return true;
+        }
+
+      protected:
+        bool DequeueWork(QueuedWork & item)
+        {
+          PWaitAndSignal lock(m_queueMutex);
+
+          WorkQueue * queue;
+          if (m_groupedQueue.empty()) {
+            if (m_stealableQueue.empty())
+              return false;
+            queue = &m_stealableQueue;
+          }
+          else if (m_stealableQueue.empty() || m_groupedQueue.front().m_time <= m_stealableQueue.front().m_time)
+            queue = &m_groupedQueue;
+          else
+            queue = &m_stealableQueue;
+
+          item = queue->front();
+          queue->pop_front();
+          return true;
+        }
+
+        WorkQueue      m_groupedQueue;   // Only ever executed by this thread
+        WorkQueue      m_stealableQueue; // May be taken by any idle worker
+        PDECLARE_MUTEX(m_queueMutex);
+        PSemaphore     m_available;
+    };
+
+  protected:
+    /* Work is still added via PThreadPool::AddWork(), so it is in the work map
+       against the worker it was queued to, whoever eventually executes it. An
+       idle worker is always chosen by AllocateWorker() if there is one, so work
+       only waits on a busy worker until another finishes and steals it. */
+    bool StealWork(StealingWorkerThread & thief, typename StealingWorkerThread::QueuedWork & item)
+    {
+      if (!m_workStealing)
+        return false;
+
+      PWaitAndSignal m(this->m_mutex);
+
+      for (PThreadPoolBase::WorkerList_t::iterator it = this->m_workers.begin(); it != this->m_workers.end(); ++it) {
+        StealingWorkerThread * victim = static_cast<StealingWorkerThread *>(*it);
+        if (victim != &thief && victim->StealWork(item)) {
+          PTRACE(6, PThreadPoolTraceModule, "Worker \"" << thief << "\" stole work from \"" << *victim << '"');
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    virtual PThreadPoolBase::WorkerThreadBase * CreateWorkerThread()
+    {
+      return new StealingWorkerThread(*this, this->m_priority, this->m_threadName);
+    }
+
+    atomic<bool> m_workStealing;
+};
+
+
 /**A PThreadPool work item template that uses PSafePtr to execute callback
    function.
   */
@@ -590,6 +787,9 @@ class PSafeWork : public PSafePtrBase {
 /// The thread pool for PSafeWork items.
 typedef PQueuedThreadPool<PSafeWork> PSafeThreadPool;
 
+/// The work stealing thread pool for PSafeWork items.
+typedef PWorkStealingThreadPool<PSafeWork> PSafeWorkStealingThreadPool;
+
 
 /// A PSafeWork thread pool item where call back has no arguments.
 template <class PtrClass, typename FuncRet = void>
@@ -194,6 +194,13 @@ class PURL : public PObject
       const PString & str,    ///< String to be translated.
       TranslationType type    ///< Type of translation.
     );
+    static PString UntranslateString(
+      const PStringView & str, ///< String to be translated.
+      TranslationType type     ///< Type of translation.
+    );
+    // Avoid ambiguity between the PString and PStringView overloads
+    static PString UntranslateString(const char * str, TranslationType type) { return UntranslateString(PStringView(str), type); }
+    static PString UntranslateString(const std::string & str, TranslationType type) { return UntranslateString(PStringView(str), type); }
 
     /** Split a string to a dictionary of names and values. */
     static void SplitVars(
@@ -203,12 +210,31 @@ class PURL : public PObject
       char sep2 = '=',        ///< Separater between key and value
       TranslationType type = ParameterTranslation ///< Type of translation.
     );
+    static void SplitVars(
+      const PStringView & str, ///< String to split into variables.
+      PStringToString & vars,  ///< Dictionary of variable names and values.
+      char sep1 = ';',         ///< Separater between pairs
+      char sep2 = '=',         ///< Separater between key and value
+      TranslationType type = ParameterTranslation ///< Type of translation.
+    );
+    static void SplitVars(const char * str, PStringToString & vars, char sep1 = ';', char sep2 = '=', TranslationType type = ParameterTranslation)
+      { SplitVars(PStringView(str), vars, sep1, sep2, type); }
+    static void SplitVars(const std::string & str, PStringToString & vars, char sep1 = ';', char sep2 = '=', TranslationType type = ParameterTranslation)
+      { SplitVars(PStringView(str), vars, sep1, sep2, type); }
 
     /** Split a string in &= form to a dictionary of names and values. */
     static void SplitQueryVars(
       const PString & queryStr,   ///< String to split into variables.
       PStringToString & queryVars ///< Dictionary of variable names and values.
+    ) { SplitVars(PStringView(queryStr), queryVars, '&', '=', QueryTranslation); }
+    static void SplitQueryVars(
+      const PStringView & queryStr, ///< String to split into variables.
+      PStringToString & queryVars   ///< Dictionary of variable names and values.
     ) { SplitVars(queryStr, queryVars, '&', '=', QueryTranslation); }
+    static void SplitQueryVars(const char * queryStr, PStringToString & queryVars)
+      { SplitQueryVars(PStringView(queryStr), queryVars); }
+    static void SplitQueryVars(const std::string & queryStr, PStringToString & queryVars)
+      { SplitQueryVars(PStringView(queryStr), queryVars); }
 
     /** Construct string from a dictionary using separators.
       */
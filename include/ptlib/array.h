@@ -237,7 +237,8 @@ class PAbstractArray : public PContainer
 
     PAbstractArray(
       PContainerReference & reference,
-      PINDEX elementSizeInBytes
+      PINDEX elementSizeInBytes,
+      void * buffer = NULL
     );
 
     /// Size of an element in bytes.
@@ -453,7 +454,7 @@ template <class T> class PBaseArray : public PAbstractArray
       stream << GetAt(index);
     }
 
-    PBaseArray(PContainerReference & reference_) : PAbstractArray(reference_, sizeof(T)) { }
+    PBaseArray(PContainerReference & reference_, T * buffer = NULL) : PAbstractArray(reference_, sizeof(T), buffer) { }
 };
 
 /**Declare a dynamic array base type.
@@ -576,8 +577,8 @@ class PCharArray : public PBaseArray<char>
       PBoolean dynamic = true ///< Buffer is copied and dynamically allocated.
     ) : ParentClass(buffer, length, dynamic) { }
 
-    PCharArray(PContainerReference & reference_)
-      : ParentClass(reference_) { }
+    PCharArray(PContainerReference & reference_, char * buffer = NULL)
+      : ParentClass(reference_, buffer) { }
   //@}
 
   /**@name Overrides from class PObject */
@@ -85,16 +85,24 @@ private:
 #endif
 };
 
+/* A load via an add of zero is a locked read/modify/write, so concurrent
+   readers contend for the cache line. Use a plain atomic load if we can. */
+#if defined(__ATOMIC_SEQ_CST)
+  #define P_ATOMIC_LOAD(AddFetch, storage) __atomic_load_n(storage, __ATOMIC_SEQ_CST)
+#else
+  #define P_ATOMIC_LOAD(AddFetch, storage) AddFetch(storage, 0)
+#endif
+
 #define P_DEFINE_ATOMIC_FUNCTIONS(Type,Exch,FetchAdd,AddFetch,CompExch) \
     __inline atomic() : m_storage() { } \
     __inline atomic(Type value) : m_storage(value) { } \
-    __inline atomic(const atomic & other) : m_storage((Type)AddFetch(const_cast<Type *>(&other.m_storage), 0)) { } \
+    __inline atomic(const atomic & other) : m_storage((Type)P_ATOMIC_LOAD(AddFetch, const_cast<Type *>(&other.m_storage))) { } \
     __inline atomic & operator=(const atomic & other) { store(other.load()); return *this; } \
     __inline atomic & operator=(Type other) { store(other); return *this; } \
-    __inline operator Type() const { return (Type)AddFetch(const_cast<Type *>(&m_storage), 0); } \
+    __inline operator Type() const { return (Type)P_ATOMIC_LOAD(AddFetch, const_cast<Type *>(&m_storage)); } \
     __inline bool compare_exchange_strong(Type & comp, Type value) { return CompExch(&m_storage, comp, value); } \
     __inline void store(Type value) { exchange(value); } \
-    __inline Type load() const { return (Type)AddFetch(const_cast<Type *>(&m_storage), 0); } \
+    __inline Type load() const { return (Type)P_ATOMIC_LOAD(AddFetch, const_cast<Type *>(&m_storage)); } \
     __inline Type exchange(Type value) { return (Type)Exch(&m_storage, value); } \
     __inline Type operator++()         { return (Type)AddFetch(&m_storage,  1); } \
     __inline Type operator++(int)      { return (Type)FetchAdd(&m_storage,  1); } \
@@ -179,13 +187,13 @@ private:
   {
     __inline atomic() : m_storage() { }
     __inline atomic(bool value) : m_storage(value) { }
-    __inline atomic(const atomic & other) : m_storage(__sync_add_and_fetch(reinterpret_cast<char *>(const_cast<bool *>(&other.m_storage)), 0)) { }
+    __inline atomic(const atomic & other) : m_storage(P_ATOMIC_LOAD(__sync_add_and_fetch, reinterpret_cast<char *>(const_cast<bool *>(&other.m_storage))) != 0) { }
     __inline atomic & operator=(const atomic & other) { store(other.load()); return *this; }
     __inline atomic & operator=(bool other) { store(other); return *this; }
-    __inline operator bool() const { return __sync_add_and_fetch(reinterpret_cast<char *>(const_cast<bool *>(&m_storage)), 0) != 0; }
+    __inline operator bool() const { return P_ATOMIC_LOAD(__sync_add_and_fetch, reinterpret_cast<char *>(const_cast<bool *>(&m_storage))) != 0; }
     __inline bool compare_exchange_strong(bool & comp, bool value) { return p_compare_exchange_strong(&m_storage, comp, value); }
     __inline void store(bool value) { exchange(value); }
-    __inline bool load() const { return __sync_add_and_fetch(reinterpret_cast<char *>(const_cast<bool *>(&m_storage)), 0) != 0; }
+    __inline bool load() const { return P_ATOMIC_LOAD(__sync_add_and_fetch, reinterpret_cast<char *>(const_cast<bool *>(&m_storage))) != 0; }
     __inline bool exchange(bool value) { return __sync_lock_test_and_set(&m_storage, value) != 0; }
   private: volatile bool m_storage;
   };
@@ -0,0 +1,76 @@
+/*
+ * cpufeatures.h
+ *
+ * Run time detection of CPU instruction set extensions.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef PTLIB_CPUFEATURES_H
+#define PTLIB_CPUFEATURES_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+
+/* P_CPU_FEATURES_X86 is 1 when the compiler can build individual functions
+   for x86 extensions beyond the baseline architecture, with P_TARGET_SSE2,
+   P_TARGET_SSSE3 and P_TARGET_AVX2 as the function attribute to do so. Such
+   functions must only be called if PCPUFeatures says the CPU has them. */
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && \
+    (defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+  #define P_CPU_FEATURES_X86 1
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #define P_TARGET_SSE2
+    #define P_TARGET_SSSE3
+    #define P_TARGET_AVX2
+  #else
+    #define P_TARGET_SSE2  __attribute__((target("sse2")))
+    #define P_TARGET_SSSE3 __attribute__((target("ssse3")))
+    #define P_TARGET_AVX2  __attribute__((target("avx2")))
+  #endif
+#else
+  #define P_CPU_FEATURES_X86 0
+#endif
+
+
+/**Instruction set extensions supported by the CPU, and the operating system,
+   for selecting accelerated code paths at run time.
+  */
+class PCPUFeatures
+{
+  public:
+    enum Features {
+      SSE2  = 1,
+      SSSE3 = 2,
+      AVX2  = 4   ///< Only if the OS also saves the YMM registers
+    };
+
+    /// Get the bit mask of Features, detected on first call.
+    static unsigned Get();
+
+    /// Indicate the CPU has all of the features in the bit mask.
+    static bool Has(unsigned features) { return (Get() & features) == features; }
+};
+
+
+#endif // PTLIB_CPUFEATURES_H
+
+
+// End Of File ///////////////////////////////////////////////////////////////
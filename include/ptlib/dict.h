@@ -88,15 +88,11 @@ class PKey : public PObject
        of <code>PSet</code> and <code>PDictionary</code> classes.
 
        @return
-       hash table bucket number.
+       hash value, the key itself.
      */
     virtual PINDEX HashFunction() const
     {
-#if PINDEX_SIGNED
-      return std::abs((PINDEX)this->m_key)%23;
-#else
-      return ((PINDEX)this->m_key)%23;
-#endif
+      return (PINDEX)this->m_key;
     }
 
     /**Output the ordinal index to the specified stream. This is identical to
@@ -151,61 +147,71 @@ typedef PKey<PINDEX> POrdinalKey;
 // Member variables
 struct PHashTableElement
 {
-    PObject           * m_key;
-    PObject           * m_data;
-    PHashTableElement * m_next;
-    PHashTableElement * m_prev;
-    PINDEX              m_bucket;
-
-    PDECLARE_POOL_ALLOCATOR(PHashTableElement);
-};
-
-P_PUSH_MSVC_WARNINGS(26495)
-struct PHashTableList
-{
-  PHashTableList()
-    : m_head(NULL)
-    , m_tail(NULL)
-#if PTRACING
-    , m_size(0)
-#endif
-  { }
-  PHashTableElement * m_head;
-  PHashTableElement * m_tail;
-#if PTRACING
-  PINDEX              m_size;
-#endif
+    PObject * m_key;    // NULL if element has been removed
+    PObject * m_data;
+    uint32_t  m_hash;   // Mixed value of m_key->HashFunction()
 };
-P_POP_MSVC_WARNINGS()
-__inline std::ostream & operator<<(std::ostream & strm, const PHashTableList & hash) { return strm << (void *)hash.m_head; }
 
 class PHashTable;
 
 
-class PHashTableInfo : public PBaseArray<PHashTableList>
+/**Storage for the <code>PHashTable</code> class.
+   The elements are kept in a contiguous array in the order they were added,
+   and are located via an open addressing index using Robin Hood linear
+   probing. Each index slot holds the full hash value, so a lookup rarely
+   needs to compare a key that does not match. The index is grown
+   automatically to keep the load factor below 75%.
+
+   A removed element leaves a hole in the element array, so the positions
+   used by iterators remain valid over a removal. Holes are squeezed out when
+   the index is next rebuilt, which only happens on adding an element.
+ */
+class PHashTableInfo
 {
-    typedef PBaseArray<PHashTableList> ParentClass;
-    PCLASSINFO(PCharArray, ParentClass);
   public:
-    PHashTableInfo(PINDEX initialSize = 0)
-      : ParentClass(initialSize), deleteKeys(true) { }
-    PHashTableInfo(PHashTableList const * buffer, PINDEX length, PBoolean dynamic = true)
-      : ParentClass(buffer, length, dynamic), deleteKeys(true) { }
-    virtual PObject * Clone() const { return PNEW PHashTableInfo(*this, GetSize()); }
-    virtual ~PHashTableInfo() { Destruct(); }
-    virtual void DestroyContents();
+    PHashTableInfo();
+    ~PHashTableInfo() { DestroyContents(); }
+    void DestroyContents();
 
     void AppendElement(PObject * key, PObject * data PTRACE_PARAM(, PHashTable * owner));
     PObject * RemoveElement(const PObject & key);
     PHashTableElement * GetElementAt(PINDEX index);
     PHashTableElement * GetElementAt(const PObject & key);
     PINDEX GetElementsIndex(const PObject*obj,PBoolean byVal,PBoolean keys) const;
-    PHashTableElement * NextElement(PHashTableElement * element) const;
-    PHashTableElement * PrevElement(PHashTableElement * element) const;
+
+    // Positions are used by iterators, P_MAX_INDEX is the end
+    PINDEX GetFirstPosition() const { return GetNextPosition(P_MAX_INDEX); }
+    PINDEX GetNextPosition(PINDEX position) const;
+    PINDEX GetPrevPosition(PINDEX position) const;
+    PINDEX GetPosition(const PObject & key) const;
+    PHashTableElement & GetElementAtPosition(PINDEX position) { return m_elements[position]; }
 
     bool deleteKeys;
+    bool deleteObjects;
+
+  protected:
+    struct Slot {
+      uint32_t m_position;  // One based index into m_elements, zero is empty slot
+      uint32_t m_hash;
+    };
+
+    static uint32_t MixHash(PINDEX hash);
+    PINDEX GetDistance(PINDEX slot) const { return (slot - m_slots[slot].m_hash) & m_mask; }
+    PINDEX FindSlot(const PObject & key, uint32_t hash) const;
+    PINDEX InsertSlot(uint32_t position, uint32_t hash);
+    void Rebuild(PINDEX slotCount);
+
+    std::vector<PHashTableElement> m_elements;
+    std::vector<Slot>              m_slots;
+    PINDEX                         m_mask;
+    PINDEX                         m_count;
+
     PTRACE_THROTTLE(m_throttlePoorHashFunction, 1);
 
+  private:
+    PHashTableInfo(const PHashTableInfo &);
+    void operator=(const PHashTableInfo &);
+
   friend class PHashTable;
   friend class PAbstractSet;
 };
@@ -215,11 +221,16 @@ class PHashTableInfo : public PBaseArray<PHashTableList>
    <code>PDictionary</code> classes.
 
    The hash table allows for very fast searches for an object based on a "hash
-   function". This function yields an index into an array which is directly
-   looked up to locate the object. When two key values have the same hash
-   function value, then a linear search of a linked list is made to locate
-   the object. Thus the efficiency of the hash table is highly dependent on the
-   quality of the hash function for the data being used as keys.
+   function". This function yields a value which is used to locate a slot in
+   an index array, from which the object is directly looked up. When two key
+   values land on the same slot, adjacent slots are searched to locate the
+   object. Thus the efficiency of the hash table is highly dependent on the
+   quality of the hash function for the data being used as keys. The full
+   range of PINDEX may be returned by <code>PObject::HashFunction()</code>,
+   there is no need to reduce the value to a small number of buckets.
+
+   Iteration order is the order in which elements were added. Adding an
+   element may invalidate iterators, removing one does not.
  */
 class PHashTable : public PCollection
 {
@@ -341,6 +352,17 @@ class PAbstractSet : public PHashTable
     PINLINE PAbstractSet();
   //@}
 
+  /**@name Overrides from class PObject */
+  //@{
+    /**Output the contents of the object to the stream, as for
+       PCollection::PrintOn() but going through the hash table in order,
+       rather than looking up every element by its index.
+     */
+    virtual void PrintOn(
+      ostream &strm   ///< Stream to print the object into.
+    ) const;
+  //@}
+
   /**@name Overrides from class PCollection */
   //@{
     /**Add a new object to the collection. If the objects value is already in
@@ -631,28 +653,29 @@ template <class T> class PSet : public PAbstractSet
       protected:
         iterator_base()
           : table(NULL)
-          , element(NULL)
+          , position(P_MAX_INDEX)
           { }
         iterator_base(PHashTableInfo * t)
           : table(t)
-          , element(t->GetElementAt((PINDEX)0))
+          , position(t->GetFirstPosition())
           { }
         iterator_base(PHashTableInfo * t, const T & k)
           : table(t)
-          , element(t->GetElementAt(k))
+          , position(t->GetPosition(k))
           { }
 
-        PHashTableInfo    * table;
-        PHashTableElement * element;
+        PHashTableInfo * table;
+        PINDEX           position;
 
-        void Next() { if (PAssertNULL(this->table)) this->element = this->table->NextElement(this->element); }
-        void Prev() { if (PAssertNULL(this->table)) this->element = this->table->PrevElement(this->element); }
+        void Next() { if (PAssertNULL(this->table)) this->position = this->table->GetNextPosition(this->position); }
+        void Prev() { if (PAssertNULL(this->table)) this->position = this->table->GetPrevPosition(this->position); }
 
-        T * Ptr() const { return PAssertNULL(this->element) ? dynamic_cast<T *>(this->element->m_key) : NULL; }
+        T * Ptr() const { return PAssert(this->position != P_MAX_INDEX, PInvalidArrayIndex)
+                                    ? dynamic_cast<T *>(this->table->GetElementAtPosition(this->position).m_key) : NULL; }
 
       public:
-        bool operator==(const iterator_base & it) const { return this->element == it.element; }
-        bool operator!=(const iterator_base & it) const { return this->element != it.element; }
+        bool operator==(const iterator_base & it) const { return this->position == it.position; }
+        bool operator!=(const iterator_base & it) const { return this->position != it.position; }
     };
 
     class iterator : public iterator_base  {
@@ -1131,35 +1154,36 @@ template <class K, class D> class PDictionary : public PAbstractDictionary
         K * m_internal_first;  // Must be first two members
         D * m_internal_second;
 
-        PHashTableInfo    * m_table;
-        PHashTableElement * m_element;
+        PHashTableInfo * m_table;
+        PINDEX           m_position;
 
         iterator_base()
           : m_internal_first(NULL)
           , m_internal_second(NULL)
           , m_table(NULL)
-          , m_element(NULL)
+          , m_position(P_MAX_INDEX)
         {
         }
 
         iterator_base(const dict_type * dict)
           : m_table(dict->hashTable)
         {
-          this->SetElement(this->m_table->GetElementAt((PINDEX)0));
+          this->SetPosition(this->m_table->GetFirstPosition());
         }
         
         iterator_base(const dict_type * dict, const K & key)
           : m_table(dict->hashTable)
         {
-          this->SetElement(this->m_table->GetElementAt(key));
+          this->SetPosition(this->m_table->GetPosition(key));
         }
 
-        void SetElement(PHashTableElement * element)
+        void SetPosition(PINDEX position)
         {
-          this->m_element = element;
-          if (element != NULL) {
-            this->m_internal_first  = dynamic_cast<K *>(element->m_key);
-            this->m_internal_second = dynamic_cast<D *>(element->m_data);
+          this->m_position = position;
+          if (position != P_MAX_INDEX) {
+            PHashTableElement & element = this->m_table->GetElementAtPosition(position);
+            this->m_internal_first  = dynamic_cast<K *>(element.m_key);
+            this->m_internal_second = dynamic_cast<D *>(element.m_data);
           }
           else {
             this->m_internal_first = NULL;
@@ -1168,13 +1192,13 @@ template <class K, class D> class PDictionary : public PAbstractDictionary
         }
 
         P_PUSH_MSVC_WARNINGS(6011)
-        void Next() { this->SetElement(PAssertNULL(this->m_table)->NextElement(this->m_element)); }
-        void Prev() { this->SetElement(PAssertNULL(this->m_table)->PrevElement(this->m_element)); }
+        void Next() { this->SetPosition(PAssertNULL(this->m_table)->GetNextPosition(this->m_position)); }
+        void Prev() { this->SetPosition(PAssertNULL(this->m_table)->GetPrevPosition(this->m_position)); }
         P_POP_MSVC_WARNINGS()
 
       public:
-        bool operator==(const iterator_base & it) const { return this->m_element == it.m_element; }
-        bool operator!=(const iterator_base & it) const { return this->m_element != it.m_element; }
+        bool operator==(const iterator_base & it) const { return this->m_position == it.m_position; }
+        bool operator!=(const iterator_base & it) const { return this->m_position != it.m_position; }
     };
 
     template<class CK, class CD>
@@ -1237,8 +1261,8 @@ template <class K, class D> class PDictionary : public PAbstractDictionary
     const_iterator end()   const { return const_iterator(); }
     const_iterator find(const K & k) const { return const_iterator(this, k); }
 
-    void erase(const       iterator & it) { this->AbstractSetAt(*it.m_element->m_key, NULL); }
-    void erase(const const_iterator & it) { this->AbstractSetAt(*it.m_element->m_key, NULL); }
+    void erase(const       iterator & it) { this->AbstractSetAt(*PAssertNULL(it.m_internal_first), NULL); }
+    void erase(const const_iterator & it) { this->AbstractSetAt(*PAssertNULL(it.m_internal_first), NULL); }
   //@}
 
   protected:
@@ -533,6 +533,27 @@ class PFile : public PChannel
        true if at end of file.
      */
     bool IsEndOfFile() const;
+
+    /**Map a region of the file into memory for read only access. This
+       allows the contents to be passed to another channel without copying
+       them into a user space buffer first. The file must be open. The
+       region should be released via <code>UnmapView()</code>.
+
+       @return
+       pointer to the mapped region, or NULL if could not be mapped, e.g.
+       the platform does not support memory mapped files.
+     */
+    const void * MapView(
+      off_t offset,   ///< Offset into file of start of region
+      size_t length   ///< Length of region
+    );
+
+    /**Release a region of memory returned by <code>MapView()</code>.
+     */
+    static void UnmapView(
+      const void * view,  ///< Pointer returned by <code>MapView()</code>
+      size_t length       ///< Length passed to <code>MapView()</code>
+    );
       
     /**Get information (eg protection, timestamps) on the specified file.
 
@@ -106,6 +106,65 @@ class PIPDatagramSocket : public PIPSocket
       const PIPSocketAddressAndPort & ipAndPort
     );
 
+    /**Information on a single datagram for <code>ReadFromMulti()</code> and
+       <code>WriteToMulti()</code>.
+     */
+    struct Datagram
+    {
+      Datagram(
+        Slice * slices = NULL,
+        size_t sliceCount = 0
+      ) : m_slices(slices)
+        , m_sliceCount(sliceCount)
+        , m_length(0)
+        , m_truncated(false)
+      { }
+
+      Slice                 * m_slices;     ///< Memory for datagram data
+      size_t                  m_sliceCount; ///< Number of entries in m_slices
+      PIPSocketAddressAndPort m_ipAndPort;  ///< Address datagram was received from, or is sent to
+      PINDEX                  m_length;     ///< Number of bytes actually read or written
+      bool                    m_truncated;  ///< Datagram received was too large for slices
+    };
+
+    /**Read multiple datagrams from remote computers.
+       This will wait for the read timeout for the first datagram, then
+       return as many further datagrams as are immediately available, up to
+       <code>count</code>. On platforms with recvmmsg() this is a single
+       system call, otherwise datagrams are read one at a time.
+
+       Descendants that override InternalReadFrom() to change the data, e.g.
+       for encapsulation, must also override this, usually to call
+       InternalReadFromEach().
+
+       The <code>GetLastReadCount()</code> function returns the total bytes
+       read over all datagrams.
+
+       @return number of datagrams read, zero if timeout or error.
+     */
+    virtual PINDEX ReadFromMulti(
+      Datagram * datagrams, ///< Array of datagrams to read into.
+      PINDEX count          ///< Number of entries in <code>datagrams</code>.
+    );
+
+    /**Write multiple datagrams to remote computers.
+       On platforms with sendmmsg() this is a single system call, otherwise
+       datagrams are written one at a time.
+
+       Descendants that override InternalWriteTo() must also override this,
+       usually to call InternalWriteToEach().
+
+       The <code>GetLastWriteCount()</code> function returns the total bytes
+       written over all datagrams.
+
+       @return number of datagrams written, less than <code>count</code> if
+               an error occurred.
+     */
+    virtual PINDEX WriteToMulti(
+      Datagram * datagrams, ///< Array of datagrams to write, m_length is set.
+      PINDEX count          ///< Number of entries in <code>datagrams</code>.
+    );
+
 
 // Include platform dependent part of class
 #ifdef _WIN32
@@ -129,6 +188,10 @@ class PIPDatagramSocket : public PIPSocket
       size_t sliceCount, 
       const PIPSocketAddressAndPort & ipAndPort
     );
+
+    // ReadFromMulti()/WriteToMulti() via the individual InternalReadFrom()/InternalWriteTo()
+    PINDEX InternalReadFromEach(Datagram * datagrams, PINDEX count);
+    PINDEX InternalWriteToEach(Datagram * datagrams, PINDEX count);
 };
 
 
@@ -45,6 +45,8 @@ class PMutexExcessiveLockInfo
     unsigned       m_excessiveLockTimeout;
     mutable atomic<bool> m_excessiveLockActive;
     uint64_t       m_startHeldSamplePoint;
+    atomic<PProfiling::LockStatistics *> m_lockStatistics;
+    bool           m_lockProfiling;
 
     PMutexExcessiveLockInfo();
     PMutexExcessiveLockInfo(
@@ -69,11 +71,18 @@ class PMutexExcessiveLockInfo
     void ExcessiveLockPhantom(const PObject & mutex) const;
     virtual void AcquiredLock(uint64_t startWaitCycle, bool readOnly, const PDebugLocation & location);
     virtual void ReleasedLock(const PObject & mutex, uint64_t startHeldSamplePoint, bool readOnly, const PDebugLocation & location);
+    PProfiling::LockStatistics * GetLockStatistics();
 
     static unsigned MinDeadlockTime(unsigned waitTime);
 
   public:
     void SetLocationName(const char * name) { m_location.m_extra = name; }
+
+    /**Include this mutex in the lock contention profile, default true.
+       Used for mutexes internal to other synchronisation objects, which
+       share the definition site of their owner.
+      */
+    void SetLockProfiling(bool enable) { m_lockProfiling = enable; }
 };
 
 
@@ -144,6 +153,15 @@ class PTimedMutex : public PSync, public PMutexExcessiveLockInfo, PProfiling::Hi
      */
     virtual void Signal();
 
+    /**As for Wait(), but the location is recorded as the waiting call site,
+       for deadlock detection and lock contention profiling.
+      */
+    virtual bool InstrumentedWait(const PTimeInterval & timeout, const PDebugLocation & location);
+
+    /**As for Signal(), with the call site location.
+      */
+    virtual void InstrumentedSignal(const PDebugLocation & location) { PlatformSignal(&location); }
+
     /** Try to enter the critical section for exlusive access. Does not wait.
         @return true if cirical section entered, leave/Signal must be called.
       */
@@ -234,9 +252,6 @@ typedef PTimedMutex PMutex;
       void SetHeldThresholdPercent(unsigned thresholdPercent) { m_timeHeldContext.SetThresholdPercent(thresholdPercent); }
       void SetHeldMaxHistory(unsigned maxHistory) { m_timeHeldContext.SetMaxHistory(maxHistory); }
 
-      virtual bool InstrumentedWait(const PTimeInterval & timeout, const PDebugLocation & location);
-      virtual void InstrumentedSignal(const PDebugLocation & location) { PlatformSignal(&location); }
-
     protected:
       virtual void AcquiredLock(uint64_t startWaitCycle, bool readOnly, const PDebugLocation & location);
       virtual void ReleasedLock(const PObject & mutex, uint64_t startHeldSamplePoint, bool readOnly, const PDebugLocation & location);
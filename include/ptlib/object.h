@@ -161,6 +161,17 @@ using namespace std; // Not a good practice (name space polution), but will take
   #define PIGNORE_RETURN(t,e)	do { t unused __attribute__((unused)) = (e); } while(0)
 #endif
 
+/* Declare a static variable with a separate instance in each thread. Pre
+   C++11 compiler extensions cannot construct or destroy the variable, so it
+   must be a simple type that is initialised to zero. */
+#if __cplusplus >= 201103L
+  #define P_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+  #define P_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+  #define P_THREAD_LOCAL __thread
+#endif
+
 // We are gradually converting over to standard C++ names, these
 // are for backward compatibility only
 
@@ -531,6 +542,10 @@ public:
                                        application. Setting this flag will automatically
                                        execute <code>#SetStream(new PSystemLog)</code>. */
     OutputJSON         = 0x10000,   ///< Output log in JSON format
+    AsynchronousOutput = 0x10000000,/**< Output is queued in per-thread buffers and written by a
+                                         background thread, see SetAsyncBufferSize() */
+    BinaryFormat       = 0x20000000,/**< Output compact binary records instead of text, use
+                                         DecodeBinary() or the tracedecode tool to read them */
     HasFilePermissions = 0x8000000, ///< Flag indicating file permissions are to be set
     FilePermissionMask = 0x7ff0000, /**< Mask for setting standard file permission mask as used in
                                          open() or creat() system function calls. */
@@ -555,6 +570,8 @@ public:
     "  hour     rotate output file hourly\r" \
     "  minute   rotate output file every minute\r" \
     "  append   append to output file, otherwise overwrites\r" \
+    "  async    output via background writer thread\r" \
+    "  binary   binary output, use tracedecode to read\r" \
     "  <perm>   file permission similar to unix chmod, but starts\r" \
     "           with +/- and only has one combination at a time,\r" \
     "           e.g. +uw is user write, +or is other read, etc"
@@ -663,6 +680,39 @@ public:
     */
   static PINDEX GetMaxLength();
 
+  /**Set the size of the per-thread buffer used when the AsynchronousOutput
+     option is set. Only affects threads that have not yet output a trace.
+     Default is 64k
+    */
+  static void SetAsyncBufferSize(
+    PINDEX size   ///< Size of buffer in bytes
+  );
+
+  /**Get the size of the per-thread buffer used for AsynchronousOutput.
+    */
+  static PINDEX GetAsyncBufferSize();
+
+  /**Get the number of trace records discarded because a threads buffer was
+     full when the AsynchronousOutput option is set. This is updated each
+     time the background writer thread runs.
+    */
+  static uint64_t GetAsyncDropCount();
+
+  /**Decode trace output written with the BinaryFormat option.
+     The text layout is the same as if the BinaryFormat option had not been
+     used. Any text found outside of binary records, e.g. the banner written
+     when the file is opened, is copied to the output unchanged. The input
+     is decoded as it is read, so is not held in memory.
+
+     @return false if the input does not have a binary trace header within
+             the first megabyte.
+    */
+  static bool DecodeBinary(
+    std::istream & input,         ///< Binary trace to decode
+    std::ostream & output,        ///< Text output
+    unsigned options = UINT_MAX   ///< Options for text layout, default is the options used when traced
+  );
+
   /** Set the trace options by name.
       The parameter string consists of a series of keywords separated
       by a + or -. Use +X or -X to add/remove option where X is one of:
@@ -680,6 +730,8 @@ public:
         hour     rotate output file hourly
         minute   rotate output file every minute
         append   append to output file, otherwise overwrites
+        async    output via background writer thread
+        binary   binary output, use tracedecode to read
         <perm>   file permission similar to unix chmod, but starts
                  with +/- and only has one combination at a time,
                  e.g. +uw is user write, +or is other read, etc"
@@ -1312,6 +1364,94 @@ namespace PProfiling
   PPROFILE_EXCLUDE(float CyclesToSeconds(uint64_t cycles));
 
 
+  /**Histogram of lock wait or held times.
+     Bucket n counts durations of 4^n to 4^(n+1) CPU cycles, with the last
+     bucket also counting anything longer.
+    */
+  struct LockHistogram
+  {
+    enum { NumBuckets = 16 };
+    uint64_t m_count[NumBuckets];
+
+    LockHistogram();
+    PPROFILE_EXCLUDE(static unsigned GetBucket(uint64_t cycles));
+  };
+
+  /// Waits on a lock from a particular call site.
+  struct LockWaiter
+  {
+    uint64_t m_count;
+    uint64_t m_waitCycles;
+
+    LockWaiter() : m_count(0), m_waitCycles(0) { }
+  };
+  typedef std::map<std::string, LockWaiter> LockWaiterMap;
+
+  /// Statistics for all the mutexes created at a definition site.
+  struct LockSite
+  {
+    uint64_t      m_acquisitions;
+    uint64_t      m_contended;
+    uint64_t      m_waitCycles;
+    uint64_t      m_heldCycles;
+    LockHistogram m_waitHistogram;
+    LockHistogram m_heldHistogram;
+    LockWaiterMap m_waiters;
+
+    LockSite();
+    void Merge(const LockSite & other);
+  };
+  typedef std::map<std::string, LockSite> LockSiteMap;
+
+  struct LockAnalysis
+  {
+    uint64_t    m_durationCycles;
+    LockSiteMap m_sites;
+
+    LockAnalysis()
+      : m_durationCycles(0)
+    {
+    }
+
+    void ToText(ostream & strm) const;
+    void ToHTML(ostream & strm) const;
+  };
+
+  /**Enable lock contention profiling.
+     When enabled, PTimedMutex and PReadWriteMutex, and thus PSafeObject,
+     accumulate statistics against the PDebugLocation the mutex was
+     constructed with, i.e. its definition site, so all instances of a
+     mutex member share an entry. A lock is considered contended if the
+     wait for it exceeded a microsecond, and for those the location passed
+     to the instrumented wait functions is recorded as the waiting call
+     site. Only waits via P_INSTRUMENTED_WAIT_AND_SIGNAL(),
+     P_INSTRUMENTED_LOCK_READ_ONLY()/P_INSTRUMENTED_LOCK_READ_WRITE(), or
+     the PReadWriteMutex functions taking a PDebugLocation, have a call
+     site, and only when PTRACING is enabled. All other waits on a mutex
+     are counted together as "(uninstrumented)".
+
+     The PTLIB_LOCK_PROFILING environment variable enables this at start up.
+    */
+  PPROFILE_EXCLUDE(
+    void EnableLockProfiling(bool enab)
+  );
+  PPROFILE_EXCLUDE(
+    bool IsLockProfilingEnabled()
+  );
+  PPROFILE_EXCLUDE(
+    void ResetLockProfiling()
+  );
+
+  void AnalyseLocks(LockAnalysis & analysis);
+  void AnalyseLocks(ostream & strm, bool html);
+
+  // Used by the mutex classes to record the lock information
+  struct LockStatistics;
+  PPROFILE_EXCLUDE(LockStatistics * GetLockStatistics(const PDebugLocation & site));
+  PPROFILE_EXCLUDE(void RecordLockAcquired(LockStatistics & stats, uint64_t waitCycles, const PDebugLocation & caller));
+  PPROFILE_EXCLUDE(void RecordLockReleased(LockStatistics & stats, uint64_t heldCycles));
+
+
 #if P_PROFILING
 
   struct Function
@@ -1368,6 +1508,7 @@ namespace PProfiling
     unsigned      m_functionCount;
     ThreadByID    m_threadByID;
     ThreadByUsage m_threadByUsage;
+    LockAnalysis  m_locks;
 
     Analysis()
       : m_durationCycles(0)
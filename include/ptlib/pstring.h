@@ -49,6 +49,7 @@
 class PStringArray;
 class PRegularExpression;
 class PString;
+class PStringView;
 
 /**The same as the standard C snprintf(fmt, 1000, ...), but returns a
    PString instead of a const char *.
@@ -98,6 +99,14 @@ typedef PBaseArray<wchar_t> PWCharArray;
    Note that the array is a '\\0' terminated string as in C strings. Thus the
    memory allocated, and the length of the string may be different values.
 
+   Short strings, up to PString::InlineSize bytes including the '\\0', are
+   held in a buffer inside the PString instance itself, so do not need any
+   heap allocation. Such a string is never shared, a copy simply copies the
+   characters, which is cheaper than touching a reference count that may be
+   shared with other threads. Only when the string grows beyond that size is
+   the usual reference counted heap array used. The cost is a larger PString
+   object, see <code>m_inline</code>.
+
    Also note that the PString is inherently an 8 bit string. The character set
    is generally defined as UTF-8, though this is only relevant when converting
    to or from wchar_t or PWideString. The format of a wchar_t based string is
@@ -111,6 +120,8 @@ class PString : public PCharArray
   public:
     typedef const char * Initialiser;
 
+    enum { InlineSize = 24 }; ///< Size of internal buffer for short strings, including the '\\0'
+
   /**@name Construction */
   //@{
     /**Construct an empty string. This will have one character in it which is
@@ -118,15 +129,19 @@ class PString : public PCharArray
      */
     PString();
 
+    /**Destroy the string.
+     */
+    ~PString() { if (IsInline()) reference = NULL; else Destruct(); }
+
     /**Create a new reference to the specified string. The string memory is not
-       copied, only the pointer to the data.
+       copied, only the pointer to the data, unless it fits in InlineSize.
      */
     PString(
       const PString & str  ///< String to create new reference to.
     );
 
     /**Create a new reference to the specified buffer. The string memory is not
-       copied, only the pointer to the data.
+       copied, only the pointer to the data, unless it fits in InlineSize.
      */
     PString(
       const PCharArray & buf  ///< Buffer to create new reference to.
@@ -146,6 +161,13 @@ class PString : public PCharArray
       const std::string & str
     );
 
+    /**Create a new string from the characters in the view. This is
+       explicit as it is where the view is materialised into a new string.
+     */
+    explicit PString(
+      const PStringView & view
+    );
+
     /**Create a string from the C string array. This is most commonly used with
        a literal string, eg "hello". A new memory block is allocated of a size
        sufficient to take the length of the string and its terminating
@@ -514,18 +536,29 @@ class PString : public PCharArray
 
     /**Calculate a hash value for use in sets and dictionaries.
     
-       The hash function for strings will produce a value based on the sum of
-       the first three characters of the string. This is a fairly basic
-       function and make no assumptions about the string contents. A user may
-       descend from PString and override the hash function if they can take
-       advantage of the types of strings being used, eg if all strings start
-       with the letter 'A' followed by 'B or 'C' then the current hash function
-       will not perform very well.
+       The hash function for strings covers every character of the string,
+       ignoring the case of ASCII letters so the same value is produced for
+       a <code>PCaselessString</code>. The full range of PINDEX is used, so
+       keys with long common prefixes or suffixes, e.g. URLs or GUIDs, are
+       still well distributed.
 
        @return
        hash value for string.
      */
     virtual PINDEX HashFunction() const;
+
+    /**Calculate a hash value over a block of characters.
+       This is the function used by <code>HashFunction()</code>, processing
+       eight characters at a time.
+
+       @return
+       hash value for characters.
+     */
+    static PINDEX CalculateHash(
+      const char * data,          ///< Characters to hash
+      PINDEX length,              ///< Number of characters
+      bool caseInsensitive = true ///< Ignore case of ASCII letters
+    );
   //@}
 
   /**@name Overrides from class PContainer */
@@ -1957,6 +1990,7 @@ class PString : public PCharArray
     ) const;
     virtual int internal_strcmp(const char * s1, const char *s2) const;
     virtual int internal_strncmp(const char * s1, const char *s2, size_t n) const;
+    bool InternalIsCaseless() const;
 
     bool InternalSplit(
       const PString & delimiter,  // Delimiter around which tom plit the substrings
@@ -1974,13 +2008,44 @@ class PString : public PCharArray
     PString(int dummy, const PString * str);
 
     virtual void AssignContents(const PContainer &);
+    virtual void DestroyReference();
     PString(PContainerReference & reference_, PINDEX len)
       : PCharArray(reference_)
       , m_length(len)
       { }
 
+    /* Set the string to use the internal buffer, copying dataSize bytes from
+       data and zeroing the rest up to newSize, which must not exceed
+       InlineSize. Any heap reference is released.
+     */
+    void InternalSetInline(
+      const char * data,
+      PINDEX dataSize,
+      PINDEX newSize
+    );
+    bool IsInline() const { return reference == &m_inline; }
+
   protected:
     mutable PINDEX m_length; // Length of the string, always at least one less than GetSize()
+
+    /* The reference for short strings, marked as constant so that any generic
+       PContainer copy, e.g. to a PCharArray, will make its own duplicate of
+       the data and not share a pointer into this object.
+
+       This is a full PContainerReference, rather than some tagging of the
+       reference pointer, as all of PContainer and PAbstractArray, much of it
+       inline in applications, read the size, count and flags through that
+       pointer. It is the last member, so the offsets of all members before
+       it are as they were, but it adds 48 bytes to every PString, 56 to 104
+       bytes on 64 bit platforms. This is not binary compatible with builds
+       of PTLib without it, so applications must be recompiled.
+     */
+    struct InlineReference : PContainerReference
+    {
+      InlineReference() : PContainerReference(1, true) { m_buffer[0] = '\0'; }
+      char m_buffer[InlineSize];
+    };
+    InlineReference m_inline;
 };
 
 
@@ -1998,6 +2063,214 @@ inline wostream & operator<<(wostream & stream, const PString & string)
 #endif
 
 
+/**A non-owning view of a sequence of characters within a string.
+   This is simply a pointer and a length, so taking a substring, trimming
+   it or splitting it into tokens does not allocate any memory. It is
+   intended for parsers, where an input is examined in many small pieces
+   but only some of those are kept. A PString is only created when a piece
+   is actually stored, via the explicit PString(const PStringView &)
+   constructor.
+
+   Note the characters are not necessarily '\\0' terminated, and the view
+   must not outlive the string it was taken from.
+ */
+class PStringView
+{
+  public:
+  /**@name Construction */
+  //@{
+    /// Construct an empty view.
+    PStringView()
+      : m_data("")
+      , m_length(0)
+    { }
+
+    /// Construct a view of a C string, a NULL pointer is an empty view.
+    PStringView(
+      const char * cstr   ///< C string to view
+    ) : m_data(cstr != NULL ? cstr : "")
+      , m_length(cstr != NULL ? strlen(cstr) : 0)
+    { }
+
+    /// Construct a view of \p len characters starting at \p ptr.
+    PStringView(
+      const char * ptr,   ///< Characters to view
+      PINDEX len          ///< Number of characters
+    ) : m_data(ptr != NULL ? ptr : "")
+      , m_length(ptr != NULL ? len : 0)
+    { }
+
+    /// Construct a view of the contents of the string.
+    PStringView(
+      const PString & str ///< String to view
+    ) : m_data(str)
+      , m_length(str.GetLength())
+    { }
+
+    /// Construct a view of the contents of the string.
+    PStringView(
+      const std::string & str ///< String to view
+    ) : m_data(str.c_str())
+      , m_length(str.length())
+    { }
+  //@}
+
+  /**@name Access */
+  //@{
+    /// Get the start of the characters, which may not be '\\0' terminated.
+    const char * GetPointer() const { return m_data; }
+
+    /// Get the number of characters in the view.
+    PINDEX GetLength() const { return m_length; }
+
+    /// Determine if view has no characters.
+    bool IsEmpty() const { return m_length == 0; }
+
+    /// Get character at \p index, or '\\0' if beyond the end of the view.
+    char operator[](PINDEX index) const { return index < m_length ? m_data[index] : '\0'; }
+
+    /// Get a view of the first \p len characters.
+    PStringView Left(PINDEX len) const { return len > 0 ? PStringView(m_data, PMIN(len, m_length)) : PStringView(); }
+
+    /// Get a view of the last \p len characters.
+    PStringView Right(PINDEX len) const { return len <= 0 ? PStringView() : len < m_length ? PStringView(m_data+m_length-len, len) : *this; }
+
+    /// Get a view of \p len characters starting at \p start.
+    PStringView Mid(
+      PINDEX start,
+      PINDEX len = P_MAX_INDEX
+    ) const;
+
+    /// Get a view of characters \p start to \p end inclusive, as for PString::operator()().
+    PStringView operator()(
+      PINDEX start,
+      PINDEX end
+    ) const;
+
+    /// Get a view with leading white space removed.
+    PStringView LeftTrim() const;
+
+    /// Get a view with trailing white space removed.
+    PStringView RightTrim() const;
+
+    /// Get a view with leading and trailing white space removed.
+    PStringView Trim() const;
+  //@}
+
+  /**@name Searching */
+  //@{
+    /** Locate the position of the character within the view.
+        @return P_MAX_INDEX if not found.
+      */
+    PINDEX Find(
+      char ch,
+      PINDEX offset = 0
+    ) const;
+
+    /** Locate the position of the substring within the view.
+        @return P_MAX_INDEX if not found.
+      */
+    PINDEX Find(
+      const PStringView & str,
+      PINDEX offset = 0
+    ) const;
+
+    /** Locate the last position of the character within the view, searching
+        backwards from \p offset.
+        @return P_MAX_INDEX if not found.
+      */
+    PINDEX FindLast(
+      char ch,
+      PINDEX offset = P_MAX_INDEX
+    ) const;
+
+    /** Locate the position of the first of any of the characters in \p cset.
+        @return P_MAX_INDEX if not found.
+      */
+    PINDEX FindOneOf(
+      const char * cset,
+      PINDEX offset = 0
+    ) const;
+
+    /** Locate the position of the first character not in \p cset.
+        @return P_MAX_INDEX if all characters are in the set.
+      */
+    PINDEX FindSpan(
+      const char * cset,
+      PINDEX offset = 0
+    ) const;
+  //@}
+
+  /**@name Comparison */
+  //@{
+    /// Compare the two views, in the same way as PString::Compare().
+    PObject::Comparison Compare(
+      const PStringView & other
+    ) const;
+
+    /// Compare the two views ignoring case, in the same way as PCaselessString.
+    PObject::Comparison CompareCaseless(
+      const PStringView & other
+    ) const;
+
+    /// Determine if the view starts with \p prefix.
+    bool StartsWith(
+      const PStringView & prefix,
+      bool caseless = false
+    ) const;
+
+    bool operator==(const PStringView & other) const { return m_length == other.m_length && Compare(other) == PObject::EqualTo; }
+    bool operator!=(const PStringView & other) const { return !operator==(other); }
+    bool operator< (const PStringView & other) const { return Compare(other) == PObject::LessThan; }
+    bool operator> (const PStringView & other) const { return Compare(other) == PObject::GreaterThan; }
+    /// Caseless equality, as for PString::operator*=().
+    bool operator*=(const PStringView & other) const { return m_length == other.m_length && CompareCaseless(other) == PObject::EqualTo; }
+  //@}
+
+  /**@name Conversion */
+  //@{
+    /// Convert to integer, as for PString::AsInteger().
+    long AsInteger(unsigned base = 10) const;
+
+    /// Convert to unsigned integer, as for PString::AsUnsigned().
+    DWORD AsUnsigned(unsigned base = 10) const;
+
+    /// Convert to 64 bit integer, as for PString::AsInteger64().
+    int64_t AsInteger64(unsigned base = 10) const;
+
+    /// Convert to 64 bit unsigned integer, as for PString::AsUnsigned64().
+    uint64_t AsUnsigned64(unsigned base = 10) const;
+
+    /** Split the view into two views around the delimiter, see PString::Split().
+      */
+    bool Split(
+      const PStringView & delimiter,  ///< Delimiter around which to split the view
+      PStringView & before,           ///< Characters before delimiter
+      PStringView & after,            ///< Characters after delimiter
+      PString::SplitOptions_Bits options = PString::SplitTrim  ///< Options for how to split
+    ) const;
+
+    /** Split the view into an array of views, see PString::Tokenise().
+      */
+    std::vector<PStringView> Tokenise(
+      const char * cseparators,     ///< Set of separator characters that delimit tokens.
+      bool onePerSeparator = true   ///< Flag for if there are empty tokens between consecutive separators.
+    ) const;
+
+    /** Split the view into individual lines, see PString::Lines().
+      */
+    std::vector<PStringView> Lines() const;
+  //@}
+
+    friend ostream & operator<<(ostream & strm, const PStringView & view) { return strm.write(view.m_data, view.m_length); }
+
+  protected:
+    const char * m_data;
+    PINDEX       m_length;
+};
+
+
+
 #ifdef _WIN32
   class PWideString : public PWCharArray {
     PCLASSINFO(PWideString, PWCharArray);
@@ -2072,6 +2345,13 @@ class PCaselessString : public PString
       ) : PString(str)
     { }
 
+    /**Create a caseless string from the characters in the view.
+     */
+    explicit PCaselessString(
+      const PStringView & view  ///< Characters to initialise the caseless string from.
+    ) : PString(view)
+    { }
+
     /**Assign the string to the current object. The current instance then
        becomes another reference to the same string in the <code>str</code>
        parameter.
@@ -3274,6 +3554,12 @@ PDECLARE_STRING_DICTIONARY(PStringToString, PString);
     void FromString(
       const PString & str  ///< String to read dictionary from
     );
+    void FromString(
+      const PStringView & str  ///< String to read dictionary from
+    );
+    // Avoid ambiguity between the PString and PStringView overloads
+    void FromString(const char * str) { FromString(PStringView(str)); }
+    void FromString(const std::string & str) { FromString(PStringView(str)); }
   //@}
 };
 
@@ -46,6 +46,7 @@
 
 
 class PSocket;
+class PUDPSocket;
 
 PLIST(PSocketList, PSocket);
 
@@ -530,6 +531,154 @@ class PSocket : public PChannel
 };
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+/**A persistent set of sockets waited on for I/O readiness.
+   Unlike PSocket::Select(), which rebuilds its list of handles on every call,
+   sockets are registered with the event loop once, and remain registered
+   until explicitly removed. On Linux this is implemented via epoll, for other
+   platforms it falls back to PSocket::Select() on the registered sockets.
+
+   When a registered socket becomes ready, the notifier supplied at
+   registration time is called with the socket and a bit mask of the
+   PSocketEventLoop::Events that occurred.
+
+   Note the caller is responsible for calling Unregister() before the socket
+   is deleted.
+  */
+class PSocketEventLoop : public PObject
+{
+    PCLASSINFO(PSocketEventLoop, PObject);
+  public:
+    /// Events that may be waited for
+    enum Events {
+      ReadEvent   = 1,  ///< Socket has data to read, or a connection to accept
+      WriteEvent  = 2,  ///< Socket may be written to
+      ExceptEvent = 4   ///< Socket has an exception or error condition
+    };
+
+    /// Callback for socket readiness, INT parameter is a bit mask of Events.
+    typedef PNotifierTemplate<int> Notifier;
+    #define PDECLARE_SocketEventNotifier(cls, fn) PDECLARE_NOTIFIER2(PSocket, cls, fn, int)
+    #define PCREATE_SocketEventNotifier(fn) PCREATE_NOTIFIER2(fn, int)
+
+    /**Create a new event loop.
+      */
+    PSocketEventLoop();
+
+    /**Destroy the event loop, stopping any dispatch thread.
+       Sockets are not closed.
+      */
+    ~PSocketEventLoop();
+
+    /**Register a socket with the event loop.
+       @return false if socket is not open or already registered.
+      */
+    bool Register(
+      PSocket & socket,           ///< Socket to monitor
+      int events,                 ///< Bit mask of events to wait for
+      const Notifier & notifier   ///< Callback for socket readiness
+    );
+
+    /**Change the events waited for on a registered socket.
+       @return false if socket is not registered.
+      */
+    bool Modify(
+      PSocket & socket,           ///< Socket to monitor
+      int events                  ///< New bit mask of events to wait for
+    );
+
+    /**Remove a socket from the event loop.
+       This may be called from a notifier, including for the socket being
+       notified.
+       @return false if socket is not registered.
+      */
+    bool Unregister(
+      PSocket & socket            ///< Socket to remove
+    );
+
+    /**Indicate the socket is registered.
+      */
+    bool IsRegistered(
+      const PSocket & socket      ///< Socket to check
+    ) const;
+
+    /// Get the number of registered sockets.
+    PINDEX GetSize() const;
+
+    /**Wait for any registered socket to become ready, and call the
+       notifiers for each.
+       This will also return early if Interrupt() is called, or if the
+       calling thread has its I/O unblocked, e.g. by PThread::Terminate().
+       The notifiers are called without any internal lock held, so they may
+       Register() or Unregister() any socket.
+
+       @return PChannel::NoError if one or more notifiers called,
+               PChannel::Timeout on time out, PChannel::Interrupted if
+               Interrupt() called, or other error code.
+      */
+    PChannel::Errors Wait(
+      const PTimeInterval & timeout = PMaxTimeInterval
+    );
+
+    /**Break a thread blocked in Wait().
+      */
+    void Interrupt();
+
+    /**Start a background thread that repeatedly calls Wait(), dispatching
+       the notifiers, until Stop() is called.
+      */
+    bool Start(
+      const char * threadName = "SocketLoop"
+    );
+
+    /**Stop the background dispatch thread started by Start().
+      */
+    void Stop();
+
+    /// Indicate the background dispatch thread is running.
+    bool IsRunning() const { return m_thread != NULL; }
+
+  protected:
+    void MainLoop();
+
+    struct Registration {
+      Registration(PSocket & socket, int events, const Notifier & notifier)
+        : m_socket(socket), m_events(events), m_notifier(notifier) { }
+      PSocket & m_socket;
+      int       m_events;
+      Notifier  m_notifier;
+    };
+    typedef std::map<P_INT_PTR, Registration> RegistrationMap;
+    RegistrationMap m_registrations;
+    PDECLARE_MUTEX(m_mutex);
+
+    // Copied from the registrations under the mutex, called after release
+    struct ReadySocket {
+      ReadySocket(P_INT_PTR handle, PSocket & socket, int events, const Notifier & notifier)
+        : m_handle(handle), m_socket(&socket), m_events(events), m_notifier(notifier) { }
+      P_INT_PTR m_handle;
+      PSocket * m_socket;
+      int       m_events;
+      Notifier  m_notifier;
+    };
+    typedef std::vector<ReadySocket> ReadyList;
+    void DispatchReady(const ReadyList & ready);
+    bool InternalIsRegistered(P_INT_PTR handle, const PSocket & socket) const;
+
+#if P_HAS_EPOLL
+    int m_epollHandle;
+    int m_interruptHandle;
+    int m_unblockHandle;
+#else
+    PUDPSocket * m_interruptSocket;
+#endif
+
+    PThread    * m_thread;
+    atomic<bool> m_running;
+};
+
+
 #endif // PTLIB_SOCKET_H
 
 
@@ -251,6 +251,17 @@ class PIntCondMutex : public PCondMutex
    can be changed via #define to an alternate algorithm 'Faster Fair Solution
    for the Reader-Writer Problem. V.Popov, O.Mazonka 2013'
    http://arxiv.org/ftp/arxiv/papers/1309/1309.4507.pdf to improve efficiency.
+
+   On top of this, readers use a biased fast path, as per 'BRAVO - Biased
+   Locking for Reader-Writer Locks. D.Dice, A.Kogan 2019'. While the bias is
+   on, a reader just publishes itself in a per-thread slot and never touches
+   the shared semaphores. A writer turns the bias off and waits for those
+   published readers to drain. The bias is only turned back on after a run of
+   reads with no writes, and not until some multiple of the time the writer
+   waited has passed, so write heavy usage stays with the algorithm above.
+
+   The per-thread nesting information is held in thread local storage, so no
+   lock or map look up is needed to determine if this is a nested call.
  */
 
 class PReadWriteMutex : public PObject, public PMutexExcessiveLockInfo, PProfiling::HighWaterMark<PReadWriteMutex>
@@ -339,29 +350,44 @@ class PReadWriteMutex : public PObject, public PMutexExcessiveLockInfo, PProfili
     PTimedMutex m_writerMutex;
     unsigned    m_writerCount;
 #endif
+    /* Nest counts are only changed by the owning thread, other threads only
+       read them for deadlock diagnostics. */
     struct Nest
     {
-      atomic<unsigned> m_readerCount;
-      atomic<unsigned> m_writerCount;
-      atomic<bool>     m_waiting;
-      atomic<uint64_t> m_startHeldCycle;
-      atomic<PUniqueThreadIdentifier> m_uniqueId;
+      unsigned                    m_readerCount;
+      unsigned                    m_writerCount;
+      bool                        m_waiting;
+      PReadWriteMutex * volatile * m_fastReader; // Published reader, NULL if not in a slot
+      uint64_t                    m_startHeldCycle;
+      PThreadIdentifier           m_threadId;
+      PUniqueThreadIdentifier     m_uniqueId;
 
       Nest();
-      Nest(const Nest & other);
-      Nest & operator=(const Nest & other);
     };
+    struct NestSlot;
+    struct ThreadNests;
     typedef std::map<PThreadIdentifier, Nest> NestMap;
-    NestMap          m_nestedThreads;
+    NestMap          m_nestedThreads; // Only used if thread local slots exhausted
     PCriticalSection m_nestingMutex;
+    atomic<unsigned> m_releasingThreads;
+
+    volatile bool    m_readerBias;
+    uint64_t         m_readerBiasInhibitUntil;
+    unsigned         m_readsSinceWrite;
 
+    static NestSlot * GetNestSlots();
+    static ThreadNests & GetThreadNests();
     Nest * GetNest();
     Nest & StartNest();
     void EndNest();
+    bool InternalStartFastRead(Nest & nest);
+    bool InternalEndFastRead(Nest & nest);
+    void InternalRevokeReaderBias(Nest & nest);
     void InternalStartReadWithNest(Nest & nest, const PDebugLocation & location);
     void InternalEndReadWithNest(Nest & nest, const PDebugLocation & location);
     void InternalStartWriteWithNest(Nest & nest, const PDebugLocation & location);
     void InternalEndWriteWithNest(Nest & nest, const PDebugLocation & location);
+    void InternalDeadlock() const;
     void InternalWait(Nest & nest, PSync & sync, const PDebugLocation & location) const;
 
   private:
@@ -35,6 +35,9 @@
 #endif
 
 
+class PFile;
+
+
 /** A socket that uses the TCP transport on the Internet Protocol.
  */
 class PTCPSocket : public PIPSocket
@@ -150,6 +153,25 @@ class PTCPSocket : public PIPSocket
       PINDEX len          ///< Number of bytes pointed to by <code>buf</code>.
     );
 
+    /** Write a region of a file to the TCP/IP stream. Where the platform
+       supports it, e.g. <code>sendfile()</code> on Linux, the data goes
+       directly from the file system cache to the socket without being
+       copied through user space. Otherwise the file is memory mapped, or
+       read in blocks, and written normally.
+
+       This is subject to the write timeout and sets the last write count
+       member variable in the same way as the usual <code>Write()</code>
+       function.
+
+       @return
+       true if all the bytes were sucessfully written.
+     */
+    virtual bool WriteFromFile(
+      PFile & file,   ///< Open file to be written
+      off_t offset,   ///< Offset into file of first byte
+      off_t length    ///< Number of bytes to be written
+    );
+
     /** This is callback function called by the system whenever out of band data
        from the TCP/IP stream is received. A descendent class may interpret
        this data according to the semantics of the high level protocol.
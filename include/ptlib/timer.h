@@ -362,8 +362,39 @@ class PTimer : public PTimeInterval
          */
         PTimeInterval Process();
 
+        /* Statistics on timer processing. The lateness histogram counts how
+           long after their expiry time timers were dispatched, with bucket
+           i counting latenesses less than LatenessBucketLimits[i] ms, and
+           the final bucket counting everything later than that.
+         */
+        struct Statistics
+        {
+          Statistics();
+
+          enum { NumLatenessBuckets = 11 };
+          static const unsigned LatenessBucketLimits[NumLatenessBuckets-1];
+
+          size_t        m_timerCount;     // Number of running timers
+          size_t        m_heapSize;       // Entries in expiry heap, including stale ones
+          unsigned      m_workQueueDepth; // Timeout work queued or executing in thread pool
+          uint64_t      m_expiredCount;   // Total timeouts dispatched
+          PTimeInterval m_maxLateness;    // Worst lateness seen
+          uint64_t      m_latenessHistogram[NumLatenessBuckets];
+
+          friend ostream & operator<<(ostream & strm, const Statistics & stats);
+        };
+
+        // Get current statistics on timer processing
+        void GetStatistics(Statistics & stats) const;
+
+        /* Set flag for idle timeout threads taking work queued behind a slow
+           callback on another thread. Off by default.
+         */
+        void SetWorkStealing(bool enable) { m_threadPool.SetWorkStealing(enable); }
+
       private:
         bool OnTimeout(PIdGenerator::Handle handle);
+        void AddExpiry(PTimer & timer);
 
         struct Timeout
         {
@@ -372,11 +403,26 @@ class PTimer : public PTimeInterval
           virtual ~Timeout() { }
           virtual void Work();
         };
-        PQueuedThreadPool<Timeout> m_threadPool;
+        PWorkStealingThreadPool<Timeout> m_threadPool;
 
         typedef std::map<PIdGenerator::Handle, PTimer *> TimerMap;
         TimerMap m_timers;
-        PCriticalSection m_timersMutex;
+
+        /* Min-heap of expiry times, so Process() only touches timers that
+           are due. Stopped or restarted timers leave stale entries, which
+           are discarded when they reach the top, or by a periodic rebuild. */
+        struct Expiry
+        {
+          Expiry(const PTimeInterval & time, PIdGenerator::Handle handle) : m_time(time), m_handle(handle) { }
+          bool operator<(const Expiry & other) const { return m_time > other.m_time; }
+          PTimeInterval        m_time;
+          PIdGenerator::Handle m_handle;
+        };
+        std::vector<Expiry> m_expiryHeap;
+
+        mutable PCriticalSection m_timersMutex;
+
+        Statistics m_statistics;
 #if PTRACING
         size_t m_highWaterMark;
 #endif
@@ -141,6 +141,7 @@ class PUDPSocket : public PIPDatagramSocket
     // Normally, one would expect these to be protected, but they are just so darn
     // useful that it's just easier if they are public
     virtual bool InternalReadFrom(Slice * slices, size_t sliceCount, PIPSocketAddressAndPort & ipAndPort);
+    virtual PINDEX ReadFromMulti(Datagram * datagrams, PINDEX count);
     virtual bool InternalSetSendAddress(const PIPSocketAddressAndPort & addr, int mtuDiscovery = -1);
     virtual void InternalGetSendAddress(PIPSocketAddressAndPort & addr) const;
     virtual void InternalSetLastReceiveAddress(const PIPSocketAddressAndPort & addr);
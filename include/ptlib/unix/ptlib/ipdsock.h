@@ -30,6 +30,10 @@
 ///////////////////////////////////////////////////////////////////////////////
 // PIPDatagramSocket
 
-// nothing to do
+#if P_HAS_RECVMMSG
+  protected:
+    PINDEX os_readmulti(Datagram * datagrams, PINDEX count);
+    PINDEX os_writemulti(Datagram * datagrams, PINDEX count);
+#endif
 
 // End Of File ////////////////////////////////////////////////////////////////
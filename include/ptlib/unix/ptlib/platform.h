@@ -137,6 +137,10 @@
 #if defined(P_LINUX)
 
 #define HAS_IFREQ
+#define P_HAS_EPOLL 1
+#define P_HAS_EVENTFD 1
+#define P_HAS_RECVMMSG 1
+#define P_HAS_SENDFILE 1
 
 #if __GNU_LIBRARY__ < 6
   typedef int socklen_t;
@@ -49,6 +49,12 @@
 #endif
     static bool PX_kill(PThreadIdentifier tid, PUniqueThreadIdentifier uid, int sig);
 
+    /// Get handle that becomes readable when PXAbortBlock() is called.
+    int PXGetAbortBlockHandle() const { return unblockPipe[0]; }
+
+    /// Consume signal written by PXAbortBlock(), returns false on error.
+    bool PXClearAbortBlock() const;
+
   protected:
     void PX_StartThread();
     void PX_Suspended();
@@ -87,7 +93,7 @@
     pthread_mutex_t   PX_WaitSemMutex;
 #endif
 
-    int unblockPipe[2];
+    int unblockPipe[2]; // Both entries are the same eventfd if P_HAS_EVENTFD
     friend class PSocket;
     friend void PX_SuspendSignalHandler(int);
 
@@ -288,6 +288,26 @@ class PColourConverter : public PColourPair
       BYTE   & r, BYTE   & g, BYTE   & b
     );
 
+    P_DECLARE_STREAMABLE_ENUM(Acceleration,
+      NoAcceleration,
+      SSE2Acceleration,
+      SSSE3Acceleration,
+      AVX2Acceleration
+    );
+
+    /**Set the SIMD instructions used by the standard colour converters.
+       The default is the best the CPU supports, as determined at run time,
+       so this is mainly for testing and benchmarking.
+       @return The acceleration actually used, which is limited by the CPU.
+      */
+    static Acceleration SetAcceleration(
+      Acceleration level
+    );
+
+    /**Get the SIMD instructions used by the standard colour converters.
+      */
+    static Acceleration GetAcceleration();
+
     /**Copy a section of the source frame to a section of the destination
        frame with scaling/cropping as required.
       */
@@ -91,10 +91,14 @@ ifeq (1, $(HAS_SAMPLES))
              $(PTLIB_TOP_LEVEL_DIR)/samples/sockbundle \
              $(PTLIB_TOP_LEVEL_DIR)/samples/timing \
              $(PTLIB_TOP_LEVEL_DIR)/samples/thread \
+             $(PTLIB_TOP_LEVEL_DIR)/samples/tracebench \
              $(PTLIB_TOP_LEVEL_DIR)/samples/json
   ifeq ($(HAS_IPV6),1)
     SUBDIRS += $(PTLIB_TOP_LEVEL_DIR)/samples/ipv6test
   endif
+  ifeq ($(HAS_VIDEO),1)
+    SUBDIRS += $(PTLIB_TOP_LEVEL_DIR)/samples/vconvbench
+  endif
   ifeq ($(HAS_DNS_RESOLVER),1)
     SUBDIRS += $(PTLIB_TOP_LEVEL_DIR)/samples/dnstest
   endif
@@ -265,6 +269,10 @@ ifeq ($(HAS_EXPAT),1)
   endif
 endif # HAS_EXPAT
 
+ifeq ($(HAS_ZLIB),1)
+  SOURCES += $(COMPONENT_SRC_DIR)/pzlib.cxx
+endif
+
 ifeq ($(HAS_LUA),1)
   SOURCES += $(COMPONENT_SRC_DIR)/lua.cxx
 endif
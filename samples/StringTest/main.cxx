@@ -26,6 +26,7 @@
  */
 #include  <ptlib.h>
 #include <ptlib/pprocess.h>
+#include <ptclib/random.h>
 
 #include <string>
 
@@ -54,6 +55,7 @@ void StringTest::Main()
 	     "a-assign."
 	     "c-copy."
 	     "e-everything."
+	     "f-find."
 	     "j-join."
 	     "l-length."
 
@@ -77,6 +79,7 @@ void StringTest::Main()
 	   << "-a or --assign         : construct a  strng with an assigned value\n"
 	   << "-c or --copy           : copy one string to another\n"
 	   << "-e or --everything     : everything together, in such a way to avoid compiler optimisations\n"
+	   << "-f or --find           : check, then time, searching and replacing within a string\n"
 	   << "-j or --join           : test the joining of two strings \n"
 	   << "-l or --length         : calculate the length of a string\n"
 	   << "-i or --interations    : the number of (x1E6) iterations to repeat the test\n"       
@@ -105,7 +108,7 @@ void StringTest::Main()
   PINDEX iterations = 100;
   if (args.HasOption('i'))
     iterations = args.GetOptionString('i').AsInteger(10);
-  iterations = PMAX(1, PMIN(iterations, 100000));
+  iterations = PMAX((PINDEX)1, PMIN(iterations, (PINDEX)100000));
   PError << "Will run the test for 1 million x " << iterations << " loops" << endl;
 
   PBoolean testPwlib = ! args.HasOption('s');
@@ -131,6 +134,13 @@ void StringTest::Main()
     test = Everything;
   }
 
+  if (args.HasOption('f')) {
+    cerr << "test searching and replacing within a string" << endl;
+    if (!CheckPwlibFind())
+      return;
+    test = Find;
+  }
+
   if (args.HasOption('j')) {
     cerr << "test joining two strings together " << endl;
     test = Join;
@@ -168,6 +178,13 @@ void StringTest::Main()
 	TestStandardEverything();
       break;
 
+    case Find: ;
+      if (testPwlib) 
+	TestPwlibFind();
+      else
+	TestStandardFind();
+      break;
+
     case Join: ;
       if (testPwlib) 
 	TestPwlibJoin();
@@ -299,6 +316,184 @@ void StringTest::TestStandardEverything()
 
 
 
+static PINDEX SlowFind(const PString & str, const char * cstr, PINDEX offset, bool caseless)
+{
+  PINDEX clen = strlen(cstr);
+  for (; offset+clen <= str.GetLength(); ++offset) {
+    const char * ptr = str.GetPointer()+offset;
+    if ((caseless ? strncasecmp(ptr, cstr, clen) : strncmp(ptr, cstr, clen)) == 0)
+      return offset;
+  }
+  return P_MAX_INDEX;
+}
+
+
+static PINDEX SlowFindOneOf(const PString & str, const char * cset, PINDEX offset, bool caseless, bool span)
+{
+  for (; offset < str.GetLength(); ++offset) {
+    bool found = false;
+    for (const char * p = cset; *p != '\0'; ++p) {
+      if (caseless ? tolower(str[offset] & 0xff) == tolower(*p & 0xff) : str[offset] == *p)
+        found = true;
+    }
+    if (found != span)
+      return offset;
+  }
+  return P_MAX_INDEX;
+}
+
+
+static PString SlowReplace(const PString & str, const char * target, const char * subs, bool caseless)
+{
+  PString result;
+  PINDEX last = 0;
+  PINDEX pos;
+  while ((pos = SlowFind(str, target, last, caseless)) != P_MAX_INDEX) {
+    result += str.Mid(last, pos-last) + subs;
+    last = pos + strlen(target);
+  }
+  return result + str.Mid(last);
+}
+
+
+template <class S> static unsigned CheckFind(const S & str, bool caseless)
+{
+  static const char * const needles[] = { "a", "B", "ab", "Ba", "abc", "cAb", "aaaaaaaaaab", "z" };
+  static const char * const sets[] = { "a", "xB", "abc", "\r\n", "Zz" };
+
+  unsigned errors = 0;
+  for (PINDEX offset = 0; offset <= str.GetLength()+1; offset += 7) {
+    for (PINDEX n = 0; n < PARRAYSIZE(needles); ++n) {
+      PINDEX expected = SlowFind(str, needles[n], offset, caseless);
+      if (str.Find(needles[n], offset) != expected) {
+        cerr << "Find(\"" << needles[n] << "\", " << offset << ") failed" << endl;
+        ++errors;
+      }
+      if (needles[n][1] == '\0' && str.Find(needles[n][0], offset) != expected) {
+        cerr << "Find('" << needles[n][0] << "', " << offset << ") failed" << endl;
+        ++errors;
+      }
+    }
+    for (PINDEX n = 0; n < PARRAYSIZE(sets); ++n) {
+      if (str.FindOneOf(sets[n], offset) != SlowFindOneOf(str, sets[n], offset, caseless, false)) {
+        cerr << "FindOneOf(" << PString(sets[n]).ToLiteral() << ", " << offset << ") failed" << endl;
+        ++errors;
+      }
+      if (str.FindSpan(sets[n], offset) != SlowFindOneOf(str, sets[n], offset, caseless, true)) {
+        cerr << "FindSpan(" << PString(sets[n]).ToLiteral() << ", " << offset << ") failed" << endl;
+        ++errors;
+      }
+    }
+  }
+
+  for (PINDEX n = 0; n < PARRAYSIZE(needles); ++n) {
+    S replaced = str;
+    replaced.Replace(needles[n], "<>", true);
+    if (replaced != SlowReplace(str, needles[n], "<>", caseless)) {
+      cerr << "Replace(\"" << needles[n] << "\") failed" << endl;
+      ++errors;
+    }
+  }
+
+  return errors;
+}
+
+
+bool StringTest::CheckPwlibFind()
+{
+  PRandom rand(1);
+  PString text;
+  for (PINDEX i = 0; i < 2000; i++)
+    text += "aAbBcC \r\n"[rand.Generate(0, 8)];
+
+  unsigned errors = CheckFind(text, false) + CheckFind(PCaselessString(text), true);
+  if (errors == 0)
+    cerr << "Search and replace results are correct" << endl;
+  else
+    cerr << "Search and replace had " << errors << " errors" << endl;
+  return errors == 0;
+}
+
+
+void StringTest::TestPwlibFind()
+{
+  PString text = std::string(1000, 'x') + "Needle\r\n";
+  PCaselessString caseless = text;
+  PINDEX found = 0;
+  for (PINDEX i = 0; i < 1000000; i++) {
+    switch (i % 7) {
+    case 0:
+      found += text.Find('\n');
+      break;
+    case 1:
+      found += caseless.Find('n');
+      break;
+    case 2:
+      found += text.Find("Needle");
+      break;
+    case 3:
+      found += caseless.Find("NEEDLE");
+      break;
+    case 4:
+      found += text.FindOneOf("\r\n");
+      break;
+    case 5:
+      found += text.FindSpan("xyz");
+      break;
+    case 6:
+      PString dst = text.Left(100);
+      dst.Replace("x", "yy", true);
+      found += dst.GetLength();
+      break;
+    }
+  }
+  cout << found << endl;
+}
+
+
+static bool CaselessEqual(char c1, char c2)
+{
+  return tolower(c1 & 0xff) == tolower(c2 & 0xff);
+}
+
+
+void StringTest::TestStandardFind()
+{
+  std::string text = std::string(1000, 'x') + "Needle\r\n";
+  static const char needle[] = "NEEDLE";
+  size_t found = 0;
+  for (PINDEX i = 0; i < 1000000; i++) {
+    switch (i % 7) {
+    case 0:
+      found += text.find('\n');
+      break;
+    case 1:
+      found += text.find_first_of("nN");
+      break;
+    case 2:
+      found += text.find("Needle");
+      break;
+    case 3:
+      found += std::search(text.begin(), text.end(), needle, needle+sizeof(needle)-1, CaselessEqual) - text.begin();
+      break;
+    case 4:
+      found += text.find_first_of("\r\n");
+      break;
+    case 5:
+      found += text.find_first_not_of("xyz");
+      break;
+    case 6:
+      std::string dst = text.substr(0, 100);
+      for (size_t pos = 0; (pos = dst.find('x', pos)) != std::string::npos; pos += 2)
+        dst.replace(pos, 1, "yy");
+      found += dst.length();
+      break;
+    }
+  }
+  cout << found << endl;
+}
+
+
 void StringTest::TestPwlibJoin()
 {
   for (PINDEX i = 0; i < 1000000; i++) {
@@ -321,8 +516,8 @@ void StringTest::TestPwlibLength()
 {
   for (PINDEX i = 0; i < 1000000; i++) {
     PString src("abcdefg");
-    int i = src.GetLength();
-    i++;
+    int len = src.GetLength();
+    len++;
   }
 }
     
@@ -330,8 +525,8 @@ void StringTest::TestStandardLength()
 {
   for (PINDEX i = 0; i < 1000000; i++) {
     std::string src("abcdefg");
-    int i = src.length();
-    i++;
+    int len = src.length();
+    len++;
   }
 }
 
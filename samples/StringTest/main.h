@@ -43,12 +43,15 @@ class StringTest : public PProcess
   void TestPwlibAssign();
   void TestPwlibCopy();
   void TestPwlibEverything();
+  bool CheckPwlibFind();
+  void TestPwlibFind();
   void TestPwlibJoin();
   void TestPwlibLength();
   void TestPwlibNone();
   void TestStandardAssign();
   void TestStandardCopy();
   void TestStandardEverything();
+  void TestStandardFind();
   void TestStandardJoin();
   void TestStandardLength();
   void TestStandardNone();
@@ -61,6 +64,7 @@ class StringTest : public PProcess
     Assign,
     Copy,
     Everything,
+    Find,
     Join,
     Length
   };
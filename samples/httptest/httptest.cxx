@@ -10,6 +10,8 @@
 #include <ptclib/pssl.h>
 #include <ptclib/http.h>
 #include <ptclib/threadpool.h>
+#include <ptclib/random.h>
+#include <ptlib/cpufeatures.h>
 
 
 class HTTPConnection
@@ -63,14 +65,315 @@ class HTTPConnection
 };
 
 
+#if P_SSL
+
+/* Client mode is normally set by PWebSocket::Connect(), allow the check to
+   set it directly so both masked and unmasked frames can be tested. */
+class TestWebSocket : public PWebSocket
+{
+  public:
+    void SetClient(bool client) { m_client = client; }
+};
+
+
+/* Check the WebSocket framing and masking against a plain byte at a time
+   implementation, for each of the SIMD mask kernels the CPU supports. One
+   end of a loopback connection is a PWebSocket, the other is read/written
+   raw. Large frames are written from another thread so the socket buffers
+   cannot fill up and deadlock. */
+class WebSocketCheck
+{
+  public:
+    WebSocketCheck()
+      : m_writer(NULL)
+      , m_errors(0)
+    {
+    }
+
+
+    bool Run()
+    {
+      PTCPSocket listener;
+      if (!listener.Listen(PIPSocket::Address::GetLoopback())) {
+        cerr << "Could not listen on loopback" << endl;
+        return false;
+      }
+
+      m_raw.SetPort(listener.GetPort());
+      if (!m_raw.Connect(PIPSocket::Address::GetLoopback())) {
+        cerr << "Could not connect on loopback" << endl;
+        return false;
+      }
+
+      PTCPSocket * socket = new PTCPSocket;
+      if (!socket->Accept(listener)) {
+        delete socket;
+        cerr << "Could not accept loopback connection" << endl;
+        return false;
+      }
+
+      // Lots of small frames back and forth, don't wait for delayed ACKs
+      m_raw.SetOption(TCP_NODELAY, 1, IPPROTO_TCP);
+      socket->SetOption(TCP_NODELAY, 1, IPPROTO_TCP);
+      m_raw.SetReadTimeout(5000);
+      socket->SetReadTimeout(5000);
+      m_webSocket.Open(socket);
+      m_webSocket.SetBinaryMode();
+
+      m_data.SetSize(MaxLength + 8);
+      for (PINDEX i = 0; i < m_data.GetSize(); ++i)
+        m_data[i] = (BYTE)PRandom::Number();
+
+      std::vector<PINDEX> lengths;
+      for (PINDEX len = 0; len <= 300; ++len)
+        lengths.push_back(len);
+      static PINDEX const BigLengths[] = { 65535, 65536, 65537, 131075, MaxLength };
+      lengths.insert(lengths.end(), BigLengths, BigLengths+PARRAYSIZE(BigLengths));
+
+      static unsigned const Levels[] = { 0, PCPUFeatures::SSE2, PCPUFeatures::SSE2|PCPUFeatures::AVX2 };
+      unsigned original = PWebSocket::GetMaskAcceleration();
+      for (PINDEX level = 0; level < PARRAYSIZE(Levels); ++level) {
+        if (PWebSocket::SetMaskAcceleration(Levels[level]) != Levels[level]) {
+          cout << "WebSocket mask features 0x" << hex << Levels[level] << dec << " not supported by CPU" << endl;
+          continue;
+        }
+
+        unsigned before = m_errors;
+        for (size_t i = 0; i < lengths.size(); ++i) {
+          for (PINDEX offset = 0; offset < 4; ++offset) {
+            CheckWrite(lengths[i], offset, true);
+            CheckWrite(lengths[i], offset, false);
+            CheckReadMessage(lengths[i], offset);
+            CheckRead(lengths[i], offset);
+            if (m_errors > before+10) {
+              cout << "Too many errors, giving up." << endl;
+              return false;
+            }
+          }
+        }
+
+        cout << "WebSocket mask features 0x" << hex << Levels[level] << dec << ": "
+             << (m_errors == before ? "passed" : "FAILED") << endl;
+      }
+      PWebSocket::SetMaskAcceleration(original);
+
+      return m_errors == 0;
+    }
+
+
+  protected:
+    enum { MaxLength = 200001 };
+
+    void Fail(const char * test, PINDEX len, PINDEX offset, const char * what)
+    {
+      cout << test << " len=" << len << " offset=" << offset << ": " << what << endl;
+      ++m_errors;
+    }
+
+
+    static void ReferenceMask(BYTE * dst, const BYTE * src, PINDEX len, const BYTE mask[4])
+    {
+      for (PINDEX i = 0; i < len; ++i)
+        dst[i] = (BYTE)(src[i] ^ mask[i&3]);
+    }
+
+
+    static PINDEX EncodeFrame(BYTE * frame, BYTE opCode, bool fin, const BYTE * data, PINDEX len)
+    {
+      frame[0] = opCode;
+      if (fin)
+        frame[0] |= 0x80;
+
+      PINDEX headerLen = 2;
+      if (len < 126)
+        frame[1] = (BYTE)len;
+      else if (len < 65536) {
+        frame[1] = 126;
+        *(PUInt16b *)&frame[2] = (uint16_t)len;
+        headerLen += 2;
+      }
+      else {
+        frame[1] = 127;
+        *(PUInt64b *)&frame[2] = (uint64_t)len;
+        headerLen += 8;
+      }
+
+      frame[1] |= 0x80;
+      BYTE * mask = frame+headerLen;
+      for (PINDEX i = 0; i < 4; ++i)
+        mask[i] = (BYTE)PRandom::Number();
+      headerLen += 4;
+
+      ReferenceMask(frame+headerLen, data, len, mask);
+      return headerLen + len;
+    }
+
+
+    bool ReadRawFrame(BYTE & opCode, bool & fin, bool & masked, PBYTEArray & payload)
+    {
+      BYTE header[10];
+      if (!m_raw.ReadBlock(header, 2))
+        return false;
+
+      fin = (header[0] & 0x80) != 0;
+      opCode = (BYTE)(header[0] & 0xf);
+      masked = (header[1] & 0x80) != 0;
+
+      uint64_t len = header[1] & 0x7f;
+      if (len == 126) {
+        if (!m_raw.ReadBlock(&header[2], 2))
+          return false;
+        len = *(PUInt16b *)&header[2];
+      }
+      else if (len == 127) {
+        if (!m_raw.ReadBlock(&header[2], 8))
+          return false;
+        len = *(PUInt64b *)&header[2];
+      }
+
+      if (len > MaxLength)
+        return false;
+
+      BYTE mask[4];
+      if (masked && !m_raw.ReadBlock(mask, 4))
+        return false;
+
+      payload.SetSize((PINDEX)len);
+      if (len > 0 && !m_raw.ReadBlock(payload.GetPointer(), (PINDEX)len))
+        return false;
+
+      if (masked)
+        ReferenceMask(payload.GetPointer(), payload, payload.GetSize(), mask);
+      return true;
+    }
+
+
+    void StartWrite(PChannel & channel, const void * data, PINDEX len)
+    {
+      m_writeChannel = &channel;
+      m_writeData = data;
+      m_writeLength = len;
+      if (len < 16384)
+        WriteMain();
+      else
+        m_writer = new PThreadObj<WebSocketCheck>(*this, &WebSocketCheck::WriteMain, false, "Writer");
+    }
+
+
+    void WriteMain()
+    {
+      m_writeOk = m_writeChannel->Write(m_writeData, m_writeLength);
+    }
+
+
+    bool EndWrite()
+    {
+      delete m_writer; // Waits for termination
+      m_writer = NULL;
+      return m_writeOk;
+    }
+
+
+    // PWebSocket::Write() through WriteMasked() or WriteGathered()
+    void CheckWrite(PINDEX len, PINDEX offset, bool client)
+    {
+      const char * test = client ? "WriteMasked" : "WriteGathered";
+      m_webSocket.SetClient(client);
+
+      StartWrite(m_webSocket, m_data+offset, len);
+      BYTE opCode;
+      bool fin, masked;
+      bool ok = ReadRawFrame(opCode, fin, masked, m_payload);
+      if (!EndWrite() || !ok)
+        Fail(test, len, offset, "I/O error");
+      else if (opCode != 2 || !fin || masked != client)
+        Fail(test, len, offset, "bad header");
+      else if (m_payload.GetSize() != len || memcmp(m_payload, m_data+offset, len) != 0)
+        Fail(test, len, offset, "payload mismatch");
+    }
+
+
+    // PWebSocket::ReadMessage() of a message in two frames, each with its own mask
+    void CheckReadMessage(PINDEX len, PINDEX offset)
+    {
+      PINDEX split = len/2 | 1;
+      if (split > len)
+        split = len;
+
+      BYTE * frame = m_frame.GetPointer(2*14 + len);
+      PINDEX frameLen = EncodeFrame(frame, 2, false, m_data+offset, split);
+      frameLen += EncodeFrame(frame+frameLen, 0, true, m_data+offset+split, len-split);
+
+      StartWrite(m_raw, frame, frameLen);
+      PINDEX length;
+      bool binary;
+      bool ok = m_webSocket.ReadMessage(m_message, length, binary);
+      if (!EndWrite() || !ok)
+        Fail("ReadMessage", len, offset, "I/O error");
+      else if (!binary)
+        Fail("ReadMessage", len, offset, "not binary");
+      else if (length != len || memcmp(m_message, m_data+offset, len) != 0)
+        Fail("ReadMessage", len, offset, "payload mismatch");
+    }
+
+
+    // PWebSocket::Read() of a frame in odd sized pieces to a misaligned buffer
+    void CheckRead(PINDEX len, PINDEX offset)
+    {
+      if (len == 0)
+        return; // Read() does not return empty frames
+
+      BYTE * frame = m_frame.GetPointer(14 + len);
+      PINDEX frameLen = EncodeFrame(frame, 2, true, m_data+offset, len);
+
+      StartWrite(m_raw, frame, frameLen);
+      BYTE * buffer = m_message.GetPointer(len + 4) + offset;
+      PINDEX done = 0;
+      bool ok = true;
+      while (ok && done < len) {
+        ok = m_webSocket.Read(buffer+done, std::min(len-done, (PINDEX)37));
+        done += m_webSocket.GetLastReadCount();
+      }
+      if (!EndWrite() || !ok)
+        Fail("Read", len, offset, "I/O error");
+      else if (!m_webSocket.IsMessageComplete())
+        Fail("Read", len, offset, "message not complete");
+      else if (memcmp(buffer, m_data+offset, len) != 0)
+        Fail("Read", len, offset, "payload mismatch");
+    }
+
+
+    TestWebSocket m_webSocket;
+    PTCPSocket    m_raw;
+    PBYTEArray    m_data;
+    PBYTEArray    m_frame;
+    PBYTEArray    m_payload;
+    PBYTEArray    m_message;
+
+    PThread     * m_writer;
+    PChannel    * m_writeChannel;
+    const void  * m_writeData;
+    PINDEX        m_writeLength;
+    bool          m_writeOk;
+
+    unsigned      m_errors;
+};
+
+#endif // P_SSL
+
+
 class HTTPTest : public PProcess
 {
   PCLASSINFO(HTTPTest, PProcess)
   PSyncPoint m_done;
+  atomic<unsigned> m_outstanding;
 public:
-  PDECLARE_HttpPoolNotifier(HTTPTest, OnPoolDone)
+  PDECLARE_NOTIFIER_EXT(PHTTPClientPool, , HTTPTest, OnPoolDone, PHTTPClientPool::Response, response)
   {
-    m_done.Signal();
+    if (response.m_code != PHTTP::RequestOK)
+      cout << "Error " << response.m_code << ' ' << response.m_body << endl;
+    if (--m_outstanding == 0)
+      m_done.Signal();
   }
 
   void ClientPool(PHTTP::Commands cmd, const PArgList & args)
@@ -82,8 +385,18 @@ public:
                            args.GetOptionString("private-key"));
 #endif
 
-    pool.QueueRequest(PHTTPClientPool::Request(cmd, args[0], PCREATE_NOTIFIER(OnPoolDone)));
+    pool.SetMaxPipeline(args.GetOptionAs("pipeline", 1U));
+
+    unsigned count = args.GetOptionAs("repeat", 1U);
+    m_outstanding = count;
+    PTime start;
+    for (unsigned i = 0; i < count; ++i)
+      pool.QueueRequest(PHTTPClientPool::Request(cmd, args[0], PCREATE_NOTIFIER(OnPoolDone)));
     m_done.Wait();
+
+    PHTTPClientPool::Statistics stats;
+    pool.GetStatistics(stats);
+    cout << count << " requests in " << start.GetElapsed() << "s\n" << stats << endl;
   }
 
 
@@ -198,13 +511,16 @@ public:
     PArgList & args = GetArguments();
     args.Parse("h-help.       print this help message.\n"
                "O-operation:  do a GET/POST/PUT/DELETE, if absent then acts as server\n"
-               "P-pool.       do above operation using client pool"
+               "P-pool.       do above operation using client pool\n"
+               "-repeat:      number of times to do operation in client pool\n"
+               "-pipeline:    maximum requests in flight per client pool connection\n"
                "p-port:       port number to listen on (default 80 or 443).\n"
 #if P_SSL
                "s-secure.     SSL/TLS mode for server.\n"
                "-ca:          SSL/TLS client certificate authority file/directory.\n"
                "-certificate: SSL/TLS server certificate.\n"
                "-private-key: SSL/TLS server private key.\n"
+               "-websocket-check. check WebSocket framing and masking, then exit.\n"
 #endif
                "T-theads:  max number of threads in pool(default 10)\n"
                "Q-queue:   max queue size for listening sockets(default 100).\n"
@@ -218,6 +534,15 @@ public:
       return;
     }
 
+#if P_SSL
+    if (args.HasOption("websocket-check")) {
+      WebSocketCheck check;
+      if (!check.Run())
+        SetTerminationValue(1);
+      return;
+    }
+#endif
+
     if (args.HasOption('O')) {
       PINDEX cmd = PHTTPClient().GetCommandFromName(args.GetOptionString('O'));
       if (cmd == P_MAX_INDEX) {
@@ -9,6 +9,7 @@ class JSONTest : public PProcess
  public:
   JSONTest();
   void Main();
+  void Benchmark(unsigned count);
 };
 
 PCREATE_PROCESS(JSONTest);
@@ -54,6 +55,11 @@ JSONTest::JSONTest()
 void JSONTest::Main()
 {
   PArgList & args = GetArguments();
+  if (args.GetCount() > 0 && args[0] == "--bench") {
+    Benchmark(args.GetCount() > 1 ? args[1].AsUnsigned() : 10000);
+    return;
+  }
+
   if (args.GetCount() > 0) {
     PJSON json;
     if (args[0] == "-")
@@ -134,6 +140,34 @@ void JSONTest::Main()
   cout << "test6b " << ok << ' ' << test6.AsString() << "\n\n";
   cout << "test6c " << test6.FromString("[]") << endl;
 
+  PJSONDocument doc7;
+  if (doc7.Parse(json1.AsString())) {
+    const PJSONDocument::Value & root = doc7.GetRoot();
+    cout << "Test 7\n" << root["one"].GetString() << ' ' << root["two"].GetInteger() << ' ' << root["four"].GetSize();
+    for (const PJSONDocument::Value * it = root["four"].begin(); it != root["four"].end(); ++it)
+      cout << ' ' << it->GetType();
+    cout << endl;
+  }
+  else
+    cout << "Test 7 failed at offset " << doc7.GetErrorOffset() << endl;
+
+  PJSONParser parser8("{\"skip\":[1,[2,3]],\"want\":\"esc\\u00e9aped\"}");
+  cout << "Test 8\n";
+  while (parser8.Next() > PJSONParser::e_EndOfData) {
+    if (parser8.GetEvent() == PJSONParser::e_MemberName && parser8.IsString("skip"))
+      parser8.Skip();
+    else if (parser8.GetEvent() == PJSONParser::e_MemberName || parser8.GetEvent() == PJSONParser::e_String)
+      cout << parser8.GetString() << '\n';
+  }
+  cout << endl;
+
+  // Strict numbers keep their text, lenient ones are reformatted to valid JSON
+  PJSONDocument doc9;
+  doc9.Parse("[007,.5,5.,-.5,1e23,-0,1.50,1E5]");
+  PStringStream out9;
+  out9 << doc9;
+  cout << "Test 9 " << (out9 == "[7,0.5,5,-0.5,1e23,-0,1.50,1E5]" ? "(good) " : "(bad) ") << out9 << endl;
+
 #if P_SSL
   PJWT jwt;
   jwt.SetIssuer("Vox Lucida, Pty. Ltd.");
@@ -151,3 +185,81 @@ void JSONTest::Main()
 #endif // P_SSL
 }
 
+
+void JSONTest::Benchmark(unsigned count)
+{
+  PStringStream strm;
+  strm << '[';
+  for (unsigned i = 0; i < count; ++i) {
+    if (i > 0)
+      strm << ',';
+    strm << "{\"id\":" << i << ",\"name\":\"user number " << i << "\",\"score\":" << i*1.5
+         << ",\"active\":true,\"tags\":[\"alpha\",\"beta\",\"gamma\"],"
+            "\"address\":{\"street\":\"" << i << " Some Street\",\"city\":\"Somewhere\",\"zip\":\"12345\"}}";
+  }
+  strm << ']';
+  PString text = strm;
+
+  static const unsigned Iterations = 10;
+  cout << "Parsing " << text.GetLength() << " bytes, " << Iterations << " times" << endl;
+
+  PTime start;
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PJSON json;
+    PStringStream input(text);
+    input >> json;
+  }
+  cout << "PJSON from istream:    " << (PTime() - start) / Iterations << endl;
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PJSON json;
+    json.FromString(text);
+  }
+  cout << "PJSON::FromString:     " << (PTime() - start) / Iterations << endl;
+
+  PJSONDocument doc;
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Iterations; ++i)
+    doc.Parse(text);
+  cout << "PJSONDocument::Parse:  " << (PTime() - start) / Iterations << " arena=" << doc.GetArenaSize() << endl;
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PJSONParser parser(text);
+    while (parser.Next() > PJSONParser::e_EndOfData)
+      ;
+  }
+  cout << "PJSONParser events:    " << (PTime() - start) / Iterations << endl;
+
+  PJSON json;
+  json.FromString(text);
+  cout << "\nSerialising " << Iterations << " times" << endl;
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PStringStream output;
+    output << json.GetArray();
+  }
+  cout << "PJSON::Base to ostream: " << (PTime() - start) / Iterations << endl;
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Iterations; ++i)
+    json.AsString();
+  cout << "PJSON::AsString:        " << (PTime() - start) / Iterations << endl;
+
+  PCharArray buffer;
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PJSONWriter writer(buffer);
+    writer.Write(json);
+  }
+  cout << "PJSONWriter from PJSON: " << (PTime() - start) / Iterations << endl;
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PJSONWriter writer(buffer);
+    writer.Write(doc.GetRoot());
+  }
+  cout << "PJSONWriter from doc:   " << (PTime() - start) / Iterations << endl;
+}
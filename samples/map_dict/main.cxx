@@ -29,6 +29,8 @@ using namespace std;
 The purpose of this program is to find out which is faster:
 \li STL based map
 \li PTLib based dictionary
+\li PTLib dictionary as it was before the open addressing hash table,
+    emulated by the ChainedDict template (shown as "Chained")
 
 By default, this program creates the 200 instances of the structure Element.
 Each instance of the Element class is given a random (and hopefully) unique key.
@@ -221,6 +223,102 @@ class StringDict : public Tester
 };
 
 
+/**This emulates the hash table PDictionary used before the open addressing
+   engine: a fixed array of linked lists indexed by the hash function reduced
+   to a small number of buckets, with a separate allocation per element and
+   no rehashing as the number of elements grows. */
+template <class K, PINDEX NumBuckets> class ChainedDict
+{
+    struct Node {
+      Node(const K & key, Element * data, Node * next) : m_key(key), m_data(data), m_next(next) { }
+      K         m_key;
+      Element * m_data;
+      Node    * m_next;
+    };
+    Node * m_buckets[NumBuckets];
+
+    static PINDEX Bucket(const K & key) { return ((size_t)key.HashFunction())%NumBuckets; }
+
+  public:
+    ChainedDict() { memset(m_buckets, 0, sizeof(m_buckets)); }
+    ~ChainedDict() { for (PINDEX i = 0; i < NumBuckets; ++i) while (m_buckets[i] != NULL) Remove(m_buckets[i]->m_key); }
+
+    void Insert(const K & key, Element * data)
+    {
+      Node * & head = m_buckets[Bucket(key)];
+      for (Node * node = head; node != NULL; node = node->m_next) {
+        if (node->m_key == key) {
+          node->m_data = data;
+          return;
+        }
+      }
+      head = new Node(key, data, head);
+    }
+
+    Element * GetAt(const K & key) const
+    {
+      for (Node * node = m_buckets[Bucket(key)]; node != NULL; node = node->m_next) {
+        if (node->m_key == key)
+          return node->m_data;
+      }
+      return NULL;
+    }
+
+    template <typename F> void Iterate(F fn) const
+    {
+      for (PINDEX i = 0; i < NumBuckets; ++i) {
+        for (Node * node = m_buckets[i]; node != NULL; node = node->m_next)
+          fn(node->m_key, *node->m_data);
+      }
+    }
+
+    void Remove(const K & key)
+    {
+      for (Node ** node = &m_buckets[Bucket(key)]; *node != NULL; node = &(*node)->m_next) {
+        if ((*node)->m_key == key) {
+          Node * next = (*node)->m_next;
+          delete *node;
+          *node = next;
+          return;
+        }
+      }
+    }
+};
+
+
+class StringChained : public Tester
+{
+    typedef ChainedDict<PString, 127> Type;
+    mutable Type data;
+
+  public:
+    virtual const char * GetName() const { return "String Chained"; }
+
+    virtual void TestInsert() const
+    {
+      for (size_t i = 0; i < StringKeys.size(); i++)
+        data.Insert(StringKeys[i], &DataElements[i]);
+    }
+
+    virtual bool TestLookup() const
+    {
+      return data.GetAt(StringKeys[StringKeys.size()/2]) != NULL;
+    }
+
+    virtual void TestIterate() const
+    {
+      void (*fn)(const PString &, const Element &) = DoNothing;
+      data.Iterate(fn);
+    }
+
+    virtual void TestRemove() const
+    {
+      for (size_t i = 0; i < StringKeys.size(); i++)
+        data.Remove(StringKeys[i]);
+    }
+};
+
+
 class IntMap : public Tester
 {
     typedef std::map<int, Element *> Type;
@@ -292,6 +390,40 @@ class IntDict : public Tester
 };
 
 
+class IntChained : public Tester
+{
+    typedef ChainedDict<POrdinalKey, 23> Type;
+    mutable Type data;
+
+  public:
+    virtual const char * GetName() const { return "Integer Chained"; }
+
+    virtual void TestInsert() const
+    {
+      for (size_t i = 0; i < IntKeys.size(); i++)
+        data.Insert(POrdinalKey(IntKeys[i]), &DataElements[i]);
+    }
+
+    virtual bool TestLookup() const
+    {
+      return data.GetAt(IntKeys[IntKeys.size()/2]) != NULL;
+    }
+
+    static void DoNothingKey(const POrdinalKey & key, const Element & element) { DoNothing((int)(PINDEX)key, element); }
+
+    virtual void TestIterate() const
+    {
+      data.Iterate(DoNothingKey);
+    }
+
+    virtual void TestRemove() const
+    {
+      for (size_t i = 0; i < IntKeys.size(); i++)
+        data.Remove(IntKeys[i]);
+    }
+};
+
+
 /**This is where all the activity happens. This class is launched on
    program startup, and does timing runs on the map and dictionaries
    to see which is faster */
@@ -419,8 +551,10 @@ void MapDictionary::TestAll()
        << endl;
   Test(StringMap());
   Test(StringDict());
+  Test(StringChained());
   Test(IntMap());
   Test(IntDict());
+  Test(IntChained());
   cout << endl;
 }
 
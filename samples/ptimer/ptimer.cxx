@@ -1105,6 +1105,7 @@ void UserInterfaceThread::Main()
        << "         D      average interval between instances " << endl
        << "         H or ? help"                                << endl
        << "         R      report count of threads done"        << endl
+       << "         S      timer list statistics"               << endl
        << "         T      time elapsed"                        << endl
        << "         X or Q exit "                               << endl;
  
@@ -1134,6 +1135,14 @@ void UserInterfaceThread::Main()
       cout << "\nHave completed " << launch.GetIteration() << " iterations" << endl;
       cout << "Command ? " << flush;
       break;
+    case 's' :
+      {
+        PTimer::List::Statistics stats;
+        PTimer::TimerList()->GetStatistics(stats);
+        cout << "\nTimer statistics: " << stats << endl;
+        cout << "Command ? " << flush;
+        break;
+      }
     case 't' :
       cout << "\nElapsed time is " << launch.GetElapsedTime() << " (Hours:mins:seconds.millseconds)" << endl;
       cout << "Command ? " << flush;
@@ -43,33 +43,150 @@ static const char * billionLaughs =
 static void TestXML(const PArgList & args, const PString & str)
 {
   PXML xml(PXML::Indent, NULL, args.GetOptionString('e'));
-  if (xml.Load(str))
-    PConsoleChannel(PConsoleChannel::StandardOutput) << xml << endl; // Use this so presents UTF-8 correctly
-  else
+  if (!xml.Load(str)) {
     cerr << "Parse error: line " << xml.GetErrorLine() << ", col " << xml.GetErrorColumn() << ", " << xml.GetErrorString() << endl;
+    return;
+  }
+
+  if (!args.HasOption('q')) {
+    PConsoleChannel console(PConsoleChannel::StandardOutput); // Use this so presents UTF-8 correctly
+    console << xml << endl;
+    return;
+  }
+
+  PXMLPath path(args.GetOptionString('q'));
+  if (!path.IsValid()) {
+    cerr << "Invalid path: " << path << endl;
+    return;
+  }
+
+  std::vector<PXMLElement *> elements;
+  if (!path.FindAll(xml, elements))
+    cout << "No match for " << path << endl;
+  for (size_t i = 0; i < elements.size(); ++i)
+    cout << elements[i]->GetPathName() << " = \"" << elements[i]->GetData() << '"' << endl;
+  cout << "Value: \"" << path.GetString(xml) << '"' << endl;
+}
+
+
+static void TestReader(const PArgList & args, const PString & str)
+{
+  PXMLReader reader(str, PXML::NoOptions, args.GetOptionString('e'));
+  for (;;) {
+    switch (reader.Next()) {
+      case PXMLReader::e_StartElement :
+        cout << setw(reader.GetDepth()*2) << ' ' << '<' << reader.GetName();
+        for (PStringToString::const_iterator it = reader.GetAttributes().begin(); it != reader.GetAttributes().end(); ++it)
+          cout << ' ' << it->first << "=\"" << it->second << '"';
+        cout << ">\n";
+        break;
+
+      case PXMLReader::e_EndElement :
+        cout << setw(reader.GetDepth()*2) << ' ' << "</" << reader.GetName() << ">\n";
+        break;
+
+      case PXMLReader::e_Data :
+        cout << setw(reader.GetDepth()*2+2) << ' ' << '"' << reader.GetData() << "\"\n";
+        break;
+
+      case PXMLReader::e_EndOfData :
+        cout << "End of data" << endl;
+        return;
+
+      default :
+        PString error;
+        unsigned col, line;
+        reader.GetErrorInfo(error, col, line);
+        cerr << "Parse error: line " << line << ", col " << col << ", " << error << endl;
+        return;
+    }
+  }
+}
+
+
+static void Benchmark(unsigned count)
+{
+  PStringStream strm;
+  strm << "<?xml version=\"1.0\"?><methodResponse><params><param><value><struct>";
+  for (unsigned i = 0; i < count; ++i)
+    strm << "<member><name>field" << i << "</name><value><int>" << i << "</int></value></member>";
+  strm << "</struct></value></param></params></methodResponse>";
+  PString text = strm;
+
+  static const unsigned Iterations = 10;
+  cout << "Loading " << text.GetLength() << " bytes, " << count << " members, " << Iterations << " times" << endl;
+
+  PTime start;
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PXML xml;
+    xml.Load(text);
+  }
+  cout << "PXML::Load:        " << (PTime() - start) / Iterations << endl;
+
+  start.SetCurrentTime();
+  unsigned total = 0;
+  for (unsigned i = 0; i < Iterations; ++i) {
+    PXMLReader reader(text);
+    while (reader.Next() > PXMLReader::e_EndOfData)
+      ++total;
+  }
+  cout << "PXMLReader events: " << (PTime() - start) / Iterations << ' ' << total/Iterations << " events" << endl;
+
+  static const unsigned Lookups = 100000;
+  cout << "\nLooking up last member, " << Lookups << " times" << endl;
+
+  for (int indexed = 0; indexed < 2; ++indexed) {
+    PXML xml(indexed ? PXML::IndexElements : PXML::NoOptions);
+    xml.Load(text);
+
+    start.SetCurrentTime();
+    for (unsigned i = 0; i < Lookups; ++i) {
+      PXMLElement * element = xml.GetElement("params");
+      element = element->GetElement("param");
+      element = element->GetElement("value");
+      element = element->GetElement("struct");
+      element = element->GetElement("member", count-1);
+      PAssert(element != NULL, PLogicError);
+    }
+    cout << "GetElement" << (indexed ? " indexed:   " : ":           ") << (PTime() - start) << endl;
+
+    PXMLPath path(psprintf("/methodResponse/params/param/value/struct/member[%u]/name", count));
+    start.SetCurrentTime();
+    for (unsigned i = 0; i < Lookups; ++i)
+      PAssert(path.Find(xml) != NULL, PLogicError);
+    cout << "PXMLPath" << (indexed ? " indexed:     " : ":             ") << (PTime() - start) << endl;
+  }
 }
 
 
 void PxmlTest::Main()
 {
   PArgList & args = GetArguments();
-  if (!args.Parse("s-simple.         Simple test\n"
-                  "b-billion-laughs. Billion laugh test\n"
-                  "e-encoding:       Set encoding character set\n"
-                  PTRACE_ARGLIST
-  ))
-    cerr << args.Usage("[ -e ] -s | -b | { file ... }") << endl;
+  args.Parse("s-simple.         Simple test\n"
+             "b-billion-laughs. Billion laugh test\n"
+             "e-encoding:       Set encoding character set\n"
+             "r-reader.         Output events from pull reader\n"
+             "q-query:          Output elements matching path\n"
+             "B-benchmark:      Benchmark with number of elements\n"
+             PTRACE_ARGLIST);
+
+  if (!args.IsParsed())
+    cerr << args.Usage("[ -e ] [ -r | -q path ] -s | -b | -B count | { file ... }") << endl;
+  else if (args.HasOption('B'))
+    Benchmark(args.GetOptionString('B').AsUnsigned());
   else if (args.HasOption('s'))
-    TestXML(args, testXML); 
+    (args.HasOption('r') ? TestReader : TestXML)(args, testXML);
   else if (args.HasOption('b'))
-    TestXML(args, billionLaughs); 
+    (args.HasOption('r') ? TestReader : TestXML)(args, billionLaughs);
+  else if (args.GetCount() == 0)
+    cerr << args.Usage("[ -e ] [ -r | -q path ] -s | -b | -B count | { file ... }") << endl;
   else {
     for (PINDEX i = 0; i < args.GetCount(); ++i) {
       PTextFile file;
       if (!file.Open(args[i], PFile::ReadOnly))
         cerr << "Could not open file: " << args[i] << " - " << file.GetErrorText() << endl;
       else
-        TestXML(args, file.ReadString(P_MAX_INDEX));
+        (args.HasOption('r') ? TestReader : TestXML)(args, file.ReadString(P_MAX_INDEX));
     }
   }
 }
@@ -81,10 +81,60 @@ void WaitForIncoming::operator () (PThread &)
 }
 
 
+static void TestMulti(PUDPSocket & rxSocket, WORD port)
+{
+  static const PINDEX Count = 8;
+  BYTE txData[Count][20];
+  BYTE rxData[Count][20];
+  PUDPSocket::Slice txSlices[Count];
+  PUDPSocket::Slice rxSlices[Count];
+  PUDPSocket::Datagram txDatagrams[Count];
+  PUDPSocket::Datagram rxDatagrams[Count];
+
+  PIPSocketAddressAndPort dest("127.0.0.1", port);
+  for (PINDEX i = 0; i < Count; ++i) {
+    memset(txData[i], (int)i, sizeof(txData[i]));
+    txSlices[i] = PUDPSocket::Slice(txData[i], 10+i);
+    txDatagrams[i] = PUDPSocket::Datagram(&txSlices[i], 1);
+    txDatagrams[i].m_ipAndPort = dest;
+    rxSlices[i] = PUDPSocket::Slice(rxData[i], i < Count-1 ? sizeof(rxData[i]) : 10);
+    rxDatagrams[i] = PUDPSocket::Datagram(&rxSlices[i], 1);
+  }
+
+  PUDPSocket txSocket;
+  PINDEX sent = txSocket.WriteToMulti(txDatagrams, Count);
+  PError << "WriteToMulti sent " << sent << " datagrams, " << txSocket.GetLastWriteCount() << " bytes" << endl;
+
+  rxSocket.SetReadTimeout(1000);
+  PINDEX received = 0;
+  while (received < sent) {
+    PINDEX count = rxSocket.ReadFromMulti(&rxDatagrams[received], Count-received);
+    if (count == 0) {
+      PError << "error: ReadFromMulti failed : " << rxSocket.GetErrorText(PChannel::LastReadError) << endl;
+      return;
+    }
+    PError << "ReadFromMulti received " << count << " datagrams, " << rxSocket.GetLastReadCount() << " bytes,"
+              " error=" << rxSocket.GetErrorCode(PChannel::LastReadError) << endl;
+    received += count;
+  }
+
+  for (PINDEX i = 0; i < received; ++i) {
+    PUDPSocket::Datagram & datagram = rxDatagrams[i];
+    PError << "  datagram " << i+1 << " from " << datagram.m_ipAndPort << " : len = " << datagram.m_length;
+    if (datagram.m_truncated)
+      PError << " (truncated)";
+    if (rxData[i][0] != i || memcmp(rxData[i], txData[i], std::min(datagram.m_length, (PINDEX)10+i)) != 0)
+      PError << " MISMATCH";
+    PError << endl;
+  }
+}
+
+
 void ScatterTest::Main()
 {
   PArgList & args = GetArguments();
   args.Parse(
+            "m-multi."
 #if PTRACING
             "t-trace."       "-no-trace."
             "o-output:"      "-no-output."
@@ -114,6 +164,11 @@ void ScatterTest::Main()
   WORD port = rxAddr.GetPort();
   PError << "listening socket opened on port " << port << endl;
 
+  if (args.HasOption('m')) {
+    TestMulti(rxSocket, port);
+    return;
+  }
+
   WaitForIncoming waiter(rxSocket);
   PThread * thread = new PThreadFunctor<WaitForIncoming>(waiter);
 
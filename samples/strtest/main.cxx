@@ -207,6 +207,183 @@ void Test4()
   delete thread;
 }
 
+////////////////////////////////////////////////
+//
+// test #5 - allocation count benchmark
+//
+
+#if PMEMORY_CHECK
+
+static unsigned GetAllocationCount()
+{
+  PMemoryHeap::State state;
+  PMemoryHeap::GetState(state);
+  return state.allocationNumber;
+}
+
+#elif defined(__GLIBC__)
+
+static volatile unsigned AllocationCount;
+
+extern "C" void * __libc_malloc(size_t size);
+
+extern "C" void * malloc(size_t size)
+{
+  __sync_fetch_and_add(&AllocationCount, 1);
+  return __libc_malloc(size);
+}
+
+static unsigned GetAllocationCount()
+{
+  return AllocationCount;
+}
+
+#else
+
+static unsigned GetAllocationCount()
+{
+  return 0;
+}
+
+#endif
+
+
+#define ALLOC_BENCHMARK(description, statement) \
+  { \
+    unsigned startAllocations = GetAllocationCount(); \
+    PTimeInterval startTime = PTimer::Tick(); \
+    for (unsigned i = 0; i < Iterations; ++i) { statement; } \
+    PTimeInterval duration = PTimer::Tick() - startTime; \
+    unsigned allocations = GetAllocationCount() - startAllocations; \
+    cout << setw(32) << left << description << right \
+         << setw(8) << fixed << setprecision(2) << (double)allocations/Iterations << " allocs/op " \
+         << setw(8) << setprecision(1) << duration.GetMicroSeconds()*1000.0/Iterations << " ns/op" << endl; \
+  }
+
+void Test5()
+{
+  static const unsigned Iterations = 1000000;
+
+  const PString shortString("short");
+  const PString longString("a string that is too long to fit internally");
+  const std::string stdString("std::string");
+  PString target;
+
+  ALLOC_BENCHMARK("Construct empty",             PString s);
+  ALLOC_BENCHMARK("Construct short from char *", PString s("hello"));
+  ALLOC_BENCHMARK("Construct long from char *",  PString s("a string that is too long to fit internally"));
+  ALLOC_BENCHMARK("Construct from std::string",  PString s(stdString));
+  ALLOC_BENCHMARK("Construct from integer",      PString s(i));
+  ALLOC_BENCHMARK("Copy short string",           PString s(shortString));
+  ALLOC_BENCHMARK("Copy long string",            PString s(longString));
+  ALLOC_BENCHMARK("Assign short string",         target = shortString);
+  ALLOC_BENCHMARK("Assign long string",          target = longString);
+  ALLOC_BENCHMARK("Concatenate short strings",   PString s = shortString + shortString);
+  ALLOC_BENCHMARK("Append to short string",      PString s(shortString); s += "ly");
+  ALLOC_BENCHMARK("Grow short to long string",   PString s(shortString); s += longString);
+  ALLOC_BENCHMARK("Make empty",                  target.MakeEmpty());
+
+  ALLOC_BENCHMARK("Array of ten short strings",  PStringArray a; for (PINDEX j = 0; j < 10; ++j) a.AppendString(shortString));
+
+  const PString csv("alpha,beta,gamma,delta,epsilon,zeta,eta,theta");
+  ALLOC_BENCHMARK("Tokenise to PStringArray",    PStringArray a = csv.Tokenise(","));
+  ALLOC_BENCHMARK("Tokenise to PStringView",     std::vector<PStringView> a = PStringView(csv).Tokenise(","));
+  ALLOC_BENCHMARK("Find in PString",             target = csv.Mid(csv.Find("theta")));
+  ALLOC_BENCHMARK("Find in PStringView",         target = PString(PStringView(csv).Mid(PStringView(csv).Find("theta"))));
+}
+
+
+////////////////////////////////////////////////
+//
+// test #6 - PStringView gives same results as PString
+//
+
+static unsigned ViewFailures;
+
+#define CHECK_VIEW(str, viewResult, stringResult) \
+  if ((viewResult) != (stringResult)) { \
+    cout << "PStringView mismatch for \"" << str << "\": " #viewResult " = \"" << (viewResult) \
+         << "\", " #stringResult " = \"" << (stringResult) << '"' << endl; \
+    ++ViewFailures; \
+  }
+
+static PString ViewTokens(const std::vector<PStringView> & tokens)
+{
+  PStringStream strm;
+  for (size_t i = 0; i < tokens.size(); ++i)
+    strm << '[' << tokens[i] << ']';
+  return strm;
+}
+
+static PString StringTokens(const PStringArray & tokens)
+{
+  PStringStream strm;
+  for (PINDEX i = 0; i < tokens.GetSize(); ++i)
+    strm << '[' << tokens[i] << ']';
+  return strm;
+}
+
+void Test6()
+{
+  static const char * const Strings[] = {
+    "", " ", "a", "ab", "  hello  world  ", "\t x \r\n", "abcabcab", "a,,b,", ",a,b", "key=value=more", "=", "a\nb\r\nc\rd\n\n"
+  };
+  static const char * const Needles[] = { "", "a", "b", "bc", "cab", "world", "abcabcabc", "," };
+  static const char * const Separators[] = { ",", " \t", "=", ",b" };
+  static const PString::SplitOptions_Bits SplitOptions[] = {
+    PString::SplitTrim,
+    PString::SplitDefaultToBefore,
+    PString::SplitDefaultToAfter,
+    PString::SplitTrimBefore|PString::SplitDefaultToAfter,
+    PString::SplitBeforeNonEmpty,
+    PString::SplitAfterNonEmpty
+  };
+
+  for (PINDEX s = 0; s < PARRAYSIZE(Strings); ++s) {
+    const PString str(Strings[s]);
+    const PStringView view(str);
+    const PINDEX len = str.GetLength();
+    const PINDEX Positions[] = { 0, 1, 2, len > 0 ? len-1 : 0, len, len+3, P_MAX_INDEX };
+
+    for (PINDEX i = 0; i < PARRAYSIZE(Positions); ++i) {
+      for (PINDEX j = 0; j < PARRAYSIZE(Positions); ++j) {
+        CHECK_VIEW(str, PString(view.Mid(Positions[i], Positions[j])), str.Mid(Positions[i], Positions[j]));
+        CHECK_VIEW(str, PString(view(Positions[i], Positions[j])), str(Positions[i], Positions[j]));
+      }
+      CHECK_VIEW(str, PString(view.Left(Positions[i])), str.Left(Positions[i]));
+      CHECK_VIEW(str, PString(view.Right(Positions[i])), str.Right(Positions[i]));
+      CHECK_VIEW(str, view.Find('b', Positions[i]), str.Find('b', Positions[i]));
+      CHECK_VIEW(str, view.FindLast('a', Positions[i]), str.FindLast('a', Positions[i]));
+      CHECK_VIEW(str, view.FindOneOf(", ", Positions[i]), str.FindOneOf(", ", Positions[i]));
+      CHECK_VIEW(str, view.FindSpan("ab ", Positions[i]), str.FindSpan("ab ", Positions[i]));
+      for (PINDEX n = 0; n < PARRAYSIZE(Needles); ++n)
+        CHECK_VIEW(str, view.Find(Needles[n], Positions[i]), str.Find(Needles[n], Positions[i]));
+    }
+
+    CHECK_VIEW(str, PString(view.Trim()), str.Trim());
+    CHECK_VIEW(str, PString(view.LeftTrim()), str.LeftTrim());
+    CHECK_VIEW(str, PString(view.RightTrim()), str.RightTrim());
+
+    for (PINDEX sep = 0; sep < PARRAYSIZE(Separators); ++sep) {
+      for (PINDEX opt = 0; opt < PARRAYSIZE(SplitOptions); ++opt) {
+        PStringView viewBefore, viewAfter;
+        PString strBefore, strAfter;
+        CHECK_VIEW(str, view.Split(Separators[sep], viewBefore, viewAfter, SplitOptions[opt]),
+                        str.Split(Separators[sep], strBefore, strAfter, SplitOptions[opt]));
+        CHECK_VIEW(str, PString(viewBefore), strBefore);
+        CHECK_VIEW(str, PString(viewAfter), strAfter);
+      }
+
+      CHECK_VIEW(str, ViewTokens(view.Tokenise(Separators[sep], true)), StringTokens(str.Tokenise(Separators[sep], true)));
+      CHECK_VIEW(str, ViewTokens(view.Tokenise(Separators[sep], false)), StringTokens(str.Tokenise(Separators[sep], false)));
+    }
+
+    CHECK_VIEW(str, ViewTokens(view.Lines()), StringTokens(str.Lines()));
+  }
+
+  cout << "PStringView checks " << (ViewFailures == 0 ? "passed" : "FAILED") << endl;
+}
+
 ////////////////////////////////////////////////
 //
 // main
@@ -228,4 +405,6 @@ void StringTest::Main()
   Test2(); cout << "End of test #2\n" << endl;
   Test3(); cout << "End of test #3\n" << endl;
   Test4(); cout << "End of test #4\n" << endl;
+  Test5(); cout << "End of test #5\n" << endl;
+  Test6(); cout << "End of test #6\n" << endl;
 }
@@ -33,6 +33,7 @@
 
 #include <ptlib.h>
 #include <ptlib/pprocess.h>
+#include <ptclib/threadpool.h>
 
 /*
  * Thread #1 displays the number 1 every 10ms.
@@ -132,6 +133,176 @@ void LockBthenA(PMutex & a, PMutex & b)
 }
 
 
+/*
+ * Contention benchmarks.
+ * Each thread does a number of operations, so the cost with many concurrent
+ * threads is measured. For the read/write mutex, there are read locks with a
+ * write lock every so often.
+ */
+struct ThreadBench
+{
+  PReadWriteMutex m_mutex;
+  unsigned        m_iterations;
+  unsigned        m_writeEvery;
+  unsigned        m_counter;
+  atomic<size_t>  m_total;
+};
+
+
+void RWMutexBenchThread(ThreadBench & bench)
+{
+  unsigned value = 0;
+  for (unsigned i = 1; i <= bench.m_iterations; ++i) {
+    if (bench.m_writeEvery > 0 && i % bench.m_writeEvery == 0) {
+      PWriteWaitAndSignal lock(bench.m_mutex);
+      ++bench.m_counter;
+    }
+    else {
+      PReadWaitAndSignal lock(bench.m_mutex);
+      value += bench.m_counter;
+    }
+  }
+  bench.m_total += value;
+}
+
+
+void CurrentThreadBenchThread(ThreadBench & bench)
+{
+  size_t value = 0;
+  for (unsigned i = 0; i < bench.m_iterations; ++i)
+    value += (size_t)PThread::Current();
+  bench.m_total += value;
+}
+
+
+void ThreadBenchmark(void (*function)(ThreadBench &), unsigned maxThreads, unsigned iterations, unsigned writeEvery)
+{
+  for (unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+    ThreadBench bench;
+    bench.m_iterations = iterations;
+    bench.m_writeEvery = writeEvery;
+    bench.m_counter = 0;
+    bench.m_total = 0;
+
+    PTime start;
+    std::vector<PThread *> threads;
+    for (unsigned i = 0; i < threadCount; ++i)
+      threads.push_back(new PThread1Arg<ThreadBench &>(bench, function));
+    for (unsigned i = 0; i < threadCount; ++i) {
+      threads[i]->WaitForTermination();
+      delete threads[i];
+    }
+    PTimeInterval elapsed = PTime() - start;
+
+    int64_t total = (int64_t)iterations*threadCount;
+    cout << setw(4) << threadCount << " threads: " << elapsed << "s, "
+         << (elapsed.GetMicroSeconds()*1000/total) << "ns/call, "
+         << total*1000/std::max(elapsed.GetMilliSeconds(), (int64_t)1) << " calls/s"
+         << endl;
+  }
+}
+
+
+/*
+ * Thread pool benchmark.
+ * Every so often a long job is queued amongst many short ones, at a rate
+ * that keeps about half the workers busy with long jobs. The latency
+ * of the short jobs shows how much they are held up behind the long ones.
+ * Grouped work is also queued, and checked that it executes in order.
+ */
+struct PoolBench
+{
+  atomic<unsigned> m_remaining;
+  atomic<int64_t>  m_totalLatency;
+  atomic<int64_t>  m_maxLatency;
+  atomic<unsigned> m_nextInGroup;
+  atomic<unsigned> m_outOfOrder;
+  PSyncPoint       m_done;
+};
+
+
+struct PoolBenchWork
+{
+  PoolBenchWork(PoolBench & bench, unsigned duration, unsigned sequence = UINT_MAX)
+    : m_bench(bench)
+    , m_duration(duration)
+    , m_sequence(sequence)
+  { }
+
+  void Work()
+  {
+    int64_t latency = m_queued.GetElapsed().GetMicroSeconds();
+
+    if (m_sequence != UINT_MAX) {
+      if (m_bench.m_nextInGroup++ != m_sequence)
+        ++m_bench.m_outOfOrder;
+    }
+    else if (m_duration == 0) {
+      m_bench.m_totalLatency += latency;
+      int64_t maxLatency = m_bench.m_maxLatency;
+      while (latency > maxLatency && !m_bench.m_maxLatency.compare_exchange_strong(maxLatency, latency))
+        ;
+    }
+
+    if (m_duration > 0)
+      PThread::Sleep(m_duration);
+
+    if (--m_bench.m_remaining == 0)
+      m_bench.m_done.Signal();
+  }
+
+  PoolBench & m_bench;
+  unsigned    m_duration;
+  unsigned    m_sequence;
+  PTime       m_queued;
+};
+
+
+template <class Pool>
+void PoolBenchmark(const char * name, unsigned workers, unsigned jobs)
+{
+  static const unsigned LongJobEvery = 50;
+  static const unsigned LongJobTime = 100;
+
+  unsigned grouped = jobs/10;
+  unsigned shortJobs = 0;
+
+  PoolBench bench;
+  bench.m_remaining = jobs + grouped;
+  bench.m_totalLatency = 0;
+  bench.m_maxLatency = 0;
+  bench.m_nextInGroup = 0;
+  bench.m_outOfOrder = 0;
+
+  PTime start;
+  {
+    Pool pool(workers, 0, "PoolBench");
+    for (unsigned i = 0; i < jobs; ++i) {
+      if (i % LongJobEvery == 0)
+        pool.AddWork(new PoolBenchWork(bench, LongJobTime));
+      else {
+        pool.AddWork(new PoolBenchWork(bench, 0));
+        ++shortJobs;
+      }
+      if (i % 10 == 0)
+        pool.AddWork(new PoolBenchWork(bench, 0, i/10), "group");
+      PThread::Sleep(1); // Keep the pool busy, but not saturated
+    }
+    bench.m_done.Wait();
+  }
+  PTimeInterval elapsed = PTime() - start;
+
+  cout << setw(16) << name << ": " << elapsed << "s, "
+       << "short job latency avg " << (int64_t)bench.m_totalLatency/std::max(shortJobs, 1U) << "us, "
+       << "max " << (int64_t)bench.m_maxLatency << "us, ";
+  if (bench.m_outOfOrder == 0)
+    cout << "grouped work in order";
+  else
+    cout << bench.m_outOfOrder << " grouped work out of order";
+  cout << endl;
+}
+
+
 /*
  * The main program class
  */
@@ -150,7 +321,42 @@ void ThreadTest::Main()
   cout << "Thread Test Program" << endl;
 
   PArgList & args = GetArguments();
-  args.Parse("d-deadlock. Test deadlock detection");
+  args.Parse("d-deadlock. Test deadlock detection\n"
+             "b-rwbench: Benchmark read/write mutex contention, up to N threads\n"
+             "c-current: Benchmark PThread::Current(), up to N threads\n"
+             "p-pool: Benchmark queued and work stealing thread pools, with N workers\n"
+             "j-jobs: Jobs queued in thread pool benchmark, default 1000\n"
+             "i-iterations: Calls per thread in benchmark, default 1000000\n"
+             "w-write-every: Write lock every N locks in benchmark, 0 is never, default 1000\n");
+
+  unsigned iterations = args.GetOptionAs('i', 1000000U);
+
+  if (args.HasOption('b')) {
+    unsigned writeEvery = args.GetOptionAs('w', 1000U);
+    cout << "Read/write mutex benchmark, " << iterations << " locks per thread, ";
+    if (writeEvery > 0)
+      cout << "write lock every " << writeEvery;
+    else
+      cout << "no write locks";
+    cout << endl;
+    ThreadBenchmark(RWMutexBenchThread, args.GetOptionAs('b', 8U), iterations, writeEvery);
+    return;
+  }
+
+  if (args.HasOption('c')) {
+    cout << "PThread::Current() benchmark, " << iterations << " calls per thread" << endl;
+    ThreadBenchmark(CurrentThreadBenchThread, args.GetOptionAs('c', 8U), iterations, 0);
+    return;
+  }
+
+  if (args.HasOption('p')) {
+    unsigned workers = args.GetOptionAs('p', 4U);
+    unsigned jobs = args.GetOptionAs('j', 1000U);
+    cout << "Thread pool benchmark, " << workers << " workers, " << jobs << " jobs" << endl;
+    PoolBenchmark< PQueuedThreadPool<PoolBenchWork> >("Queued", workers, jobs);
+    PoolBenchmark< PWorkStealingThreadPool<PoolBenchWork> >("Work stealing", workers, jobs);
+    return;
+  }
 
   if (args.HasOption('d')) {
     cout << "Testing deadlock detection." << endl;
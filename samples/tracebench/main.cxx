@@ -0,0 +1,155 @@
+/*
+ * main.cxx
+ *
+ * PTLib application source file for trace output benchmark.
+ *
+ * Compares the time taken by threads producing trace output in the
+ * normal synchronous mode, and with the PTrace::AsynchronousOutput option.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+
+#include <vector>
+
+
+class TraceBench : public PProcess
+{
+  PCLASSINFO(TraceBench, PProcess)
+
+  public:
+    TraceBench()
+      : PProcess("PTLib", "TraceBench", 1, 0, AlphaCode, 1)
+      , m_threads(4)
+      , m_records(100000)
+    {
+    }
+
+    void Main();
+
+  protected:
+    void Run(bool async);
+    void ProduceTrace();
+
+    unsigned m_threads;
+    unsigned m_records;
+};
+
+
+PCREATE_PROCESS(TraceBench);
+
+
+void TraceBench::Main()
+{
+  PArgList & args = GetArguments();
+  args.Parse("T-threads:"
+             "r-records:"
+             "b-buffer:"
+             "B-binary."
+             "o-output:"
+             "h-help.");
+
+  if (args.HasOption('h')) {
+    cout << "usage: " << GetFile().GetTitle() << " [ options ]\n"
+            "     -T --threads #  : number of threads producing trace output (4)\n"
+            "     -r --records #  : number of trace records per thread (100000)\n"
+            "     -b --buffer #   : per-thread buffer size for async mode (65536)\n"
+            "     -B --binary     : use binary trace format, decode with tracedecode\n"
+            "     -o --output     : file for trace output, default is " << GetFile().GetTitle() << ".log\n"
+            "     -h --help       : Get this help message\n"
+         << endl;
+    return;
+  }
+
+#if PTRACING
+  m_threads = args.GetOptionString('T', "4").AsUnsigned();
+  m_records = args.GetOptionString('r', "100000").AsUnsigned();
+  if (m_threads == 0 || m_records == 0) {
+    cerr << "Illegal number of threads or records\n";
+    return;
+  }
+
+  PTrace::SetAsyncBufferSize(args.GetOptionString('b', "65536").AsUnsigned());
+
+  PTrace::Initialise(4,
+                     args.GetOptionString('o', GetFile().GetTitle() + ".log"),
+                     PTrace::Timestamp | PTrace::Thread | PTrace::FileAndLine |
+                     (args.HasOption('B') ? PTrace::BinaryFormat : 0));
+
+  cout << "Running " << m_threads << " threads, " << m_records << " records each, to "
+       << PTrace::GetFilename() << endl;
+
+  cout << setw(8) << left << "Mode" << right
+       << setw(12) << "Time"
+       << setw(14) << "Records/sec"
+       << setw(10) << "Dropped"
+       << endl;
+  Run(false);
+  Run(true);
+#else
+  cout << "Trace not enabled in library" << endl;
+#endif
+}
+
+
+void TraceBench::Run(bool PTRACE_PARAM(async))
+{
+#if PTRACING
+  if (async)
+    PTrace::SetOptions(PTrace::AsynchronousOutput);
+  else
+    PTrace::ClearOptions(PTrace::AsynchronousOutput);
+
+  uint64_t droppedBefore = PTrace::GetAsyncDropCount();
+
+  std::vector<PThread *> threads;
+  PTime start;
+
+  for (unsigned i = 0; i < m_threads; ++i)
+    threads.push_back(new PThreadObj<TraceBench>(*this, &TraceBench::ProduceTrace, false, "Producer"));
+
+  for (unsigned i = 0; i < m_threads; ++i) {
+    threads[i]->WaitForTermination();
+    delete threads[i];
+  }
+
+  PTimeInterval duration = start.GetElapsed();
+
+  // Let the writer catch up before getting drop count
+  if (async)
+    PThread::Sleep(500);
+
+  cout << setw(8) << left << (async ? "async" : "sync") << right
+       << setw(12) << duration
+       << setw(14) << (PInt64)(m_threads*(double)m_records*1000/std::max(PInt64(1), duration.GetMilliSeconds()))
+       << setw(10) << (PTrace::GetAsyncDropCount() - droppedBefore)
+       << endl;
+#endif
+}
+
+
+void TraceBench::ProduceTrace()
+{
+  for (unsigned i = 0; i < m_records; ++i)
+    PTRACE(4, "TraceBench", "Record " << i << " of " << m_records << ", some padding to make a typical length line");
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -0,0 +1,192 @@
+/*
+ * main.cxx
+ *
+ * PTLib application source file for colour converter benchmark.
+ *
+ * Times every registered colour converter at each level of SIMD acceleration
+ * the CPU supports, and checks the accelerated output is identical to the
+ * plain C++ implementation.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+#include <ptlib/vconvert.h>
+#include <ptclib/random.h>
+
+
+class ConvertBench : public PProcess
+{
+  PCLASSINFO(ConvertBench, PProcess)
+
+  public:
+    ConvertBench()
+      : PProcess("PTLib", "ConvertBench", 1, 0, AlphaCode, 1)
+      , m_width(1920)
+      , m_height(1080)
+      , m_frames(50)
+    {
+    }
+
+    void Main();
+
+  protected:
+    bool Run(const PColourPair & pair);
+
+    unsigned m_width;
+    unsigned m_height;
+    unsigned m_frames;
+    PColourConverter::Acceleration m_maxAcceleration;
+};
+
+
+PCREATE_PROCESS(ConvertBench);
+
+
+void ConvertBench::Main()
+{
+  PArgList & args = GetArguments();
+  args.Parse("s-size:"
+             "f-frames:"
+             "c-converter:"
+             "h-help.");
+
+  if (args.HasOption('h')) {
+    cout << "usage: " << GetFile().GetTitle() << " [ options ]\n"
+            "     -s --size WxH   : frame size, or name e.g. cif, hd720 (hd1080)\n"
+            "     -f --frames #   : number of frames converted for each timing (50)\n"
+            "     -c --converter  : only converters with this source or destination format\n"
+            "     -h --help       : Get this help message\n"
+         << endl;
+    return;
+  }
+
+  if (!PVideoFrameInfo::ParseSize(args.GetOptionString('s', "hd1080"), m_width, m_height)) {
+    cerr << "Illegal frame size \"" << args.GetOptionString('s') << '"' << endl;
+    SetTerminationValue(1);
+    return;
+  }
+
+  m_frames = args.GetOptionString('f', "50").AsUnsigned();
+  if (m_frames == 0) {
+    cerr << "Illegal number of frames" << endl;
+    SetTerminationValue(1);
+    return;
+  }
+
+  m_maxAcceleration = PColourConverter::SetAcceleration(PColourConverter::EndAcceleration);
+
+  cout << "Converting " << m_frames << " frames of " << m_width << 'x' << m_height
+       << ", CPU supports " << m_maxAcceleration << '\n'
+       << setw(24) << left << "Conversion" << right;
+  for (PColourConverter::Acceleration level = PColourConverter::BeginAcceleration; level <= m_maxAcceleration; ++level)
+    cout << setw(20) << level;
+  cout << endl;
+
+  PString filter = args.GetOptionString('c');
+  unsigned failed = 0;
+
+  PColourConverterFactory::KeyList_T keys = PColourConverterFactory::GetKeyList();
+  for (PColourConverterFactory::KeyList_T::iterator it = keys.begin(); it != keys.end(); ++it) {
+    if (filter.IsEmpty() || it->GetSrcColourFormat() == filter || it->GetDstColourFormat() == filter) {
+      if (!Run(*it))
+        ++failed;
+    }
+  }
+
+  PColourConverter::SetAcceleration(m_maxAcceleration);
+  SetTerminationValue(failed > 0 ? 1 : 0);
+}
+
+
+bool ConvertBench::Run(const PColourPair & pair)
+{
+  cout << setw(24) << left << (pair.GetSrcColourFormat() + "->" + pair.GetDstColourFormat()) << right << flush;
+
+  // Random data is not a valid compressed image
+  if (pair.GetSrcColourFormat().Find("JPEG") != P_MAX_INDEX) {
+    cout << "  skipped" << endl;
+    return true;
+  }
+
+  PVideoFrameInfo srcInfo(m_width, m_height, pair.GetSrcColourFormat());
+  PVideoFrameInfo dstInfo(m_width, m_height, pair.GetDstColourFormat());
+  PColourConverter * converter = PColourConverter::Create(srcInfo, dstInfo);
+  if (converter == NULL) {
+    cout << "  could not create" << endl;
+    return true;
+  }
+
+  PBYTEArray src(PVideoFrameInfo::CalculateFrameBytes(m_width, m_height, pair.GetSrcColourFormat()));
+  PBYTEArray dst(PVideoFrameInfo::CalculateFrameBytes(m_width, m_height, pair.GetDstColourFormat()));
+  if (src.IsEmpty() || dst.IsEmpty()) {
+    cout << "  unknown frame size" << endl;
+    delete converter;
+    return true;
+  }
+
+  PRandom random(1);
+  for (PINDEX i = 0; i < src.GetSize(); ++i)
+    src[i] = (BYTE)random.Generate();
+
+  bool ok = true;
+  PBYTEArray reference;
+  double baseline = 0;
+  for (PColourConverter::Acceleration level = PColourConverter::BeginAcceleration; level <= m_maxAcceleration; ++level) {
+    PColourConverter::SetAcceleration(level);
+
+    // Same initial destination, as some converters do not write every byte
+    memset(dst.GetPointer(), 0x55, dst.GetSize());
+    if (!converter->Convert(src, dst.GetPointer())) {
+      cout << "  conversion failed";
+      break;
+    }
+
+    if (level == PColourConverter::NoAcceleration)
+      reference = dst;
+    else if (dst != reference) {
+      PINDEX i = 0;
+      while (dst[i] == reference[i])
+        ++i;
+      cout << "  MISMATCH at byte " << i;
+      ok = false;
+      break;
+    }
+
+    PTime start;
+    for (unsigned frame = 0; frame < m_frames; ++frame)
+      converter->Convert(src, dst.GetPointer());
+    double milliseconds = start.GetElapsed().GetMicroSeconds()/1000.0/m_frames;
+
+    cout << setw(10) << fixed << setprecision(3) << milliseconds << "ms";
+    if (level == PColourConverter::NoAcceleration) {
+      baseline = milliseconds;
+      cout << "        ";
+    }
+    else
+      cout << " (x" << setw(4) << setprecision(1) << (baseline/std::max(milliseconds, 0.001)) << ')';
+  }
+
+  cout << endl;
+  delete converter;
+  return ok;
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -1052,6 +1052,37 @@ bool PCLI::SetCommand(const char * commands,
 }
 
 
+bool PCLI::SetLockProfilingCommand(const char * commands)
+{
+  return SetCommand(commands, PCREATE_NOTIFIER(LockProfilingCommand),
+                    "Control and display lock contention profile",
+                    "[ enable | disable | reset | html ]");
+}
+
+
+void PCLI::LockProfilingCommand(Arguments & args, P_INT_PTR)
+{
+  if (args.GetCount() == 0)
+    PProfiling::AnalyseLocks(args.GetContext(), false);
+  else if (args[0] *= "enable") {
+    PProfiling::EnableLockProfiling(true);
+    args.GetContext() << "Lock profiling enabled" << endl;
+  }
+  else if (args[0] *= "disable") {
+    PProfiling::EnableLockProfiling(false);
+    args.GetContext() << "Lock profiling disabled" << endl;
+  }
+  else if (args[0] *= "reset") {
+    PProfiling::ResetLockProfiling();
+    args.GetContext() << "Lock profiling reset" << endl;
+  }
+  else if (args[0] *= "html")
+    PProfiling::AnalyseLocks(args.GetContext(), true);
+  else
+    args.WriteUsage();
+}
+
+
 void PCLI::ShowHelp(Context & context, const PArgList & partial)
 {
   PINDEX i;
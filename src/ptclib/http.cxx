@@ -56,13 +56,20 @@ const PCaselessString & PHTTP::HostTag             () { static const PConstCasel
 const PCaselessString & PHTTP::AllowTag            () { static const PConstCaselessString s("Allow"); return s; }
 const PCaselessString & PHTTP::AuthorizationTag    () { static const PConstCaselessString s("Authorization"); return s; }
 const PCaselessString & PHTTP::ContentEncodingTag  () { static const PConstCaselessString s("Content-Encoding"); return s; }
+const PCaselessString & PHTTP::AcceptEncodingTag   () { static const PConstCaselessString s("Accept-Encoding"); return s; }
 const PCaselessString & PHTTP::ContentLengthTag    () { static const PConstCaselessString s("Content-Length"); return s; }
 const PCaselessString & PHTTP::DateTag             () { static const PConstCaselessString s("Date"); return s; }
 const PCaselessString & PHTTP::ExpiresTag          () { static const PConstCaselessString s("Expires"); return s; }
 const PCaselessString & PHTTP::FromTag             () { static const PConstCaselessString s("From"); return s; }
 const PCaselessString & PHTTP::IfModifiedSinceTag  () { static const PConstCaselessString s("If-Modified-Since"); return s; }
+const PCaselessString & PHTTP::IfNoneMatchTag      () { static const PConstCaselessString s("If-None-Match"); return s; }
+const PCaselessString & PHTTP::ETagTag             () { static const PConstCaselessString s("ETag"); return s; }
 const PCaselessString & PHTTP::LastModifiedTag     () { static const PConstCaselessString s("Last-Modified"); return s; }
 const PCaselessString & PHTTP::LocationTag         () { static const PConstCaselessString s("Location"); return s; }
+const PCaselessString & PHTTP::RangeTag            () { static const PConstCaselessString s("Range"); return s; }
+const PCaselessString & PHTTP::ContentRangeTag     () { static const PConstCaselessString s("Content-Range"); return s; }
+const PCaselessString & PHTTP::AcceptRangesTag     () { static const PConstCaselessString s("Accept-Ranges"); return s; }
+const PCaselessString & PHTTP::VaryTag             () { static const PConstCaselessString s("Vary"); return s; }
 const PCaselessString & PHTTP::PragmaTag           () { static const PConstCaselessString s("Pragma"); return s; }
 const PCaselessString & PHTTP::PragmaNoCacheTag    () { static const PConstCaselessString s("no-cache"); return s; }
 const PCaselessString & PHTTP::RefererTag          () { static const PConstCaselessString s("Referer"); return s; }
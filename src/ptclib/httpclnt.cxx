@@ -36,6 +36,10 @@
 #include <ptclib/pssl.h>
 #endif
 
+#if P_ZLIB
+#include <ptclib/pzlib.h>
+#endif
+
 #include <ctype.h>
 
 
@@ -235,12 +239,71 @@ struct PHTTPClient_FileWriter : public PHTTPContentProcessor
 };
 
 
+#if P_ZLIB
+struct PHTTPClient_DecodingProcessor : public PHTTPContentProcessor
+{
+  PHTTPContentProcessor & m_target;
+  PZLib      m_zlib;
+  BYTE       m_buffer[8192];
+  PBYTEArray m_decoded;
+  PINDEX     m_totalSize;
+
+  PHTTPClient_DecodingProcessor(PHTTPContentProcessor & target)
+    : PHTTPContentProcessor(true)
+    , m_target(target)
+    , m_zlib(PZLib::e_Decompress, PZLib::e_AutoDetect)
+    , m_totalSize(0)
+  {
+  }
+
+  virtual void * GetBuffer(PINDEX & size)
+  {
+    // Never the requested size, so everything goes through Process()
+    size = size != sizeof(m_buffer) ? sizeof(m_buffer) : sizeof(m_buffer)-1;
+    return m_buffer;
+  }
+
+  virtual bool Process(const void * data, PINDEX length)
+  {
+    if (!m_zlib.Process(data, length, m_decoded))
+      return false;
+
+    const BYTE * ptr = m_decoded;
+    PINDEX left = m_decoded.GetSize();
+    m_totalSize += left;
+    while (left > 0) {
+      PINDEX size = left;
+      void * buffer = m_target.GetBuffer(size);
+      if (buffer == NULL)
+        return false;
+
+      if (size == left) {
+        memcpy(buffer, ptr, left);
+        break;
+      }
+
+      if (size > left)
+        size = left;
+      memcpy(buffer, ptr, size);
+      if (!m_target.Process(buffer, size))
+        return false;
+      ptr += size;
+      left -= size;
+    }
+
+    return true;
+  }
+};
+#endif // P_ZLIB
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PHTTPClient
 
 PHTTPClient::PHTTPClient(const PString & userAgent)
   : m_userAgentName(userAgent)
   , m_persist(true)
+  , m_contentDecoding(true)
   , m_maxRedirects(10)
   , m_authentication(NULL)
 {
@@ -290,6 +353,11 @@ PHTTP::StatusCode PHTTPClient::ExecuteCommand(Commands cmd,
   if (m_persist && !outMIME.Contains(ConnectionTag()))
     outMIME.SetAt(ConnectionTag(), KeepAliveTag());
 
+#if P_ZLIB
+  if (m_contentDecoding && !outMIME.Contains(AcceptEncodingTag()))
+    outMIME.SetAt(AcceptEncodingTag(), "gzip, deflate");
+#endif
+
   unsigned redirectCount = m_maxRedirects;
   bool needAuthentication = true;
   bool forceReopen = !m_persist;
@@ -526,6 +594,32 @@ bool PHTTPClient::ReadContentBody(PMIMEInfo & replyMIME, PBYTEArray & body)
 
 
 bool PHTTPClient::ReadContentBody(PMIMEInfo & replyMIME, ContentProcessor & processor)
+{
+#if P_ZLIB
+  PZLib::Format format;
+  if (m_contentDecoding && PZLib::GetFormat(replyMIME.GetString(ContentEncodingTag()).Trim(), format)) {
+    PHTTPClient_DecodingProcessor decoder(processor);
+    if (!InternalReadContentBody(replyMIME, decoder))
+      return false;
+
+    // Compressed stream has its own end marker, without it the body was cut short
+    if (!decoder.m_zlib.IsFinished()) {
+      PTRACE(2, "Truncated " << replyMIME.GetString(ContentEncodingTag()) << " content, only decoded " << decoder.m_totalSize << " bytes");
+      return false;
+    }
+
+    PTRACE(4, "Decoded " << replyMIME.GetString(ContentEncodingTag()) << " content to " << decoder.m_totalSize << " bytes");
+    replyMIME.RemoveAt(ContentEncodingTag());
+    replyMIME.SetAt(ContentLengthTag(), decoder.m_totalSize);
+    return true;
+  }
+#endif // P_ZLIB
+
+  return InternalReadContentBody(replyMIME, processor);
+}
+
+
+bool PHTTPClient::InternalReadContentBody(PMIMEInfo & replyMIME, ContentProcessor & processor)
 {
   PCaselessString encoding = replyMIME(TransferEncodingTag());
 
@@ -803,6 +897,12 @@ bool PHTTPClient::DeleteDocument(const PURL & url)
 
 
 bool PHTTPClient::ConnectURL(const PURL & url)
+{
+  return ConnectURL(url, PIPSocket::GetInvalidAddress());
+}
+
+
+bool PHTTPClient::ConnectURL(const PURL & url, const PIPSocket::Address & address)
 {
   if (IsOpen())
     return true;
@@ -813,6 +913,9 @@ bool PHTTPClient::ConnectURL(const PURL & url)
   if (host.IsEmpty())
     return SetLastResponse(BadRequest, "No host specified");
 
+  // Connect to resolved address if we have one, but still use name for SNI etc
+  PString connectHost = address.IsValid() ? address.AsString(true) : host;
+
 #if P_SSL
   if (url.GetScheme() == "https" || url.GetScheme() == "wss") {
     PAutoPtr<PSSLChannel> ssl;
@@ -820,7 +923,7 @@ bool PHTTPClient::ConnectURL(const PURL & url)
     for (;;) {
       PAutoPtr<PTCPSocket> tcp(new PTCPSocket(url.GetPort()));
       tcp->SetReadTimeout(readTimeout);
-      if (!tcp->Connect(host))
+      if (!tcp->Connect(connectHost))
         return SetLastResponse(TransportConnectError, PSTRSTRM("TCP connect fail: " << tcp->GetErrorText() << " (errno=" << tcp->GetErrorNumber() << ')'));
 
       PAutoPtr<PSSLContext> context(new PSSLContext(method));
@@ -847,7 +950,7 @@ bool PHTTPClient::ConnectURL(const PURL & url)
   else
 #endif
 
-  if (!Connect(host, url.GetPort()))
+  if (!Connect(connectHost, url.GetPort()))
     return SetLastResponse(TransportConnectError, PString::Empty());
 
   PTRACE(5, "Connected to " << host);
@@ -1254,6 +1357,145 @@ void PHTTPClientPool::SetSSLCredentials(const PString & authority, const PString
 #endif
 
 
+const unsigned PHTTPClientPool::Statistics::LatencyBucketLimits[NumLatencyBuckets-1] = {
+  1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000
+};
+
+
+PHTTPClientPool::Statistics::Statistics()
+  : m_requests(0)
+  , m_failures(0)
+  , m_retries(0)
+  , m_pipelined(0)
+  , m_connects(0)
+  , m_reused(0)
+  , m_dnsHits(0)
+  , m_dnsMisses(0)
+  , m_connections(0)
+{
+  memset(m_connectHistogram, 0, sizeof(m_connectHistogram));
+  memset(m_firstByteHistogram, 0, sizeof(m_firstByteHistogram));
+  memset(m_totalHistogram, 0, sizeof(m_totalHistogram));
+}
+
+
+static void OutputLatencyHistogram(ostream & strm, const char * name, const uint64_t * histogram)
+{
+  strm << ' ' << name << "-ms:";
+  for (PINDEX i = 0; i < PHTTPClientPool::Statistics::NumLatencyBuckets; ++i) {
+    strm << ' ';
+    if (i < PHTTPClientPool::Statistics::NumLatencyBuckets-1)
+      strm << '<' << PHTTPClientPool::Statistics::LatencyBucketLimits[i];
+    else
+      strm << ">=" << PHTTPClientPool::Statistics::LatencyBucketLimits[i-1];
+    strm << '=' << histogram[i];
+  }
+}
+
+
+ostream & operator<<(ostream & strm, const PHTTPClientPool::Statistics & stats)
+{
+  strm << "requests=" << stats.m_requests
+       << " failures=" << stats.m_failures
+       << " retries=" << stats.m_retries
+       << " pipelined=" << stats.m_pipelined
+       << " connections=" << stats.m_connections
+       << " connects=" << stats.m_connects
+       << " reused=" << stats.m_reused
+       << " dns-hits=" << stats.m_dnsHits
+       << " dns-misses=" << stats.m_dnsMisses;
+  OutputLatencyHistogram(strm, "connect", stats.m_connectHistogram);
+  OutputLatencyHistogram(strm, "first-byte", stats.m_firstByteHistogram);
+  OutputLatencyHistogram(strm, "total", stats.m_totalHistogram);
+  return strm;
+}
+
+
+void PHTTPClientPool::GetStatistics(Statistics & stats) const
+{
+  PWaitAndSignal lock(m_statisticsMutex);
+  stats = m_statistics;
+}
+
+
+void PHTTPClientPool::AddLatency(uint64_t * histogram, const PTimeInterval & time)
+{
+  // Assumes m_statisticsMutex already locked
+  int64_t ms = time.GetMilliSeconds();
+  PINDEX bucket = 0;
+  while (bucket < Statistics::NumLatencyBuckets-1 && ms >= (int64_t)Statistics::LatencyBucketLimits[bucket])
+    ++bucket;
+  ++histogram[bucket];
+}
+
+
+bool PHTTPClientPool::ResolveHost(const PURL & url, PIPSocket::Address & address)
+{
+  PCaselessString host = url.GetHostName();
+  if (m_dnsCacheTime == 0 || address.FromString(host))
+    return false;
+
+  m_dnsMutex.Wait();
+  std::map<PCaselessString, DNSEntry>::iterator it = m_dnsCache.find(host);
+  if (it != m_dnsCache.end() && it->second.m_expiry.IsFuture()) {
+    address = it->second.m_address;
+    m_dnsMutex.Signal();
+    PWaitAndSignal lock(m_statisticsMutex);
+    ++m_statistics.m_dnsHits;
+    return true;
+  }
+  m_dnsMutex.Signal();
+
+  if (!PIPSocket::GetHostAddress(host, address))
+    return false;
+
+  m_dnsMutex.Wait();
+  DNSEntry & entry = m_dnsCache[host];
+  entry.m_address = address;
+  entry.m_expiry = PTime() + m_dnsCacheTime;
+  m_dnsMutex.Signal();
+
+  PTRACE(4, "Resolved " << host << " to " << address);
+  PWaitAndSignal lock(m_statisticsMutex);
+  ++m_statistics.m_dnsMisses;
+  return true;
+}
+
+
+void PHTTPClientPool::OnResponse(Request & request, Response & response)
+{
+  response.m_totalTime = request.m_queued.GetElapsed();
+
+  m_statisticsMutex.Wait();
+  ++m_statistics.m_requests;
+  if (response.m_code < PHTTP::Continue)
+    ++m_statistics.m_failures;
+  else
+    AddLatency(m_statistics.m_firstByteHistogram, response.m_firstByteTime);
+  AddLatency(m_statistics.m_totalHistogram, response.m_totalTime);
+  m_statisticsMutex.Signal();
+
+  if (!request.m_notifier.IsNULL())
+    request.m_notifier(*this, response);
+}
+
+
+bool PHTTPClientPool::Request::IsIdempotent() const
+{
+  switch (m_command) {
+    case PHTTP::GET :
+    case PHTTP::HEAD :
+    case PHTTP::PUT :
+    case PHTTP::DELETE :
+    case PHTTP::TRACE :
+    case PHTTP::OPTIONS :
+      return true;
+    default :
+      return false;
+  }
+}
+
+
 void PHTTPClientPool::ShutDown()
 {
   PWaitAndSignal lock(m_mutex);
@@ -1261,6 +1503,9 @@ void PHTTPClientPool::ShutDown()
   for (ConnectionMap::iterator it = m_connections.begin(); it != m_connections.end(); ++it)
     delete it->second;
   m_connections.clear();
+
+  PWaitAndSignal statsLock(m_statisticsMutex);
+  m_statistics.m_connections = 0;
 }
 
 
@@ -1276,7 +1521,7 @@ void PHTTPClientPool::QueueRequest(const Request & request)
 
   for (;;) {
     for (ConnectionMap::iterator it = m_connections.begin(); it != m_connections.end(); ) {
-      if (it->second->m_lastUse.GetElapsed() < m_timeToLive)
+      if (!it->second->IsExpired(m_timeToLive))
         ++it;
       else {
         delete it->second;
@@ -1292,16 +1537,27 @@ void PHTTPClientPool::QueueRequest(const Request & request)
     m_mutex.Wait();
   }
 
+  Request queued = request;
+  queued.m_queued.SetCurrentTime();
+
+  /* Use the least busy connection to the host, but only open another one
+     if all the existing ones have requests outstanding. */
   std::pair<ConnectionMap::iterator, ConnectionMap::iterator> range = m_connections.equal_range(hostPort);
-  if (range.first == m_connections.end() || std::distance(range.first, range.second) < (ptrdiff_t)m_maxParallel)
-    m_connections.insert(std::make_pair(hostPort, new Connection(*this, request)));
+  ConnectionMap::iterator leastBusy = range.second;
+  for (ConnectionMap::iterator it = range.first; it != range.second; ++it) {
+    if (leastBusy == range.second || it->second->m_outstanding < leastBusy->second->m_outstanding)
+      leastBusy = it;
+  }
+
+  if (leastBusy == range.second ||
+        (leastBusy->second->m_outstanding > 0 && std::distance(range.first, range.second) < (ptrdiff_t)m_maxParallel)) {
+    m_connections.insert(std::make_pair(hostPort, new Connection(*this, queued)));
+    PWaitAndSignal statsLock(m_statisticsMutex);
+    m_statistics.m_connections = m_connections.size();
+  }
   else {
-    ConnectionMap::iterator shortestQueue = range.first;
-    for (ConnectionMap::iterator it = range.first; it != range.second; ++it) {
-      if (it->second->m_requests.size() < shortestQueue->second->m_requests.size())
-        shortestQueue = it;
-    }
-    shortestQueue->second->m_requests.Enqueue(request);
+    ++leastBusy->second->m_outstanding;
+    leastBusy->second->m_requests.Enqueue(queued);
   }
 }
 
@@ -1317,9 +1573,13 @@ void PHTTPClientPool::Get(const PURL & url, const Notifier & notifier, const PSt
 
 PHTTPClientPool::Connection::Connection(PHTTPClientPool & owner, const Request & request)
   : m_owner(owner)
+  , m_outstanding(1)
 {
   m_http.SetReadTimeout(owner.m_connectTimeout);
   m_http.SetReadLineTimeout(owner.m_readTimeout);
+#if P_SSL
+  m_http.SetSSLCredentials(owner.m_authority, owner.m_certificate, owner.m_privateKey);
+#endif
   m_requests.Enqueue(request);
   m_thread = new PThreadObj<Connection>(*this, &Connection::Main, false, "PHTTPClient");
 }
@@ -1333,17 +1593,237 @@ PHTTPClientPool::Connection::~Connection()
 }
 
 
+bool PHTTPClientPool::Connection::IsExpired(const PTimeInterval & timeToLive)
+{
+  if (m_outstanding > 0)
+    return false;
+
+  PWaitAndSignal lock(m_lastUseMutex);
+  return m_lastUse.GetElapsed() >= timeToLive;
+}
+
+
 void PHTTPClientPool::Connection::Main()
 {
   Request request;
   while (m_requests.Dequeue(request)) {
-    Response response;
-    response.m_code = m_http.ExecuteCommand(request.m_command, request.m_url, request.m_headers, response.m_body, response.m_headers);
-    if (response.m_code >= 200)
-      m_http.ReadContentBody(response.m_headers, response.m_body);
-    if (!request.m_notifier.IsNULL())
-      request.m_notifier(m_owner, response);
+    if (m_owner.m_maxPipeline > 1) {
+      m_pending.push_back(request);
+      ExecutePipelined();
+    }
+    else
+      ExecuteSerial(request);
+  }
+}
+
+
+bool PHTTPClientPool::Connection::Connect(const PURL & url, Response & response)
+{
+  if (m_http.IsOpen()) {
+    PWaitAndSignal lock(m_owner.m_statisticsMutex);
+    ++m_owner.m_statistics.m_reused;
+    return true;
   }
+
+  PTime start;
+
+  PIPSocket::Address address = PIPSocket::GetInvalidAddress();
+  m_owner.ResolveHost(url, address);
+
+  m_http.SetPersistent(true);
+  if (!m_http.ConnectURL(url, address)) {
+    response.m_code = (PHTTP::StatusCode)m_http.GetLastResponseCode();
+    return false;
+  }
+  m_http.clear(); // Reset iostream state from any failure on previous connection
+
+  // Headers and body are written separately, don't let Nagle delay the body
+  PIPSocket * socket = m_http.GetSocket();
+  if (socket != NULL)
+    socket->SetOption(TCP_NODELAY, 1, IPPROTO_TCP);
+
+  response.m_connectTime = start.GetElapsed();
+
+  PWaitAndSignal lock(m_owner.m_statisticsMutex);
+  ++m_owner.m_statistics.m_connects;
+  m_owner.AddLatency(m_owner.m_statistics.m_connectHistogram, response.m_connectTime);
+  return true;
+}
+
+
+void PHTTPClientPool::Connection::ReadBody(const Request & request, Response & response)
+{
+  // Error responses have their body read by PHTTPClient::ReadResponse()
+  if (response.m_code >= 300) {
+    PString info = m_http.GetLastResponseInfo();
+    PINDEX nl = info.Find('\n');
+    if (nl != P_MAX_INDEX)
+      response.m_body = info.Mid(nl+1);
+    return;
+  }
+
+  if (request.m_command == PHTTP::HEAD || response.m_code == PHTTP::NoContent || response.m_code < PHTTP::RequestOK)
+    return;
+
+  if (!m_http.ReadContentBody(response.m_headers, response.m_body)) {
+    response.m_code = PHTTP::TransportReadError;
+    m_http.CloseBaseReadChannel();
+  }
+}
+
+
+void PHTTPClientPool::Connection::Completed(Request & request, Response & response)
+{
+  m_lastUseMutex.Wait();
+  m_lastUse.SetCurrentTime();
+  m_lastUseMutex.Signal();
+
+  m_owner.OnResponse(request, response);
+
+  --m_outstanding;
+}
+
+
+void PHTTPClientPool::Connection::ExecuteSerial(Request & request)
+{
+  Response response;
+  if (Connect(request.m_url, response)) {
+    PTime sent;
+    response.m_code = m_http.ExecuteCommand(request.m_command, request.m_url, request.m_headers, request.m_body, response.m_headers);
+    response.m_firstByteTime = sent.GetElapsed();
+    if (response.m_code >= PHTTP::Continue)
+      ReadBody(request, response);
+
+    // Remote may have asked to close the connection
+    if (!m_http.GetPersistent())
+      m_http.CloseBaseReadChannel();
+  }
+  Completed(request, response);
+}
+
+
+void PHTTPClientPool::Connection::ExecutePipelined()
+{
+  while (!m_pending.empty() || !m_inFlight.empty()) {
+    /* Fill the pipeline with whatever requests are available. Cannot
+       reconnect while responses are outstanding on the old connection. */
+    while (m_inFlight.size() < m_owner.m_maxPipeline && (m_http.IsOpen() || m_inFlight.empty())) {
+      Request request;
+      if (!m_pending.empty()) {
+        request = m_pending.front();
+        m_pending.pop_front();
+      }
+      else if (!m_requests.Dequeue(request, 0))
+        break;
+      SendPipelined(request);
+    }
+
+    if (!m_inFlight.empty() && !ReadPipelined())
+      ConnectionLost();
+  }
+}
+
+
+void PHTTPClientPool::Connection::SendPipelined(const Request & request)
+{
+  m_inFlight.push_back(InFlight(request));
+  InFlight & item = m_inFlight.back();
+
+  if (!Connect(item.m_request.m_url, item.m_response)) {
+    Completed(item.m_request, item.m_response);
+    m_inFlight.pop_back();
+    return;
+  }
+
+  if (m_inFlight.size() > 1) {
+    PWaitAndSignal lock(m_owner.m_statisticsMutex);
+    ++m_owner.m_statistics.m_pipelined;
+  }
+
+  PMIMEInfo & headers = item.m_request.m_headers;
+  if (!headers.Contains(PHTTP::HostTag()))
+    headers.SetAt(PHTTP::HostTag(), item.m_request.m_url.GetHostPort());
+  if (!headers.Contains(PHTTP::ConnectionTag()))
+    headers.SetAt(PHTTP::ConnectionTag(), PHTTP::KeepAliveTag());
+#if P_ZLIB
+  if (m_http.GetContentDecoding() && !headers.Contains(PHTTP::AcceptEncodingTag()))
+    headers.SetAt(PHTTP::AcceptEncodingTag(), "gzip, deflate");
+#endif
+
+  PHTTPClient_StringWriter processor(item.m_request.m_body);
+  item.m_sent.SetCurrentTime();
+  if (!m_http.WriteCommand(item.m_request.m_command,
+                           item.m_request.m_url.AsString(PURL::RelativeOnly),
+                           headers,
+                           processor) || !m_http.flush().good()) {
+    PTRACE(3, &m_http, PTraceModule(), "Pipelined write failed to " << item.m_request.m_url.GetHostPort() << ": " << m_http.GetErrorText(PChannel::LastWriteError));
+    m_http.CloseBaseReadChannel();
+  }
+}
+
+
+bool PHTTPClientPool::Connection::ReadPipelined()
+{
+  InFlight & item = m_inFlight.front();
+  Response & response = item.m_response;
+
+  if (!m_http.IsOpen() || !m_http.ReadResponse(response.m_headers))
+    return false;
+
+  if (m_http.GetLastResponseCode() == PHTTP::Continue) {
+    response.m_headers.RemoveAll();
+    if (!m_http.ReadResponse(response.m_headers))
+      return false;
+  }
+
+  response.m_firstByteTime = item.m_sent.GetElapsed();
+  response.m_code = (PHTTP::StatusCode)m_http.GetLastResponseCode();
+  ReadBody(item.m_request, response);
+  if (response.m_code < PHTTP::Continue)
+    return false;
+
+  bool closing = response.m_headers.Get(PHTTP::ConnectionTag()) *= "close";
+
+  Completed(item.m_request, response);
+  m_inFlight.pop_front();
+
+  if (closing) {
+    PTRACE(4, &m_http, PTraceModule(), "Remote closing pipelined connection to " << m_http);
+    m_http.CloseBaseReadChannel();
+    if (!m_inFlight.empty())
+      return false;
+  }
+
+  return true;
+}
+
+
+static const unsigned MaxPipelineRetries = 3;
+
+
+void PHTTPClientPool::Connection::ConnectionLost()
+{
+  m_http.CloseBaseReadChannel();
+
+  /* Requests sent but not answered may or may not have been acted on by
+     the server, so only resend those that can be safely repeated. */
+  std::deque<Request> retries;
+  while (!m_inFlight.empty()) {
+    InFlight & item = m_inFlight.front();
+    if (item.m_request.IsIdempotent() && item.m_request.m_retries < MaxPipelineRetries) {
+      ++item.m_request.m_retries;
+      retries.push_back(item.m_request);
+      PWaitAndSignal lock(m_owner.m_statisticsMutex);
+      ++m_owner.m_statistics.m_retries;
+    }
+    else {
+      item.m_response.m_code = PHTTP::TransportReadError;
+      Completed(item.m_request, item.m_response);
+    }
+    m_inFlight.pop_front();
+  }
+
+  m_pending.insert(m_pending.begin(), retries.begin(), retries.end());
 }
 
 
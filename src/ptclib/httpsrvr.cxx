@@ -31,7 +31,10 @@
 #include <ptlib/sockets.h>
 #include <ptclib/http.h>
 #include <ptclib/random.h>
+#include <ptclib/pzlib.h>
 #include <ctype.h>
+#include <list>
+#include <map>
 
 #define new PNEW
 #define PTraceModule() "HTTPServer"
@@ -56,10 +59,156 @@ static const PConstString WebSocketGUID("258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
 //////////////////////////////////////////////////////////////////////////////
 // PHTTPSpace
 
+class PHTTPSpace::ResponseCache
+{
+  public:
+    ResponseCache()
+      : m_maxBytes(0)
+      , m_maxEntrySize(0)
+      , m_bytes(0)
+    { }
+
+    struct Entry {
+      Entry() : m_dependencySize(0), m_encodable(false) { }
+
+      PString      m_url;
+      PString      m_key;
+      PStringArray m_vary;  // Request headers, other than Accept-Encoding, response varies on
+      PMIMEInfo    m_headers;
+      PBYTEArray   m_body;
+      PString      m_etag;
+      PTime        m_lastModified;
+      PFilePath    m_dependency;
+      PTime        m_dependencyTime;
+      PUInt64      m_dependencySize;
+      bool         m_encodable;  // Identity body that may have a gzip/deflate variant
+    };
+    typedef std::list<Entry> EntryList; // Front is most recently used
+    typedef std::map<PString, EntryList::iterator> EntryIndex;
+
+    // The Vary headers of the cached responses for a URL, so a request can make the key
+    struct VaryInfo {
+      VaryInfo() : m_entries(0) { }
+      PStringArray m_headers;
+      unsigned     m_entries;
+    };
+    typedef std::map<PString, VaryInfo> VaryMap;
+
+    // Each content encoding, and value of other Vary headers, of a URL is a separate entry
+    static PString MakeKey(const PString & url, const PString & encoding, const PStringArray & vary, const PMIMEInfo & mime)
+    {
+      PStringStream key;
+      key << url << '\n' << encoding;
+      for (PINDEX i = 0; i < vary.GetSize(); ++i)
+        key << '\n' << vary[i] << ": " << mime.GetString(vary[i]);
+      return key;
+    }
+
+    /* Copy out the entry for the request. The check that the file it came from
+       has not changed is done without the lock, so a slow file system does not
+       hold up every other lookup. */
+    bool Find(const PHTTPConnectionInfo & connectInfo, const PString & encoding, Entry & entry)
+    {
+      PString key;
+      {
+        PWaitAndSignal lock(m_mutex);
+
+        if (m_maxBytes == 0)
+          return false;
+
+        PString url = connectInfo.GetURL().AsString();
+        VaryMap::const_iterator vary = m_vary.find(url);
+        if (vary == m_vary.end())
+          return false;
+
+        key = MakeKey(url, encoding, vary->second.m_headers, connectInfo.GetMIME());
+        EntryIndex::iterator it = m_index.find(key);
+        if (it == m_index.end())
+          return false;
+
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        entry = *it->second;
+      }
+
+      if (entry.m_dependency.IsEmpty())
+        return true;
+
+      PFileInfo info;
+      if (PFile::GetInfo(entry.m_dependency, info) &&
+          info.modified == entry.m_dependencyTime &&
+          info.size == entry.m_dependencySize)
+        return true;
+
+      PTRACE(4, NULL, PTraceModule(), "Cached response for " << key << " invalidated by change to " << entry.m_dependency);
+
+      PWaitAndSignal lock(m_mutex);
+      EntryIndex::iterator it = m_index.find(key);
+      if (it != m_index.end() && it->second->m_etag == entry.m_etag)
+        Remove(it->second);
+      return false;
+    }
+
+    void Insert(const Entry & entry)
+    {
+      EntryIndex::iterator it = m_index.find(entry.m_key);
+      if (it != m_index.end())
+        Remove(it->second);
+
+      VaryInfo & vary = m_vary[entry.m_url];
+      vary.m_headers = entry.m_vary;
+      ++vary.m_entries;
+
+      m_entries.push_front(entry);
+      m_index[entry.m_key] = m_entries.begin();
+      m_bytes += entry.m_body.GetSize();
+      Trim();
+    }
+
+    void Remove(EntryList::iterator it)
+    {
+      VaryMap::iterator vary = m_vary.find(it->m_url);
+      if (vary != m_vary.end() && --vary->second.m_entries == 0)
+        m_vary.erase(vary);
+
+      m_bytes -= it->m_body.GetSize();
+      m_index.erase(it->m_key);
+      m_entries.erase(it);
+      ++m_statistics.m_evictions;
+    }
+
+    void Trim()
+    {
+      while (m_bytes > m_maxBytes && !m_entries.empty())
+        Remove(--m_entries.end());
+    }
+
+    PDECLARE_MUTEX(m_mutex);
+    PINDEX          m_maxBytes;
+    PINDEX          m_maxEntrySize;
+    PINDEX          m_bytes;
+    EntryList       m_entries;
+    EntryIndex      m_index;
+    VaryMap         m_vary;
+    CacheStatistics m_statistics;
+};
+
+
+PHTTPSpace::CacheStatistics::CacheStatistics()
+  : m_hits(0)
+  , m_notModified(0)
+  , m_misses(0)
+  , m_evictions(0)
+  , m_entries(0)
+  , m_bytes(0)
+{
+}
+
+
 PHTTPSpace::PHTTPSpace()
 {
   mutex = new PReadWriteMutex("HTTP Space");
   root = new Node(PString(), NULL);
+  m_cache = new ResponseCache;
 }
 
 
@@ -67,6 +216,7 @@ void PHTTPSpace::DestroyContents()
 {
   delete mutex;
   delete root;
+  delete m_cache;
 }
 
 
@@ -74,6 +224,9 @@ void PHTTPSpace::CloneContents(const PHTTPSpace * c)
 {
   mutex = new PReadWriteMutex("HTTP Space");
   root = new Node(*c->root);
+  m_cache = new ResponseCache;
+  m_cache->m_maxBytes = c->m_cache->m_maxBytes;
+  m_cache->m_maxEntrySize = c->m_cache->m_maxEntrySize;
 }
 
 
@@ -81,6 +234,7 @@ void PHTTPSpace::CopyContents(const PHTTPSpace & c)
 {
   mutex = c.mutex;
   root = c.root;
+  m_cache = c.m_cache;
 }
 
 
@@ -132,6 +286,7 @@ PBoolean PHTTPSpace::AddResource(PHTTPResource * res, AddOptions overwrite)
   delete node->resource;
   node->resource = res;
 
+  FlushCache();
   return true;
 }
 
@@ -167,6 +322,7 @@ PBoolean PHTTPSpace::DelResource(const PURL & url)
     } while (node->parent != NULL && node->children.IsEmpty());
   }
 
+  FlushCache();
   return true;
 }
 
@@ -206,6 +362,282 @@ PHTTPResource * PHTTPSpace::FindResource(const PURL & url)
 }
 
 
+void PHTTPSpace::SetCacheLimits(PINDEX maxBytes, PINDEX maxEntrySize)
+{
+  PWaitAndSignal lock(m_cache->m_mutex);
+  m_cache->m_maxBytes = maxBytes;
+  m_cache->m_maxEntrySize = std::min(maxBytes, maxEntrySize);
+  m_cache->Trim();
+}
+
+
+PHTTPSpace::CacheStatistics PHTTPSpace::GetCacheStatistics() const
+{
+  PWaitAndSignal lock(m_cache->m_mutex);
+  CacheStatistics statistics = m_cache->m_statistics;
+  statistics.m_entries = m_cache->m_entries.size();
+  statistics.m_bytes = m_cache->m_bytes;
+  return statistics;
+}
+
+
+void PHTTPSpace::FlushCache()
+{
+  PWaitAndSignal lock(m_cache->m_mutex);
+  while (!m_cache->m_entries.empty())
+    m_cache->Remove(m_cache->m_entries.begin());
+}
+
+
+#if P_ZLIB
+static const PINDEX MinimumEncodedSize = 256;
+
+/* Select the content encoding from the client Accept-Encoding, RFC7231/5.3.4.
+   Preference is gzip, then deflate, subject to the q-values. */
+static PCaselessString SelectContentEncoding(const PMIMEInfo & mime)
+{
+  PStringArray codings = mime.GetString(PHTTP::AcceptEncodingTag()).Tokenise(',', false);
+  if (codings.IsEmpty())
+    return PString::Empty();
+
+  double gzip = -1, deflate = -1, wildcard = -1;
+  for (PINDEX i = 0; i < codings.GetSize(); ++i) {
+    PString coding = codings[i];
+    double quality = 1;
+    PINDEX semicolon = coding.Find(';');
+    if (semicolon != P_MAX_INDEX) {
+      PString params = coding.Mid(semicolon+1).Trim();
+      if (params.NumCompare("q=") == PObject::EqualTo)
+        quality = params.Mid(2).AsReal();
+      coding.Delete(semicolon, P_MAX_INDEX);
+    }
+
+    PCaselessString name = coding.Trim();
+    if (name == "gzip" || name == "x-gzip")
+      gzip = quality;
+    else if (name == "deflate")
+      deflate = quality;
+    else if (name == "*")
+      wildcard = quality;
+  }
+
+  if (gzip < 0)
+    gzip = wildcard;
+  if (deflate < 0)
+    deflate = wildcard;
+
+  if (gzip > 0 && gzip >= deflate)
+    return PZLib::GetEncoding(PZLib::e_GZip);
+  if (deflate > 0)
+    return PZLib::GetEncoding(PZLib::e_Deflate);
+  return PString::Empty();
+}
+
+
+// Already compressed types, e.g. images, gain nothing from encoding
+static bool IsEncodableType(const PCaselessString & contentType)
+{
+  PCaselessString type = contentType.Left(contentType.Find(';')).Trim();
+  return type.NumCompare("text/") == PObject::EqualTo ||
+         type == "application/json" ||
+         type == "application/javascript" ||
+         type == "application/ecmascript" ||
+         type == "application/xml" ||
+         type == "application/x-www-form-urlencoded" ||
+         type.Find("+xml") != P_MAX_INDEX ||
+         type.Find("+json") != P_MAX_INDEX;
+}
+
+
+/* Determine the content encoding for the response, if any. If the response
+   could be encoded, Vary is set, even if this client did not accept it, so
+   shared caches do not return the wrong representation. */
+static PCaselessString GetResponseEncoding(PHTTPRequest & request, PINDEX size)
+{
+  if (request.m_resource == NULL ||
+     !request.m_resource->IsCompressible() ||
+      request.code != PHTTP::RequestOK ||
+      request.outMIME.Contains(PHTTP::ContentEncodingTag()) ||
+      request.GetMIME().Contains(PHTTP::RangeTag()) ||
+      size < MinimumEncodedSize ||
+     !IsEncodableType(request.outMIME.GetString(PHTTP::ContentTypeTag())))
+    return PString::Empty();
+
+  PCaselessString vary = request.outMIME.GetString(PHTTP::VaryTag());
+  if (vary.IsEmpty())
+    request.outMIME.SetAt(PHTTP::VaryTag(), PHTTP::AcceptEncodingTag());
+  else if (vary.Find(PHTTP::AcceptEncodingTag()) == P_MAX_INDEX)
+    request.outMIME.SetAt(PHTTP::VaryTag(), vary + ", " + PHTTP::AcceptEncodingTag());
+
+  return SelectContentEncoding(request.GetMIME());
+}
+#endif // P_ZLIB
+
+
+static PString MakeETag(const PBYTEArray & body)
+{
+  // FNV-1a hash of the body makes a strong validator
+  PUInt64 hash = PUInt64(14695981039346656037ULL);
+  const BYTE * ptr = body;
+  for (PINDEX i = 0; i < body.GetSize(); ++i)
+    hash = (hash ^ ptr[i]) * PUInt64(1099511628211ULL);
+  return PSTRSTRM('"' << hex << hash << '-' << body.GetSize() << '"');
+}
+
+
+static bool MatchETag(const PString & header, const PString & etag)
+{
+  PStringArray tags = header.Tokenise(',', false);
+  for (PINDEX i = 0; i < tags.GetSize(); ++i) {
+    PString tag = tags[i].Trim();
+    if (tag == "*" || tag == etag || (tag.NumCompare("W/") == PObject::EqualTo && tag.Mid(2) == etag))
+      return true;
+  }
+  return false;
+}
+
+
+bool PHTTPSpace::GetCachedResponse(PHTTPRequest & request, PBYTEArray & body)
+{
+  const PMIMEInfo & mime = request.GetMIME();
+  if (mime.Contains(PHTTP::RangeTag()))
+    return false;
+
+  PCaselessString encoding;
+#if P_ZLIB
+  if (request.m_resource == NULL || request.m_resource->IsCompressible())
+    encoding = SelectContentEncoding(mime);
+#endif
+
+  ResponseCache::Entry entry;
+  if (!m_cache->Find(request, encoding, entry)) {
+    if (encoding.IsEmpty() || !m_cache->Find(request, PString::Empty(), entry))
+      return false;
+
+#if P_ZLIB
+    // Make the encoded variant from the cached identity body, once
+    PZLib::Format format;
+    PBYTEArray encoded;
+    if (entry.m_encodable && PZLib::GetFormat(encoding, format) &&
+        PZLib::Compress(entry.m_body, entry.m_body.GetSize(), encoded, format)) {
+      PTRACE(4, "Cached " << encoding << " variant of " << request.GetURL()
+             << ", " << entry.m_body.GetSize() << " -> " << encoded.GetSize() << " bytes");
+      entry.m_key = ResponseCache::MakeKey(entry.m_url, encoding, entry.m_vary, mime);
+      entry.m_headers.MakeUnique();
+      entry.m_headers.SetAt(PHTTP::ContentEncodingTag(), encoding);
+      entry.m_body = encoded;
+      entry.m_etag = MakeETag(encoded);
+      entry.m_encodable = false;
+
+      PWaitAndSignal lock(m_cache->m_mutex);
+      if (entry.m_body.GetSize() <= m_cache->m_maxEntrySize)
+        m_cache->Insert(entry);
+    }
+#endif
+  }
+
+  for (PMIMEInfo::const_iterator hdr = entry.m_headers.begin(); hdr != entry.m_headers.end(); ++hdr)
+    request.outMIME.SetAt(hdr->first, hdr->second);
+  request.outMIME.SetAt(PHTTP::ETagTag(), entry.m_etag);
+  request.outMIME.SetAt(PHTTP::LastModifiedTag(), entry.m_lastModified.AsString(PTime::RFC1123, PTime::GMT));
+
+  bool notModified;
+  if (mime.Contains(PHTTP::IfNoneMatchTag()))
+    notModified = MatchETag(mime[PHTTP::IfNoneMatchTag()], entry.m_etag);
+  else if (mime.Contains(PHTTP::IfModifiedSinceTag()))
+    notModified = entry.m_lastModified.GetTimeInSeconds() <= PTime(mime[PHTTP::IfModifiedSinceTag()]).GetTimeInSeconds();
+  else
+    notModified = false;
+
+  if (notModified) {
+    request.code = PHTTP::NotModified;
+    request.contentSize = 0;
+    body.SetSize(0);
+  }
+  else {
+    request.code = PHTTP::RequestOK;
+    request.contentSize = entry.m_body.GetSize();
+    body = entry.m_body;
+  }
+
+  PWaitAndSignal lock(m_cache->m_mutex);
+  ++m_cache->m_statistics.m_hits;
+  if (notModified)
+    ++m_cache->m_statistics.m_notModified;
+  return true;
+}
+
+
+bool PHTTPSpace::IsCacheable(const PHTTPConnectionInfo & connectInfo, PINDEX size) const
+{
+  if (connectInfo.GetMIME().Contains(PHTTP::RangeTag()))
+    return false;
+
+  PWaitAndSignal lock(m_cache->m_mutex);
+  return m_cache->m_maxBytes > 0 && size <= m_cache->m_maxEntrySize;
+}
+
+
+void PHTTPSpace::AddToCache(PHTTPRequest & request, const PBYTEArray & body)
+{
+  PString encoding = request.outMIME.GetString(PHTTP::ContentEncodingTag());
+
+  ResponseCache::Entry entry;
+  entry.m_url = request.GetURL().AsString();
+  entry.m_dependency = request.m_cacheDependency;
+  entry.m_encodable = encoding.IsEmpty() &&
+                      request.outMIME.GetString(PHTTP::VaryTag()).Find(PHTTP::AcceptEncodingTag()) != P_MAX_INDEX;
+
+  if (!entry.m_dependency.IsEmpty()) {
+    PFileInfo info;
+    if (!PFile::GetInfo(entry.m_dependency, info))
+      return;
+    entry.m_dependencyTime = entry.m_lastModified = info.modified;
+    entry.m_dependencySize = info.size;
+  }
+
+  entry.m_etag = MakeETag(body);
+
+  request.outMIME.SetAt(PHTTP::ETagTag(), entry.m_etag);
+  request.outMIME.SetAt(PHTTP::LastModifiedTag(), entry.m_lastModified.AsString(PTime::RFC1123, PTime::GMT));
+
+  if (request.outMIME.Contains(PHTTP::SetCookieTag()))
+    return;
+
+  PStringArray vary = request.outMIME.GetString(PHTTP::VaryTag()).Tokenise(',', false);
+  for (PINDEX i = 0; i < vary.GetSize(); ++i) {
+    PCaselessString header = vary[i].Trim();
+    if (header == "*")
+      return; // Varies on something other than the request headers
+    if (header != PHTTP::AcceptEncodingTag())
+      entry.m_vary.AppendString(header);
+  }
+  entry.m_key = ResponseCache::MakeKey(entry.m_url, encoding, entry.m_vary, request.GetMIME());
+
+  // Connection specific headers are regenerated for each response
+  static const PCaselessString & (* const ExcludedHeaders[])() = {
+    &PHTTP::DateTag, &PHTTP::ServerTag, &PHTTP::MIMEVersionTag, &PHTTP::ConnectionTag,
+    &PHTTP::KeepAliveTag, &PHTTP::ProxyConnectionTag, &PHTTP::ExpiresTag,
+    &PHTTP::ContentLengthTag, &PHTTP::TransferEncodingTag, &PHTTP::ETagTag, &PHTTP::LastModifiedTag
+  };
+  for (PMIMEInfo::const_iterator hdr = request.outMIME.begin(); hdr != request.outMIME.end(); ++hdr) {
+    PINDEX i = 0;
+    while (i < PARRAYSIZE(ExcludedHeaders) && ExcludedHeaders[i]() != hdr->first)
+      ++i;
+    if (i >= PARRAYSIZE(ExcludedHeaders))
+      entry.m_headers.SetAt(hdr->first, hdr->second);
+  }
+
+  entry.m_body = body;
+
+  PWaitAndSignal lock(m_cache->m_mutex);
+
+  ++m_cache->m_statistics.m_misses;
+  if (body.GetSize() <= m_cache->m_maxEntrySize)
+    m_cache->Insert(entry);
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PHTTPServer
 
@@ -313,6 +745,13 @@ PBoolean PHTTPServer::ProcessCommand()
         (url.GetPort() != 0 && url.GetPort() != myPort) ||
         (!url.GetHostName().IsEmpty() && !PIPSocket::IsLocalHost(url.GetHostName())))
       persist = OnProxy(m_connectInfo);
+    else if (m_connectInfo.GetMIME().Contains(TransferEncodingTag()) &&
+             !(m_connectInfo.GetMIME()[TransferEncodingTag()] *= "identity")) {
+      // Only Content-Length delimited bodies are supported, cannot find the next request
+      PTRACE(2, "Unsupported request Transfer-Encoding: " << m_connectInfo.GetMIME()[TransferEncodingTag()]);
+      OnError(NotImplemented, "Transfer-Encoding not supported", m_connectInfo);
+      persist = false;
+    }
     else {
       m_connectInfo.m_entityBody = ReadEntityBody();
       persist = OnCommand(cmd, url, args, m_connectInfo);
@@ -619,6 +1058,8 @@ static const httpStatusCodeStruct * GetStatusCodeStruct(int code)
     { "Gone",                          PHTTP::Gone, 1, 1, 1 },
     { "Length Required",               PHTTP::LengthRequired, 1, 1, 1 },
     { "Unless True",                   PHTTP::UnlessTrue, 1, 1, 1 },
+    { "Requested Range Not Satisfiable", PHTTP::RequestedRangeNotSatisfiable, 1, 1, 1 },
+    { "Request Header Fields Too Large", PHTTP::RequestHeaderFieldsTooLarge, 1, 1, 1 },
     { "Not Implemented",               PHTTP::NotImplemented, 1 },
     { "Service Unavailable",           PHTTP::ServiceUnavailable, 1, 1, 1 },
     { "Gateway Timeout",               PHTTP::GatewayTimeout, 1, 1, 1 }
@@ -659,8 +1100,11 @@ bool PHTTPServer::StartResponse(StatusCode code,
 
   PBoolean chunked = false;
 
+  // A 304 never has a body, and a zero length would be wrong, RFC7230/3.3.2
+  if (code == NotModified)
+    headers.RemoveAt(ContentLengthTag());
   // If do not have user set content length, decide if we should add one
-  if (!headers.Contains(ContentLengthTag())) {
+  else if (!headers.Contains(ContentLengthTag())) {
     if (m_connectInfo.m_minorVersion < 1) {
       // v1.0 client, don't put in ContentLength if the bodySize is zero because
       // that can be confused by some browsers as meaning there is no body length.
@@ -788,10 +1232,147 @@ PBoolean PHTTPServer::OnError(StatusCode code,
 //////////////////////////////////////////////////////////////////////////////
 // PHTTPListener
 
+/* Connection state in event-driven mode. While waiting for a request the
+   connection is registered with one of the reactor event loops, which
+   accumulate the request without blocking. Whichever thread successfully
+   unregisters it from the event loop owns it from then on. */
+class PHTTPListener::Connection : public PObject
+{
+    PCLASSINFO(Connection, PObject);
+  public:
+    Connection(PHTTPListener & listener, PHTTPServer * server, PTCPSocket & socket, PSocketEventLoop & reactor)
+      : m_listener(listener)
+      , m_server(server)
+      , m_socket(socket)
+      , m_reactor(reactor)
+      , m_received(0)
+      , m_waitStart(0)
+      , m_webSocket(false)
+      , m_closed(false)
+      , m_headerTooLarge(false)
+      , m_waiting(false)
+    {
+    }
+
+    enum RequestState {
+      e_Incomplete,
+      e_Complete,
+      e_HeaderTooLarge
+    };
+    RequestState GetRequestState() const;
+    PDECLARE_SocketEventNotifier(Connection, OnReadable);
+
+    PHTTPListener    & m_listener;
+    PHTTPServer      * m_server;     // Owned by PHTTPListener::m_httpServers
+    PTCPSocket       & m_socket;     // Owned by m_server
+    PSocketEventLoop & m_reactor;
+    PCharArray         m_buffer;
+    PINDEX             m_received;
+    atomic<int64_t>    m_waitStart;  // PTimer::Tick() in ms, read by idle timer
+    bool               m_webSocket;
+    bool               m_closed;
+    bool               m_headerTooLarge;
+    atomic<bool>       m_waiting;
+};
+
+
+// Limits on what is accumulated in the reactor, beyond that a pool thread reads the rest
+static const PINDEX MaxReactorHeaderSize = 65536;
+static const PINDEX MaxReactorBodySize = 1024*1024;
+
+
+PHTTPListener::Connection::RequestState PHTTPListener::Connection::GetRequestState() const
+{
+  const char * data = m_buffer;
+  const char * end = data + m_received;
+
+  // Skip blank lines before request line, RFC7230/3.5
+  while (data < end && (*data == '\r' || *data == '\n'))
+    ++data;
+
+  const char * eol = (const char *)memchr(data, '\n', end - data);
+  if (eol == NULL)
+    return m_received >= MaxReactorHeaderSize ? e_HeaderTooLarge : e_Incomplete;
+
+  // HTTP/0.9 simple request has no MIME headers
+  PINDEX lineLength = eol - data;
+  if (lineLength < 10 || memcmp(eol - (eol[-1] == '\r' ? 10 : 9), " HTTP/", 6) != 0)
+    return e_Complete;
+
+  PINDEX contentLength = 0;
+  const char * line = eol + 1;
+  for (;;) {
+    eol = (const char *)memchr(line, '\n', end - line);
+    if (eol == NULL)
+      return m_received >= MaxReactorHeaderSize ? e_HeaderTooLarge : e_Incomplete;
+
+    if (line == eol || (line[0] == '\r' && line+1 == eol))
+      break;
+
+    static const char ContentLength[] = "content-length:";
+    if ((PINDEX)(eol - line) > sizeof(ContentLength) && strncasecmp(line, ContentLength, sizeof(ContentLength)-1) == 0)
+      contentLength = PString(line + sizeof(ContentLength) - 1, eol - line - sizeof(ContentLength) + 1).AsUnsigned();
+
+    /* A chunked body has no length to wait for, PHTTPServer::ProcessCommand()
+       rejects any Transfer-Encoding, so dispatch as soon as headers are in. */
+    static const char TransferEncoding[] = "transfer-encoding:";
+    if ((PINDEX)(eol - line) > sizeof(TransferEncoding) && strncasecmp(line, TransferEncoding, sizeof(TransferEncoding)-1) == 0)
+      return e_Complete;
+
+    line = eol + 1;
+  }
+
+  if ((PINDEX)(eol + 1 - data) > MaxReactorHeaderSize)
+    return e_HeaderTooLarge;
+
+  return (PINDEX)(end - (eol + 1)) >= std::min(contentLength, MaxReactorBodySize) ? e_Complete : e_Incomplete;
+}
+
+
+void PHTTPListener::Connection::OnReadable(PSocket &, int)
+{
+  // WebSocket framing is left to the application, so just dispatch
+  if (!m_webSocket) {
+    // Never more than the limits, anything past them is read by the pool thread
+    static const PINDEX MaxReceived = MaxReactorHeaderSize + MaxReactorBodySize;
+    PTimeInterval oldTimeout = m_socket.GetReadTimeout();
+    m_socket.SetReadTimeout(0);
+    while (m_received < MaxReceived) {
+      PINDEX readSize = std::min((PINDEX)4096, MaxReceived - m_received);
+      if (!m_socket.Read(m_buffer.GetPointer(m_received + readSize) + m_received, readSize)) {
+        if (m_socket.GetErrorCode(PChannel::LastReadError) != PChannel::Timeout)
+          m_closed = true;
+        break;
+      }
+      m_received += m_socket.GetLastReadCount();
+    }
+    m_socket.SetReadTimeout(oldTimeout);
+
+    if (!m_closed) {
+      switch (GetRequestState()) {
+        case e_Incomplete :
+          return;
+        case e_HeaderTooLarge :
+          m_headerTooLarge = true;
+          break;
+        case e_Complete :
+          break;
+      }
+    }
+  }
+
+  if (m_reactor.Unregister(m_socket))
+    m_listener.DispatchConnection(this);
+}
+
+
 PHTTPListener::PHTTPListener(unsigned maxWorkers)
   : m_listenerPort(80)
   , m_listenerThread(NULL)
-  , m_threadPool(maxWorkers, 0, "HTTP-Service")
+  , m_threadPool(maxWorkers, 0, "HTTP-Service", PThread::NormalPriority, PMaxTimeInterval, 0, false)
+  , m_useEventLoop(false)
+  , m_reactorThreads(0)
+  , m_nextReactor(0)
 {
 }
 
@@ -846,8 +1427,19 @@ bool PHTTPListener::ListenForHTTP(const PString & interfaces, WORD port, PSocket
     }
   }
 
-  if (atLeastOne)
+  if (atLeastOne) {
+    for (unsigned i = 0; i < m_reactorThreads; ++i) {
+      PSocketEventLoop * reactor = new PSocketEventLoop;
+      reactor->Start("HTTP-Reactor");
+      m_reactors.push_back(reactor);
+    }
+    if (!m_reactors.empty()) {
+      m_idleTimer.SetNotifier(PCREATE_NOTIFIER(OnIdleTimer), "HTTP-Idle");
+      m_idleTimer.RunContinuous(PTimeInterval(0, 1));
+    }
+
     m_listenerThread = new PThreadObj<PHTTPListener>(*this, &PHTTPListener::ListenMain, false, "HTTP-Listen");
+  }
 
   return atLeastOne;
 }
@@ -860,6 +1452,7 @@ void PHTTPListener::ShutdownListeners()
 
   for (PSocketList::iterator it = m_httpListeningSockets.begin(); it != m_httpListeningSockets.end(); ++it)
     it->Close();
+  m_eventLoop.Interrupt();
 
   if (m_listenerThread != NULL) {
     PAssert(m_listenerThread->WaitForTermination(10000), "HTTP service listener did not terminate promptly");
@@ -867,6 +1460,10 @@ void PHTTPListener::ShutdownListeners()
     m_listenerThread = NULL;
   }
 
+  m_idleTimer.Stop();
+  for (std::vector<PSocketEventLoop *>::iterator it = m_reactors.begin(); it != m_reactors.end(); ++it)
+    (*it)->Stop();
+
   m_httpServersMutex.Wait();
   for (PList<PHTTPServer>::iterator it = m_httpServers.begin(); it != m_httpServers.end(); ++it)
     it->CloseBaseReadChannel();
@@ -874,12 +1471,43 @@ void PHTTPListener::ShutdownListeners()
 
   m_threadPool.Shutdown();
 
+  // Anything left is idle in a reactor, or was queued for a pool thread
+  for (;;) {
+    m_connectionsMutex.Wait();
+    Connection * connection = m_connections.empty() ? NULL : *m_connections.begin();
+    m_connectionsMutex.Signal();
+    if (connection == NULL)
+      break;
+    connection->m_reactor.Unregister(connection->m_socket);
+    EndConnection(connection);
+  }
+
+  for (std::vector<PSocketEventLoop *>::iterator it = m_reactors.begin(); it != m_reactors.end(); ++it)
+    delete *it;
+  m_reactors.clear();
+
   m_httpListeningSockets.RemoveAll();
 }
 
 
 void PHTTPListener::ListenMain()
 {
+  if (m_useEventLoop) {
+    for (PSocketList::iterator it = m_httpListeningSockets.begin(); it != m_httpListeningSockets.end(); ++it)
+      m_eventLoop.Register(*it, PSocketEventLoop::ReadEvent, PCREATE_SocketEventNotifier(OnListenerReady));
+
+    while (IsListening()) {
+      PChannel::Errors error = m_eventLoop.Wait();
+      if (error != PChannel::NoError && error != PChannel::Interrupted) {
+        PTRACE(2, "Event loop failed for HTTP: " << PSocket::GetErrorText(error));
+      }
+    }
+
+    for (PSocketList::iterator it = m_httpListeningSockets.begin(); it != m_httpListeningSockets.end(); ++it)
+      m_eventLoop.Unregister(*it);
+    return;
+  }
+
   while (IsListening()) {
     PSocket::SelectList listeners;
     for (PSocketList::iterator it = m_httpListeningSockets.begin(); it != m_httpListeningSockets.end(); ++it)
@@ -888,19 +1516,8 @@ void PHTTPListener::ListenMain()
     PChannel::Errors error = PSocket::Select(listeners);
     if (error == PChannel::NoError) {
       // get a socket(s) when a client connects
-      for (PSocket::SelectList::iterator it = listeners.begin(); it != listeners.end(); ++it) {
-        PTCPSocket * socket = new PTCPSocket;
-        if (socket->Accept(*it)) {
-          PTRACE(5, "Queuing thread pool work for: local=" << socket->GetLocalAddress() << ", peer=" << socket->GetPeerAddress());
-          m_threadPool.AddWork(new Worker(*this, socket));
-        }
-        else {
-          if (socket->GetErrorCode() != PChannel::Interrupted) {
-            PTRACE(2, "Accept failed for HTTP: " << socket->GetErrorText());
-          }
-          delete socket;
-        }
-      }
+      for (PSocket::SelectList::iterator it = listeners.begin(); it != listeners.end(); ++it)
+        AcceptHTTP(*it);
     }
     else if (error != PChannel::Interrupted) {
       PTRACE(2, "Select failed for HTTP: " << PSocket::GetErrorText(error));
@@ -909,6 +1526,28 @@ void PHTTPListener::ListenMain()
 }
 
 
+void PHTTPListener::OnListenerReady(PSocket & listener, int)
+{
+  AcceptHTTP(listener);
+}
+
+
+void PHTTPListener::AcceptHTTP(PSocket & listener)
+{
+  PTCPSocket * socket = new PTCPSocket;
+  if (socket->Accept(listener)) {
+    PTRACE(5, "Queuing thread pool work for: local=" << socket->GetLocalAddress() << ", peer=" << socket->GetPeerAddress());
+    m_threadPool.AddWork(new Worker(*this, socket));
+  }
+  else {
+    if (socket->GetErrorCode() != PChannel::Interrupted) {
+      PTRACE(2, "Accept failed for HTTP: " << socket->GetErrorText());
+    }
+    delete socket;
+  }
+}
+
+
 PChannel * PHTTPListener::CreateChannelForHTTP(PChannel * channel)
 {
   return channel;
@@ -931,10 +1570,154 @@ void PHTTPListener::OnHTTPEnded(PHTTPServer & /*server*/)
 }
 
 
+bool PHTTPListener::OnWebSocketData(PHTTPServer & PTRACE_PARAM(server))
+{
+  PTRACE(3, "No handler for WebSocket data on " << server << ", closing");
+  return false;
+}
+
+
+PINDEX PHTTPListener::GetIdleConnectionCount() const
+{
+  PINDEX count = 0;
+  for (std::vector<PSocketEventLoop *>::const_iterator it = m_reactors.begin(); it != m_reactors.end(); ++it)
+    count += (*it)->GetSize();
+  return count;
+}
+
+
+void PHTTPListener::WaitForRequest(Connection * connection)
+{
+  // Pipelined request, or WebSocket data, may already have been read
+  if (connection->m_server->GetReadAheadCount() > 0) {
+    DispatchConnection(connection);
+    return;
+  }
+
+  connection->m_received = 0;
+  connection->m_waitStart = PTimer::Tick().GetMilliSeconds();
+  connection->m_waiting = true;
+  if (!connection->m_reactor.Register(connection->m_socket,
+                                      PSocketEventLoop::ReadEvent,
+                                      PCREATE_NOTIFIER2_EXT(connection, Connection, OnReadable, int))) {
+    connection->m_waiting = false;
+    EndConnection(connection);
+  }
+}
+
+
+void PHTTPListener::DispatchConnection(Connection * connection)
+{
+  connection->m_waiting = false;
+  m_threadPool.AddWork(new Worker(*this, connection));
+}
+
+
+void PHTTPListener::ProcessConnection(Connection * connection)
+{
+  PHTTPServer & server = *connection->m_server;
+
+  if (connection->m_closed) {
+    PTRACE(5, "Connection closed by remote: " << server);
+    EndConnection(connection);
+    return;
+  }
+
+  if (connection->m_headerTooLarge) {
+    PTRACE(2, "Request headers exceed " << MaxReactorHeaderSize << " bytes: " << server);
+    const httpStatusCodeStruct * status = GetStatusCodeStruct(PHTTP::RequestHeaderFieldsTooLarge);
+    server << "HTTP/1.1 " << status->code << ' ' << status->text << "\r\n"
+           << PHTTP::ConnectionTag() << ": close\r\n"
+           << PHTTP::ContentLengthTag() << ": 0\r\n"
+              "\r\n" << flush;
+    server.Shutdown(PSocket::ShutdownWrite);
+    EndConnection(connection);
+    return;
+  }
+
+  if (connection->m_webSocket) {
+    if (OnWebSocketData(server) && server.IsOpen())
+      WaitForRequest(connection);
+    else
+      EndConnection(connection);
+    return;
+  }
+
+  server.UnRead(connection->m_buffer, connection->m_received);
+  connection->m_received = 0;
+
+  bool persist;
+  do {
+    persist = server.ProcessCommand();
+    PTRACE(5, "Processed " << server << ", duration=" << server.GetLastCommandTime().GetElapsed());
+  } while (persist && server.GetReadAheadCount() > 0);
+
+  if (persist)
+    WaitForRequest(connection);
+  else if (server.GetConnectionInfo().IsWebSocket() && server.IsOpen()) {
+    PTRACE(4, "Waiting for WebSocket data on " << server);
+    connection->m_webSocket = true;
+    WaitForRequest(connection);
+  }
+  else
+    EndConnection(connection);
+}
+
+
+void PHTTPListener::EndConnection(Connection * connection)
+{
+  OnHTTPEnded(*connection->m_server);
+
+  m_connectionsMutex.Wait();
+  m_connections.erase(connection);
+  m_connectionsMutex.Signal();
+
+  m_httpServersMutex.Wait();
+  m_httpServers.Remove(connection->m_server); // And deletes it, and the socket
+  m_httpServersMutex.Signal();
+
+  delete connection;
+}
+
+
+void PHTTPListener::OnIdleTimer(PTimer &, P_INT_PTR)
+{
+  int64_t now = PTimer::Tick().GetMilliSeconds();
+  std::vector<Connection *> expired;
+
+  m_connectionsMutex.Wait();
+  for (std::set<Connection *>::iterator it = m_connections.begin(); it != m_connections.end(); ++it) {
+    Connection & connection = **it;
+    // WebSockets have their own keep alive mechanism
+    if (connection.m_waiting && !connection.m_webSocket &&
+        (now - connection.m_waitStart) > connection.m_server->GetConnectionInfo().GetPersistenceTimeout().GetMilliSeconds() &&
+        connection.m_reactor.Unregister(connection.m_socket))
+      expired.push_back(&connection);
+  }
+  m_connectionsMutex.Signal();
+
+  for (std::vector<Connection *>::iterator it = expired.begin(); it != expired.end(); ++it) {
+    PTRACE(4, "Closing idle connection " << *(*it)->m_server);
+    (*it)->m_server->Shutdown(PSocket::ShutdownWrite);
+    EndConnection(*it);
+  }
+}
+
+
 PHTTPListener::Worker::Worker(PHTTPListener & listener, PTCPSocket * socket)
   : m_listener(listener)
   , m_socket(socket)
   , m_httpServer(NULL)
+  , m_connection(NULL)
+{
+}
+
+
+PHTTPListener::Worker::Worker(PHTTPListener & listener, Connection * connection)
+  : m_listener(listener)
+  , m_socket(NULL)
+  , m_httpServer(NULL)
+  , m_connection(connection)
 {
 }
 
@@ -953,6 +1736,11 @@ PHTTPListener::Worker::~Worker()
 
 void PHTTPListener::Worker::Work()
 {
+  if (m_connection != NULL) {
+    m_listener.ProcessConnection(m_connection);
+    return;
+  }
+
   if (PAssertNULL(m_socket) == NULL)
     return;
 
@@ -978,6 +1766,7 @@ void PHTTPListener::Worker::Work()
   m_listener.m_httpServers.Append(m_httpServer); // Deleted in this list
   m_listener.m_httpServersMutex.Signal();
 
+  PTCPSocket * socket = m_socket;
   PChannel * channel = m_listener.CreateChannelForHTTP(m_socket);
   if (channel == NULL) {
     PTRACE(2, "Indirect channel creation failed" << socketInfo);
@@ -994,6 +1783,18 @@ void PHTTPListener::Worker::Work()
   PTRACE(5, "Started" << socketInfo);
   m_listener.OnHTTPStarted(*m_httpServer);
 
+  // Event-driven mode, reactor waits for the first request
+  if (!m_listener.m_reactors.empty() && channel == socket) {
+    Connection * connection = new Connection(m_listener, m_httpServer, *socket,
+                    *m_listener.m_reactors[m_listener.m_nextReactor++ % m_listener.m_reactors.size()]);
+    m_httpServer = NULL; // Now owned by connection
+    m_listener.m_connectionsMutex.Wait();
+    m_listener.m_connections.insert(connection);
+    m_listener.m_connectionsMutex.Signal();
+    m_listener.WaitForRequest(connection);
+    return;
+  }
+
   // process requests
   while (m_httpServer->ProcessCommand()) {
     PTRACE(5, "Processed" << socketInfo << ", duration=" << m_httpServer->GetLastCommandTime().GetElapsed());
@@ -1141,6 +1942,7 @@ PHTTPRequest::PHTTPRequest(PHTTPServer & _server,
   , origin(0)
   , localAddr(0)
   , localPort(0)
+  , m_cacheable(false)
 {
   PIPSocket * socket = server.GetSocket();
   if (socket != NULL) {
@@ -1186,6 +1988,131 @@ bool PHTTPRequest::SendResponse(const PString & body, bool html)
 
 #if P_SSL
 
+#include <ptlib/cpufeatures.h>
+
+#define P_WEBSOCKET_MASK_X86 P_CPU_FEATURES_X86
+
+
+/* The mask kernels XOR as much of the buffer as they can in whole vectors,
+   and return the number of bytes done, which is always a multiple of four so
+   the mask does not need rotating. ApplyWebSocketMask() does the remainder. */
+typedef PINDEX (*WebSocketMaskKernel)(BYTE * dst, const BYTE * src, PINDEX len, uint32_t mask);
+
+static PINDEX WebSocketMask_Scalar(BYTE *, const BYTE *, PINDEX, uint32_t)
+{
+  return 0;
+}
+
+#if P_WEBSOCKET_MASK_X86
+
+static P_TARGET_SSE2 PINDEX WebSocketMask_SSE2(BYTE * dst, const BYTE * src, PINDEX len, uint32_t mask)
+{
+  __m128i m = _mm_set1_epi32((int)mask);
+  PINDEX done = 0;
+
+  for (; done+64 <= len; done += 64) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(src+done));
+    __m128i b = _mm_loadu_si128((const __m128i *)(src+done+16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(src+done+32));
+    __m128i d = _mm_loadu_si128((const __m128i *)(src+done+48));
+    _mm_storeu_si128((__m128i *)(dst+done),    _mm_xor_si128(a, m));
+    _mm_storeu_si128((__m128i *)(dst+done+16), _mm_xor_si128(b, m));
+    _mm_storeu_si128((__m128i *)(dst+done+32), _mm_xor_si128(c, m));
+    _mm_storeu_si128((__m128i *)(dst+done+48), _mm_xor_si128(d, m));
+  }
+
+  for (; done+16 <= len; done += 16)
+    _mm_storeu_si128((__m128i *)(dst+done), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src+done)), m));
+
+  return done;
+}
+
+
+static P_TARGET_AVX2 PINDEX WebSocketMask_AVX2(BYTE * dst, const BYTE * src, PINDEX len, uint32_t mask)
+{
+  __m256i m = _mm256_set1_epi32((int)mask);
+  PINDEX done = 0;
+
+  for (; done+128 <= len; done += 128) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(src+done));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(src+done+32));
+    __m256i c = _mm256_loadu_si256((const __m256i *)(src+done+64));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(src+done+96));
+    _mm256_storeu_si256((__m256i *)(dst+done),    _mm256_xor_si256(a, m));
+    _mm256_storeu_si256((__m256i *)(dst+done+32), _mm256_xor_si256(b, m));
+    _mm256_storeu_si256((__m256i *)(dst+done+64), _mm256_xor_si256(c, m));
+    _mm256_storeu_si256((__m256i *)(dst+done+96), _mm256_xor_si256(d, m));
+  }
+
+  for (; done+32 <= len; done += 32)
+    _mm256_storeu_si256((__m256i *)(dst+done), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src+done)), m));
+
+  _mm256_zeroupper();
+  return done;
+}
+
+#endif // P_WEBSOCKET_MASK_X86
+
+
+static WebSocketMaskKernel GetWebSocketMaskKernel(unsigned features)
+{
+#if P_WEBSOCKET_MASK_X86
+  if ((features & PCPUFeatures::AVX2) != 0)
+    return WebSocketMask_AVX2;
+  if ((features & PCPUFeatures::SSE2) != 0)
+    return WebSocketMask_SSE2;
+#endif // P_WEBSOCKET_MASK_X86
+
+  return WebSocketMask_Scalar;
+}
+
+static unsigned WebSocketMaskFeatures = PCPUFeatures::Get() & (PCPUFeatures::SSE2|PCPUFeatures::AVX2);
+static WebSocketMaskKernel WebSocketMaskVectors = GetWebSocketMaskKernel(WebSocketMaskFeatures);
+
+
+unsigned PWebSocket::SetMaskAcceleration(unsigned features)
+{
+  WebSocketMaskFeatures = features & PCPUFeatures::Get() & (PCPUFeatures::SSE2|PCPUFeatures::AVX2);
+  WebSocketMaskVectors = GetWebSocketMaskKernel(WebSocketMaskFeatures);
+  PTRACE(4, "WebSocket", "Mask acceleration set to 0x" << hex << WebSocketMaskFeatures << dec);
+  return WebSocketMaskFeatures;
+}
+
+
+unsigned PWebSocket::GetMaskAcceleration()
+{
+  return WebSocketMaskFeatures;
+}
+
+
+/* XOR len bytes from src to dst (which may be the same) with the mask, the
+   first byte of the mask, in memory order, applying to the first byte. On
+   return the mask is rotated so that it continues from where this left off. */
+static void ApplyWebSocketMask(BYTE * dst, const BYTE * src, PINDEX len, uint32_t & mask)
+{
+  PINDEX done = WebSocketMaskVectors(dst, src, len, mask);
+
+  for (; done+4 <= len; done += 4) {
+    uint32_t word;
+    memcpy(&word, src+done, 4);
+    word ^= mask;
+    memcpy(dst+done, &word, 4);
+  }
+
+  PINDEX tail = len - done;
+  if (tail == 0)
+    return;
+
+  BYTE maskBytes[4], rotated[4];
+  memcpy(maskBytes, &mask, 4);
+  for (PINDEX i = 0; i < tail; ++i)
+    dst[done+i] = (BYTE)(src[done+i] ^ maskBytes[i]);
+  for (PINDEX i = 0; i < 4; ++i)
+    rotated[i] = maskBytes[(i+tail)&3];
+  memcpy(&mask, rotated, 4);
+}
+
+
 PWebSocket::PWebSocket()
   : m_client(false)
   , m_fragmentingWrite(false)
@@ -1194,6 +2121,7 @@ PWebSocket::PWebSocket()
   , m_remainingPayload(0)
   , m_currentMask(-1)
   , m_fragmentedRead(false)
+  , m_binaryRead(false)
   , m_recursiveRead(false)
 {
 }
@@ -1220,9 +2148,15 @@ PBoolean PWebSocket::Read(void * buf, PINDEX len)
 
 bool PWebSocket::InternalRead(void * buf, PINDEX len)
 {
-  if (m_remainingPayload > 0)
-    return ReadMasked(buf, len);
+  if (m_remainingPayload == 0 && !ReadDataHeader())
+    return false;
+
+  return ReadMasked(buf, len);
+}
+
 
+bool PWebSocket::ReadDataHeader()
+{
   for (;;) {
     OpCodes opCode;
     if (!ReadHeader(opCode, m_fragmentedRead, m_remainingPayload, m_currentMask))
@@ -1238,10 +2172,13 @@ bool PWebSocket::InternalRead(void * buf, PINDEX len)
     }
 
     switch (opCode) {
-      case Continuation :
       case TextFrame :
       case BinaryFrame :
-        return ReadMasked(buf, len);
+        m_binaryRead = opCode == BinaryFrame;
+        // Next case
+
+      case Continuation :
+        return true;
 
       case Ping :
         // RFC6455/5.5.2 echo ping payload
@@ -1288,54 +2225,69 @@ bool PWebSocket::ReadMasked(void * buf, PINDEX len)
   // Only get here if exactly len bytes were read to buf
   m_remainingPayload -= len;
 
-  if (m_currentMask < 0)
-    return true;
-
-  BYTE * ptr = (BYTE *)buf;
-  while (len >= 4) {
-    *(uint32_t *)ptr ^= m_currentMask;
-    len -= 4;
-    ptr += 4;
+  if (m_currentMask >= 0) {
+    uint32_t mask = (uint32_t)m_currentMask;
+    ApplyWebSocketMask((BYTE *)buf, (const BYTE *)buf, len, mask);
+    m_currentMask = mask;
   }
 
-  switch (len) {
-    case 1:
-      *(BYTE *)ptr ^= m_currentMask;
-      m_currentMask = uint32_t(m_currentMask << 24) | (m_currentMask >> 8);
-      break;
+  return true;
+}
 
-    case 2:
-      *(uint16_t *)ptr ^= m_currentMask;
-      m_currentMask = uint32_t(m_currentMask << 16) | (m_currentMask >> 16);
-      break;
 
-    case 3:
-      *(uint16_t *)ptr ^= m_currentMask;
-      *(BYTE *)(ptr+2) ^= m_currentMask>>16;
-      m_currentMask = uint32_t(m_currentMask << 8) | (m_currentMask >> 24);
-      break;
-  }
+bool PWebSocket::ReadMessage(PBYTEArray & msg)
+{
+  PINDEX length;
+  bool binary;
+  if (!ReadMessage(msg, length, binary))
+    return false;
 
+  msg.SetSize(length);
   return true;
 }
 
 
-bool PWebSocket::ReadMessage(PBYTEArray & msg)
+bool PWebSocket::ReadMessage(PBYTEArray & msg, PINDEX & length, bool & binary)
 {
+  if (CheckNotOpen())
+    return false;
+
   if (!PAssert(m_remainingPayload == 0, "Cannot call ReadMessage when have partial frames unread."))
     return false;
 
-  PINDEX totalSize = 0;
+  length = 0;
+
+  m_recursiveRead = true;
+
+  bool ok;
   do {
-    static const PINDEX chunkSize = 10000;
-    if (!Read(msg.GetPointer(totalSize + chunkSize) + totalSize, chunkSize))
-      return false;
-    totalSize += GetLastReadCount();
-  } while (!IsMessageComplete());
+    ok = ReadDataHeader();
+    if (!ok)
+      break;
+
+    if (length + m_remainingPayload > m_maxFrameSize) {
+      PTRACE(3, "Closing due to excessive message size: " << length + m_remainingPayload << " > " << m_maxFrameSize);
+      PBYTEArray payload;
+      InternalWrite(ConnectionClose, false, payload, payload.GetSize());
+      CloseBaseReadChannel();
+      ok = false;
+      break;
+    }
 
-  msg.SetSize(totalSize);
+    // Grow geometrically, so a message in many small fragments is not quadratic
+    PINDEX needed = length + (PINDEX)m_remainingPayload;
+    if (msg.GetSize() < needed)
+      msg.SetSize(std::max(needed, msg.GetSize()*2));
 
-  return true;
+    PINDEX frameSize = (PINDEX)m_remainingPayload;
+    ok = ReadMasked(msg.GetPointer() + length, frameSize);
+    length += frameSize;
+  } while (ok && m_fragmentedRead);
+
+  m_recursiveRead = false;
+
+  binary = m_binaryRead;
+  return ok;
 }
 
 
@@ -1367,36 +2319,94 @@ PBoolean PWebSocket::Write(const void * buf, PINDEX len)
 
 bool PWebSocket::InternalWrite(OpCodes opCode, bool fragmenting, const void * buf, PINDEX len)
 {
-  // Make sure WriteHeader and WriteMasked/Write of body are atomic
+  // Make sure header and body are written atomically
   PWaitAndSignal lock(m_writeMutex);
 
+  BYTE header[MaxHeaderSize];
+
   if (!m_client)
-    return WriteHeader(opCode, fragmenting, len, -1) && PIndirectChannel::Write(buf, len);
+    return WriteGathered(header, EncodeHeader(header, opCode, fragmenting, len, -1), buf, len);
 
   uint32_t mask = PRandom::Number();
-  if (!WriteHeader(opCode, fragmenting, len, mask))
+  return WriteMasked(header, EncodeHeader(header, opCode, fragmenting, len, mask), (const BYTE *)buf, len, mask);
+}
+
+
+bool PWebSocket::WriteMasked(const BYTE * header, PINDEX headerLen, const BYTE * data, PINDEX len, uint32_t mask)
+{
+  // The header goes in front of the first chunk so small frames are one write
+  static const PINDEX ChunkSize = 65536;
+
+  PINDEX chunk = std::min(len, ChunkSize);
+  BYTE * buffer = m_writeBuffer.GetPointer(MaxHeaderSize + chunk);
+  memcpy(buffer, header, headerLen);
+  ApplyWebSocketMask(buffer+headerLen, data, chunk, mask);
+  if (!PIndirectChannel::Write(buffer, headerLen + chunk))
     return false;
 
-  const uint32_t * ptr = (const uint32_t *)buf;
-  while (len > 65536) {
-    if (!WriteMasked(ptr, 65536, mask))
+  for (PINDEX done = chunk; done < len; done += chunk) {
+    chunk = std::min(len - done, ChunkSize);
+    ApplyWebSocketMask(buffer, data+done, chunk, mask);
+    if (!PIndirectChannel::Write(buffer, chunk))
       return false;
-    ptr += 16384;
-    len -= 65536;
   }
 
-  return WriteMasked(ptr, len, mask);
+  return true;
 }
 
 
-bool PWebSocket::WriteMasked(const uint32_t * data, PINDEX len, uint32_t mask)
+bool PWebSocket::WriteGathered(const BYTE * header, PINDEX headerLen, const void * data, PINDEX len)
 {
-  uint32_t buffer[16384];
-  PINDEX i = (len+3) / 4;
-  while (i-- > 0)
-    buffer[i] = data[i] ^ mask;
+  flush();
+
+  {
+    PReadWaitAndSignal mutex(channelPointerMutex);
+
+    // If directly on a socket, can write header and payload in one system call
+    PSocket * socket = dynamic_cast<PSocket *>(writeChannel);
+    if (socket != NULL) {
+      PSocket::Slice slices[2];
+      slices[0] = PSocket::Slice(header, headerLen);
+      slices[1] = PSocket::Slice(data, len);
+      PSocket::Slice * next = slices;
+      size_t count = len > 0 ? 2 : 1;
+
+      socket->SetWriteTimeout(writeTimeout);
+      bool ok;
+      for (;;) {
+        ok = socket->Write(next, count);
+        if (!ok)
+          break;
+
+        // Partial write, skip what went and try again
+        size_t written = socket->GetLastWriteCount();
+        while (count > 0 && written >= next->GetLength()) {
+          written -= next->GetLength();
+          ++next;
+          --count;
+        }
+        if (count == 0)
+          break;
+        next->SetBase((char *)next->GetBase() + written);
+        next->SetLength(next->GetLength() - written);
+      }
+
+      SetErrorValues(socket->GetErrorCode(LastWriteError), socket->GetErrorNumber(LastWriteError), LastWriteError);
+      SetLastWriteCount(ok ? len : 0);
+      return ok;
+    }
+  }
+
+  // Otherwise, copy small frames so they go in one write to the channel below
+  static const PINDEX MaxCoalesce = 16384;
+  if (len <= MaxCoalesce) {
+    BYTE * buffer = m_writeBuffer.GetPointer(MaxHeaderSize + len);
+    memcpy(buffer, header, headerLen);
+    memcpy(buffer+headerLen, data, len);
+    return PIndirectChannel::Write(buffer, headerLen + len);
+  }
 
-  return PIndirectChannel::Write(buffer, len);
+  return PIndirectChannel::Write(header, headerLen) && PIndirectChannel::Write(data, len);
 }
 
 
@@ -1477,68 +2487,55 @@ bool PWebSocket::ReadHeader(OpCodes  & opCode,
                             uint64_t & payloadLength,
                             int64_t  & masking)
 {
-  BYTE header1;
-  if (!Read(&header1, 1))
+  BYTE header[MaxHeaderSize];
+  if (!ReadBlock(header, 2))
     return false;
 
-  fragment = (header1 & 0x80) == 0;
-  opCode = (OpCodes)(header1 & 0xf);
+  fragment = (header[0] & 0x80) == 0;
+  opCode = (OpCodes)(header[0] & 0xf);
+  payloadLength = header[1] & 0x7f;
+  masking = -1;
+
+  // Get extended length and mask, if present, in one read
+  PINDEX extra = 0;
+  if (payloadLength == 126)
+    extra = 2;
+  else if (payloadLength == 127)
+    extra = 8;
+  if ((header[1] & 0x80) != 0)
+    extra += 4;
+
+  if (extra == 0)
+    return true;
 
   PTimeInterval oldTimeout = GetReadTimeout();
   SetReadTimeout(1000);
-  bool ok = false;
-
-  BYTE header2;
-  if (!Read(&header2, 1))
-    goto badHeader;
-
-  switch (header2 & 0x7f) {
-    case 126 :
-    {
-      PUInt16b len16;
-      if (!ReadBlock(&len16, 2))
-        goto badHeader;
-      payloadLength = len16;
-      break;
-    }
-
-    case 127 :
-    {
-      PUInt64b len64;
-      if (!ReadBlock(&len64, 8))
-        goto badHeader;
-      payloadLength = len64;
-      break;
-    }
+  bool ok = ReadBlock(&header[2], extra);
+  SetReadTimeout(oldTimeout);
+  if (!ok)
+    return false;
 
-    default :
-      payloadLength = header2 & 0x7f;
-  }
+  if (payloadLength == 126)
+    payloadLength = *(PUInt16b *)&header[2];
+  else if (payloadLength == 127)
+    payloadLength = *(PUInt64b *)&header[2];
 
-  if ((header2 & 0x80) == 0)
-    masking = -1;
-  else {
+  if ((header[1] & 0x80) != 0) {
     uint32_t mask32;
-    if (!ReadBlock(&mask32, 4))
-      goto badHeader;
-
+    memcpy(&mask32, &header[2+extra-4], 4);
     masking = mask32;
   }
 
-  ok = true;
-
-badHeader:
-  SetReadTimeout(oldTimeout);
-  return ok;
+  return true;
 }
 
 
-bool PWebSocket::WriteHeader(OpCodes  opCode,
-                             bool     fragment,
-                             uint64_t payloadLength,
-                             int64_t  masking)
+PINDEX PWebSocket::EncodeHeader(BYTE   * header,
+                                OpCodes  opCode,
+                                bool     fragment,
+                                uint64_t payloadLength,
+                                int64_t  masking)
 {
-  BYTE header[14];
   PUInt64b * pLen = (PUInt64b *)&header[2];
   PINDEX len = 2;
 
@@ -1561,11 +2558,22 @@ bool PWebSocket::WriteHeader(OpCodes  opCode,
 
   if (masking >= 0) {
     header[1] |= 0x80;
-    *(uint32_t *)&header[len] = (uint32_t)masking;
+    uint32_t mask32 = (uint32_t)masking;
+    memcpy(&header[len], &mask32, 4);
     len += 4;
   }
 
-  return PIndirectChannel::Write(header, len);
+  return len;
+}
+
+
+bool PWebSocket::WriteHeader(OpCodes  opCode,
+                             bool     fragment,
+                             uint64_t payloadLength,
+                             int64_t  masking)
+{
+  BYTE header[MaxHeaderSize];
+  return PIndirectChannel::Write(header, EncodeHeader(header, opCode, fragment, payloadLength, masking));
 }
 
 #endif //P_SSL
@@ -1733,6 +2741,7 @@ PHTTPResource::PHTTPResource(const PURL & url)
   : m_baseURL(url)
   , m_authority(NULL)
   , m_hitCount(0)
+  , m_compressible(true)
 {
 }
 
@@ -1741,6 +2750,7 @@ PHTTPResource::PHTTPResource(const PURL & url, const PHTTPAuthority & auth)
   : m_baseURL(url)
   , m_authority(auth.CloneAs<PHTTPAuthority>())
   , m_hitCount(0)
+  , m_compressible(true)
 {
 }
 
@@ -1750,6 +2760,7 @@ PHTTPResource::PHTTPResource(const PURL & url, const PString & type)
   , m_contentType(type)
   , m_authority(NULL)
   , m_hitCount(0)
+  , m_compressible(true)
 {
 }
 
@@ -1761,6 +2772,7 @@ PHTTPResource::PHTTPResource(const PURL & url,
   , m_contentType(type)
   , m_authority(auth.CloneAs<PHTTPAuthority>())
   , m_hitCount(0)
+  , m_compressible(true)
 {
 }
 
@@ -1772,6 +2784,7 @@ PHTTPResource::PHTTPResource(const PURL & url,
   , m_contentType(type)
   , m_authority(auth.CloneAs<PHTTPAuthority>())
   , m_hitCount(0)
+  , m_compressible(true)
 {
   SetAllowedOrigins(allowedOrigins);
 }
@@ -1822,6 +2835,7 @@ bool PHTTPResource::InternalOnCommand(PHTTPServer & server,
 
   bool retVal = true;
   if (CheckAuthority(server, *request, connectInfo)) {
+    PBYTEArray body;
     retVal = false;
     server.SetDefaultMIMEInfo(request->outMIME, connectInfo);
 
@@ -1835,13 +2849,43 @@ bool PHTTPResource::InternalOnCommand(PHTTPServer & server,
         PURL::SplitQueryVars(connectInfo.GetEntityBody(), postData);
       retVal = OnPOSTData(*request, postData);
     }
+    else if ((cmd == PHTTP::GET || cmd == PHTTP::HEAD) && server.GetURLSpace().GetCachedResponse(*request, body)) {
+      StartResponse(*request);
+      if (cmd == PHTTP::HEAD)
+        retVal = true;
+      else {
+        m_hitCount++;
+        server.Write(body, body.GetSize());
+        // A 304, or any other response without a body, needs no Content-Length to persist
+        retVal = request->code == PHTTP::NotModified || body.IsEmpty() ||
+                 request->outMIME.Contains(PHTTP::ContentLengthTag());
+      }
+    }
     else if (!LoadHeaders(*request)) 
       retVal = server.OnError(request->code, connectInfo.GetURL().AsString(), connectInfo);
+    else if (cmd == PHTTP::HEAD) {
+      // Same headers as a GET, there is never a body so can always persist
+      if (!request->outMIME.Contains(PHTTP::ContentTypeTag) && !m_contentType.IsEmpty())
+        request->outMIME.SetAt(PHTTP::ContentTypeTag, m_contentType);
+#if P_ZLIB
+      // Also sets Vary, encoded length is not known without compressing the body
+      PCaselessString encoding = GetResponseEncoding(*request, request->contentSize);
+      if (!encoding.IsEmpty()) {
+        request->outMIME.SetAt(PHTTP::ContentEncodingTag(), encoding);
+        request->contentSize = P_MAX_INDEX;
+      }
+#endif
+      StartResponse(*request);
+      retVal = true;
+    }
     else if (cmd != PHTTP::GET)
       retVal = request->outMIME.Contains(PHTTP::ContentLengthTag());
     else {
       m_hitCount++;
-      retVal = OnGETData(*request);
+      if (request->m_cacheable && server.GetURLSpace().IsCacheable(*request, request->contentSize))
+        retVal = SendCacheableData(*request);
+      else
+        retVal = OnGETData(*request);
     }
   }
 
@@ -1991,14 +3035,20 @@ PHTTPRequest * PHTTPResource::CreateRequest(PHTTPServer & server, const PHTTPCon
 }
 
 
-static void WriteChunkedDataToServer(PHTTPServer & server, PCharArray & data)
+static void WriteChunkedDataToServer(PHTTPServer & server, const void * data, PINDEX size)
 {
-  if (data.GetSize() == 0)
+  if (size == 0)
     return;
 
-  server << data.GetSize() << "\r\n";
-  server.Write(data, data.GetSize());
+  server << hex << size << dec << "\r\n";
+  server.Write(data, size);
   server << "\r\n";
+}
+
+
+static void WriteChunkedDataToServer(PHTTPServer & server, PCharArray & data)
+{
+  WriteChunkedDataToServer(server, data, data.GetSize());
   data.SetSize(0);
 }
 
@@ -2016,7 +3066,11 @@ void PHTTPResource::SendData(PHTTPRequest & request)
     request.outMIME.SetAt(PHTTP::ContentTypeTag, m_contentType);
 
   PCharArray data;
-  if (LoadData(request, data)) {
+  bool more = LoadData(request, data);
+  if (SendEncodedData(request, data, more))
+    return;
+
+  if (more) {
     if (StartResponse(request)) {
       // Chunked transfer encoding
       request.outMIME.RemoveAll();
@@ -2042,6 +3096,99 @@ void PHTTPResource::SendData(PHTTPRequest & request)
 }
 
 
+bool PHTTPResource::SendEncodedData(PHTTPRequest & request, PCharArray & data, bool more)
+{
+#if P_ZLIB
+  PZLib::Format format;
+  if (!PZLib::GetFormat(GetResponseEncoding(request, more ? P_MAX_INDEX : data.GetSize()), format))
+    return false;
+
+  // Encoded size is unknown until the end, so need chunked transfer if more than one block
+  if (more && (request.GetMajorVersion() < 1 || (request.GetMajorVersion() == 1 && request.GetMinorVersion() < 1)))
+    return false;
+
+  PZLib zlib(PZLib::e_Compress, format);
+  PBYTEArray encoded;
+
+  if (!more && !zlib.Process(data, data.GetSize(), encoded, PZLib::e_Finish))
+    return false;
+
+  request.outMIME.SetAt(PHTTP::ContentEncodingTag(), PZLib::GetEncoding(format));
+  request.outMIME.RemoveAt(PHTTP::ContentLengthTag());
+
+  if (!more) {
+    PTRACE(5, "Encoded " << request.GetURL() << " as " << PZLib::GetEncoding(format)
+           << ", " << data.GetSize() << " -> " << encoded.GetSize() << " bytes");
+    request.contentSize = encoded.GetSize();
+    StartResponse(request);
+    request.server.Write(encoded, encoded.GetSize());
+    return true;
+  }
+
+  request.contentSize = P_MAX_INDEX;
+  if (!PAssert(StartResponse(request), PLogicError))
+    return true;
+
+  request.outMIME.RemoveAll();
+  for (;;) {
+    // Flush each block, so is not held up for slow, continuous sources
+    if (!zlib.Process(data, data.GetSize(), encoded, more ? PZLib::e_SyncFlush : PZLib::e_Finish))
+      break;
+    WriteChunkedDataToServer(request.server, encoded, encoded.GetSize());
+    data.SetSize(0);
+    if (!more)
+      break;
+    more = LoadData(request, data);
+  }
+  request.server << "0\r\n" << request.outMIME;
+  return true;
+#else
+  return false;
+#endif // P_ZLIB
+}
+
+
+bool PHTTPResource::SendCacheableData(PHTTPRequest & request)
+{
+  if (!request.outMIME.Contains(PHTTP::ContentTypeTag) && !m_contentType.IsEmpty())
+    request.outMIME.SetAt(PHTTP::ContentTypeTag, m_contentType);
+
+  // Load it all, so can be put into the cache
+  PBYTEArray body;
+  PCharArray data;
+  bool more;
+  do {
+    more = LoadData(request, data);
+    PINDEX size = data.GetSize();
+    if (size > 0) {
+      PINDEX offset = body.GetSize();
+      memcpy(body.GetPointer(offset + size) + offset, data, size);
+      data.SetSize(0);
+    }
+  } while (more);
+
+#if P_ZLIB
+  PZLib::Format format;
+  if (PZLib::GetFormat(GetResponseEncoding(request, body.GetSize()), format)) {
+    PBYTEArray encoded;
+    if (PZLib::Compress(body, body.GetSize(), encoded, format)) {
+      request.outMIME.SetAt(PHTTP::ContentEncodingTag(), PZLib::GetEncoding(format));
+      body = encoded;
+    }
+  }
+#endif
+
+  // Macro expansion etc may have decided it should not be cached after all
+  if (request.m_cacheable && request.code == PHTTP::RequestOK)
+    request.server.GetURLSpace().AddToCache(request, body);
+
+  request.contentSize = body.GetSize();
+  StartResponse(request);
+  request.server.Write(body, body.GetSize());
+  return request.outMIME.Contains(PHTTP::ContentLengthTag());
+}
+
+
 PBoolean PHTTPResource::LoadData(PHTTPRequest & request, PCharArray & data)
 {
   PString text = LoadText(request);
@@ -2246,19 +3393,174 @@ PBoolean PHTTPFile::LoadHeaders(PHTTPRequest & request)
   }
 
   request.contentSize = file.GetLength();
+  request.m_cacheable = true;
+  request.m_cacheDependency = m_filePath;
+
+  // Same test as OnGETData() for sending direct from the file, so HEAD matches GET
+  if (!IsTextFile(file)) {
+    if (!request.outMIME.Contains(PHTTP::ContentTypeTag) && !m_contentType.IsEmpty())
+      request.outMIME.SetAt(PHTTP::ContentTypeTag, m_contentType);
+#if P_ZLIB
+    if (GetResponseEncoding(request, request.contentSize).IsEmpty())
+#endif
+      request.outMIME.SetAt(PHTTP::AcceptRangesTag(), "bytes");
+  }
+
   return true;
 }
 
 
-PBoolean PHTTPFile::LoadData(PHTTPRequest & request, PCharArray & data)
+bool PHTTPFile::IsTextFile(const PFile & file) const
 {
-  PFile & file = ((PHTTPFileRequest&)request).m_file;
-
   PString contentType = GetContentType();
   if (contentType.IsEmpty())
     contentType = PMIMEInfo::GetContentType(file.GetFilePath().GetType());
 
-  if (contentType(0, 4) *= "text/")
+  return contentType(0, 4) *= "text/";
+}
+
+
+// Only a single range is supported, anything else gets the whole file
+static PHTTP::StatusCode ParseByteRange(const PString & header, off_t fileLength, off_t & offset, off_t & length)
+{
+  offset = 0;
+  length = fileLength;
+
+  PCaselessString range = header.Trim();
+  if (range.NumCompare("bytes=") != PObject::EqualTo || range.Find(',') != P_MAX_INDEX)
+    return PHTTP::RequestOK;
+
+  PINDEX dash = range.Find('-', 6);
+  if (dash == P_MAX_INDEX)
+    return PHTTP::RequestOK;
+
+  static const char Digits[] = "0123456789";
+  PString first = range(6, dash-1).Trim();
+  PString last = range.Mid(dash+1).Trim();
+  if (first.FindSpan(Digits) != P_MAX_INDEX || last.FindSpan(Digits) != P_MAX_INDEX)
+    return PHTTP::RequestOK;
+
+  if (first.IsEmpty()) {
+    // Suffix range, the last N bytes
+    if (last.IsEmpty())
+      return PHTTP::RequestOK;
+    uint64_t suffix = last.AsUnsigned64();
+    if (suffix == 0 || fileLength == 0)
+      return PHTTP::RequestedRangeNotSatisfiable;
+    if (suffix < (uint64_t)fileLength)
+      offset = fileLength - suffix;
+  }
+  else {
+    uint64_t start = first.AsUnsigned64();
+    if (start >= (uint64_t)fileLength)
+      return PHTTP::RequestedRangeNotSatisfiable;
+
+    uint64_t end = fileLength - 1;
+    if (!last.IsEmpty()) {
+      uint64_t lastByte = last.AsUnsigned64();
+      if (lastByte < start)
+        return PHTTP::RequestOK;
+      if (lastByte < end)
+        end = lastByte;
+    }
+
+    offset = start;
+    length = end - start + 1;
+    return PHTTP::PartialContent;
+  }
+
+  length = fileLength - offset;
+  return PHTTP::PartialContent;
+}
+
+
+PBoolean PHTTPFile::OnGETData(PHTTPRequest & request)
+{
+  PFile & file = ((PHTTPFileRequest&)request).m_file;
+
+  // Text may be altered by OnLoadedText(), and tail files have no end
+  if (!file.IsOpen() || request.contentSize == P_MAX_INDEX || IsTextFile(file))
+    return PHTTPResource::OnGETData(request);
+
+  if (!request.outMIME.Contains(PHTTP::ContentTypeTag) && !m_contentType.IsEmpty())
+    request.outMIME.SetAt(PHTTP::ContentTypeTag, m_contentType);
+
+#if P_ZLIB
+  // Things like JSON or SVG files are worth compressing, so cannot go direct to socket
+  if (!GetResponseEncoding(request, request.contentSize).IsEmpty())
+    return PHTTPResource::OnGETData(request);
+#endif
+
+  request.outMIME.SetAt(PHTTP::AcceptRangesTag(), "bytes");
+
+  off_t fileLength = file.GetLength();
+  off_t offset, length;
+  switch (ParseByteRange(request.GetMIME().GetString(PHTTP::RangeTag()), fileLength, offset, length)) {
+    case PHTTP::RequestedRangeNotSatisfiable :
+      PTRACE(3, "Unsatisfiable range \"" << request.GetMIME().GetString(PHTTP::RangeTag())
+             << "\" for " << fileLength << " byte file \"" << file.GetFilePath() << '"');
+      request.code = PHTTP::RequestedRangeNotSatisfiable;
+      request.outMIME.SetAt(PHTTP::ContentRangeTag(), PSTRSTRM("bytes */" << fileLength));
+      request.contentSize = 0;
+      StartResponse(request);
+      return request.outMIME.Contains(PHTTP::ContentLengthTag());
+
+    case PHTTP::PartialContent :
+      request.code = PHTTP::PartialContent;
+      request.outMIME.SetAt(PHTTP::ContentRangeTag(),
+                            PSTRSTRM("bytes " << offset << '-' << (offset+length-1) << '/' << fileLength));
+      break;
+
+    default :
+      break;
+  }
+
+  request.contentSize = (PINDEX)length;
+  StartResponse(request);
+  request.server.flush();
+
+  bool ok;
+  PTCPSocket * socket = dynamic_cast<PTCPSocket *>(request.server.GetWriteChannel());
+  if (socket != NULL)
+    ok = socket->WriteFromFile(file, offset, length);
+  else {
+    // Probably TLS, which must encrypt from a user space buffer anyway
+    static const off_t BlockSize = 1024*1024;
+    off_t position = offset;
+    off_t end = offset + length;
+    ok = true;
+    while (ok && position < end) {
+      size_t count = (size_t)std::min(end - position, BlockSize);
+      const void * view = file.MapView(position, count);
+      if (view != NULL) {
+        ok = request.server.Write(view, count);
+        PFile::UnmapView(view, count);
+      }
+      else {
+        // File may have shrunk since Content-Length was sent, stop on a short read
+        PBYTEArray buffer;
+        ok = file.SetPosition(position) &&
+             file.Read(buffer.GetPointer(count), count) &&
+             request.server.Write(buffer, file.GetLastReadCount()) &&
+             (size_t)file.GetLastReadCount() == count;
+      }
+      position += count;
+    }
+  }
+
+  PTRACE_IF(3, !ok, "Could not send \"" << file.GetFilePath() << "\" to " << request.origin << ": "
+            << (socket != NULL ? socket->GetErrorText(PChannel::LastWriteError)
+                               : request.server.GetErrorText(PChannel::LastWriteError)));
+  file.Close();
+  return ok && request.outMIME.Contains(PHTTP::ContentLengthTag());
+}
+
+
+PBoolean PHTTPFile::LoadData(PHTTPRequest & request, PCharArray & data)
+{
+  PFile & file = ((PHTTPFileRequest&)request).m_file;
+
+  if (IsTextFile(file))
     return PHTTPResource::LoadData(request, data);
 
   PAssert(file.IsOpen(), PLogicError);
@@ -2344,6 +3646,7 @@ PBoolean PHTTPTailFile::LoadHeaders(PHTTPRequest & request)
     return false;
 
   request.contentSize = P_MAX_INDEX;
+  request.m_cacheable = false;
   return true;
 }
 
@@ -2509,6 +3812,8 @@ PBoolean PHTTPDirectory::LoadHeaders(PHTTPRequest & request)
     request.outMIME.SetAt(PHTTP::ContentTypeTag(),
                           PMIMEInfo::GetContentType(file.GetFilePath().GetType()));
     request.contentSize = file.GetLength();
+    request.m_cacheable = true;
+    request.m_cacheDependency = file.GetFilePath();
     fakeIndex = PString();
     return true;
   }
@@ -1103,10 +1103,11 @@ static PBoolean ExtractVariables(const PString & args,
 PServiceMacro * PServiceMacro::list;
 
 
-PServiceMacro::PServiceMacro(const char * name, PBoolean isBlock)
+PServiceMacro::PServiceMacro(const char * name, PBoolean isBlock, bool cacheable)
 {
   macroName = name;
   isMacroBlock = isBlock;
+  m_cacheable = cacheable;
   link = list;
   list = this;
 }
@@ -1116,6 +1117,7 @@ PServiceMacro::PServiceMacro(const PCaselessString & name, PBoolean isBlock)
 {
   macroName = name;
   isMacroBlock = isBlock;
+  m_cacheable = false;
 }
 
 
@@ -1163,31 +1165,31 @@ PCREATE_SERVICE_MACRO(Header,request,P_EMPTY)
 }
 
 
-PCREATE_SERVICE_MACRO(Copyright,P_EMPTY,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(Copyright,P_EMPTY,P_EMPTY)
 {
   return PHTTPServiceProcess::Current().GetCopyrightText();
 }
 
 
-PCREATE_SERVICE_MACRO(ProductName,P_EMPTY,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(ProductName,P_EMPTY,P_EMPTY)
 {
   return PHTTPServiceProcess::Current().GetProductName();
 }
 
 
-PCREATE_SERVICE_MACRO(Manufacturer,P_EMPTY,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(Manufacturer,P_EMPTY,P_EMPTY)
 {
   return PHTTPServiceProcess::Current().GetManufacturer();
 }
 
 
-PCREATE_SERVICE_MACRO(Version,P_EMPTY,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(Version,P_EMPTY,P_EMPTY)
 {
   return PHTTPServiceProcess::Current().GetVersion(true);
 }
 
 
-PCREATE_SERVICE_MACRO(BuildDate,P_EMPTY,args)
+PCREATE_CACHEABLE_SERVICE_MACRO(BuildDate,P_EMPTY,args)
 {
   const PTime & date = PHTTPServiceProcess::Current().GetCompilationDate();
   if (args.IsEmpty())
@@ -1197,14 +1199,14 @@ PCREATE_SERVICE_MACRO(BuildDate,P_EMPTY,args)
 }
 
 
-PCREATE_SERVICE_MACRO(OS,P_EMPTY,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(OS,P_EMPTY,P_EMPTY)
 {
   return PHTTPServiceProcess::Current().GetOSClass() &
          PHTTPServiceProcess::Current().GetOSName();
 }
 
 
-PCREATE_SERVICE_MACRO(Machine,P_EMPTY,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(Machine,P_EMPTY,P_EMPTY)
 {
   return PHTTPServiceProcess::Current().GetOSVersion() + '-' +
          PHTTPServiceProcess::Current().GetOSHardware();
@@ -1269,7 +1271,7 @@ PCREATE_SERVICE_MACRO(Time,P_EMPTY,args)
 }
 
 
-PCREATE_SERVICE_MACRO(StartTime,P_EMPTY,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(StartTime,P_EMPTY,P_EMPTY)
 {
   return PProcess::Current().GetStartTime().AsString(PTime::MediumDateTime);
 }
@@ -1444,7 +1446,7 @@ PCREATE_SERVICE_MACRO(Registration,P_EMPTY,args)
 }
 
 
-PCREATE_SERVICE_MACRO(InputsFromQuery,request,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(InputsFromQuery,request,P_EMPTY)
 {
   PStringToString vars = request.url.GetQueryVars();
   PStringStream subs;
@@ -1455,7 +1457,7 @@ PCREATE_SERVICE_MACRO(InputsFromQuery,request,P_EMPTY)
 }
 
 
-PCREATE_SERVICE_MACRO(Query,request,args)
+PCREATE_CACHEABLE_SERVICE_MACRO(Query,request,args)
 {
   if (args.IsEmpty())
     return request.url.GetQuery();
@@ -1489,7 +1491,7 @@ PCREATE_SERVICE_MACRO(Get,request,args)
 }
 
 
-PCREATE_SERVICE_MACRO(URL,request,P_EMPTY)
+PCREATE_CACHEABLE_SERVICE_MACRO(URL,request,P_EMPTY)
 {
   return request.url.AsString();
 }
@@ -1536,7 +1538,7 @@ PCREATE_SERVICE_MACRO(SignedInclude,P_EMPTY,args)
   return text;
 }
 
-PCREATE_SERVICE_MACRO_BLOCK(IfQuery,request,args,block)
+PCREATE_CACHEABLE_SERVICE_MACRO_BLOCK(IfQuery,request,args,block)
 {
   PStringToString vars = request.url.GetQueryVars();
 
@@ -1576,7 +1578,7 @@ PCREATE_SERVICE_MACRO_BLOCK(IfQuery,request,args,block)
 }
 
 
-PCREATE_SERVICE_MACRO_BLOCK(IfInURL,request,args,block)
+PCREATE_CACHEABLE_SERVICE_MACRO_BLOCK(IfInURL,request,args,block)
 {
   if (request.url.AsString().Find(args) != P_MAX_INDEX)
     return block;
@@ -1585,7 +1587,7 @@ PCREATE_SERVICE_MACRO_BLOCK(IfInURL,request,args,block)
 }
 
 
-PCREATE_SERVICE_MACRO_BLOCK(IfNotInURL,request,args,block)
+PCREATE_CACHEABLE_SERVICE_MACRO_BLOCK(IfNotInURL,request,args,block)
 {
   if (request.url.AsString().Find(args) == P_MAX_INDEX)
     return block;
@@ -1692,6 +1694,8 @@ bool PServiceHTML::ProcessMacros(PHTTPRequest & request,
         if (idx != P_MAX_INDEX) {
           substitution = ServiceMacros[idx].Translate(request, args, text(startpos, endpos-1));
           substitedMacro = true;
+          if (!ServiceMacros[idx].IsCacheable())
+            request.m_cacheable = false;
         }
       }
 
@@ -1705,11 +1709,15 @@ bool PServiceHTML::ProcessMacros(PHTTPRequest & request,
       SplitCmdAndArgs(text, pos, cmd, args);
 
       PString substitution;
-      if (!process.SubstituteEquivalSequence(request, cmd & args, substitution)) {
+      if (process.SubstituteEquivalSequence(request, cmd & args, substitution))
+        request.m_cacheable = false;
+      else {
         PINDEX idx = ServiceMacros.GetValuesIndex(PServiceMacro(cmd, false));
         if (idx != P_MAX_INDEX) {
           substitution = ServiceMacros[idx].Translate(request, args, PString::Empty());
           substitedMacro = true;
+          if (!ServiceMacros[idx].IsCacheable())
+            request.m_cacheable = false;
         }
       }
 
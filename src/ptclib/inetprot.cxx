@@ -55,7 +55,7 @@ PInternetProtocol::PInternetProtocol(const char * svcName,
   SetReadTimeout(PTimeInterval(0, 0, 10));  // 10 minutes
   stuffingState = DontStuff;
   newLineToCRLF = true;
-  unReadCount = 0;
+  readBufferStart = readBufferEnd = 0;
 }
 
 
@@ -65,49 +65,46 @@ void PInternetProtocol::SetReadLineTimeout(const PTimeInterval & t)
 }
 
 
-PBoolean PInternetProtocol::Read(void * buf, PINDEX len)
+static const PINDEX ReadAheadSize = 4096;
+
+bool PInternetProtocol::FillReadBuffer()
 {
-  if (unReadCount == 0) {
-    char readAhead[1000];
-    if (!PIndirectChannel::Read(readAhead, sizeof(readAhead)))
-      return false;
+  if (readBufferStart < readBufferEnd)
+    return true;
 
-    UnRead(readAhead, GetLastReadCount());
-  }
+  readBufferStart = readBufferEnd = 0;
+  if (!PIndirectChannel::Read(readBuffer.GetPointer(ReadAheadSize), ReadAheadSize))
+    return false;
 
-  SetLastReadCount(PMIN(unReadCount, len));
-  const char * unReadPtr = ((const char *)unReadBuffer)+unReadCount;
-  char * bufptr = (char *)buf;
-  while (unReadCount > 0 && len > 0) {
-    *bufptr++ = *--unReadPtr;
-    unReadCount--;
-    len--;
-  }
+  readBufferEnd = GetLastReadCount();
+  return readBufferEnd > 0;
+}
 
-  if (len > 0) {
-    PINDEX saveCount = GetLastReadCount();
-    PIndirectChannel::Read(bufptr, len);
-    SetLastReadCount(GetLastReadCount() + saveCount);
-  }
 
-  return GetLastReadCount() > 0;
+PBoolean PInternetProtocol::Read(void * buf, PINDEX len)
+{
+  // Large reads with nothing buffered go straight through without a copy
+  if (readBufferStart == readBufferEnd && len >= ReadAheadSize)
+    return PIndirectChannel::Read(buf, len);
+
+  if (!FillReadBuffer())
+    return false;
+
+  PINDEX count = PMIN(readBufferEnd - readBufferStart, len);
+  memcpy(buf, (const char *)readBuffer + readBufferStart, count);
+  readBufferStart += count;
+  SetLastReadCount(count);
+  return count > 0;
 }
 
 
 int PInternetProtocol::ReadChar()
 {
-  if (unReadCount == 0) {
-    char readAhead[1000];
-    if (!PIndirectChannel::Read(readAhead, sizeof(readAhead)))
-      return -1;
-
-    UnRead(readAhead, GetLastReadCount());
-    if (unReadCount == 0)
-      return -1;
-  }
+  if (!FillReadBuffer())
+    return -1;
 
   SetLastReadCount(1);
-  return (unReadBuffer[--unReadCount]&0xff);
+  return readBuffer[readBufferStart++] & 0xff;
 }
 
 
@@ -268,59 +265,69 @@ PBoolean PInternetProtocol::ReadLine(PString & line, PBoolean allowContinuation)
   if (!line.SetMinSize(1000))
     return false;
 
-  PINDEX count = 0;
-  PBoolean gotEndOfLine = false;
-
-  int c = ReadChar();
-  if (c < 0)
+  if (!FillReadBuffer())
     return false;
 
   PTimeInterval oldTimeout = GetReadTimeout();
   SetReadTimeout(readLineTimeout);
 
-  while (c >= 0 && !gotEndOfLine) {
-    switch (c) {
-      case '\b' :
-      case '\177' :
-        if (count > 0)
-          count--;
-        c = ReadChar();
-        break;
+  PINDEX count = 0;
+  bool gotEndOfLine = false;
 
-      case '\r' :
-        c = ReadChar();
-        switch (c) {
-          case -1 :
-          case '\n' :
-            break;
+  while (!gotEndOfLine && FillReadBuffer()) {
+    const char * start = (const char *)readBuffer + readBufferStart;
+    PINDEX available = readBufferEnd - readBufferStart;
 
-          case '\r' :
-            c = ReadChar();
-            if (c == '\n')
-              break;
-            UnRead(c);
-            c = '\r';
-            // Then do default case
-
-          default :
-            UnRead(c);
-        }
-        // Then do line feed case
-
-      case '\n' :
-        if (count == 0 || !allowContinuation || (c = ReadChar()) < 0)
-          gotEndOfLine = true;
-        else if (c != ' ' && c != '\t') {
-          UnRead(c);
-          gotEndOfLine = true;
-        }
-        break;
+    // Find end of line, which may be a lone CR
+    const char * eol = (const char *)memchr(start, '\n', available);
+    const char * cr = (const char *)memchr(start, '\r', eol != NULL ? eol - start : available);
+    if (cr != NULL)
+      eol = cr;
 
-      default :
-        if (count >= line.GetSize())
-          line.SetSize(count + 100);
-        line[count++] = (char)c;
-        c = ReadChar();
+    PINDEX length = eol != NULL ? eol - start : available;
+    if (count + length >= line.GetSize() && !line.SetMinSize(count + length + 100))
+      break;
+
+    // This makes the string unique, so it is safe to write to
+    char * ptr = line.GetPointerAndSetLength(count + length);
+
+    // Backspace and delete are rare, so only do a character loop if present
+    if (memchr(start, '\b', length) == NULL && memchr(start, '\177', length) == NULL) {
+      memcpy(ptr + count, start, length);
+      count += length;
+    }
+    else {
+      for (PINDEX i = 0; i < length; ++i) {
+        if (start[i] != '\b' && start[i] != '\177')
+          ptr[count++] = start[i];
+        else if (count > 0)
+          count--;
+      }
+    }
+
+    readBufferStart += length;
+    if (eol == NULL)
+      continue;
+
+    // Consume the end of line, allowing for CR, CR/LF or CR/CR/LF
+    if (readBuffer[readBufferStart++] == '\r' && FillReadBuffer()) {
+      if (readBuffer[readBufferStart] == '\n')
+        ++readBufferStart;
+      else if (readBuffer[readBufferStart] == '\r') {
+        ++readBufferStart;
+        if (FillReadBuffer() && readBuffer[readBufferStart] == '\n')
+          ++readBufferStart;
+        else
+          UnRead('\r');
+      }
+    }
+
+    // Continuation lines start with white space, which is kept in the line
+    if (count == 0 || !allowContinuation || !FillReadBuffer())
+      gotEndOfLine = true;
+    else {
+      char c = readBuffer[readBufferStart];
+      gotEndOfLine = c != ' ' && c != '\t';
     }
   }
 
@@ -337,8 +344,8 @@ PBoolean PInternetProtocol::ReadLine(PString & line, PBoolean allowContinuation)
 
 void PInternetProtocol::UnRead(int ch)
 {
-  unReadBuffer.SetSize((unReadCount+256)&~255);
-  unReadBuffer[unReadCount++] = (char)ch;
+  char c = (char)ch;
+  UnRead(&c, 1);
 }
 
 
@@ -350,12 +357,21 @@ void PInternetProtocol::UnRead(const PString & str)
 
 void PInternetProtocol::UnRead(const void * buffer, PINDEX len)
 {
-  char * unreadptr =
-               unReadBuffer.GetPointer((unReadCount+len+255)&~255)+unReadCount;
-  const char * bufptr = ((const char *)buffer)+len;
-  unReadCount += len;
-  while (len-- > 0)
-    *unreadptr++ = *--bufptr;
+  if (len <= 0)
+    return;
+
+  if (readBufferStart < len) {
+    // Not enough room in front of unread data, so move it up
+    PINDEX unread = readBufferEnd - readBufferStart;
+    PINDEX newStart = len + ReadAheadSize/4;
+    char * ptr = readBuffer.GetPointer(newStart + unread);
+    memmove(ptr + newStart, ptr + readBufferStart, unread);
+    readBufferStart = newStart;
+    readBufferEnd = newStart + unread;
+  }
+
+  readBufferStart -= len;
+  memcpy(readBuffer.GetPointer() + readBufferStart, buffer, len);
 }
 
 
@@ -665,16 +681,19 @@ PBoolean PMIMEInfo::Read(PInternetProtocol & socket)
 
 
 bool PMIMEInfo::AddMIME(const PString & line)
+{
+  return AddMIME(PStringView(line));
+}
+
+
+bool PMIMEInfo::AddMIME(const PStringView & line)
 {
   PINDEX colonPos = line.Find(':');
   if (colonPos == P_MAX_INDEX)
     return false;
 
-  PINDEX dataPos = colonPos+1;
-  while (isspace(line[dataPos]))
-    ++dataPos;
-
-  return AddMIME(line.Left(colonPos).Trim(), line.Mid(dataPos));
+  // Only the name and value are materialised, not the intermediate slices
+  return AddMIME(PString(line.Left(colonPos).Trim()), PString(line.Mid(colonPos+1).LeftTrim()));
 }
 
 
@@ -107,19 +107,107 @@ PJSON & PJSON::operator=(const PJSON & other)
 
 bool PJSON::FromString(const PString & str)
 {
-  PStringStream strm(str);
-  ReadFrom(strm);
+  return FromString(str, str.GetLength());
+}
+
+
+static PJSON::Base * CreateFromParser(PJSONParser & parser)
+{
+  PJSON::Base * root = NULL;
+  std::vector< std::pair<PJSON::Base *, bool> > containers;
+  std::string name;
+
+  for (;;) {
+    PJSON::Base * value;
+    switch (parser.Next()) {
+      case PJSONParser::e_Error :
+        delete root;
+        return NULL;
+
+      case PJSONParser::e_EndOfData :
+        return root;
+
+      case PJSONParser::e_MemberName :
+        name.assign(parser.GetStringPtr(), parser.GetStringLength());
+        continue;
+
+      case PJSONParser::e_EndObject :
+      case PJSONParser::e_EndArray :
+        containers.pop_back();
+        continue;
+
+      case PJSONParser::e_StartObject :
+        value = new PJSON::Object;
+        break;
+
+      case PJSONParser::e_StartArray :
+        value = new PJSON::Array;
+        break;
+
+      case PJSONParser::e_String :
+      {
+        PJSON::String * str = new PJSON::String;
+        *str = parser.GetString();
+        value = str;
+        break;
+      }
+
+      case PJSONParser::e_Number :
+        value = new PJSON::Number(parser.GetNumber());
+        break;
+
+      case PJSONParser::e_Boolean :
+        value = new PJSON::Boolean(parser.GetBoolean());
+        break;
+
+      default :
+        value = new PJSON::Null;
+    }
+
+    if (containers.empty())
+      root = value;
+    else if (!containers.back().second)
+      static_cast<PJSON::Array *>(containers.back().first)->push_back(value);
+    else if (!static_cast<PJSON::Object *>(containers.back().first)->insert(make_pair(name, value)).second) {
+      // Duplicate name, first one wins, as always has
+      delete value;
+      if (parser.GetEvent() == PJSONParser::e_StartObject || parser.GetEvent() == PJSONParser::e_StartArray) {
+        if (!parser.Skip()) {
+          delete root;
+          return NULL;
+        }
+      }
+      continue;
+    }
+
+    if (parser.GetEvent() == PJSONParser::e_StartObject)
+      containers.push_back(std::make_pair(value, true));
+    else if (parser.GetEvent() == PJSONParser::e_StartArray)
+      containers.push_back(std::make_pair(value, false));
+  }
+}
+
+
+bool PJSON::FromString(const char * data, size_t length)
+{
+  PJSONParser parser(data, length);
+
+  delete m_root;
+  m_root = CreateFromParser(parser);
+  m_valid = m_root != NULL;
+  if (!m_valid)
+    m_root = new Null;
+
   return m_valid;
 }
 
 
 PString PJSON::AsString(std::streamsize initialIndent, std::streamsize subsequentIndent) const
 {
-  PStringStream strm;
-  strm.width(initialIndent);
-  strm.precision(subsequentIndent != 0 ? subsequentIndent : (initialIndent != 0 ? 2 : 6));
-  PrintOn(strm);
-  return strm;
+  PJSONWriter writer((unsigned)initialIndent, (unsigned)subsequentIndent);
+  if (PAssertNULL(m_root) != NULL)
+    writer.Write(*m_root);
+  return writer.GetString();
 }
 
 
@@ -184,10 +272,26 @@ void PJSON::ReadFrom(istream & strm)
 }
 
 
+static void SetWriterFromStream(PJSONWriter & writer, ostream & strm)
+{
+  // Same use of the std::ios width/precision as PJSON::Object::PrintOn()
+  std::streamsize indent = strm.width();
+  std::streamsize increment = strm.precision();
+  if (indent != 0 || increment != 6)
+    writer.SetPretty((unsigned)indent, increment != 6 ? (unsigned)increment : 2);
+  strm.width(0);
+}
+
+
 void PJSON::PrintOn(ostream & strm) const
 {
-  if (PAssertNULL(m_root) != NULL)
-    m_root->PrintOn(strm);
+  if (PAssertNULL(m_root) == NULL)
+    return;
+
+  PJSONWriter writer;
+  SetWriterFromStream(writer, strm);
+  writer.Write(*m_root);
+  strm.write(writer.GetData(), writer.GetLength());
 }
 
 
@@ -844,22 +948,8 @@ void PJSON::Number::ReadFrom(istream & strm)
 
 void PJSON::Number::PrintOn(ostream & strm) const
 {
-  if (m_value < 0) {
-    int64_t intval = (int64_t)m_value;
-    if (intval == m_value) {
-      strm << intval;
-      return;
-    }
-  }
-  else {
-    uint64_t uintval = (uint64_t)m_value;
-    if (uintval == m_value) {
-      strm << uintval;
-      return;
-    }
-  }
-
-  strm << m_value;
+  char buffer[PJSONWriter::MaxNumberSize];
+  strm.write(buffer, PJSONWriter::FormatNumber(buffer, m_value));
 }
 
 
@@ -952,212 +1042,1920 @@ PJSON::Base * PJSON::Null::DeepClone() const
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static PThreadLocalStorage< std::stack<PJSONRecord*> > s_jsonDataInitialiser;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define P_JSON_SSE2 1
+  #include <emmintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    static __inline unsigned CountTrailingZeros(unsigned mask) { unsigned long bit; _BitScanForward(&bit, mask); return bit; }
+  #else
+    static __inline unsigned CountTrailingZeros(unsigned mask) { return __builtin_ctz(mask); }
+  #endif
+#else
+  #define P_JSON_SSE2 0
+#endif
 
-PJSONRecord::PJSONRecord()
+
+static __inline bool IsJSONWhiteSpace(char c)
 {
-  s_jsonDataInitialiser->push(this);
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
 }
 
 
-PJSONRecord::PJSONRecord(const PJSONRecord &)
+static const char * FindQuoteOrEscape(const char * ptr, const char * end)
 {
-  s_jsonDataInitialiser->push(this);
+#if P_JSON_SSE2
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i escape = _mm_set1_epi8('\\');
+  while (end - ptr >= 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)ptr);
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, escape)));
+    if (mask != 0)
+      return ptr + CountTrailingZeros(mask);
+    ptr += 16;
+  }
+#endif
+
+  while (ptr < end && *ptr != '"' && *ptr != '\\')
+    ++ptr;
+  return ptr;
 }
 
 
-PJSONWrapMember::PJSONWrapMember(const char * memberName)
-  : m_memberName(memberName)
+static const char * SkipJSONWhiteSpace(const char * ptr, const char * end)
 {
-  if (m_memberName.IsEmpty())
-    return;
-
-  if (m_memberName[0] == '_')
-    m_memberName.Delete(0, 1);
-  else if (m_memberName.NumCompare("m_") == PObject::EqualTo)
-    m_memberName.Delete(0, 2);
+#if P_JSON_SSE2
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i tab = _mm_set1_epi8('\t');
+  while (end - ptr >= 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)ptr);
+    __m128i white = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newline)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(chunk, cr),    _mm_cmpeq_epi8(chunk, tab)));
+    unsigned mask = ~_mm_movemask_epi8(white) & 0xffff;
+    if (mask != 0)
+      return ptr + CountTrailingZeros(mask);
+    ptr += 16;
+  }
+#endif
 
-  s_jsonDataInitialiser->top()->m_jsonDataMembers[m_memberName] = this;
+  while (ptr < end && IsJSONWhiteSpace(*ptr))
+    ++ptr;
+  return ptr;
 }
 
 
-PJSONWrapMember::PJSONWrapMember(const PJSONWrapMember & other)
-  : m_memberName(other.m_memberName)
+PJSONParser::PJSONParser(const char * data, size_t length)
+  : m_data(data)
+  , m_position(data)
+  , m_end(data + length)
 {
-  if (!m_memberName.IsEmpty())
-    s_jsonDataInitialiser->top()->m_jsonDataMembers[m_memberName] = this;
+  Construct();
 }
 
 
-PJSONWrapMember & PJSONWrapMember::operator=(const PJSONWrapMember & other)
+PJSONParser::PJSONParser(const PString & str)
+  : m_source(str)
+  , m_data((const char *)m_source)
+  , m_position(m_data)
+  , m_end(m_data + m_source.GetLength())
 {
-  PAssert(m_memberName == other.m_memberName, "Cannot assign from different type of enclosing PJSONRecord");
-  return *this;
+  Construct();
 }
 
 
-void PJSONWrapMember::EndRecordConstruction()
+void PJSONParser::Construct()
 {
-  if (!m_memberName.IsEmpty())
-    s_jsonDataInitialiser->pop();
+  m_event = e_StartObject; // Anything not e_Error or e_EndOfData
+  m_expecting = e_ExpectValue;
+  m_string = m_data;
+  m_stringLength = 0;
+  m_stringInBuffer = true;
+  m_boolean = false;
 }
 
 
-void PJSONRecord::ReadFrom(istream & strm)
+PJSONParser::Events PJSONParser::Next()
 {
-  PJSON json;
-  json.ReadFrom(strm);
-  if (strm.bad() || strm.fail())
-    return;
+  if (m_event == e_Error || m_event == e_EndOfData)
+    return m_event;
 
-  if (!FromJSON(json))
-    strm.setstate(ios::failbit);
+  SkipWhiteSpace();
+
+  switch (m_expecting) {
+    case e_ExpectEndOfData :
+      return m_position == m_end ? SetEvent(e_EndOfData) : Fail("extra characters after value");
+
+    case e_ExpectCommaOrClose :
+      if (m_position < m_end && *m_position == ',') {
+        ++m_position;
+        SkipWhiteSpace();
+        return m_containers.back() == '{' ? ParseMemberName() : ParseValue();
+      }
+      return ParseClose();
+
+    case e_ExpectNameOrClose :
+      if (m_position < m_end && *m_position == '}')
+        return ParseClose();
+      return ParseMemberName();
+
+    case e_ExpectValueOrClose :
+      if (m_position < m_end && *m_position == ']')
+        return ParseClose();
+      // Next case
+
+    default :
+      return ParseValue();
+  }
 }
 
 
-void PJSONRecord::PrintOn(ostream & strm) const
+bool PJSONParser::Skip()
 {
-  PJSON json;
-  AsJSON(json);
-  strm << json;
+  switch (m_event) {
+    case e_MemberName :
+      if (Next() == e_Error)
+        return false;
+      if (m_event != e_StartObject && m_event != e_StartArray)
+        return true;
+      // Next case
+
+    case e_StartObject :
+    case e_StartArray :
+    {
+      size_t depth = m_containers.size();
+      while (m_containers.size() >= depth) {
+        if (Next() == e_Error || m_event == e_EndOfData)
+          return false;
+      }
+      return true;
+    }
+
+    default :
+      return m_event != e_Error;
+  }
 }
 
 
-bool PJSONRecord::FromString(const PString & str)
+bool PJSONParser::IsString(const char * str) const
 {
-  PJSON json;
-  return json.FromString(str) && FromJSON(json);
+  return strlen(str) == m_stringLength && memcmp(str, m_string, m_stringLength) == 0;
 }
 
 
-PString PJSONRecord::AsString(std::streamsize initialIndent, std::streamsize subsequentIndent) const
+long double PJSONParser::GetNumber() const
 {
-  PJSON json;
-  AsJSON(json);
-  return json.AsString(initialIndent, subsequentIndent);
+  return ConvertNumber(m_string, m_stringLength);
 }
 
 
-bool PJSONRecord::FromJSON(const PJSON & json)
+long double PJSONParser::ConvertNumber(const char * text, size_t length)
 {
-  return json.IsType(PJSON::e_Object) && FromJSON(json.GetObject());
+  const char * ptr = text;
+  const char * end = text + length;
+  bool negative = ptr < end && *ptr == '-';
+  if (negative)
+    ++ptr;
+
+  // Up to 18 digits cannot overflow 64 bits
+  if (ptr < end && end - ptr <= 18) {
+    uint64_t value = 0;
+    while (ptr < end && *ptr >= '0' && *ptr <= '9')
+      value = value*10 + (*ptr++ - '0');
+    if (ptr == end)
+      return negative ? -(long double)value : (long double)value;
+  }
+
+  // Text in buffer is not null terminated
+  char buffer[64];
+  if (length < sizeof(buffer)) {
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return strtold(buffer, NULL);
+  }
+
+  return strtold(std::string(text, length).c_str(), NULL);
 }
 
 
-void PJSONRecord::AsJSON(PJSON & json) const
+PJSONParser::Events PJSONParser::Fail(const char * PTRACE_PARAM(reason))
 {
-  json = PJSON(PJSON::e_Object);
-  AsJSON(json.GetObject());
+  PTRACE(4, "Parse error at offset " << GetOffset() << ": " << reason);
+  return SetEvent(e_Error);
 }
 
 
-bool PJSONRecord::FromJSON(const PJSON::Object & obj)
+PJSONParser::Events PJSONParser::ValueDone(Events event)
 {
-  bool good = true;
-  for (PJSON::Object::const_iterator it = obj.begin(); it != obj.end(); ++it) {
-    std::map<PString, PJSONWrapMember *>::iterator member = m_jsonDataMembers.find(it->first);
-    if (member != m_jsonDataMembers.end()) {
-      if (!it->second->IsType(member->second->GetType()) || !member->second->FromJSON(*it->second)) {
-        good = false;
-      }
-    }
-  }
-  return good;
+  m_expecting = m_containers.empty() ? e_ExpectEndOfData : e_ExpectCommaOrClose;
+  return SetEvent(event);
 }
 
 
-void PJSONRecord::AsJSON(PJSON::Object & obj) const
+PJSONParser::Events PJSONParser::ParseValue()
 {
-  for (std::map<PString, PJSONWrapMember *>::const_iterator it = m_jsonDataMembers.begin(); it != m_jsonDataMembers.end(); ++it) {
-    if (obj.Set(it->first, it->second->GetType()))
-      it->second->AsJSON(*obj.at(it->first));
-  }
-}
+  if (m_position == m_end)
+    return Fail("unexpected end of data");
 
+  switch (*m_position) {
+    case '{' :
+    case '[' :
+      if (m_containers.size() >= MaxDepth)
+        return Fail("nested too deeply");
+      m_containers.push_back(*m_position);
+      m_expecting = *m_position++ == '{' ? e_ExpectNameOrClose : e_ExpectValueOrClose;
+      return SetEvent(m_expecting == e_ExpectNameOrClose ? e_StartObject : e_StartArray);
 
-///////////////////////////////////////////////////////////////////////////////
+    case '"' :
+      if (!ParseString())
+        return Fail("unterminated string or bad escape");
+      return ValueDone(e_String);
 
-#if P_SSL
+    case '0' :
+    case '1' :
+    case '2' :
+    case '3' :
+    case '4' :
+    case '5' :
+    case '6' :
+    case '7' :
+    case '8' :
+    case '9' :
+    case '-' :
+    case '.' :
+      if (!ParseNumber())
+        return Fail("invalid number");
+      return ValueDone(e_Number);
 
-PJWT::PJWT()
-  : PJSON(e_Object)
-{
+    case 'T' :
+    case 't' :
+      if (!ParseLiteral("true", 4))
+        return Fail("invalid literal");
+      m_boolean = true;
+      return ValueDone(e_Boolean);
+
+    case 'F' :
+    case 'f' :
+      if (!ParseLiteral("false", 5))
+        return Fail("invalid literal");
+      m_boolean = false;
+      return ValueDone(e_Boolean);
+
+    case 'N' :
+    case 'n' :
+      if (!ParseLiteral("null", 4))
+        return Fail("invalid literal");
+      return ValueDone(e_Null);
+  }
+
+  return Fail("unexpected character");
 }
 
 
-PJWT::PJWT(const PString & str, const PString & secret, const PTime & verifyTime)
+PJSONParser::Events PJSONParser::ParseMemberName()
 {
-  m_valid = Decode(str, secret, verifyTime);
+  if (m_position == m_end || *m_position != '"')
+    return Fail("expected member name");
+
+  if (!ParseString())
+    return Fail("unterminated string or bad escape");
+
+  SkipWhiteSpace();
+  if (m_position == m_end || *m_position != ':')
+    return Fail("expected ':'");
+
+  ++m_position;
+  m_expecting = e_ExpectValue;
+  return SetEvent(e_MemberName);
 }
 
 
-static PHMAC * CreateHMAC(const PJWT::Algorithm algorithm)
+PJSONParser::Events PJSONParser::ParseClose()
 {
-  switch (algorithm) {
-    case PJWT::HS256:
-      return new PHMAC_SHA256;
-      break;
-    case PJWT::HS384:
-      return new PHMAC_SHA384;
-      break;
-    case PJWT::HS512:
-      return new PHMAC_SHA512;
-    default :
-      PAssertAlways("Unknown algorithm");
-      return NULL;
-  }
+  if (m_position == m_end)
+    return Fail("unexpected end of data");
+
+  char close = m_containers.back() == '{' ? '}' : ']';
+  if (*m_position != close)
+    return Fail(close == '}' ? "expected ',' or '}'" : "expected ',' or ']'");
+
+  ++m_position;
+  m_containers.pop_back();
+  return ValueDone(close == '}' ? e_EndObject : e_EndArray);
 }
 
 
-PString PJWT::Encode(const PString & secret, const Algorithm algorithm)
+bool PJSONParser::ParseString()
 {
-  PAutoPtr<PHMAC> hmac(CreateHMAC(algorithm));
-  if (!hmac.get())
-    return PString::Empty();
+  const char * start = ++m_position;
+  const char * ptr = FindQuoteOrEscape(start, m_end);
 
-  hmac->SetKey(secret);
+  // The usual case, no escapes, so no copy
+  if (ptr < m_end && *ptr == '"') {
+    m_string = start;
+    m_stringLength = ptr - start;
+    m_stringInBuffer = true;
+    m_position = ptr+1;
+    return true;
+  }
 
-  PJSON hdr(e_Object);
-  Object & hdrObj = hdr.GetObject();
-  hdrObj.SetString("typ", "JWT");
-  hdrObj.SetString("alg", PSTRSTRM(algorithm));
+  m_decoded.assign(start, ptr);
+  while (ptr < m_end) {
+    if (*ptr == '"') {
+      m_string = m_decoded.data();
+      m_stringLength = m_decoded.length();
+      m_stringInBuffer = false;
+      m_position = ptr+1;
+      return true;
+    }
 
-  PStringStream token;
-  token << PBase64::Encode(hdr.AsString(), PBase64::e_URL) << '.' << PBase64::Encode(AsString(), PBase64::e_URL);
-  PINDEX prefixLength = token.GetLength();
+    if (!ParseEscape(ptr)) {
+      m_position = ptr;
+      return false;
+    }
 
-  token << '.' << hmac->Encode(token.GetPointer(), prefixLength, PBase64::e_URL);
+    const char * next = FindQuoteOrEscape(ptr, m_end);
+    m_decoded.append(ptr, next);
+    ptr = next;
+  }
 
-  return token;
+  m_position = ptr;
+  return false;
 }
 
 
-bool PJWT::Decode(const PString & str, const PString & secret, const PTime & verifyTime)
+static bool ReadHex4(const char * ptr, const char * end, unsigned & value)
 {
-  PStringArray section = str.Tokenise(".");
-  if (section.size() != 3) {
-    PTRACE(2, "Invalid JWT header: \"" << str.Left(100) << '"');
+  if (end - ptr < 4)
     return false;
+
+  value = 0;
+  for (int i = 0; i < 4; ++i) {
+    char c = ptr[i];
+    value <<= 4;
+    if (c >= '0' && c <= '9')
+      value |= c - '0';
+    else if (c >= 'a' && c <= 'f')
+      value |= c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      value |= c - 'A' + 10;
+    else
+      return false;
   }
+  return true;
+}
 
-  PJSON hdr(PBase64::Decode(section[0]));
-  if (!hdr.IsValid()) {
-    PTRACE(2, "Invalid JWT header JSON.");
+
+bool PJSONParser::ParseEscape(const char * & ptr)
+{
+  // ptr is at the backslash
+  if (++ptr == m_end)
     return false;
+
+  char c = *ptr++;
+  switch (c) {
+    case '"' :
+    case '\\' :
+    case '/' :
+      m_decoded += c;
+      return true;
+    case 'b' :
+      m_decoded += '\b';
+      return true;
+    case 'f' :
+      m_decoded += '\f';
+      return true;
+    case 'n' :
+      m_decoded += '\n';
+      return true;
+    case 'r' :
+      m_decoded += '\r';
+      return true;
+    case 't' :
+      m_decoded += '\t';
+      return true;
+    case 'u' :
+      break;
+    default :
+      return false;
   }
 
-  if (!hdr.IsType(e_Object)) {
-    PTRACE(2, "Invalid JWT header JSON type.");
+  unsigned code;
+  if (!ReadHex4(ptr, m_end, code))
     return false;
+  ptr += 4;
+
+  // Combine UTF-16 surrogate pair
+  unsigned low;
+  if (code >= 0xd800 && code < 0xdc00 && m_end - ptr >= 6 && ptr[0] == '\\' && ptr[1] == 'u' &&
+        ReadHex4(ptr+2, m_end, low) && low >= 0xdc00 && low < 0xe000) {
+    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+    ptr += 6;
   }
 
-  Object & hdrObj = hdr.GetObject();
-  if (hdrObj.GetString("typ") != "JWT") {
+  if (code < 0x80)
+    m_decoded += (char)code;
+  else if (code < 0x800) {
+    m_decoded += (char)(0xc0 | (code >> 6));
+    m_decoded += (char)(0x80 | (code & 0x3f));
+  }
+  else if (code < 0x10000) {
+    m_decoded += (char)(0xe0 | (code >> 12));
+    m_decoded += (char)(0x80 | ((code >> 6) & 0x3f));
+    m_decoded += (char)(0x80 | (code & 0x3f));
+  }
+  else {
+    m_decoded += (char)(0xf0 | (code >> 18));
+    m_decoded += (char)(0x80 | ((code >> 12) & 0x3f));
+    m_decoded += (char)(0x80 | ((code >> 6) & 0x3f));
+    m_decoded += (char)(0x80 | (code & 0x3f));
+  }
+  return true;
+}
+
+
+bool PJSONParser::ParseNumber()
+{
+  const char * ptr = m_position;
+
+  if (*ptr == '-')
+    ++ptr;
+
+  // Allow the leading zeros and leading or trailing decimal point that istream does
+  const char * digits = ptr;
+  while (ptr < m_end && *ptr >= '0' && *ptr <= '9')
+    ++ptr;
+  size_t mantissaDigits = ptr - digits;
+
+  if (ptr < m_end && *ptr == '.') {
+    digits = ++ptr;
+    while (ptr < m_end && *ptr >= '0' && *ptr <= '9')
+      ++ptr;
+    mantissaDigits += ptr - digits;
+  }
+
+  if (mantissaDigits == 0)
+    return false;
+
+  if (ptr < m_end && (*ptr == 'e' || *ptr == 'E')) {
+    ++ptr;
+    if (ptr < m_end && (*ptr == '+' || *ptr == '-'))
+      ++ptr;
+    digits = ptr;
+    while (ptr < m_end && *ptr >= '0' && *ptr <= '9')
+      ++ptr;
+    if (ptr == digits)
+      return false;
+  }
+
+  m_string = m_position;
+  m_stringLength = ptr - m_position;
+  m_stringInBuffer = true;
+  m_position = ptr;
+  return true;
+}
+
+
+bool PJSONParser::ParseLiteral(const char * literal, size_t length)
+{
+  if ((size_t)(m_end - m_position) < length)
+    return false;
+
+  for (size_t i = 0; i < length; ++i) {
+    if (tolower(m_position[i]) != literal[i])
+      return false;
+  }
+
+  m_position += length;
+  return true;
+}
+
+
+void PJSONParser::SkipWhiteSpace()
+{
+  // Most tokens have no white space before them, so quick check first
+  if (m_position < m_end && IsJSONWhiteSpace(*m_position))
+    m_position = SkipJSONWhiteSpace(m_position+1, m_end);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static const PJSONDocument::Value & GetNullJSONValue()
+{
+  static const PJSONDocument::Value null;
+  return null;
+}
+
+
+PString PJSONDocument::Value::GetString() const
+{
+  return m_type == PJSON::e_String ? PString(m_text, m_size) : PString::Empty();
+}
+
+
+PJSON::NumberType PJSONDocument::Value::GetNumber() const
+{
+  return m_type == PJSON::e_Number ? PJSONParser::ConvertNumber(m_text, m_size) : 0;
+}
+
+
+int PJSONDocument::Value::GetInteger() const
+{
+  return lrintl(GetNumber());
+}
+
+
+int64_t PJSONDocument::Value::GetInteger64() const
+{
+  return llrintl(GetNumber());
+}
+
+
+unsigned PJSONDocument::Value::GetUnsigned() const
+{
+  return lrintl(GetNumber());
+}
+
+
+uint64_t PJSONDocument::Value::GetUnsigned64() const
+{
+  return llrintl(GetNumber());
+}
+
+
+const PJSONDocument::Value & PJSONDocument::Value::operator[](size_t index) const
+{
+  return index < GetSize() ? m_children[index] : GetNullJSONValue();
+}
+
+
+const PJSONDocument::Value * PJSONDocument::Value::Find(const char * name) const
+{
+  if (m_type != PJSON::e_Object)
+    return NULL;
+
+  size_t length = strlen(name);
+  for (const Value * it = begin(); it != end(); ++it) {
+    if (it->m_nameLength == length && memcmp(it->m_name, name, length) == 0)
+      return it;
+  }
+
+  return NULL;
+}
+
+
+const PJSONDocument::Value & PJSONDocument::Value::operator[](const char * name) const
+{
+  const Value * member = Find(name);
+  return member != NULL ? *member : GetNullJSONValue();
+}
+
+
+PJSON::Base * PJSONDocument::Value::CreateJSON() const
+{
+  switch (m_type) {
+    case PJSON::e_Object :
+    {
+      PJSON::Object * obj = new PJSON::Object;
+      for (const Value * it = begin(); it != end(); ++it) {
+        std::pair<PJSON::Object::iterator, bool> result = obj->insert(make_pair(std::string(it->m_name, it->m_nameLength), (PJSON::Base *)NULL));
+        if (result.second)
+          result.first->second = it->CreateJSON();
+      }
+      return obj;
+    }
+
+    case PJSON::e_Array :
+    {
+      PJSON::Array * arr = new PJSON::Array;
+      arr->reserve(m_size);
+      for (const Value * it = begin(); it != end(); ++it)
+        arr->push_back(it->CreateJSON());
+      return arr;
+    }
+
+    case PJSON::e_String :
+    {
+      PJSON::String * str = new PJSON::String;
+      *str = GetString();
+      return str;
+    }
+
+    case PJSON::e_Number :
+      return new PJSON::Number(GetNumber());
+
+    case PJSON::e_Boolean :
+      return new PJSON::Boolean(m_boolean);
+
+    default :
+      return new PJSON::Null;
+  }
+}
+
+
+PJSONDocument::PJSONDocument()
+  : m_valid(false)
+  , m_errorOffset(0)
+  , m_blocks(NULL)
+  , m_nextFree(NULL)
+  , m_freeSize(0)
+{
+}
+
+
+PJSONDocument::~PJSONDocument()
+{
+  Clear();
+}
+
+
+bool PJSONDocument::Parse(const char * data, size_t length)
+{
+  m_source.MakeEmpty();
+  PJSONParser parser(data, length);
+  return InternalParse(parser);
+}
+
+
+bool PJSONDocument::Parse(const PString & str)
+{
+  m_source = str;
+  PJSONParser parser((const char *)m_source, m_source.GetLength());
+  return InternalParse(parser);
+}
+
+
+void PJSONDocument::Clear()
+{
+  while (m_blocks != NULL) {
+    Block * next = m_blocks->m_next;
+    delete [] (char *)m_blocks;
+    m_blocks = next;
+  }
+  m_nextFree = NULL;
+  m_freeSize = 0;
+
+  m_root = Value();
+  m_valid = false;
+}
+
+
+size_t PJSONDocument::GetArenaSize() const
+{
+  size_t total = 0;
+  for (Block * block = m_blocks; block != NULL; block = block->m_next)
+    total += block->m_size;
+  return total;
+}
+
+
+void PJSONDocument::PrintOn(ostream & strm) const
+{
+  PJSONWriter writer;
+  SetWriterFromStream(writer, strm);
+  writer.Write(m_root);
+  strm.write(writer.GetData(), writer.GetLength());
+}
+
+
+void * PJSONDocument::Allocate(size_t size)
+{
+  // Keep everything aligned for Value
+  size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  if (size > m_freeSize) {
+    size_t blockSize = m_blocks != NULL ? std::min(m_blocks->m_size*2, (size_t)1000000) : 4096;
+    if (blockSize < size)
+      blockSize = size;
+    Block * block = (Block *)new char[sizeof(Block) + blockSize];
+    block->m_next = m_blocks;
+    block->m_size = blockSize;
+    m_blocks = block;
+    m_nextFree = (char *)(block + 1);
+    m_freeSize = blockSize;
+  }
+
+  void * ptr = m_nextFree;
+  m_nextFree += size;
+  m_freeSize -= size;
+  return ptr;
+}
+
+
+const char * PJSONDocument::SaveString(const PJSONParser & parser)
+{
+  if (parser.IsStringInBuffer())
+    return parser.GetStringPtr();
+
+  char * str = (char *)Allocate(parser.GetStringLength());
+  memcpy(str, parser.GetStringPtr(), parser.GetStringLength());
+  return str;
+}
+
+
+bool PJSONDocument::InternalParse(PJSONParser & parser)
+{
+  /* Reuse the arena, if it took more than one block last time, replace with a
+     single block of the total size, so parsing similar documents repeatedly
+     settles down to no allocations at all. */
+  size_t arenaSize = GetArenaSize();
+  if (m_blocks != NULL && m_blocks->m_next == NULL) {
+    m_nextFree = (char *)(m_blocks + 1);
+    m_freeSize = m_blocks->m_size;
+    m_root = Value();
+    m_valid = false;
+  }
+  else {
+    Clear();
+    if (arenaSize > 0) {
+      Allocate(arenaSize);
+      m_nextFree = (char *)(m_blocks + 1);
+      m_freeSize = m_blocks->m_size;
+    }
+  }
+
+  m_valueStack.clear();
+  m_containerStack.clear();
+
+  const char * name = "";
+  size_t nameLength = 0;
+
+  for (;;) {
+    Value value;
+    value.m_name = name;
+    value.m_nameLength = (unsigned)nameLength;
+
+    switch (parser.Next()) {
+      case PJSONParser::e_Error :
+        m_errorOffset = parser.GetOffset();
+        return false;
+
+      case PJSONParser::e_EndOfData :
+        m_root = m_valueStack.front();
+        m_valid = true;
+        return true;
+
+      case PJSONParser::e_MemberName :
+        name = SaveString(parser);
+        nameLength = parser.GetStringLength();
+        continue;
+
+      case PJSONParser::e_EndObject :
+      case PJSONParser::e_EndArray :
+      {
+        // Move children from stack to their final, contiguous, place in arena
+        size_t start = m_containerStack.back();
+        m_containerStack.pop_back();
+        size_t count = m_valueStack.size() - start;
+        Value & container = m_valueStack[start-1];
+        container.m_size = count;
+        if (count > 0) {
+          Value * children = (Value *)Allocate(count*sizeof(Value));
+          std::copy(m_valueStack.begin()+start, m_valueStack.end(), children);
+          container.m_children = children;
+        }
+        m_valueStack.resize(start);
+        continue;
+      }
+
+      case PJSONParser::e_StartObject :
+        value.m_type = PJSON::e_Object;
+        break;
+
+      case PJSONParser::e_StartArray :
+        value.m_type = PJSON::e_Array;
+        break;
+
+      case PJSONParser::e_String :
+        value.m_type = PJSON::e_String;
+        value.m_text = SaveString(parser);
+        value.m_size = parser.GetStringLength();
+        break;
+
+      case PJSONParser::e_Number :
+        value.m_type = PJSON::e_Number;
+        value.m_text = parser.GetStringPtr();
+        value.m_size = parser.GetStringLength();
+        break;
+
+      case PJSONParser::e_Boolean :
+        value.m_type = PJSON::e_Boolean;
+        value.m_boolean = parser.GetBoolean();
+        break;
+
+      default :
+        break;
+    }
+
+    m_valueStack.push_back(value);
+    if (value.m_type == PJSON::e_Object || value.m_type == PJSON::e_Array)
+      m_containerStack.push_back(m_valueStack.size());
+
+    name = "";
+    nameLength = 0;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/* Grisu2 shortest floating point to text, after Florian Loitsch, "Printing
+   Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010.
+   The output always reads back to the same value, and is the shortest
+   possible in all but a tiny fraction of cases, which are then caught by
+   ShortestRoundTrip(). */
+
+namespace PJSONGrisu {
+
+struct DiyFp
+{
+  DiyFp() : f(0), e(0) { }
+  DiyFp(uint64_t fp, int exp) : f(fp), e(exp) { }
+
+  DiyFp operator-(const DiyFp & rhs) const { return DiyFp(f - rhs.f, e); }
+
+  DiyFp operator*(const DiyFp & rhs) const
+  {
+    // 64x64 multiply, keeping the rounded upper 64 bits
+    const uint64_t M32 = 0xffffffff;
+    uint64_t a = f >> 32;
+    uint64_t b = f & M32;
+    uint64_t c = rhs.f >> 32;
+    uint64_t d = rhs.f & M32;
+    uint64_t ac = a * c;
+    uint64_t bc = b * c;
+    uint64_t ad = a * d;
+    uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32) + (1U << 31);
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+  }
+
+  DiyFp Normalize() const
+  {
+    DiyFp result = *this;
+    while ((result.f & 0x8000000000000000ULL) == 0) {
+      result.f <<= 1;
+      --result.e;
+    }
+    return result;
+  }
+
+  uint64_t f;
+  int e;
+};
+
+
+// Normalised 10^k for k = -348, -340, ..., 340
+static const uint64_t CachedPowersF[] = {
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+  0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+  0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+  0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+  0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+  0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+  0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+  0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+  0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+  0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+  0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+  0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+  0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+  0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+  0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+  0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+  0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+  0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+  0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+  0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+  0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+  0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t CachedPowersE[] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+
+static DiyFp GetCachedPower(int e, int & K)
+{
+  double dk = (-61 - e) * 0.30102999566398114 + 347; // 1/lg(10)
+  int k = (int)dk;
+  if (dk - k > 0.0)
+    ++k;
+
+  unsigned index = (unsigned)((k >> 3) + 1);
+  K = -(-348 + (int)(index * 8));
+  return DiyFp(CachedPowersF[index], CachedPowersE[index]);
+}
+
+
+static const uint32_t Pow10_32[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+static const uint64_t Pow10_64[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+  1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+  1000000000000000000ULL, 10000000000000000000ULL
+};
+
+
+static void GrisuRound(char * buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+{
+  while (rest < wpw && delta - rest >= tenKappa && (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+    buffer[length - 1]--;
+    rest += tenKappa;
+  }
+}
+
+
+static int CountDecimalDigits(uint32_t n)
+{
+  int digits = 1;
+  while (digits < 10 && n >= Pow10_32[digits])
+    ++digits;
+  return digits;
+}
+
+
+static void DigitGen(const DiyFp & W, const DiyFp & Mp, uint64_t delta, char * buffer, int & length, int & K)
+{
+  const DiyFp one(1ULL << -Mp.e, Mp.e);
+  const DiyFp wpw = Mp - W;
+  uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = CountDecimalDigits(p1);
+  length = 0;
+
+  while (kappa > 0) {
+    uint32_t d = p1 / Pow10_32[kappa-1];
+    p1 %= Pow10_32[kappa-1];
+    if (d != 0 || length != 0)
+      buffer[length++] = (char)('0' + d);
+    --kappa;
+    uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+    if (rest <= delta) {
+      K += kappa;
+      GrisuRound(buffer, length, delta, rest, (uint64_t)Pow10_32[kappa] << -one.e, wpw.f);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char)(p2 >> -one.e);
+    if (d != 0 || length != 0)
+      buffer[length++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    --kappa;
+    if (p2 < delta) {
+      K += kappa;
+      int index = -kappa;
+      GrisuRound(buffer, length, delta, p2, one.f, wpw.f * (index < 20 ? Pow10_64[index] : 0));
+      return;
+    }
+  }
+}
+
+
+/* Value is f*2^e, f including any hidden bit. The lower boundary is closer
+   when the significand is an exact power of two (and not denormal). */
+static void Grisu2(uint64_t f, int e, bool lowerCloser, char * buffer, int & length, int & K)
+{
+  DiyFp plus = DiyFp((f << 1) + 1, e - 1).Normalize();
+  DiyFp minus = lowerCloser ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+
+  DiyFp cmk = GetCachedPower(plus.e, K);
+  DiyFp W = DiyFp(f, e).Normalize() * cmk;
+  DiyFp Wp = plus * cmk;
+  DiyFp Wm = minus * cmk;
+  ++Wm.f;
+  --Wp.f;
+  DigitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+
+static char * WriteExponent(int K, char * buffer)
+{
+  if (K < 0) {
+    *buffer++ = '-';
+    K = -K;
+  }
+  else
+    *buffer++ = '+';
+
+  if (K >= 100) {
+    *buffer++ = (char)('0' + K / 100);
+    K %= 100;
+    *buffer++ = (char)('0' + K / 10);
+  }
+  else if (K >= 10)
+    *buffer++ = (char)('0' + K / 10);
+  *buffer++ = (char)('0' + K % 10);
+  return buffer;
+}
+
+
+// Convert digits and exponent to JSON number text, returning length
+static size_t Prettify(char * buffer, int length, int k)
+{
+  const int kk = length + k; // 10^(kk-1) <= v < 10^kk
+
+  if (k >= 0 && kk <= 21) {
+    // 1234e7 -> 12340000000
+    for (int i = length; i < kk; ++i)
+      buffer[i] = '0';
+    return kk;
+  }
+
+  if (kk > 0 && kk <= 21) {
+    // 1234e-2 -> 12.34
+    memmove(&buffer[kk + 1], &buffer[kk], length - kk);
+    buffer[kk] = '.';
+    return length + 1;
+  }
+
+  if (kk > -6 && kk <= 0) {
+    // 1234e-6 -> 0.001234
+    const int offset = 2 - kk;
+    memmove(&buffer[offset], &buffer[0], length);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    for (int i = 2; i < offset; ++i)
+      buffer[i] = '0';
+    return length + offset;
+  }
+
+  if (length == 1) {
+    // 1e30
+    buffer[1] = 'e';
+    return WriteExponent(kk - 1, &buffer[2]) - buffer;
+  }
+
+  // 1234e30 -> 1.234e33
+  memmove(&buffer[2], &buffer[1], length - 1);
+  buffer[1] = '.';
+  buffer[length + 1] = 'e';
+  return WriteExponent(kk - 1, &buffer[length + 2]) - buffer;
+}
+
+/* Grisu2 may miss the shortest representation, e.g. 1e23 gives 16 digits.
+   Any double that reads back from 15 significant digits (6 for float) is
+   then exactly its shortest form when correctly rounded to that many digits,
+   so only long results need to be checked, using the C library with
+   increasing precision. */
+static void ShortestRoundTrip(double value, bool isFloat, char * buffer, int & length, int & K)
+{
+  for (int precision = isFloat ? 6 : 15; precision < length; ++precision) {
+    char text[40];
+    snprintf(text, sizeof(text), "%.*e", precision - 1, value);
+    if (isFloat ? (strtof(text, NULL) != (float)value) : (strtod(text, NULL) != value))
+      continue;
+
+    const char * exponent = strchr(text, 'e');
+    if (exponent == NULL)
+      return;
+
+    // Just the digits, the caller has already output any sign
+    int digits = 0;
+    for (const char * ptr = text; ptr < exponent; ++ptr) {
+      if (isdigit(*ptr))
+        buffer[digits++] = *ptr;
+    }
+    while (digits > 1 && buffer[digits - 1] == '0')
+      --digits;
+
+    length = digits;
+    K = atoi(exponent + 1) - (digits - 1);
+    return;
+  }
+}
+
+} // namespace PJSONGrisu
+
+
+static const char TwoDigits[] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+
+size_t PJSONWriter::FormatNumber(char * buffer, unsigned long long value)
+{
+  char digits[20];
+  char * ptr = digits + sizeof(digits);
+
+  while (value >= 100) {
+    unsigned pair = (unsigned)(value % 100) * 2;
+    value /= 100;
+    *--ptr = TwoDigits[pair + 1];
+    *--ptr = TwoDigits[pair];
+  }
+
+  if (value >= 10) {
+    *--ptr = TwoDigits[value * 2 + 1];
+    *--ptr = TwoDigits[value * 2];
+  }
+  else
+    *--ptr = (char)('0' + value);
+
+  size_t length = digits + sizeof(digits) - ptr;
+  memcpy(buffer, ptr, length);
+  return length;
+}
+
+
+size_t PJSONWriter::FormatNumber(char * buffer, long long value)
+{
+  if (value >= 0)
+    return FormatNumber(buffer, (unsigned long long)value);
+
+  *buffer = '-';
+  return FormatNumber(buffer+1, 0ULL - (unsigned long long)value) + 1;
+}
+
+
+static size_t FormatNull(char * buffer)
+{
+  memcpy(buffer, "null", 4);
+  return 4;
+}
+
+
+size_t PJSONWriter::FormatNumber(char * buffer, long double value)
+{
+  if (!std::isfinite(value))
+    return FormatNull(buffer);
+
+  // Integers are output as such, even if they do not fit in a double
+  if (value >= 0) {
+    if (value < 18446744073709551616.0L) {
+      unsigned long long integer = (unsigned long long)value;
+      if (integer == value)
+        return FormatNumber(buffer, integer);
+    }
+  }
+  else if (value >= -9223372036854775808.0L) {
+    long long integer = (long long)value;
+    if (integer == value)
+      return FormatNumber(buffer, integer);
+  }
+
+  return FormatNumber(buffer, (double)value);
+}
+
+
+size_t PJSONWriter::FormatNumber(char * buffer, double value)
+{
+  if (!std::isfinite(value))
+    return FormatNull(buffer);
+
+  if (value >= 0) {
+    if (value < 18446744073709551616.0) {
+      unsigned long long integer = (unsigned long long)value;
+      if (integer == value)
+        return FormatNumber(buffer, integer);
+    }
+  }
+  else if (value >= -9223372036854775808.0) {
+    long long integer = (long long)value;
+    if (integer == value)
+      return FormatNumber(buffer, integer);
+  }
+
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  size_t sign = 0;
+  if (value < 0) {
+    *buffer++ = '-';
+    sign = 1;
+  }
+
+  uint64_t significand = bits & ((1ULL << 52) - 1);
+  int biasedExponent = (int)((bits >> 52) & 0x7ff);
+  int length, K = 0;
+  if (biasedExponent != 0)
+    PJSONGrisu::Grisu2(significand | (1ULL << 52), biasedExponent - 1075, significand == 0 && biasedExponent > 1, buffer, length, K);
+  else
+    PJSONGrisu::Grisu2(significand, -1074, false, buffer, length, K);
+
+  if (length > 15)
+    PJSONGrisu::ShortestRoundTrip(value, false, buffer, length, K);
+
+  return PJSONGrisu::Prettify(buffer, length, K) + sign;
+}
+
+
+size_t PJSONWriter::FormatNumber(char * buffer, float value)
+{
+  if (!std::isfinite(value))
+    return FormatNull(buffer);
+
+  // Any integral float fits in a double exactly
+  if (value >= -9223372036854775808.0f && value < 18446744073709551616.0f && floorf(value) == value)
+    return FormatNumber(buffer, (double)value);
+
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  size_t sign = 0;
+  if (value < 0) {
+    *buffer++ = '-';
+    sign = 1;
+  }
+
+  uint32_t significand = bits & ((1U << 23) - 1);
+  int biasedExponent = (int)((bits >> 23) & 0xff);
+  int length, K = 0;
+  if (biasedExponent != 0)
+    PJSONGrisu::Grisu2(significand | (1U << 23), biasedExponent - 150, significand == 0 && biasedExponent > 1, buffer, length, K);
+  else
+    PJSONGrisu::Grisu2(significand, -149, false, buffer, length, K);
+
+  if (length > 6)
+    PJSONGrisu::ShortestRoundTrip(value, true, buffer, length, K);
+
+  return PJSONGrisu::Prettify(buffer, length, K) + sign;
+}
+
+
+PJSONWriter::PJSONWriter(unsigned initialIndent, unsigned increment)
+  : m_buffer(m_ownBuffer)
+{
+  Construct(initialIndent, increment);
+}
+
+
+PJSONWriter::PJSONWriter(PCharArray & buffer, unsigned initialIndent, unsigned increment)
+  : m_buffer(buffer)
+{
+  Construct(initialIndent, increment);
+}
+
+
+void PJSONWriter::Construct(unsigned initialIndent, unsigned increment)
+{
+  m_pretty = initialIndent != 0 || increment != 0;
+  m_initialIndent = initialIndent;
+  m_increment = increment != 0 ? increment : 2;
+  Clear();
+}
+
+
+void PJSONWriter::SetPretty(unsigned initialIndent, unsigned increment)
+{
+  m_pretty = true;
+  m_initialIndent = initialIndent;
+  m_increment = increment;
+}
+
+
+void PJSONWriter::Clear()
+{
+  // Reuse whatever the buffer has from previous use
+  m_data = m_buffer.GetPointer(1);
+  m_capacity = m_buffer.GetSize();
+  m_length = 0;
+  m_depth = 0;
+  m_first = true;
+  m_afterName = false;
+  *Reserve(0) = '\0';
+}
+
+
+char * PJSONWriter::Reserve(size_t length)
+{
+  // Always leave room for the null terminator
+  size_t needed = m_length + length + 1;
+  if (needed > m_capacity) {
+    m_capacity = std::max(needed, m_capacity*2 + 256);
+    m_data = m_buffer.GetPointer(m_capacity);
+  }
+  return m_data + m_length;
+}
+
+
+void PJSONWriter::Append(const char * data, size_t length)
+{
+  char * ptr = Reserve(length);
+  memcpy(ptr, data, length);
+  ptr[length] = '\0';
+  m_length += length;
+}
+
+
+void PJSONWriter::Append(char c)
+{
+  char * ptr = Reserve(1);
+  ptr[0] = c;
+  ptr[1] = '\0';
+  ++m_length;
+}
+
+
+void PJSONWriter::AppendIndent(unsigned indent)
+{
+  char * ptr = Reserve(indent);
+  memset(ptr, ' ', indent);
+  ptr[indent] = '\0';
+  m_length += indent;
+}
+
+
+void PJSONWriter::BeginValue(bool container)
+{
+  if (m_afterName) {
+    // Value of an object member, as in PJSON::Object::PrintOn()
+    m_afterName = false;
+    if (m_pretty) {
+      if (container) {
+        Append('\n');
+        AppendIndent(m_initialIndent + m_depth*m_increment);
+      }
+      else
+        Append(' ');
+    }
+    return;
+  }
+
+  if (m_depth == 0) {
+    if (m_pretty && container)
+      AppendIndent(m_initialIndent);
+    return;
+  }
+
+  // Element of an array
+  if (!m_first)
+    Append(',');
+  if (m_pretty) {
+    Append('\n');
+    AppendIndent(m_initialIndent + m_depth*m_increment);
+  }
+}
+
+
+PJSONWriter & PJSONWriter::OpenContainer(char open)
+{
+  BeginValue(true);
+  Append(open);
+  ++m_depth;
+  m_first = true;
+  return *this;
+}
+
+
+PJSONWriter & PJSONWriter::CloseContainer(char close)
+{
+  if (PAssert(m_depth > 0, PLogicError))
+    --m_depth;
+  if (m_pretty && !m_first) {
+    Append('\n');
+    AppendIndent(m_initialIndent + m_depth*m_increment);
+  }
+  Append(close);
+  EndValue();
+  return *this;
+}
+
+
+PJSONWriter & PJSONWriter::StartObject()
+{
+  return OpenContainer('{');
+}
+
+
+PJSONWriter & PJSONWriter::EndObject()
+{
+  return CloseContainer('}');
+}
+
+
+PJSONWriter & PJSONWriter::StartArray()
+{
+  return OpenContainer('[');
+}
+
+
+PJSONWriter & PJSONWriter::EndArray()
+{
+  return CloseContainer(']');
+}
+
+
+#if P_JSON_SSE2
+  static const __m128i EscapeLimit = _mm_set1_epi8(0x1f);
+#endif
+
+static const char * FindCharToEscape(const char * ptr, const char * end)
+{
+#if P_JSON_SSE2
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i escape = _mm_set1_epi8('\\');
+  while (end - ptr >= 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)ptr);
+    __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, EscapeLimit), EscapeLimit);
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(control, _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, escape))));
+    if (mask != 0)
+      return ptr + CountTrailingZeros(mask);
+    ptr += 16;
+  }
+#endif
+
+  while (ptr < end && *ptr != '"' && *ptr != '\\' && (BYTE)*ptr >= ' ')
+    ++ptr;
+  return ptr;
+}
+
+
+PJSONWriter & PJSONWriter::Name(const char * name, size_t length)
+{
+  if (!m_first)
+    Append(',');
+  if (m_pretty) {
+    Append('\n');
+    AppendIndent(m_initialIndent + m_depth*m_increment);
+  }
+
+  AppendQuoted(name, length);
+
+  if (m_pretty)
+    Append(" :", 2);
+  else
+    Append(':');
+
+  m_afterName = true;
+  return *this;
+}
+
+
+void PJSONWriter::AppendQuoted(const char * str, size_t length)
+{
+  Append('"');
+
+  const char * end = str + length;
+  while (str < end) {
+    const char * next = FindCharToEscape(str, end);
+    Append(str, next - str);
+    if (next == end)
+      break;
+
+    // Same escapes as PJSON::String::PrintOn()
+    switch (*next) {
+      case '"' :
+        Append("\\\"", 2);
+        break;
+      case '\\' :
+        Append("\\\\", 2);
+        break;
+      case '\t' :
+        Append("\\t", 2);
+        break;
+      case '\r' :
+        Append("\\r", 2);
+        break;
+      case '\n' :
+        Append("\\n", 2);
+        break;
+      default :
+        char hex[6] = { '\\', 'u', '0', '0', "0123456789abcdef"[(*next >> 4) & 0xf], "0123456789abcdef"[*next & 0xf] };
+        Append(hex, sizeof(hex));
+    }
+    str = next + 1;
+  }
+
+  Append('"');
+}
+
+
+PJSONWriter & PJSONWriter::String(const char * str, size_t length)
+{
+  BeginValue(false);
+  AppendQuoted(str, length);
+  EndValue();
+  return *this;
+}
+
+
+PJSONWriter & PJSONWriter::RawNumber(const char * text, size_t length)
+{
+  BeginValue(false);
+  Append(text, length);
+  EndValue();
+  return *this;
+}
+
+
+PJSONWriter & PJSONWriter::Number(long long value)
+{
+  char buffer[MaxNumberSize];
+  return RawNumber(buffer, FormatNumber(buffer, value));
+}
+
+
+PJSONWriter & PJSONWriter::Number(unsigned long long value)
+{
+  char buffer[MaxNumberSize];
+  return RawNumber(buffer, FormatNumber(buffer, value));
+}
+
+
+PJSONWriter & PJSONWriter::Number(float value)
+{
+  char buffer[MaxNumberSize];
+  return RawNumber(buffer, FormatNumber(buffer, value));
+}
+
+
+PJSONWriter & PJSONWriter::Number(double value)
+{
+  char buffer[MaxNumberSize];
+  return RawNumber(buffer, FormatNumber(buffer, value));
+}
+
+
+PJSONWriter & PJSONWriter::Number(long double value)
+{
+  char buffer[MaxNumberSize];
+  return RawNumber(buffer, FormatNumber(buffer, value));
+}
+
+
+PJSONWriter & PJSONWriter::Boolean(bool value)
+{
+  return value ? RawNumber("true", 4) : RawNumber("false", 5);
+}
+
+
+PJSONWriter & PJSONWriter::Null()
+{
+  return RawNumber("null", 4);
+}
+
+
+PJSONWriter & PJSONWriter::Write(const PJSON::Base & value)
+{
+  if (value.IsType(PJSON::e_Object)) {
+    const PJSON::Object & obj = static_cast<const PJSON::Object &>(value);
+    StartObject();
+    for (PJSON::Object::const_iterator it = obj.begin(); it != obj.end(); ++it) {
+      Name(it->first.data(), it->first.length());
+      Write(*it->second);
+    }
+    return EndObject();
+  }
+
+  if (value.IsType(PJSON::e_Array)) {
+    const PJSON::Array & arr = static_cast<const PJSON::Array &>(value);
+    StartArray();
+    for (PJSON::Array::const_iterator it = arr.begin(); it != arr.end(); ++it)
+      Write(**it);
+    return EndArray();
+  }
+
+  if (value.IsType(PJSON::e_String))
+    return String(static_cast<const PJSON::String &>(value));
+
+  if (value.IsType(PJSON::e_Number))
+    return Number(static_cast<const PJSON::Number &>(value).GetValue());
+
+  if (value.IsType(PJSON::e_Boolean))
+    return Boolean(static_cast<const PJSON::Boolean &>(value).GetValue());
+
+  return Null();
+}
+
+
+/* The parser is lenient, as istream is, e.g. "007", ".5" or "5.", so check
+   for RFC8259 number grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+static bool IsStrictJSONNumber(const char * text, size_t length)
+{
+  const char * ptr = text;
+  const char * end = text + length;
+
+  if (ptr < end && *ptr == '-')
+    ++ptr;
+
+  if (ptr >= end)
+    return false;
+
+  if (*ptr == '0')
+    ++ptr;
+  else if (*ptr >= '1' && *ptr <= '9') {
+    while (ptr < end && *ptr >= '0' && *ptr <= '9')
+      ++ptr;
+  }
+  else
+    return false;
+
+  if (ptr < end && *ptr == '.') {
+    const char * digits = ++ptr;
+    while (ptr < end && *ptr >= '0' && *ptr <= '9')
+      ++ptr;
+    if (ptr == digits)
+      return false;
+  }
+
+  if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+    ++ptr;
+    if (ptr < end && (*ptr == '+' || *ptr == '-'))
+      ++ptr;
+    const char * digits = ptr;
+    while (ptr < end && *ptr >= '0' && *ptr <= '9')
+      ++ptr;
+    if (ptr == digits)
+      return false;
+  }
+
+  return ptr == end;
+}
+
+
+PJSONWriter & PJSONWriter::Write(const PJSONDocument::Value & value)
+{
+  switch (value.m_type) {
+    case PJSON::e_Object :
+      StartObject();
+      for (const PJSONDocument::Value * it = value.begin(); it != value.end(); ++it) {
+        Name(it->m_name, it->m_nameLength);
+        Write(*it);
+      }
+      return EndObject();
+
+    case PJSON::e_Array :
+      StartArray();
+      for (const PJSONDocument::Value * it = value.begin(); it != value.end(); ++it)
+        Write(*it);
+      return EndArray();
+
+    case PJSON::e_String :
+      return String(value.m_text, value.m_size);
+
+    case PJSON::e_Number :
+      // Output the source text as is, so it round trips exactly, if it is strictly valid
+      if (IsStrictJSONNumber(value.m_text, value.m_size))
+        return RawNumber(value.m_text, value.m_size);
+      return Number(value.GetNumber());
+
+    case PJSON::e_Boolean :
+      return Boolean(value.m_boolean);
+
+    default :
+      return Null();
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static PThreadLocalStorage< std::stack<PJSONRecord*> > s_jsonDataInitialiser;
+
+PJSONRecord::PJSONRecord()
+{
+  s_jsonDataInitialiser->push(this);
+}
+
+
+PJSONRecord::PJSONRecord(const PJSONRecord &)
+{
+  s_jsonDataInitialiser->push(this);
+}
+
+
+PJSONWrapMember::PJSONWrapMember(const char * memberName)
+  : m_memberName(memberName)
+{
+  if (m_memberName.IsEmpty())
+    return;
+
+  if (m_memberName[0] == '_')
+    m_memberName.Delete(0, 1);
+  else if (m_memberName.NumCompare("m_") == PObject::EqualTo)
+    m_memberName.Delete(0, 2);
+
+  s_jsonDataInitialiser->top()->m_jsonDataMembers[m_memberName] = this;
+}
+
+
+PJSONWrapMember::PJSONWrapMember(const PJSONWrapMember & other)
+  : m_memberName(other.m_memberName)
+{
+  if (!m_memberName.IsEmpty())
+    s_jsonDataInitialiser->top()->m_jsonDataMembers[m_memberName] = this;
+}
+
+
+PJSONWrapMember & PJSONWrapMember::operator=(const PJSONWrapMember & other)
+{
+  PAssert(m_memberName == other.m_memberName, "Cannot assign from different type of enclosing PJSONRecord");
+  return *this;
+}
+
+
+void PJSONWrapMember::AsJSON(PJSONWriter & writer) const
+{
+  PAutoPtr<PJSON::Base> value(CreateByType(GetType()));
+  AsJSON(*value);
+  writer.Write(*value);
+}
+
+
+void PJSONWrapMember::EndRecordConstruction()
+{
+  if (!m_memberName.IsEmpty())
+    s_jsonDataInitialiser->pop();
+}
+
+
+void PJSONRecord::ReadFrom(istream & strm)
+{
+  PJSON json;
+  json.ReadFrom(strm);
+  if (strm.bad() || strm.fail())
+    return;
+
+  if (!FromJSON(json))
+    strm.setstate(ios::failbit);
+}
+
+
+void PJSONRecord::PrintOn(ostream & strm) const
+{
+  PJSONWriter writer;
+  SetWriterFromStream(writer, strm);
+  AsJSON(writer);
+  strm.write(writer.GetData(), writer.GetLength());
+}
+
+
+bool PJSONRecord::FromString(const PString & str)
+{
+  PJSON json;
+  return json.FromString(str) && FromJSON(json);
+}
+
+
+PString PJSONRecord::AsString(std::streamsize initialIndent, std::streamsize subsequentIndent) const
+{
+  PJSONWriter writer((unsigned)initialIndent, (unsigned)subsequentIndent);
+  AsJSON(writer);
+  return writer.GetString();
+}
+
+
+bool PJSONRecord::FromJSON(const PJSON & json)
+{
+  return json.IsType(PJSON::e_Object) && FromJSON(json.GetObject());
+}
+
+
+void PJSONRecord::AsJSON(PJSON & json) const
+{
+  json = PJSON(PJSON::e_Object);
+  AsJSON(json.GetObject());
+}
+
+
+bool PJSONRecord::FromJSON(const PJSON::Object & obj)
+{
+  bool good = true;
+  for (PJSON::Object::const_iterator it = obj.begin(); it != obj.end(); ++it) {
+    std::map<PString, PJSONWrapMember *>::iterator member = m_jsonDataMembers.find(it->first);
+    if (member != m_jsonDataMembers.end()) {
+      if (!it->second->IsType(member->second->GetType()) || !member->second->FromJSON(*it->second)) {
+        good = false;
+      }
+    }
+  }
+  return good;
+}
+
+
+void PJSONRecord::AsJSON(PJSON::Object & obj) const
+{
+  for (std::map<PString, PJSONWrapMember *>::const_iterator it = m_jsonDataMembers.begin(); it != m_jsonDataMembers.end(); ++it) {
+    if (obj.Set(it->first, it->second->GetType()))
+      it->second->AsJSON(*obj.at(it->first));
+  }
+}
+
+
+void PJSONRecord::AsJSON(PJSONWriter & writer) const
+{
+  writer.StartObject();
+  for (std::map<PString, PJSONWrapMember *>::const_iterator it = m_jsonDataMembers.begin(); it != m_jsonDataMembers.end(); ++it) {
+    writer.Name(it->first);
+    it->second->AsJSON(writer);
+  }
+  writer.EndObject();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+#if P_SSL
+
+PJWT::PJWT()
+  : PJSON(e_Object)
+{
+}
+
+
+PJWT::PJWT(const PString & str, const PString & secret, const PTime & verifyTime)
+{
+  m_valid = Decode(str, secret, verifyTime);
+}
+
+
+static PHMAC * CreateHMAC(const PJWT::Algorithm algorithm)
+{
+  switch (algorithm) {
+    case PJWT::HS256:
+      return new PHMAC_SHA256;
+      break;
+    case PJWT::HS384:
+      return new PHMAC_SHA384;
+      break;
+    case PJWT::HS512:
+      return new PHMAC_SHA512;
+    default :
+      PAssertAlways("Unknown algorithm");
+      return NULL;
+  }
+}
+
+
+PString PJWT::Encode(const PString & secret, const Algorithm algorithm)
+{
+  PAutoPtr<PHMAC> hmac(CreateHMAC(algorithm));
+  if (!hmac.get())
+    return PString::Empty();
+
+  hmac->SetKey(secret);
+
+  PJSON hdr(e_Object);
+  Object & hdrObj = hdr.GetObject();
+  hdrObj.SetString("typ", "JWT");
+  hdrObj.SetString("alg", PSTRSTRM(algorithm));
+
+  PStringStream token;
+  token << PBase64::Encode(hdr.AsString(), PBase64::e_URL) << '.' << PBase64::Encode(AsString(), PBase64::e_URL);
+  PINDEX prefixLength = token.GetLength();
+
+  token << '.' << hmac->Encode(token.GetPointer(), prefixLength, PBase64::e_URL);
+
+  return token;
+}
+
+
+bool PJWT::Decode(const PString & str, const PString & secret, const PTime & verifyTime)
+{
+  PStringArray section = str.Tokenise(".");
+  if (section.size() != 3) {
+    PTRACE(2, "Invalid JWT header: \"" << str.Left(100) << '"');
+    return false;
+  }
+
+  // Header is only looked at here, so no need for the heap allocated PJSON tree
+  PJSONDocument hdr;
+  if (!hdr.Parse(PBase64::Decode(section[0]))) {
+    PTRACE(2, "Invalid JWT header JSON.");
+    return false;
+  }
+
+  const PJSONDocument::Value & hdrObj = hdr.GetRoot();
+  if (!hdrObj.IsType(e_Object)) {
+    PTRACE(2, "Invalid JWT header JSON type.");
+    return false;
+  }
+
+  if (hdrObj["typ"].GetString() != "JWT") {
     PTRACE(2, "Unsupported JWT type.");
     return false;
   }
 
-  PAutoPtr<PHMAC> hmac(CreateHMAC(AlgorithmFromString(hdrObj.GetString("alg"))));
+  PAutoPtr<PHMAC> hmac(CreateHMAC(AlgorithmFromString(hdrObj["alg"].GetString())));
   if (!hmac.get()) {
     PTRACE(2, "Unsupported JWT algorithm.");
     return false;
@@ -595,11 +595,27 @@ void PMonitoredSockets::ReadFromSocketList(PSocket::SelectList & readers,
   }
 
   socket = (PUDPSocket *)&readers.front();
+  ReadFromSocket(*socket, param);
+}
 
-  bool ok = socket->ReadFrom(param.m_buffer, param.m_length, param.m_addr, param.m_port);
-  param.m_lastCount = socket->GetLastReadCount();
-  param.m_errorCode = socket->GetErrorCode(PChannel::LastReadError);
-  param.m_errorNumber = socket->GetErrorNumber(PChannel::LastReadError);
+
+void PMonitoredSockets::ReadFromSocket(PUDPSocket & socket, BundleParams & param)
+{
+  bool ok;
+  if (param.m_datagrams == NULL)
+    ok = socket.ReadFrom(param.m_buffer, param.m_length, param.m_addr, param.m_port);
+  else {
+    PINDEX received = socket.ReadFromMulti(param.m_datagrams, param.m_datagramCount);
+    ok = received > 0;
+    if (ok) {
+      param.m_datagramCount = received;
+      param.m_addr = param.m_datagrams[0].m_ipAndPort.GetAddress();
+      param.m_port = param.m_datagrams[0].m_ipAndPort.GetPort();
+    }
+  }
+  param.m_lastCount = socket.GetLastReadCount();
+  param.m_errorCode = socket.GetErrorCode(PChannel::LastReadError);
+  param.m_errorNumber = socket.GetErrorNumber(PChannel::LastReadError);
 
   if (ok)
     return;
@@ -620,8 +636,8 @@ void PMonitoredSockets::ReadFromSocketList(PSocket::SelectList & readers,
 
     default :
       PTRACE(1, "Socket read UDP error ("
-             << socket->GetErrorNumber(PChannel::LastReadError) << "): "
-             << socket->GetErrorText(PChannel::LastReadError));
+             << socket.GetErrorNumber(PChannel::LastReadError) << "): "
+             << socket.GetErrorText(PChannel::LastReadError));
   }
 }
 
@@ -838,6 +854,8 @@ PMonitoredSocketBundle::PMonitoredSocketBundle(const PString & fixedInterface,
   , m_onInterfaceChange(PCREATE_InterfaceNotifier(OnInterfaceChange))
   , m_fixedInterface(fixedInterface)
   , m_ipVersion(ipVersion)
+  , m_eventLoop(NULL)
+  , m_eventLoopInUse(false)
 {
   PInterfaceMonitor::GetInstance().AddNotifier(m_onInterfaceChange);
 
@@ -873,6 +891,35 @@ PMonitoredSocketBundle::~PMonitoredSocketBundle()
   Close();
 
   PInterfaceMonitor::GetInstance().RemoveNotifier(m_onInterfaceChange);
+
+  delete m_eventLoop;
+}
+
+
+void PMonitoredSocketBundle::SetUseEventLoop(bool use)
+{
+  PSafeLockReadWrite guard(*this);
+
+  if (use == (m_eventLoop != NULL))
+    return;
+
+  if (m_eventLoopInUse) {
+    PTRACE(2, "Cannot change event loop mode while reading.");
+    return;
+  }
+
+  if (!use) {
+    delete m_eventLoop;
+    m_eventLoop = NULL;
+    m_readySockets.clear();
+    return;
+  }
+
+  m_eventLoop = new PSocketEventLoop;
+  for (SocketInfoMap_T::iterator iter = m_socketInfoMap.begin(); iter != m_socketInfoMap.end(); ++iter)
+    m_eventLoop->Register(*iter->second.m_socket, PSocketEventLoop::ReadEvent, PCREATE_SocketEventNotifier(OnSocketReady));
+
+  PTRACE(4, "Using event loop for socket bundle");
 }
 
 
@@ -920,6 +967,8 @@ PBoolean PMonitoredSocketBundle::Close()
   while (!m_socketInfoMap.empty())
     CloseSocket(m_socketInfoMap.begin());
   m_interfaceAddedSignal.Close(); // Fail safe break out of Select()
+  if (m_eventLoop != NULL)
+    m_eventLoop->Interrupt();
 
   UnlockReadWrite();
 
@@ -994,6 +1043,8 @@ void PMonitoredSocketBundle::OpenSocket(const PString & iface)
       m_localPort = addrAndPort.GetPort();
     }
     m_socketInfoMap[iface] = info;
+    if (m_eventLoop != NULL)
+      m_eventLoop->Register(*info.m_socket, PSocketEventLoop::ReadEvent, PCREATE_SocketEventNotifier(OnSocketReady));
   }
 }
 
@@ -1005,6 +1056,13 @@ void PMonitoredSocketBundle::CloseSocket(SocketInfoMap_T::iterator iterSocket)
   if (iterSocket == m_socketInfoMap.end())
     return;
 
+  if (m_eventLoop != NULL) {
+    PUDPSocket * socket = iterSocket->second.m_socket;
+    m_eventLoop->Unregister(*socket);
+    PWaitAndSignal lock(m_readySocketsMutex);
+    m_readySockets.remove(socket);
+  }
+
   DestroySocket(iterSocket->second);
   m_socketInfoMap.erase(iterSocket);
 }
@@ -1043,7 +1101,9 @@ void PMonitoredSocketBundle::ReadFromBundle(BundleParams & param)
     return;
   }
 
-  if (param.m_iface.IsEmpty()) {
+  if (param.m_iface.IsEmpty() && m_eventLoop != NULL)
+    ReadFromEventLoop(param);
+  else if (param.m_iface.IsEmpty()) {
     do {
       // If interface is empty, then grab the next datagram on any of the interfaces
       PSocket::SelectList readers;
@@ -1085,6 +1145,70 @@ void PMonitoredSocketBundle::ReadFromBundle(BundleParams & param)
 }
 
 
+void PMonitoredSocketBundle::ReadFromEventLoop(BundleParams & param)
+{
+  // Assume is already locked
+
+  if (m_eventLoopInUse) {
+    PTRACE(2, "Cannot read from multiple threads.");
+    param.m_errorCode = PChannel::DeviceInUse;
+    return;
+  }
+
+  m_eventLoopInUse = true;
+  param.m_lastCount = 0;
+
+  do {
+    PUDPSocket * socket = NULL;
+    m_readySocketsMutex.Wait();
+    if (!m_readySockets.empty()) {
+      socket = m_readySockets.front();
+      m_readySockets.pop_front();
+    }
+    m_readySocketsMutex.Signal();
+
+    if (socket != NULL) {
+      for (SocketInfoMap_T::iterator iter = m_socketInfoMap.begin(); iter != m_socketInfoMap.end(); ++iter) {
+        if (iter->second.m_socket == socket)
+          param.m_iface = iter->first;
+      }
+      ReadFromSocket(*socket, param);
+      continue;
+    }
+
+    UnlockReadWrite();
+
+    // OnSocketReady() adds to m_readySockets
+    param.m_errorCode = m_eventLoop->Wait(param.m_timeout);
+
+    if (!LockReadWrite())
+      return;
+
+    if (!m_opened) {
+      param.m_errorCode = PChannel::NotOpen;  // Closed, break out
+      break;
+    }
+
+    if (param.m_errorCode == PChannel::Interrupted) {
+      // Interface added or removed
+      if (!m_interfaceAddedSignal.IsOpen())
+        m_interfaceAddedSignal.Listen(); // Reset if this was used to break Select() block
+      PTRACE(4, "Interfaces changed");
+      break;
+    }
+  } while (param.m_errorCode == PChannel::NoError && param.m_lastCount == 0);
+
+  m_eventLoopInUse = false;
+}
+
+
+void PMonitoredSocketBundle::OnSocketReady(PSocket & socket, int)
+{
+  PWaitAndSignal lock(m_readySocketsMutex);
+  m_readySockets.push_back(dynamic_cast<PUDPSocket *>(&socket));
+}
+
+
 void PMonitoredSocketBundle::OnInterfaceChange(PInterfaceMonitor &, PInterfaceMonitor::InterfaceChange entry)
 {
   if (!m_opened || !LockReadWrite())
@@ -1094,6 +1218,8 @@ void PMonitoredSocketBundle::OnInterfaceChange(PInterfaceMonitor &, PInterfaceMo
     OpenSocket(MakeInterfaceDescription(entry));
     PTRACE(3, "UDP socket bundle has added interface " << entry);
     m_interfaceAddedSignal.Close();
+    if (m_eventLoop != NULL)
+      m_eventLoop->Interrupt();
   }
   else {
     CloseSocket(m_socketInfoMap.find(MakeInterfaceDescription(entry)));
@@ -1823,6 +1823,33 @@ bool PTURNUDPSocket::InternalReadFrom(Slice * slices, size_t sliceCount, PIPSock
   return status;
 }
 
+
+PINDEX PTURNUDPSocket::ReadFromMulti(Datagram * datagrams, PINDEX count)
+{
+  // Batched system calls would bypass the channel framing
+  if (!m_usingTURN)
+    return PSTUNUDPSocket::ReadFromMulti(datagrams, count);
+
+  SetLastReadCount(0);
+  if (count == 0 || CheckNotOpen())
+    return 0;
+
+  return InternalReadFromEach(datagrams, count);
+}
+
+
+PINDEX PTURNUDPSocket::WriteToMulti(Datagram * datagrams, PINDEX count)
+{
+  if (!m_usingTURN)
+    return PSTUNUDPSocket::WriteToMulti(datagrams, count);
+
+  SetLastWriteCount(0);
+  if (count == 0 || CheckNotOpen())
+    return 0;
+
+  return InternalWriteToEach(datagrams, count);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 PSTUNClient::RTPSupportTypes PTURNClient::GetRTPSupport(bool force)
@@ -47,9 +47,40 @@ ostream & operator<<(ostream & strm, const PSTUNServer::SocketInfo & info)
 
 PSTUNServer::PSTUNServer()
   : m_autoDelete(true)
+  , m_eventLoop(NULL)
 {
 }
 
+
+PSTUNServer::~PSTUNServer()
+{
+  delete m_eventLoop;
+}
+
+
+void PSTUNServer::SetUseEventLoop(bool use)
+{
+  if (use == (m_eventLoop != NULL))
+    return;
+
+  if (!use) {
+    delete m_eventLoop;
+    m_eventLoop = NULL;
+    m_selectList.SetSize(0);
+    return;
+  }
+
+  m_eventLoop = new PSocketEventLoop;
+  for (PINDEX i = 0; i < m_sockets.GetSize(); ++i)
+    m_eventLoop->Register(m_sockets[i], PSocketEventLoop::ReadEvent, PCREATE_SocketEventNotifier(OnSocketReady));
+}
+
+
+void PSTUNServer::OnSocketReady(PSocket & socket, int)
+{
+  m_selectList += socket;
+}
+
 bool PSTUNServer::Open(WORD port)
 {
   Close();
@@ -154,11 +185,11 @@ bool PSTUNServer::Open(WORD port)
 bool PSTUNServer::Open(PUDPSocket * socket1, PUDPSocket * socket2)
 {
   if (socket1 != NULL) {
-    m_sockets.Append(socket1);
+    AddSocket(socket1);
     PopulateInfo(socket1, PIPSocket::GetInvalidAddress(), 0, NULL, NULL, NULL);
   }
   if (socket2 != NULL) {
-    m_sockets.Append(socket1);
+    AddSocket(socket2);
     PopulateInfo(socket2, PIPSocket::GetInvalidAddress(), 0, NULL, NULL, NULL);
   }
 
@@ -193,10 +224,18 @@ PSTUNServer::SocketInfo * PSTUNServer::CreateAndAddSocket(const PIPSocket::Addre
     return NULL;
   }
 
-  m_sockets.Append(sock);
+  AddSocket(sock);
   return &m_socketToSocketInfoMap.insert(SocketToSocketInfoMap::value_type(sock, SocketInfo(sock))).first->second;
 }
 
+void PSTUNServer::AddSocket(PUDPSocket * socket)
+{
+  // Register what is in the list, so Close() unregisters exactly the same sockets
+  m_sockets.Append(socket);
+  if (m_eventLoop != NULL)
+    m_eventLoop->Register(m_sockets[m_sockets.GetSize()-1], PSocketEventLoop::ReadEvent, PCREATE_SocketEventNotifier(OnSocketReady));
+}
+
 bool PSTUNServer::IsOpen() const 
 { 
   return m_sockets.GetSize() > 0; 
@@ -204,6 +243,11 @@ bool PSTUNServer::IsOpen() const
 
 bool PSTUNServer::Close()
 {
+  if (m_eventLoop != NULL) {
+    for (PINDEX i = 0; i < m_sockets.GetSize(); ++i)
+      m_eventLoop->Unregister(m_sockets[i]);
+  }
+
   m_sockets.AllowDeleteObjects(m_autoDelete);
   m_sockets.SetSize(0);
   m_selectList.SetSize(0);
@@ -219,6 +263,20 @@ bool PSTUNServer::Read(PSTUNMessage & message, PSTUNServer::SocketInfo & socketI
   if (!IsOpen())
     return false;
 
+  if (m_selectList.GetSize() == 0 && m_eventLoop != NULL) {
+    // Notifier adds ready sockets to m_selectList
+    switch (m_eventLoop->Wait()) {
+      default:
+        return false;
+      case PChannel::Timeout:
+      case PChannel::Interrupted:
+        return true;
+      case PChannel::NoError:
+        if (m_selectList.GetSize() == 0)
+          return true;
+    }
+  }
+
   if (m_selectList.GetSize() == 0) {
     for (PINDEX i = 0; i < m_sockets.GetSize(); ++i)
       m_selectList += m_sockets[i];
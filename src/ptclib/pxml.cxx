@@ -297,6 +297,8 @@ void PXMLParser::StartElement(const char * name, const char **attrs)
     PAssert(m_document.m_rootElement == NULL, PLogicError);
     newElement = m_document.m_rootElement = m_document.CreateRootElement(name);
     PAssert(newElement != NULL, PLogicError);
+    if (m_options & IndexElements)
+      newElement->EnableIndex(false);
   }
   else {
     newElement = m_currentElement->CreateElement(name);
@@ -1249,6 +1251,8 @@ void PXMLData::InternalPrintTrace(ostream & strm) const
 
 PXMLElement::PXMLElement(const char * name, const char * data)
  : m_name(name)
+ , m_indexed(false)
+ , m_childIndex(NULL)
 {
   if (data != NULL)
     AddData(data);
@@ -1258,6 +1262,8 @@ PXMLElement::PXMLElement(const char * name, const char * data)
 PXMLElement::PXMLElement(const PXMLElement & copy)
   : m_name(copy.m_name)
   , m_attributes(copy.m_attributes)
+  , m_indexed(copy.m_indexed)
+  , m_childIndex(NULL)
 {
   m_attributes.MakeUnique();
   m_dirty = copy.m_dirty;
@@ -1267,6 +1273,123 @@ PXMLElement::PXMLElement(const PXMLElement & copy)
 }
 
 
+struct PXMLElement::ChildIndex
+{
+  void Add(PXMLElement * element)
+  {
+    m_elements.push_back(element);
+    m_byName[element->GetName()].push_back(element);
+  }
+
+  std::vector<PXMLElement *> m_elements;
+  typedef std::map<PCaselessString, std::vector<PXMLElement *> > ByName;
+  ByName m_byName;
+};
+
+
+PXMLElement::~PXMLElement()
+{
+  delete m_childIndex;
+}
+
+
+PXMLElement & PXMLElement::operator=(const PXMLElement & other)
+{
+  if (this == &other)
+    return *this;
+
+  PXMLObject::operator=(other);
+  m_name = other.m_name;
+  m_attributes = other.m_attributes;
+  m_nameSpaces = other.m_nameSpaces;
+  m_defaultNamespace = other.m_defaultNamespace;
+  m_subObjects = other.m_subObjects;
+  m_indexed = other.m_indexed;
+  InvalidateIndex();
+  return *this;
+}
+
+
+void PXMLElement::SetName(const PString & v)
+{
+  m_name = v;
+  if (m_parent != NULL)
+    m_parent->InvalidateIndex();
+}
+
+
+void PXMLElement::EnableIndex(bool recursive)
+{
+  m_indexed = true;
+
+  if (recursive) {
+    for (PINDEX i = 0; i < m_subObjects.GetSize(); i++) {
+      PXMLElement * element = dynamic_cast<PXMLElement *>(m_subObjects.GetAt(i));
+      if (element != NULL)
+        element->EnableIndex(true);
+    }
+  }
+}
+
+
+const PXMLElement::ChildIndex * PXMLElement::GetChildIndex() const
+{
+  if (!m_indexed)
+    return NULL;
+
+  ChildIndex * index = m_childIndex;
+  if (index != NULL)
+    return index;
+
+  /* Concurrent readers may both get here, the first to publish its index
+     wins, and the others discard theirs and use that. */
+  ChildIndex * newIndex = new ChildIndex;
+  for (PINDEX i = 0; i < m_subObjects.GetSize(); i++) {
+    PXMLElement * element = dynamic_cast<PXMLElement *>(m_subObjects.GetAt(i));
+    if (element != NULL)
+      newIndex->Add(element);
+  }
+
+  if (m_childIndex.compare_exchange_strong(index, newIndex))
+    return newIndex;
+
+  delete newIndex;
+  return index;
+}
+
+
+void PXMLElement::InvalidateIndex()
+{
+  // Rebuilt on next use
+  delete m_childIndex.exchange(NULL);
+}
+
+
+const std::vector<PXMLElement *> & PXMLElement::GetElementList(const PCaselessString & name,
+                                                               std::vector<PXMLElement *> & scratch) const
+{
+  const ChildIndex * index = GetChildIndex();
+  if (index != NULL) {
+    if (name.IsEmpty())
+      return index->m_elements;
+
+    ChildIndex::ByName::const_iterator it = index->m_byName.find(PrependNamespace(name));
+    return it != index->m_byName.end() ? it->second : scratch;
+  }
+
+  PCaselessString extendedName;
+  if (!name.IsEmpty())
+    extendedName = PrependNamespace(name);
+
+  for (PINDEX i = 0; i < m_subObjects.GetSize(); i++) {
+    PXMLElement * element = dynamic_cast<PXMLElement *>(m_subObjects.GetAt(i));
+    if (element != NULL && (extendedName.IsEmpty() || extendedName == element->GetName()))
+      scratch.push_back(element);
+  }
+  return scratch;
+}
+
+
 PINDEX PXMLElement::FindObject(const PXMLObject * ptr) const
 {
   return m_subObjects.GetObjectsIndex(ptr);
@@ -1354,6 +1477,10 @@ PXMLObject * PXMLElement::GetSubObject(PINDEX idx) const
 
 PXMLElement * PXMLElement::GetElement(PINDEX index) const
 {
+  const ChildIndex * childIndex = GetChildIndex();
+  if (childIndex != NULL)
+    return index < (PINDEX)childIndex->m_elements.size() ? childIndex->m_elements[index] : NULL;
+
   for (PINDEX i = 0; i < m_subObjects.GetSize(); i++) {
     PXMLElement * element = dynamic_cast<PXMLElement *>(m_subObjects.GetAt(i));
     if (element != NULL && index-- == 0)
@@ -1366,6 +1493,13 @@ PXMLElement * PXMLElement::GetElement(PINDEX index) const
 PXMLElement * PXMLElement::GetElement(const PCaselessString & name, PINDEX index) const
 {
   PCaselessString extendedName(PrependNamespace(name));
+
+  const ChildIndex * childIndex = GetChildIndex();
+  if (childIndex != NULL) {
+    ChildIndex::ByName::const_iterator it = childIndex->m_byName.find(extendedName);
+    return it != childIndex->m_byName.end() && index < (PINDEX)it->second.size() ? it->second[index] : NULL;
+  }
+
   for (PINDEX i = 0; i < m_subObjects.GetSize(); i++) {
     PXMLElement * element = dynamic_cast<PXMLElement *>(m_subObjects.GetAt(i));
     if (element != NULL && extendedName == element->GetName() && index-- == 0)
@@ -1378,6 +1512,19 @@ PXMLElement * PXMLElement::GetElement(const PCaselessString & name, PINDEX index
 PXMLElement * PXMLElement::GetElement(const PCaselessString & name, const PCaselessString & attr, const PString & attrval) const
 {
   PCaselessString extendedName(PrependNamespace(name));
+
+  const ChildIndex * childIndex = GetChildIndex();
+  if (childIndex != NULL) {
+    ChildIndex::ByName::const_iterator it = childIndex->m_byName.find(extendedName);
+    if (it != childIndex->m_byName.end()) {
+      for (size_t i = 0; i < it->second.size(); ++i) {
+        if (attrval == it->second[i]->GetAttribute(attr))
+          return it->second[i];
+      }
+    }
+    return NULL;
+  }
+
   for (PINDEX i = 0; i < m_subObjects.GetSize(); i++) {
     PXMLElement * element = dynamic_cast<PXMLElement *>(m_subObjects.GetAt(i));
     if (element != NULL && extendedName == element->GetName() && attrval == element->GetAttribute(attr))
@@ -1392,6 +1539,9 @@ bool PXMLElement::RemoveSubObject(PINDEX idx, bool dispose)
   if (idx >= m_subObjects.GetSize())
     return false;
 
+  if (m_subObjects[idx].IsElement())
+    InvalidateIndex();
+
   if (dispose)
     m_subObjects.RemoveAt(idx);
   else {
@@ -1498,9 +1648,20 @@ PXMLObject * PXMLElement::AddSubObject(PXMLObject * obj, bool setDirty)
   if (PAssertNULL(obj) == NULL)
     return NULL;
 
-  if (obj->SetParent(this))
+  if (obj->SetParent(this)) {
     m_subObjects.SetAt(m_subObjects.GetSize(), obj);
 
+    if (m_indexed) {
+      PXMLElement * element = dynamic_cast<PXMLElement *>(obj);
+      if (element != NULL) {
+        element->EnableIndex();
+        ChildIndex * index = m_childIndex;
+        if (index != NULL)
+          index->Add(element);
+      }
+    }
+  }
+
   if (setDirty)
     SetDirty();
 
@@ -1620,6 +1781,283 @@ PXMLElement * PXMLRootElement::CreateElement(const PCaselessString & name, const
 }
 
 
+///////////////////////////////////////////////////////
+
+PXMLPath::PXMLPath(const PString & path)
+  : m_absolute(false)
+{
+  if (!path.IsEmpty())
+    Compile(path);
+}
+
+
+bool PXMLPath::Compile(const PString & path)
+{
+  m_path = path;
+  m_absolute = false;
+  m_steps.clear();
+  m_selectAttribute.MakeEmpty();
+
+  const char * ptr = path;
+  if (*ptr == '/') {
+    m_absolute = true;
+    ++ptr;
+  }
+
+  for (;;) {
+    if (*ptr == '@') {
+      // Attribute selection, must be last
+      m_selectAttribute = ptr+1;
+      if (m_selectAttribute.IsEmpty() || m_selectAttribute.FindOneOf("/[]@") != P_MAX_INDEX || m_steps.empty())
+        break;
+      return true;
+    }
+
+    Step step;
+
+    const char * name = ptr;
+    while (*ptr != '\0' && *ptr != '/' && *ptr != '[')
+      ++ptr;
+    if (ptr == name)
+      break;
+    if (ptr - name != 1 || *name != '*')
+      step.m_name = PString(name, ptr - name);
+
+    bool good = true;
+    while (good && *ptr == '[') {
+      good = false;
+      if (*++ptr == '@') {
+        const char * attr = ++ptr;
+        while (*ptr != '\0' && *ptr != '=' && *ptr != ']')
+          ++ptr;
+        if (ptr == attr)
+          break;
+        step.m_attribute = PString(attr, ptr - attr);
+
+        if (*ptr == '=') {
+          char quote = *++ptr;
+          if (quote != '\'' && quote != '"')
+            break;
+          const char * value = ++ptr;
+          while (*ptr != '\0' && *ptr != quote)
+            ++ptr;
+          if (*ptr == '\0')
+            break;
+          step.m_value = PString(value, ptr - value);
+          step.m_hasValue = true;
+          ++ptr;
+        }
+      }
+      else {
+        char * end;
+        step.m_position = strtoul(ptr, &end, 10);
+        if (end == ptr || step.m_position == 0)
+          break;
+        ptr = end;
+      }
+
+      if (*ptr == ']') {
+        ++ptr;
+        good = true;
+      }
+    }
+
+    if (!good)
+      break;
+
+    m_steps.push_back(step);
+
+    if (*ptr == '\0')
+      return true;
+
+    if (*ptr != '/')
+      break;
+    ++ptr;
+  }
+
+  PTRACE(2, "PXML\tInvalid path \"" << path << "\" at position " << (ptr - (const char *)path));
+  m_steps.clear();
+  return false;
+}
+
+
+void PXMLPath::PrintOn(ostream & strm) const
+{
+  strm << m_path;
+}
+
+
+bool PXMLPath::Matches(const PXMLElement & element, const Step & step) const
+{
+  if (step.m_attribute.IsEmpty())
+    return true;
+
+  if (step.m_hasValue)
+    return element.GetAttribute(step.m_attribute) == step.m_value;
+
+  return element.HasAttribute(step.m_attribute);
+}
+
+
+const PXMLElement * PXMLPath::GetStart(const PXMLElement & context, size_t & stepIndex) const
+{
+  stepIndex = 0;
+  if (!m_absolute)
+    return &context;
+
+  const PXMLElement * root = &context;
+  while (root->GetParent() != NULL)
+    root = root->GetParent();
+
+  // The first step selects the root element itself
+  const Step & step = m_steps[0];
+  if ((!step.m_name.IsEmpty() && root->PrependNamespace(step.m_name) != root->GetName()) ||
+       step.m_position > 1 || !Matches(*root, step))
+    return NULL;
+
+  stepIndex = 1;
+  return root;
+}
+
+
+PXMLElement * PXMLPath::FindFirst(const PXMLElement & parent, size_t stepIndex) const
+{
+  const Step & step = m_steps[stepIndex];
+  bool last = stepIndex+1 >= m_steps.size();
+
+  std::vector<PXMLElement *> scratch;
+  const std::vector<PXMLElement *> & children = parent.GetElementList(step.m_name, scratch);
+
+  if (step.m_position != 0 && step.m_attribute.IsEmpty()) {
+    // Simple position, so can go straight to it
+    if (step.m_position > (PINDEX)children.size())
+      return NULL;
+    PXMLElement * child = children[step.m_position-1];
+    return last ? child : FindFirst(*child, stepIndex+1);
+  }
+
+  PINDEX position = 0;
+  for (size_t i = 0; i < children.size(); ++i) {
+    PXMLElement * child = children[i];
+    if (!Matches(*child, step))
+      continue;
+
+    if (step.m_position != 0 && ++position != step.m_position)
+      continue;
+
+    PXMLElement * found = last ? child : FindFirst(*child, stepIndex+1);
+    if (found != NULL || step.m_position != 0)
+      return found;
+  }
+
+  return NULL;
+}
+
+
+void PXMLPath::FindAll(const PXMLElement & parent, size_t stepIndex, std::vector<PXMLElement *> & elements) const
+{
+  const Step & step = m_steps[stepIndex];
+  bool last = stepIndex+1 >= m_steps.size();
+
+  std::vector<PXMLElement *> scratch;
+  const std::vector<PXMLElement *> & children = parent.GetElementList(step.m_name, scratch);
+
+  PINDEX position = 0;
+  for (size_t i = 0; i < children.size(); ++i) {
+    PXMLElement * child = children[i];
+    if (!Matches(*child, step))
+      continue;
+
+    if (step.m_position != 0 && ++position != step.m_position)
+      continue;
+
+    if (last)
+      elements.push_back(child);
+    else
+      FindAll(*child, stepIndex+1, elements);
+
+    if (step.m_position != 0)
+      break;
+  }
+}
+
+
+PXMLElement * PXMLPath::Find(const PXMLElement & context) const
+{
+  if (!IsValid())
+    return NULL;
+
+  size_t stepIndex;
+  const PXMLElement * start = GetStart(context, stepIndex);
+  if (start == NULL)
+    return NULL;
+
+  if (stepIndex >= m_steps.size())
+    return const_cast<PXMLElement *>(start);
+
+  return FindFirst(*start, stepIndex);
+}
+
+
+PXMLElement * PXMLPath::Find(const PXML & xml) const
+{
+  PXMLElement * root = xml.GetRootElement();
+  return root != NULL ? Find(*root) : NULL;
+}
+
+
+bool PXMLPath::FindAll(const PXMLElement & context, std::vector<PXMLElement *> & elements) const
+{
+  elements.clear();
+
+  if (!IsValid())
+    return false;
+
+  size_t stepIndex;
+  const PXMLElement * start = GetStart(context, stepIndex);
+  if (start == NULL)
+    return false;
+
+  if (stepIndex >= m_steps.size())
+    elements.push_back(const_cast<PXMLElement *>(start));
+  else
+    FindAll(*start, stepIndex, elements);
+
+  return !elements.empty();
+}
+
+
+bool PXMLPath::FindAll(const PXML & xml, std::vector<PXMLElement *> & elements) const
+{
+  PXMLElement * root = xml.GetRootElement();
+  if (root != NULL)
+    return FindAll(*root, elements);
+
+  elements.clear();
+  return false;
+}
+
+
+PString PXMLPath::GetString(const PXMLElement & context, const PString & dflt) const
+{
+  PXMLElement * element = Find(context);
+  if (element == NULL)
+    return dflt;
+
+  if (m_selectAttribute.IsEmpty())
+    return element->GetData();
+
+  return element->HasAttribute(m_selectAttribute) ? element->GetAttribute(m_selectAttribute) : dflt;
+}
+
+
+PString PXMLPath::GetString(const PXML & xml, const PString & dflt) const
+{
+  PXMLElement * root = xml.GetRootElement();
+  return root != NULL ? GetString(*root, dflt) : dflt;
+}
+
+
 ///////////////////////////////////////////////////////
 
 PXMLSettings::PXMLSettings(PXML::Options options)
@@ -1734,6 +2172,317 @@ PXMLElement * PXMLStreamParser::Read(PChannel * channel)
   return 0;
 }
 
+///////////////////////////////////////////////////////
+
+PXMLReader::PXMLReader(const PString & data, Options options, const char * encoding)
+  : PXMLBase(options)
+  , PXMLParserBase(options, encoding != NULL && *encoding != '\0' ? encoding : NULL)
+  , m_string(data)
+  , m_stream(NULL)
+  , m_channel(NULL)
+{
+  Construct();
+}
+
+
+PXMLReader::PXMLReader(istream & strm, Options options, const char * encoding)
+  : PXMLBase(options)
+  , PXMLParserBase(options, encoding != NULL && *encoding != '\0' ? encoding : NULL)
+  , m_stream(&strm)
+  , m_channel(NULL)
+{
+  Construct();
+}
+
+
+PXMLReader::PXMLReader(PStringStream & strm, Options options, const char * encoding)
+  : PXMLBase(options)
+  , PXMLParserBase(options, encoding != NULL && *encoding != '\0' ? encoding : NULL)
+  , m_string(strm)
+  , m_stream(NULL)
+  , m_channel(NULL)
+{
+  Construct();
+}
+
+
+PXMLReader::PXMLReader(PChannel & channel, Options options, const char * encoding)
+  : PXMLBase(options)
+  , PXMLParserBase(options, encoding != NULL && *encoding != '\0' ? encoding : NULL)
+  , m_stream(NULL)
+  , m_channel(&channel)
+{
+  Construct();
+}
+
+
+void PXMLReader::Construct()
+{
+  m_finalChunk = false;
+  m_depth = 0;
+  m_parseDepth = 0;
+  m_failed = false;
+  m_pendingIndex = 0;
+  m_pendingCount = 0;
+  m_attributesValid = false;
+}
+
+
+bool PXMLReader::ParseMore()
+{
+  XML_ParsingStatus status;
+  XML_GetParsingStatus(MY_CONTEXT, &status);
+  switch (status.parsing) {
+    case XML_SUSPENDED :
+      return XML_ResumeParser(MY_CONTEXT) != XML_STATUS_ERROR;
+
+    case XML_FINISHED :
+      return false;
+
+    default :
+      break;
+  }
+
+  if (m_finalChunk)
+    return false;
+
+  if (m_stream != NULL) {
+    m_stream->read(m_buffer, sizeof(m_buffer));
+    m_finalChunk = !m_stream->good();
+    return Parse(m_buffer, (size_t)m_stream->gcount(), m_finalChunk);
+  }
+
+  if (m_channel != NULL) {
+    PINDEX count = 0;
+    if (m_channel->Read(m_buffer, sizeof(m_buffer)))
+      count = m_channel->GetLastReadCount();
+    else
+      m_finalChunk = true;
+    return Parse(m_buffer, count, m_finalChunk);
+  }
+
+  m_finalChunk = true;
+  return Parse(m_string, m_string.GetLength(), true);
+}
+
+
+PXMLReader::Event PXMLReader::Next()
+{
+  if (m_event.m_type == e_EndElement)
+    --m_depth;
+
+  while (m_pendingIndex >= m_pendingCount) {
+    m_pendingIndex = m_pendingCount = 0;
+
+    if (m_failed || !m_parsing) {
+      m_event.m_type = m_failed ? e_Error : e_EndOfData;
+      m_event.m_attributes.clear();
+      m_attributesValid = false;
+      return m_event.m_type;
+    }
+
+    if (!ParseMore()) {
+      PTRACE(3, "PXML\tReader error: " << XML_ErrorString(XML_GetErrorCode(MY_CONTEXT)));
+      m_failed = true;
+    }
+  }
+
+  EventInfo & next = m_pending[m_pendingIndex++];
+  m_event.m_type = next.m_type;
+  m_event.m_name = next.m_name;
+  m_event.m_attributes.swap(next.m_attributes);
+  m_event.m_data = next.m_data;
+  m_attributesValid = false;
+
+  if (m_event.m_type == e_StartElement)
+    ++m_depth;
+
+  return m_event.m_type;
+}
+
+
+bool PXMLReader::Skip()
+{
+  if (m_event.m_type != e_StartElement)
+    return false;
+
+  unsigned depth = m_depth;
+  for (;;) {
+    switch (Next()) {
+      case e_EndElement :
+        if (m_depth == depth)
+          return true;
+        break;
+
+      case e_StartElement :
+      case e_Data :
+        break;
+
+      default :
+        return false;
+    }
+  }
+}
+
+
+const PStringToString & PXMLReader::GetAttributes() const
+{
+  // Only create the dictionary if needed
+  if (!m_attributesValid) {
+    m_attributes.RemoveAll();
+    for (size_t i = 0; i+1 < m_event.m_attributes.size(); i += 2)
+      m_attributes.SetAt(m_event.m_attributes[i], m_event.m_attributes[i+1]);
+    m_attributesValid = true;
+  }
+  return m_attributes;
+}
+
+
+PString PXMLReader::GetAttribute(const PCaselessString & key) const
+{
+  for (size_t i = 0; i+1 < m_event.m_attributes.size(); i += 2) {
+    if (key == m_event.m_attributes[i])
+      return m_event.m_attributes[i+1];
+  }
+  return PString::Empty();
+}
+
+
+bool PXMLReader::HasAttribute(const PCaselessString & key) const
+{
+  for (size_t i = 0; i+1 < m_event.m_attributes.size(); i += 2) {
+    if (key == m_event.m_attributes[i])
+      return true;
+  }
+  return false;
+}
+
+
+static void SetAttributes(PXMLElement * element, const std::vector<PString> & attributes)
+{
+  for (size_t i = 0; i+1 < attributes.size(); i += 2)
+    element->SetAttribute(attributes[i], attributes[i+1], false);
+}
+
+
+PXMLElement * PXMLReader::ReadElement()
+{
+  if (m_event.m_type != e_StartElement)
+    return NULL;
+
+  PXMLElement * element = new PXMLElement(m_event.m_name);
+  SetAttributes(element, m_event.m_attributes);
+
+  unsigned depth = m_depth;
+  PXMLElement * current = element;
+  for (;;) {
+    switch (Next()) {
+      case e_StartElement :
+      {
+        PXMLElement * child = current->CreateElement(m_event.m_name);
+        current->AddSubObject(child, false);
+        SetAttributes(child, m_event.m_attributes);
+        current = child;
+        break;
+      }
+
+      case e_Data :
+        current->AddData(m_event.m_data);
+        break;
+
+      case e_EndElement :
+        current->EndData();
+        if (m_depth == depth)
+          return element;
+        current = current->GetParent();
+        break;
+
+      default :
+        delete element;
+        return NULL;
+    }
+  }
+}
+
+
+void PXMLReader::Suspend()
+{
+  /* Return from XML_Parse() after this callback. This can fail if already
+     suspended, e.g. end of an empty element, which is fine as it is queued. */
+  XML_StopParser(MY_CONTEXT, XML_TRUE);
+}
+
+
+PXMLReader::EventInfo & PXMLReader::NewEvent(Event type)
+{
+  if (m_pendingCount >= m_pending.size())
+    m_pending.resize(m_pendingCount+1);
+
+  EventInfo & info = m_pending[m_pendingCount++];
+  info.m_type = type;
+  info.m_attributes.clear();
+  return info;
+}
+
+
+void PXMLReader::FlushData()
+{
+  size_t start = 0;
+  if (!(m_options & NoIgnoreWhiteSpace)) {
+    while (start < m_pendingData.size() && m_pendingData[start] > 0 && isspace(m_pendingData[start]))
+      ++start;
+  }
+
+  if (start < m_pendingData.size()) {
+    EventInfo & info = NewEvent(e_Data);
+    info.m_name.MakeEmpty(); // Entries are reused, so don't leave an old element name
+    info.m_data = PString(m_pendingData.data() + start, m_pendingData.size() - start);
+  }
+
+  m_pendingData.clear();
+}
+
+
+void PXMLReader::StartElement(const char * name, const char ** attrs)
+{
+  FlushData();
+
+  EventInfo & info = NewEvent(e_StartElement);
+  info.m_name = name;
+
+  while (attrs[0] != NULL)
+    info.m_attributes.push_back(*attrs++);
+
+  ++m_parseDepth;
+  Suspend();
+}
+
+
+void PXMLReader::EndElement(const char * name)
+{
+  FlushData();
+
+  NewEvent(e_EndElement).m_name = name;
+
+  if (--m_parseDepth == 0)
+    m_parsing = false;
+
+  Suspend();
+}
+
+
+void PXMLReader::AddCharacterData(const char * data, int len)
+{
+  if (m_pendingData.size() + len >= m_maxEntityLength) {
+    PTRACE(2, "PXML\tAborting XML parse at size " << m_maxEntityLength << " - possible 'billion laugh' attack");
+    XML_StopParser(MY_CONTEXT, XML_FALSE);
+    return;
+  }
+
+  m_pendingData.append(data, len);
+}
+
+
 ///////////////////////////////////////////////////////
 #endif
 
@@ -0,0 +1,205 @@
+/*
+ * pzlib.cxx
+ *
+ * zlib compression wrapper
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifdef __GNUC__
+#pragma implementation "pzlib.h"
+#endif
+
+#include <ptlib.h>
+
+#if P_ZLIB
+
+#include <ptclib/pzlib.h>
+
+#include <zlib.h>
+
+#ifdef _MSC_VER
+  #pragma comment(lib, "zlib.lib")
+#endif
+
+#define new PNEW
+#define PTraceModule() "ZLib"
+
+
+struct PZLib::Stream : z_stream
+{
+};
+
+
+static const PINDEX OutputBlockSize = 16384;
+
+
+PZLib::PZLib(Direction direction, Format format, int level)
+  : m_stream(new Stream)
+  , m_direction(direction)
+  , m_format(format)
+  , m_level(level)
+  , m_initialised(false)
+  , m_started(false)
+  , m_finished(false)
+{
+  Initialise(false);
+}
+
+
+PZLib::~PZLib()
+{
+  if (m_initialised) {
+    if (m_direction == e_Compress)
+      deflateEnd(m_stream);
+    else
+      inflateEnd(m_stream);
+  }
+  delete m_stream;
+}
+
+
+bool PZLib::Initialise(bool raw)
+{
+  if (m_initialised) {
+    if (m_direction == e_Compress)
+      deflateEnd(m_stream);
+    else
+      inflateEnd(m_stream);
+  }
+
+  memset(m_stream, 0, sizeof(z_stream));
+
+  int windowBits = MAX_WBITS;
+  if (raw)
+    windowBits = -MAX_WBITS;
+  else if (m_format == e_GZip)
+    windowBits += 16;
+  else if (m_format == e_AutoDetect)
+    windowBits += 32;
+
+  int result;
+  if (m_direction == e_Compress) {
+    if (m_format == e_AutoDetect)
+      m_format = e_GZip;
+    result = deflateInit2(m_stream, m_level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+  }
+  else
+    result = inflateInit2(m_stream, windowBits);
+
+  m_initialised = result == Z_OK;
+  PTRACE_IF(2, !m_initialised, "Could not initialise zlib: " << (m_stream->msg != NULL ? m_stream->msg : zError(result)));
+  return m_initialised;
+}
+
+
+bool PZLib::Process(const void * data, PINDEX length, PBYTEArray & output, Flush flush)
+{
+  output.SetSize(0);
+
+  if (!m_initialised)
+    return false;
+
+  if (m_finished)
+    return length == 0;
+
+  static const int FlushModes[] = { Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FINISH };
+
+  m_stream->next_in = (Bytef *)data;
+  m_stream->avail_in = length;
+
+  PINDEX produced = 0;
+  for (;;) {
+    m_stream->next_out = output.GetPointer(produced + OutputBlockSize) + produced;
+    m_stream->avail_out = OutputBlockSize;
+
+    int result = m_direction == e_Compress ? deflate(m_stream, FlushModes[flush]) : inflate(m_stream, Z_NO_FLUSH);
+    produced += OutputBlockSize - m_stream->avail_out;
+
+    if (result == Z_STREAM_END) {
+      m_finished = true;
+      break;
+    }
+
+    if (result == Z_DATA_ERROR && m_direction == e_Decompress && m_format == e_AutoDetect && !m_started) {
+      // Some servers send "deflate" encoding without the zlib wrapper
+      PTRACE(4, "Retrying as raw deflate stream");
+      if (!Initialise(true))
+        return false;
+      m_stream->next_in = (Bytef *)data;
+      m_stream->avail_in = length;
+      m_started = true;
+      produced = 0;
+      continue;
+    }
+
+    if (result != Z_OK && result != Z_BUF_ERROR) {
+      PTRACE(2, "zlib " << (m_direction == e_Compress ? "compression" : "decompression")
+             << " error: " << (m_stream->msg != NULL ? m_stream->msg : zError(result)));
+      output.SetSize(0);
+      return false;
+    }
+
+    // Output buffer not filled, so all available input consumed and flushed
+    if (m_stream->avail_out != 0 && (m_direction == e_Decompress || flush != e_Finish))
+      break;
+  }
+
+  if (produced > 0)
+    m_started = true;
+
+  output.SetSize(produced);
+  return true;
+}
+
+
+bool PZLib::Compress(const void * data, PINDEX length, PBYTEArray & output, Format format, int level)
+{
+  PZLib zlib(e_Compress, format, level);
+  return zlib.Process(data, length, output, e_Finish);
+}
+
+
+bool PZLib::Decompress(const void * data, PINDEX length, PBYTEArray & output, Format format)
+{
+  PZLib zlib(e_Decompress, format);
+  return zlib.Process(data, length, output) && zlib.IsFinished();
+}
+
+
+bool PZLib::GetFormat(const PCaselessString & encoding, Format & format)
+{
+  if (encoding == "gzip" || encoding == "x-gzip")
+    format = e_GZip;
+  else if (encoding == "deflate")
+    format = e_Deflate;
+  else
+    return false;
+  return true;
+}
+
+
+const char * PZLib::GetEncoding(Format format)
+{
+  return format == e_Deflate ? "deflate" : "gzip";
+}
+
+
+#endif // P_ZLIB
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -68,6 +68,17 @@ void PThreadPoolBase::Shutdown()
 }
 
 
+unsigned PThreadPoolBase::GetWorkSize() const
+{
+  PWaitAndSignal mutex(m_mutex);
+
+  unsigned total = 0;
+  for (WorkerList_t::const_iterator iter = m_workers.begin(); iter != m_workers.end(); ++iter)
+    total += (*iter)->GetWorkSize();
+  return total;
+}
+
+
 void PThreadPoolBase::SetMaxWorkers(unsigned count)
 {
   m_mutex.Wait();
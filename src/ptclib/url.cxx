@@ -266,34 +266,49 @@ PString PURL::TranslateString(const PString & str, TranslationType type)
 
 PString PURL::UntranslateString(const PString & str, TranslationType type)
 {
-  PString xlat = str;
-  xlat.MakeUnique();
+  return UntranslateString(PStringView(str), type);
+}
 
-  PINDEX pos;
-  if (type == PURL::QueryTranslation) {
-    /* Even though RFC2396 never mentions this, RFC1630 does. */
-    for (pos = 0; (pos = xlat.Find('+', pos)) != P_MAX_INDEX; ++pos)
-      xlat[pos] = ' ';
-  }
 
-  for (pos = 0; (pos = xlat.Find('%', pos)) != P_MAX_INDEX; ++pos) {
-    int digit1 = xlat[pos+1];
-    int digit2 = xlat[pos+2];
-    if (isxdigit(digit1) && isxdigit(digit2)) {
-      char buf[2];
-      buf[0] = (char)(
-            (isdigit(digit2) ? (digit2-'0') : (toupper(digit2)-'A'+10)) +
-           ((isdigit(digit1) ? (digit1-'0') : (toupper(digit1)-'A'+10)) << 4));
-      buf[1] = '\0';
-      xlat.Splice(buf, pos, 3);
+PString PURL::UntranslateString(const PStringView & str, TranslationType type)
+{
+  // Result can only ever be shorter, so do it in one pass into the final buffer
+  PINDEX len = str.GetLength();
+  PString xlat;
+  char * out = xlat.GetPointerAndSetLength(len);
+
+  PINDEX outLen = 0;
+  for (PINDEX pos = 0; pos < len; ++pos) {
+    char c = str[pos];
+    if (c == '+' && type == PURL::QueryTranslation)
+      c = ' '; // Even though RFC2396 never mentions this, RFC1630 does.
+    else if (c == '%') {
+      int digit1 = str[pos+1] & 0xff;
+      int digit2 = str[pos+2] & 0xff;
+      if (isxdigit(digit1) && isxdigit(digit2)) {
+        c = (char)(
+              (isdigit(digit2) ? (digit2-'0') : (toupper(digit2)-'A'+10)) +
+             ((isdigit(digit1) ? (digit1-'0') : (toupper(digit1)-'A'+10)) << 4));
+        pos += 2;
+        if (c == '\0')
+          continue;
+      }
     }
+    out[outLen++] = c;
   }
 
+  xlat.GetPointerAndSetLength(outLen);
   return xlat;
 }
 
 
 void PURL::SplitVars(const PString & str, PStringToString & vars, char sep1, char sep2, TranslationType type)
+{
+  SplitVars(PStringView(str), vars, sep1, sep2, type);
+}
+
+
+void PURL::SplitVars(const PStringView & str, PStringToString & vars, char sep1, char sep2, TranslationType type)
 {
   vars.RemoveAll();
 
@@ -303,7 +318,8 @@ void PURL::SplitVars(const PString & str, PStringToString & vars, char sep1, cha
     if (sep1next == P_MAX_INDEX)
       sep1next--; // Implicit assumption string is not a couple of gigabytes long ...
 
-    PCaselessString key, data;
+    PStringView key, data;
+    PString quoted;
 
     PINDEX sep2pos = str.Find(sep2, sep1prev);
     if (sep2pos > sep1next) {
@@ -316,7 +332,7 @@ void PURL::SplitVars(const PString & str, PStringToString & vars, char sep1, cha
       if (type != QuotedParameterTranslation)
         data = str(sep2pos+1, sep1next-1);
       else {
-        while (isspace(str[++sep2pos]))
+        while (isspace(str[++sep2pos] & 0xff))
           ;
         if (str[sep2pos] != '"')
           data = str(sep2pos, sep1next-1);
@@ -332,7 +348,8 @@ void PURL::SplitVars(const PString & str, PStringToString & vars, char sep1, cha
             }
           } while (str[endQuote-1] == '\\');
 
-          data = PString(PString::Literal, str(sep2pos, endQuote));
+          quoted = PString(PString::Literal, PString(str(sep2pos, endQuote)));
+          data = quoted;
 
           if (sep1next < endQuote) {
             sep1next = str.Find(sep1, endQuote);
@@ -343,13 +360,13 @@ void PURL::SplitVars(const PString & str, PStringToString & vars, char sep1, cha
       }
     }
 
-    key = PURL::UntranslateString(key.Trim(), type);
-    if (!key.IsEmpty()) {
-      data = PURL::UntranslateString(data, type);
-      if (vars.Contains(key))
-        vars.SetAt(key, vars[key] + '\n' + data);
+    PCaselessString keyStr = PURL::UntranslateString(key.Trim(), type);
+    if (!keyStr.IsEmpty()) {
+      PCaselessString dataStr = PURL::UntranslateString(data, type);
+      if (vars.Contains(keyStr))
+        vars.SetAt(keyStr, vars[keyStr] + '\n' + dataStr);
       else
-        vars.SetAt(key, data);
+        vars.SetAt(keyStr, dataStr);
     }
 
     sep1prev = sep1next+1;
@@ -484,7 +501,8 @@ PBoolean PURL::InternalParse(const char * cstr, const char * defaultScheme)
 
 bool PURL::LegacyParse(const char * cstr, const PURLLegacyScheme * schemeInfo)
 {
-  const PConstCaselessString str(cstr);
+  // Only non-alphabetic characters are searched for, so a plain view suffices
+  const PStringView str(cstr);
   PINDEX start = 0;
   PINDEX end = P_MAX_INDEX;
   PINDEX pos;
@@ -523,7 +541,7 @@ bool PURL::LegacyParse(const char * cstr, const PURLLegacyScheme * schemeInfo)
     else
       pos = str.FindOneOf(endHostChars, start);
 
-    PString uphp;
+    PStringView uphp;
     if (pos > start) {
       uphp = str(start, pos - 1);
       start = pos;
@@ -537,7 +555,7 @@ bool PURL::LegacyParse(const char * cstr, const PURLLegacyScheme * schemeInfo)
       if (schemeInfo->hasPassword)
         pos3 = uphp.Find(':');
       if (pos2 == 0)
-        uphp.Delete(0, 1);
+        uphp = uphp.Mid(1);
       else if (pos2 == P_MAX_INDEX) {
         if (schemeInfo->defaultToUserIfNoAt) {
           if (pos3 == P_MAX_INDEX)
@@ -546,7 +564,7 @@ bool PURL::LegacyParse(const char * cstr, const PURLLegacyScheme * schemeInfo)
             m_username = UntranslateString(uphp.Left(pos3), LoginTranslation);
             m_password = UntranslateString(uphp.Mid(pos3+1), LoginTranslation);
           }
-          uphp.MakeEmpty();
+          uphp = PStringView();
         }
       }
       else {
@@ -556,7 +574,7 @@ bool PURL::LegacyParse(const char * cstr, const PURLLegacyScheme * schemeInfo)
           m_username = UntranslateString(uphp.Left(pos3), LoginTranslation);
           m_password = UntranslateString(uphp(pos3+1, pos2-1), LoginTranslation);
         }
-        uphp.Delete(0, pos2+1);
+        uphp = uphp.Mid(pos2+1);
       }
     }
 
@@ -567,7 +585,7 @@ bool PURL::LegacyParse(const char * cstr, const PURLLegacyScheme * schemeInfo)
       // determine if the URL has a port number
       // Allow for [ipv6] form
       if (uphp[0] == '[' && (pos = uphp.Find(']')) != P_MAX_INDEX) {
-        m_hostname = uphp.Left(pos+1); // No translation if inside []
+        m_hostname = PString(uphp.Left(pos+1)); // No translation if inside []
         pos = uphp.Find(':', pos);
       }
       else {
@@ -614,7 +632,7 @@ bool PURL::LegacyParse(const char * cstr, const PURLLegacyScheme * schemeInfo)
   if (schemeInfo->hasPath) {
     if (str[start] == '/')
       ++start;
-    SetPathStr(str(start, end));   // the hierarchy is what is left
+    SetPathStr(PString(str(start, end)));   // the hierarchy is what is left
   }
   else {
     // if the rest of the URL isn't a path, then we are finished!
@@ -34,7 +34,6 @@ PDEFINE_POOL_ALLOCATOR(PListElement)
 PDEFINE_POOL_ALLOCATOR(PListInfo)
 PDEFINE_POOL_ALLOCATOR(PSortedListElement)
 PDEFINE_POOL_ALLOCATOR(PSortedListInfo)
-PDEFINE_POOL_ALLOCATOR(PHashTableElement)
 
 
 #define new PNEW
@@ -1115,183 +1114,227 @@ void PAbstractSortedList::DeleteSubTrees(PSortedListElement * node, PBoolean del
 
 ///////////////////////////////////////////////////////////////////////////////
 
+PHashTableInfo::PHashTableInfo()
+  : deleteKeys(true)
+  , deleteObjects(true)
+  , m_mask(0)
+  , m_count(0)
+{
+}
+
+
 void PHashTableInfo::DestroyContents()
 {
-  for (PINDEX i = 0; i < GetSize(); i++) {
-    PHashTableElement * elmt = GetAt(i).m_head;
-    while (elmt != NULL) {
-      PHashTableElement * nextElmt = elmt->m_next;
-      if (elmt->m_data != NULL && reference->deleteObjects)
-        delete elmt->m_data;
-      if (deleteKeys)
-        delete elmt->m_key;
-      delete elmt;
-      elmt = nextElmt;
-    }
+  for (std::vector<PHashTableElement>::iterator it = m_elements.begin(); it != m_elements.end(); ++it) {
+    if (it->m_key == NULL)
+      continue;
+    if (it->m_data != NULL && deleteObjects)
+      delete it->m_data;
+    if (deleteKeys)
+      delete it->m_key;
   }
-  PAbstractArray::DestroyContents();
+  m_elements.clear();
+  m_slots.clear();
+  m_mask = 0;
+  m_count = 0;
 }
 
 
-void PHashTableInfo::AppendElement(PObject * key, PObject * data PTRACE_PARAM(, PHashTable * owner))
+uint32_t PHashTableInfo::MixHash(PINDEX hash)
+{
+  /* Fibonacci hashing, so a hash function can return sequential, or any
+     other poorly distributed values, and still get well spread slots. */
+  static const uint64_t GoldenRatio = ((uint64_t)0x9E3779B9 << 32) | 0x7F4A7C15;
+  return (uint32_t)(((uint64_t)hash * GoldenRatio) >> 32);
+}
+
+
+PINDEX PHashTableInfo::FindSlot(const PObject & key, uint32_t hash) const
 {
-  PINDEX bucket = PAssertNULL(key)->HashFunction();
-  if (bucket >= GetSize())
-    SetSize(bucket+1);
-
-  PHashTableList & list = operator[](bucket);
-  PHashTableElement * element = new PHashTableElement;
-  PAssert(element != NULL, POutOfMemory);
-  element->m_key = key;
-  element->m_data = data;
-  element->m_bucket = bucket;
-  element->m_next = NULL;
-
-  if (list.m_head == NULL) {
-    element->m_prev = NULL;
-    list.m_head = list.m_tail = element;
+  if (m_count == 0)
+    return P_MAX_INDEX;
+
+  PINDEX slot = hash & m_mask;
+  for (PINDEX distance = 0; ; ++distance) {
+    const Slot & probe = m_slots[slot];
+    // Robin Hood invariant means we can stop as soon as a richer slot is found
+    if (probe.m_position == 0 || GetDistance(slot) < distance)
+      return P_MAX_INDEX;
+    if (probe.m_hash == hash && *m_elements[probe.m_position-1].m_key == key)
+      return slot;
+    slot = (slot + 1) & m_mask;
   }
-  else {
-    element->m_prev = list.m_tail;
-    list.m_tail->m_next = element;
-    list.m_tail =  element;
+}
+
+
+PINDEX PHashTableInfo::InsertSlot(uint32_t position, uint32_t hash)
+{
+  Slot entry;
+  entry.m_position = position;
+  entry.m_hash = hash;
+
+  PINDEX slot = hash & m_mask;
+  PINDEX distance = 0;
+  PINDEX maxDistance = 0;
+  while (m_slots[slot].m_position != 0) {
+    PINDEX existing = GetDistance(slot);
+    if (existing < distance) {
+      std::swap(entry, m_slots[slot]);
+      distance = existing;
+    }
+    slot = (slot + 1) & m_mask;
+    if (++distance > maxDistance)
+      maxDistance = distance;
+  }
+  m_slots[slot] = entry;
+  return maxDistance;
+}
+
+
+void PHashTableInfo::Rebuild(PINDEX slotCount)
+{
+  if (m_elements.size() > (size_t)m_count) {
+    // Squeeze out the holes left by removed elements
+    std::vector<PHashTableElement>::iterator out = m_elements.begin();
+    for (std::vector<PHashTableElement>::iterator it = m_elements.begin(); it != m_elements.end(); ++it) {
+      if (it->m_key != NULL)
+        *out++ = *it;
+    }
+    m_elements.erase(out, m_elements.end());
   }
 
+  m_slots.assign(slotCount, Slot());
+  m_mask = slotCount - 1;
+  for (size_t i = 0; i < m_elements.size(); ++i)
+    InsertSlot((uint32_t)(i+1), m_elements[i].m_hash);
+}
+
+
+void PHashTableInfo::AppendElement(PObject * key, PObject * data PTRACE_PARAM(, PHashTable * owner))
+{
+  PINDEX slotCount = (PINDEX)m_slots.size();
+  if ((m_count+1)*4 > slotCount*3)
+    Rebuild(std::max(slotCount*2, (PINDEX)8));
+  else if ((PINDEX)m_elements.size() - m_count > std::max(m_count, (PINDEX)8))
+    Rebuild(slotCount);
+
+  PHashTableElement element;
+  element.m_key = key;
+  element.m_data = data;
+  element.m_hash = MixHash(key->HashFunction());
+  m_elements.push_back(element);
+  ++m_count;
+
 #if PTRACING
-  ++list.m_size;
-  PINDEX totalSize = owner->GetSize();
-  PTRACE_IF(m_throttlePoorHashFunction, list.m_size > 20 && list.m_size > totalSize/2, owner, "PTLib",
-            "Poor hash function used, more than 50% of " << totalSize <<
-            " items in same bucket for class=\"" << owner->GetClassName() << "\""
-            " key=\"" << *key << "\" bucket=" << bucket);
+  PINDEX distance =
 #endif
+  InsertSlot((uint32_t)m_elements.size(), element.m_hash);
+
+  PTRACE_IF(m_throttlePoorHashFunction, distance > 32 && distance > m_count/2, owner, "PTLib",
+            "Poor hash function used, probe distance of " << distance << " with " << m_count <<
+            " items for class=\"" << owner->GetClassName() << "\" key=\"" << *key << '"');
 }
 
 
 PObject * PHashTableInfo::RemoveElement(const PObject & key)
 {
-  PObject * obj = NULL;
-  PHashTableElement * element = GetElementAt(key);
-  if (element != NULL) {
-    PHashTableList & list = operator[](element->m_bucket);
-    if (element == list.m_head) {
-      if (element == list.m_tail)
-        list.m_head = list.m_tail = NULL;
-      else {
-        list.m_head = list.m_head->m_next;
-        list.m_head->m_prev = NULL;
-      }
-    }
-    else {
-      if (element == list.m_tail) {
-        list.m_tail = list.m_tail->m_prev;
-        list.m_tail->m_next = NULL;
-      }
-      else {
-        element->m_prev->m_next = element->m_next;
-        element->m_next->m_prev = element->m_prev;
-      }
-    }
-#if PTRACING
-    --list.m_size;
-#endif
+  PINDEX slot = FindSlot(key, MixHash(key.HashFunction()));
+  if (slot == P_MAX_INDEX)
+    return NULL;
 
-    obj = element->m_data;
-    if (deleteKeys)
-      delete element->m_key;
-    delete element;
+  PHashTableElement & element = m_elements[m_slots[slot].m_position-1];
+  PObject * obj = element.m_data;
+  if (deleteKeys)
+    delete element.m_key;
+  element.m_key = NULL;
+  element.m_data = NULL;
+  --m_count;
+
+  // Backward shift deletion, so no tombstones needed
+  PINDEX next = (slot + 1) & m_mask;
+  while (m_slots[next].m_position != 0 && GetDistance(next) > 0) {
+    m_slots[slot] = m_slots[next];
+    slot = next;
+    next = (next + 1) & m_mask;
   }
+  m_slots[slot].m_position = 0;
+
+  // Trailing holes can go immediately without disturbing iterators
+  while (!m_elements.empty() && m_elements.back().m_key == NULL)
+    m_elements.pop_back();
+
   return obj;
 }
 
 
 PHashTableElement * PHashTableInfo::GetElementAt(PINDEX index)
 {
-  PHashTableElement * element;
-  PINDEX bucket = 0;
-  while ((element = GetAt(bucket).m_head) == NULL) {
-    if (bucket >= GetSize())
-      return NULL;
-    bucket++;
-  }
+  if (index >= m_count)
+    return NULL;
 
-  for (PINDEX i = 0; i < index; ++i) {
-    if (element->m_next != NULL)
-      element = element->m_next;
-    else {
-      do {
-        if (++bucket >= GetSize())
-          return NULL;
-      } while ((element = GetAt(bucket).m_head) == NULL);
-    }
-  }
+  if (m_elements.size() == (size_t)m_count)
+    return &m_elements[index];
 
-  return element;
+  for (std::vector<PHashTableElement>::iterator it = m_elements.begin(); it != m_elements.end(); ++it) {
+    if (it->m_key != NULL && index-- == 0)
+      return &*it;
+  }
+  return NULL;
 }
 
 
 PHashTableElement * PHashTableInfo::GetElementAt(const PObject & key)
 {
-  PHashTableElement * element = GetAt(key.HashFunction()).m_head;
-  while (element != NULL) {
-    if (*element->m_key == key) 
-      return element;
-    element = element->m_next;
-  }
-  return NULL;
+  PINDEX position = GetPosition(key);
+  return position != P_MAX_INDEX ? &m_elements[position] : NULL;
 }
 
 
 PINDEX PHashTableInfo::GetElementsIndex(const PObject * obj, PBoolean byValue, PBoolean keys) const
 {
   PINDEX index = 0;
-  for (PINDEX i = 0; i < GetSize(); i++) {
-    PHashTableElement * element = GetAt(i).m_head;
-    while (element != NULL) {
-      PObject * keydata = keys ? element->m_key : element->m_data;
-      if (byValue ? (*keydata == *obj) : (keydata == obj))
-        return index;
-      element = element->m_next;
-      index++;
-    }
+  for (std::vector<PHashTableElement>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it) {
+    if (it->m_key == NULL)
+      continue;
+    PObject * keydata = keys ? it->m_key : it->m_data;
+    if (byValue ? (*keydata == *obj) : (keydata == obj))
+      return index;
+    index++;
   }
   return P_MAX_INDEX;
 }
 
 
-PHashTableElement * PHashTableInfo::NextElement(PHashTableElement * element) const
+PINDEX PHashTableInfo::GetNextPosition(PINDEX position) const
 {
-  if (element == NULL)
-    return NULL;
-
-  PINDEX bucket = element->m_bucket;
-  if (element->m_next != NULL)
-    element = element->m_next;
-  else {
-    do {
-      if (++bucket >= GetSize())
-        return NULL;
-    } while ((element = GetAt(bucket).m_head) == NULL);
+  PINDEX size = (PINDEX)m_elements.size();
+  for (position = position == P_MAX_INDEX ? 0 : position+1; position < size; ++position) {
+    if (m_elements[position].m_key != NULL)
+      return position;
   }
-  return element;
+  return P_MAX_INDEX;
 }
 
 
-PHashTableElement * PHashTableInfo::PrevElement(PHashTableElement * element) const
+PINDEX PHashTableInfo::GetPrevPosition(PINDEX position) const
 {
-  if (element == NULL)
-    return NULL;
+  if (position == P_MAX_INDEX)
+    return P_MAX_INDEX;
 
-  PINDEX bucket = element->m_bucket;
-  if (element->m_prev != NULL)
-    element = element->m_prev;
-  else {
-    do {
-      if (bucket-- == 0)
-        return NULL;
-    } while ((element = GetAt(bucket).m_tail) == NULL);
+  // Trailing holes may have been removed since the position was obtained
+  position = std::min(position, (PINDEX)m_elements.size());
+  while (position-- > 0) {
+    if (m_elements[position].m_key != NULL)
+      return position;
   }
-  return element;
+  return P_MAX_INDEX;
+}
+
+
+PINDEX PHashTableInfo::GetPosition(const PObject & key) const
+{
+  PINDEX slot = FindSlot(key, MixHash(key.HashFunction()));
+  return slot != P_MAX_INDEX ? m_slots[slot].m_position-1 : P_MAX_INDEX;
 }
 
 
@@ -1307,7 +1350,7 @@ PHashTable::PHashTable()
 void PHashTable::DestroyContents()
 {
   if (hashTable != NULL) {
-    hashTable->reference->deleteObjects = reference->deleteObjects;
+    hashTable->deleteObjects = reference->deleteObjects;
     delete hashTable;
     hashTable = NULL;
   }
@@ -1322,19 +1365,18 @@ void PHashTable::CopyContents(const PHashTable & hash)
   
 void PHashTable::CloneContents(const PHashTable * hash)
 {
-  PINDEX sz = PAssertNULL(hash)->GetSize();
-  PHashTableInfo * original = PAssertNULL(hash->hashTable);
+  PHashTableInfo * original = PAssertNULL(PAssertNULL(hash)->hashTable);
 
-  hashTable = new PHashTableInfo(original->GetSize());
+  hashTable = new PHashTableInfo;
   PAssert(hashTable != NULL, POutOfMemory);
   hashTable->deleteKeys = original->deleteKeys;
 
-  for (PINDEX i = 0; i < sz; i++) {
-    PHashTableElement * lastElement = original->GetElementAt(i);
-    PObject * data = lastElement->m_data;
+  for (PINDEX pos = original->GetFirstPosition(); pos != P_MAX_INDEX; pos = original->GetNextPosition(pos)) {
+    PHashTableElement & element = original->GetElementAtPosition(pos);
+    PObject * data = element.m_data;
     if (data != NULL)
       data = data->Clone();
-    hashTable->AppendElement(lastElement->m_key->Clone(), data PTRACE_PARAM(, this));
+    hashTable->AppendElement(element.m_key->Clone(), data PTRACE_PARAM(, this));
   }
 }
 
@@ -1388,6 +1430,30 @@ void PAbstractSet::CloneContents(const PAbstractSet * )
 }
 
 
+void PAbstractSet::PrintOn(ostream &strm) const
+{
+  char separator = strm.fill();
+  int width = (int)strm.width();
+
+  PINDEX first = hashTable->GetFirstPosition();
+  for (PINDEX pos = first; pos != P_MAX_INDEX; pos = hashTable->GetNextPosition(pos)) {
+    if (pos != first && separator != ' ')
+      strm << separator;
+
+    if (separator == '\n' && width < 0)
+      strm << setfill(' ') << setw(-width) << ' ';
+
+    if (separator != ' ')
+      strm.width(width);
+
+    strm << *hashTable->GetElementAtPosition(pos).m_key;
+  }
+
+  if (separator == '\n')
+    strm << '\n';
+}
+
+
 PINDEX PAbstractSet::Append(PObject * obj)
 {
   if (AbstractContains(*obj)) {
@@ -1422,7 +1488,7 @@ PBoolean PAbstractSet::Remove(const PObject * obj)
   if (hashTable->GetElementAt(*obj) == NULL)
     return false;
 
-  hashTable->deleteKeys = hashTable->reference->deleteObjects = reference->deleteObjects;
+  hashTable->deleteKeys = hashTable->deleteObjects = reference->deleteObjects;
   hashTable->RemoveElement(*obj);
   reference->size--;
   return true;
@@ -1436,7 +1502,7 @@ PObject * PAbstractSet::RemoveAt(PINDEX index)
     return NULL;
 
   PObject * obj = lastElement->m_key;
-  hashTable->deleteKeys = hashTable->reference->deleteObjects = reference->deleteObjects;
+  hashTable->deleteKeys = hashTable->deleteObjects = reference->deleteObjects;
   hashTable->RemoveElement(*obj);
   reference->size--;
   return obj;
@@ -1470,8 +1536,9 @@ PBoolean PAbstractSet::SetAt(PINDEX, PObject * obj)
 bool PAbstractSet::Union(const PAbstractSet & set)
 {
   bool something = false;
-  for (PINDEX i = 0; i < set.GetSize(); ++i) {
-    const PObject & obj = set.AbstractGetKeyAt(i);
+  PHashTableInfo & table = *set.hashTable;
+  for (PINDEX pos = table.GetFirstPosition(); pos != P_MAX_INDEX; pos = table.GetNextPosition(pos)) {
+    const PObject & obj = *table.GetElementAtPosition(pos).m_key;
     if (!AbstractContains(obj)) {
       something = true;
       Append(obj.Clone());
@@ -1486,8 +1553,9 @@ bool PAbstractSet::Intersection(const PAbstractSet & set1,
                                 PAbstractSet * intersection)
 {
   bool something = false;
-  for (PINDEX i = 0; i < set1.GetSize(); ++i) {
-    const PObject & obj = set1.AbstractGetKeyAt(i);
+  PHashTableInfo & table = *set1.hashTable;
+  for (PINDEX pos = table.GetFirstPosition(); pos != P_MAX_INDEX; pos = table.GetNextPosition(pos)) {
+    const PObject & obj = *table.GetElementAtPosition(pos).m_key;
     if (set2.AbstractContains(obj)) {
       something = true;
       if (intersection == NULL)
@@ -1619,8 +1687,8 @@ void PAbstractDictionary::AbstractGetKeys(PArrayObjects & keys) const
 {
   keys.SetSize(GetSize());
   PINDEX index = 0;
-  for (PHashTableElement * element = hashTable->GetElementAt((PINDEX)0); element != NULL; element = hashTable->NextElement(element))
-    keys.SetAt(index++, element->m_key->Clone());
+  for (PINDEX pos = hashTable->GetFirstPosition(); pos != P_MAX_INDEX; pos = hashTable->GetNextPosition(pos))
+    keys.SetAt(index++, hashTable->GetElementAtPosition(pos).m_key->Clone());
 }
 
 
@@ -1630,10 +1698,13 @@ void PAbstractDictionary::PrintOn(ostream &strm) const
   if (separator == ' ')
     separator = '\n';
 
-  for (PINDEX i = 0; i < GetSize(); i++) {
-    if (i > 0)
+  // Getting the first position may skip holes, so don't do it every time around
+  PINDEX first = hashTable->GetFirstPosition();
+  for (PINDEX pos = first; pos != P_MAX_INDEX; pos = hashTable->GetNextPosition(pos)) {
+    if (pos != first)
       strm << separator;
-    strm << AbstractGetKeyAt(i) << '=' << AbstractGetDataAt(i);
+    PHashTableElement & element = hashTable->GetElementAtPosition(pos);
+    strm << *element.m_key << '=' << *element.m_data;
   }
 
   if (separator == '\n')
@@ -231,10 +231,10 @@ PAbstractArray::PAbstractArray(PINDEX elementSizeInBytes,
 }
 
 
-PAbstractArray::PAbstractArray(PContainerReference & reference, PINDEX elementSizeInBytes)
+PAbstractArray::PAbstractArray(PContainerReference & reference, PINDEX elementSizeInBytes, void * buffer)
   : PContainer(reference)
   , elementSize(elementSizeInBytes)
-  , m_theArray(NULL)
+  , m_theArray((char *)buffer)
   , allocatedDynamically(false)
 {
 }
@@ -594,28 +594,36 @@ void PHexDump::PrintOn(ostream & strm) const
 ///////////////////////////////////////////////////////////////////////////////
 
 PString::PString()
-  : PCharArray(1)
+  : PCharArray(m_inline, m_inline.m_buffer)
   , m_length(0)
 {
 }
 
 
 PString::PString(const PString & str)
-  : PCharArray(str)
-  , m_length(str.GetLength())
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  AssignContents(str);
 }
 
 
 PString::PString(const PCharArray & buf)
-  : PCharArray(buf)
-  , m_length(strlen(buf))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  PINDEX size = buf.GetSize();
+  if (size >= InlineSize)
+    PCharArray::AssignContents(buf);
+  else if (size > 0)
+    InternalSetInline(buf, size, size+1);
+  m_length = strlen(m_theArray);
 }
 
 
 PString::PString(const PBYTEArray & buf)
-  : m_length(0)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
   PINDEX bufSize = buf.GetSize();
   if (bufSize > 0) {
@@ -627,31 +635,35 @@ PString::PString(const PBYTEArray & buf)
 
 
 PString::PString(int, const PString * str)
-  : PCharArray(*str)
-  , m_length(str->GetLength())
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  AssignContents(*str);
+  MakeUnique();
 }
 
 
 PString::PString(const std::string & str)
-  : PCharArray(str.c_str(), str.length()+1)
-  , m_length(str.length())
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  memcpy(GetPointerAndSetLength(str.length()), str.c_str(), str.length());
 }
 
 
 PString::PString(char c)
-  : PCharArray(2)
+  : PCharArray(m_inline, m_inline.m_buffer)
   , m_length(1)
 {
-  SetAt(0, c);
+  InternalSetInline(&c, 1, 2);
 }
 
 
 PString::PString(bool b)
-  : PCharArray(b ? "true" : "false", b ? 5 : 6)
+  : PCharArray(m_inline, m_inline.m_buffer)
   , m_length(b ? 4 : 5)
 {
+  InternalSetInline(b ? "true" : "false", m_length+1, m_length+1);
 }
 
 
@@ -666,6 +678,8 @@ const PString & PString::Empty()
 
 
 PString::PString(const char * cstr)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
   if (cstr == NULL)
     MakeEmpty();
@@ -679,6 +693,8 @@ PString::PString(const char * cstr)
 #ifdef P_HAS_WCHAR
 
 PString::PString(const wchar_t * wstr)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
   if (wstr == NULL)
     MakeEmpty();
@@ -687,12 +703,16 @@ PString::PString(const wchar_t * wstr)
 }
 
 PString::PString(const wchar_t * wstr, PINDEX len)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
   InternalFromWChar(wstr, len);
 }
 
 
 PString::PString(const PWCharArray & wstr)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
   PINDEX size = wstr.GetSize();
   if (size > 0 && wstr[size-1] == 0) // Stip off trailing NULL if present
@@ -703,11 +723,21 @@ PString::PString(const PWCharArray & wstr)
 #endif // P_HAS_WCHAR
 
 PString::PString(const char * cstr, PINDEX len)
-  : PCharArray(len+1)
-  , m_length(len)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
   if (len > 0)
-    memcpy(PCharArray::GetPointer(), PAssertNULL(cstr), len);
+    memcpy(GetPointerAndSetLength(len), PAssertNULL(cstr), len);
+}
+
+
+PString::PString(const PStringView & view)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
+{
+  PINDEX len = view.GetLength();
+  if (len > 0)
+    memcpy(GetPointerAndSetLength(len), view.GetPointer(), len);
 }
 
 
@@ -767,7 +797,7 @@ static void TranslateEscapes(const char * & src, char * dst)
 
 
 PString::PString(ConversionType type, const char * str, ...)
-  : PCharArray(1)
+  : PCharArray(m_inline, m_inline.m_buffer)
   , m_length(0)
 {
   switch (type) {
@@ -830,61 +860,85 @@ template <typename S, typename U> PINDEX p_signed2string(S value, unsigned base,
 
 
 PString::PString(short n)
-  : PCharArray(sizeof(short)*3+2)
-  , m_length(p_signed2string<signed int, unsigned>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(short)*3+2];
+  m_length = p_signed2string<signed int, unsigned>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 
 
 PString::PString(unsigned short n)
-  : PCharArray(sizeof(unsigned short)*3+1)
-  , m_length(p_unsigned2string<unsigned int>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(unsigned short)*3+1];
+  m_length = p_unsigned2string<unsigned int>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 
 
 PString::PString(int n)
-  : PCharArray(sizeof(int)*3+2)
-  , m_length(p_signed2string<signed int, unsigned>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(int)*3+2];
+  m_length = p_signed2string<signed int, unsigned>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 
 
 PString::PString(unsigned int n)
-  : PCharArray(sizeof(unsigned int)*3+1)
-  , m_length(p_unsigned2string<unsigned int>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(unsigned int)*3+1];
+  m_length = p_unsigned2string<unsigned int>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 
 
 PString::PString(long n)
-  : PCharArray(sizeof(long)*3+2)
-  , m_length(p_signed2string<signed long, unsigned long>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(long)*3+2];
+  m_length = p_signed2string<signed long, unsigned long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 
 
 PString::PString(unsigned long n)
-  : PCharArray(sizeof(unsigned long)*3+1)
-  , m_length(p_unsigned2string<unsigned long>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(unsigned long)*3+1];
+  m_length = p_unsigned2string<unsigned long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 
 
 #ifdef HAVE_LONG_LONG_INT
 PString::PString(long long n)
-  : PCharArray(sizeof(long long)*3+2)
-  , m_length(p_signed2string<signed long long, unsigned long long>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(long long)*3+2];
+  m_length = p_signed2string<signed long long, unsigned long long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 #endif
 
 
 #ifdef HAVE_UNSIGNED_LONG_LONG_INT
 PString::PString(unsigned long long n)
-  : PCharArray(sizeof(unsigned long long)*3+1)
-  , m_length(p_unsigned2string<unsigned long long>(n, 10, PCharArray::GetPointer()))
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
+  char buffer[sizeof(unsigned long long)*3+1];
+  m_length = p_unsigned2string<unsigned long long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length);
 }
 #endif
 
@@ -957,9 +1011,11 @@ template <typename S, typename U>
 
 #define PSTRING_CONV_CTOR(paramType, signedType, unsignedType) \
 PString::PString(ConversionType type, paramType value, unsigned param) \
-  : PCharArray(sizeof(paramType)*3+1) \
+  : PCharArray(m_inline, m_inline.m_buffer) \
 { \
-  m_length = p_convert<signedType, unsignedType>(type, value, param, PCharArray::GetPointer()); \
+  char buffer[sizeof(paramType)*3+1]; \
+  m_length = p_convert<signedType, unsignedType>(type, value, param, buffer); \
+  memcpy(GetPointerAndSetLength(m_length), buffer, m_length); \
 }
 
 PSTRING_CONV_CTOR(unsigned char,  char,   unsigned char);
@@ -978,7 +1034,8 @@ PSTRING_CONV_CTOR(unsigned long long, long long, unsigned long long);
 
 
 PString::PString(ConversionType type, double value, unsigned places)
-  : m_length(0)
+  : PCharArray(m_inline, m_inline.m_buffer)
+  , m_length(0)
 {
   switch (type) {
     case Decimal :
@@ -1092,8 +1149,53 @@ PString & PString::operator=(unsigned long long n)
 
 void PString::AssignContents(const PContainer & cont)
 {
-  PCharArray::AssignContents(cont);
-  m_length = ((const PString &)cont).GetLength();
+  const PString & other = (const PString &)cont;
+  PINDEX len = other.GetLength();
+  if (len < InlineSize && other.m_theArray != NULL)
+    InternalSetInline(other.m_theArray, len+1, len+1);
+  else if (IsInline() && !other.IsInline()) {
+    // Nothing to release, just share the heap array
+    ++other.reference->count;
+    reference = other.reference;
+    PAbstractArray::CopyContents(other);
+  }
+  else
+    PCharArray::AssignContents(cont);
+  m_length = len;
+}
+
+
+void PString::DestroyReference()
+{
+  if (IsInline())
+    reference = NULL;
+  else
+    PCharArray::DestroyReference();
+}
+
+
+void PString::InternalSetInline(const char * data, PINDEX dataSize, PINDEX newSize)
+{
+  PAssert(dataSize <= newSize && newSize <= InlineSize, PInvalidParameter);
+
+  // Copy before releasing the old reference, as data may be in the old array
+  if (data != m_inline.m_buffer && dataSize > 0)
+    memmove(m_inline.m_buffer, data, dataSize);
+  if (newSize > dataSize)
+    memset(m_inline.m_buffer+dataSize, 0, newSize-dataSize);
+
+  if (!IsInline()) {
+    if (reference != NULL && --reference->count == 0) {
+      DestroyContents();
+      DestroyReference();
+    }
+    reference = &m_inline;
+    m_inline.count = 1;
+    m_theArray = m_inline.m_buffer;
+    allocatedDynamically = false;
+  }
+
+  m_inline.size = newSize;
 }
 
 
@@ -1149,29 +1251,71 @@ PObject::Comparison PString::Compare(const PObject & obj) const
 }
 
 
-PINDEX PString::HashFunction() const
+// Constants and round function from the xxHash64 algorithm
+static const uint64_t HashPrime1 = ((uint64_t)0x9E3779B1 << 32) | 0x85EBCA87;
+static const uint64_t HashPrime2 = ((uint64_t)0xC2B2AE3D << 32) | 0x27D4EB4F;
+static const uint64_t HashPrime3 = ((uint64_t)0x165667B1 << 32) | 0x9E3779F9;
+static const uint64_t HashPrime4 = ((uint64_t)0x85EBCA77 << 32) | 0xC2B2AE63;
+static const uint64_t HashHighBits = ((uint64_t)0x80808080 << 32) | 0x80808080;
+static const uint64_t HashLowBits  = ((uint64_t)0x7F7F7F7F << 32) | 0x7F7F7F7F;
+
+static __inline uint64_t HashRotate(uint64_t x, unsigned r)
 {
-  /* Hash function from "Data Structures and Algorithm Analysis in C++" by
-     Mark Allen Weiss, with limit of only executing over at most the first and
-     last characters to increase speed when dealing with large strings. */
+  return (x << r) | (x >> (64 - r));
+}
 
-  switch (GetLength()) { // Use virtual function so PStringStream recalculates length
-    case 0:
-      return 0;
-    case 1:
-      return tolower(at(0) & 0xff) % 127;
+
+static __inline uint64_t HashToLower(uint64_t x)
+{
+  /* Lower case all ASCII letters in eight bytes at once. Adding is done on
+     the bytes with top bit removed, so there is no carry between bytes. */
+  static const uint64_t Ones = HashHighBits >> 7;
+  uint64_t low = x & HashLowBits;
+  uint64_t atLeastA = low + (0x80 - 'A')*Ones;
+  uint64_t aboveZ   = low + (0x80 - 'Z' - 1)*Ones;
+  uint64_t isUpper  = atLeastA & ~aboveZ & ~x & HashHighBits;
+  return x | (isUpper >> 2);
+}
+
+
+PINDEX PString::CalculateHash(const char * data, PINDEX length, bool caseInsensitive)
+{
+  uint64_t hash = HashPrime3 + (uint64_t)length*HashPrime1;
+
+  while (length >= 8) {
+    uint64_t lane;
+    memcpy(&lane, data, 8);
+    if (caseInsensitive)
+      lane = HashToLower(lane);
+    hash ^= HashRotate(lane * HashPrime2, 31) * HashPrime1;
+    hash = HashRotate(hash, 27) * HashPrime1 + HashPrime4;
+    data += 8;
+    length -= 8;
   }
 
-  static const PINDEX MaxCount = 18; // Make sure big enough to cover whole PGloballyUniqueID::AsString()
-  PINDEX count = std::min(m_length / 2, MaxCount);
-  unsigned hash = 0;
-  PINDEX i;
-  const char* theArray = c_str();
-  for (i = 0; i < count; i++)
-    hash = (hash << 5) ^ tolower(theArray[i] & 0xff) ^ hash;
-  for (i = m_length - count - 1; i < m_length; i++)
-    hash = (hash << 5) ^ tolower(theArray[i] & 0xff) ^ hash;
-  return hash % 127;
+  if (length > 0) {
+    uint64_t lane = 0;
+    memcpy(&lane, data, length);
+    if (caseInsensitive)
+      lane = HashToLower(lane);
+    hash ^= HashRotate(lane * HashPrime2, 31) * HashPrime1;
+    hash = HashRotate(hash, 27) * HashPrime1 + HashPrime4;
+  }
+
+  // Final avalanche, so every input bit affects every output bit
+  hash ^= hash >> 33;
+  hash *= HashPrime2;
+  hash ^= hash >> 29;
+  hash *= HashPrime3;
+  hash ^= hash >> 32;
+  return (PINDEX)hash;
+}
+
+
+PINDEX PString::HashFunction() const
+{
+  // Use virtual function so PStringStream recalculates length
+  return CalculateHash(c_str(), GetLength(), true);
 }
 
 
@@ -1186,7 +1330,21 @@ PBoolean PString::SetSize(PINDEX newSize)
   if (newSize < 1)
     newSize = 1;
 
-  if (!InternalSetSize(newSize, !IsUnique()))
+  if (newSize <= InlineSize)
+    InternalSetInline(m_theArray, PMIN(newSize, GetSize()), newSize);
+  else if (IsInline()) {
+    // Grown out of the internal buffer, move to a heap array
+    char * newArray = PAbstractArrayAllocate(newSize);
+    if (newArray == NULL)
+      return false;
+    PINDEX oldSize = GetSize();
+    memcpy(newArray, m_theArray, oldSize);
+    memset(newArray+oldSize, 0, newSize-oldSize);
+    reference = new PContainerReference(newSize);
+    m_theArray = newArray;
+    allocatedDynamically = true;
+  }
+  else if (!InternalSetSize(newSize, !IsUnique()))
     return false;
 
   if (GetLength() >= newSize) {
@@ -1203,7 +1361,11 @@ PBoolean PString::MakeUnique()
   if (IsUnique())
     return true;
 
-  InternalSetSize(GetSize(), true);
+  PINDEX size = GetSize();
+  if (size <= InlineSize)
+    InternalSetInline(m_theArray, size, size);
+  else
+    InternalSetSize(size, true);
   return false;
 }
 
@@ -1540,6 +1702,91 @@ int PString::internal_strncmp(const char * s1, const char *s2, size_t n) const
 }
 
 
+bool PString::InternalIsCaseless() const
+{
+  // Derived classes only override the comparison functions, so ask them
+  return internal_strncmp("a", "A", 1) == 0;
+}
+
+
+/* Locates the next occurrence of a character, or its other case, using
+   memchr() which the C library implements with vector instructions. For
+   caseless search the position of each case is remembered, so the string
+   is not rescanned when the caller rejects a candidate. */
+class PStringCharFinder
+{
+  public:
+    PStringCharFinder(const char * str, PINDEX end, char ch, bool caseless)
+      : m_str(str)
+      , m_end(end)
+      , m_count(1)
+      , m_started(false)
+    {
+      m_char[0] = ch;
+      if (caseless) {
+        char other = (char)(islower(ch & 0xff) ? toupper(ch & 0xff) : tolower(ch & 0xff));
+        if (other != ch)
+          m_char[m_count++] = other;
+      }
+      m_next[0] = m_next[1] = 0;
+    }
+
+    PINDEX Next(PINDEX offset)
+    {
+      PINDEX found = P_MAX_INDEX;
+      for (int i = 0; i < m_count; ++i) {
+        if (m_next[i] != P_MAX_INDEX && (!m_started || m_next[i] < offset)) {
+          const char * ptr = offset < m_end ? (const char *)memchr(m_str+offset, m_char[i], m_end-offset) : NULL;
+          m_next[i] = ptr != NULL ? (PINDEX)(ptr - m_str) : P_MAX_INDEX;
+        }
+        if (m_next[i] < found)
+          found = m_next[i];
+      }
+      m_started = true;
+      return found;
+    }
+
+  private:
+    const char * m_str;
+    PINDEX       m_end;
+    char         m_char[2];
+    PINDEX       m_next[2];
+    int          m_count;
+    bool         m_started;
+};
+
+
+/* Bit set of characters for FindOneOf() and FindSpan(), so each character
+   of the string is a single lookup rather than a compare per member. */
+class PStringCharSet
+{
+  public:
+    PStringCharSet(const char * cset, bool caseless)
+    {
+      memset(m_bits, 0, sizeof(m_bits));
+      while (*cset != '\0') {
+        int ch = *cset++ & 0xff;
+        Add(ch);
+        if (caseless) {
+          Add(tolower(ch));
+          Add(toupper(ch));
+        }
+      }
+    }
+
+    bool Contains(char ch) const
+    {
+      unsigned idx = ch & 0xff;
+      return (m_bits[idx >> 3] & (1 << (idx & 7))) != 0;
+    }
+
+  private:
+    void Add(int ch) { m_bits[ch >> 3] |= (BYTE)(1 << (ch & 7)); }
+
+    BYTE m_bits[32];
+};
+
+
 PINDEX PString::Find(char ch, PINDEX offset) const
 {
 #if PINDEX_SIGNED
@@ -1547,13 +1794,7 @@ PINDEX PString::Find(char ch, PINDEX offset) const
     return P_MAX_INDEX;
 #endif
 
-  PINDEX len = GetLength();
-  while (offset < len) {
-    if (InternalCompare(offset, 1, &ch) == EqualTo)
-      return offset;
-    offset++;
-  }
-  return P_MAX_INDEX;
+  return PStringCharFinder(GetPointer(), GetLength(), ch, InternalIsCaseless()).Next(offset);
 }
 
 
@@ -1575,30 +1816,14 @@ PINDEX PString::Find(const char * cstr, PINDEX offset) const
   if (offset > len - clen)
     return P_MAX_INDEX;
 
-  if (len - clen < 10) {
-    while (offset+clen <= len) {
-      if (InternalCompare(offset, clen, cstr) == EqualTo)
-        return offset;
-      offset++;
-    }
-    return P_MAX_INDEX;
-  }
-
-  const char* theArray = GetPointer();
-
-  int strSum = 0;
-  int cstrSum = 0;
-  for (PINDEX i = 0; i < clen; i++) {
-    strSum += toupper(theArray[offset+i] & 0xff);
-    cstrSum += toupper(cstr[i] & 0xff);
-  }
+  if (!InternalIsCaseless())
+    return PStringView(GetPointer(), len).Find(PStringView(cstr, clen), offset);
 
-  // search for a matching substring
-  while (offset+clen <= len) {
-    if (strSum == cstrSum && InternalCompare(offset, clen, cstr) == EqualTo)
+  // Only positions starting with the first character, in either case, are compared
+  PStringCharFinder finder(GetPointer(), len - clen + 1, *cstr, true);
+  while ((offset = finder.Next(offset)) != P_MAX_INDEX) {
+    if (InternalCompare(offset, clen, cstr) == EqualTo)
       return offset;
-    strSum += toupper(theArray[offset+clen] & 0xff);
-    strSum -= toupper(theArray[offset] & 0xff);
     offset++;
   }
 
@@ -1620,7 +1845,12 @@ PINDEX PString::FindLast(char ch, PINDEX offset) const
   if (offset >= len)
     offset = len-1;
 
-  while (InternalCompare(offset, 1, &ch) != EqualTo) {
+  char other = ch;
+  if (InternalIsCaseless())
+    other = (char)(islower(ch & 0xff) ? toupper(ch & 0xff) : tolower(ch & 0xff));
+
+  const char * theArray = GetPointer();
+  while (theArray[offset] != ch && theArray[offset] != other) {
     if (offset == 0)
       return P_MAX_INDEX;
     offset--;
@@ -1680,14 +1910,15 @@ PINDEX PString::FindOneOf(const char * cset, PINDEX offset) const
   if (cset == NULL || *cset == '\0')
     return P_MAX_INDEX;
 
+  if (cset[1] == '\0')
+    return Find(*cset, offset);
+
+  PStringCharSet set(cset, InternalIsCaseless());
+  const char * theArray = GetPointer();
   PINDEX len = GetLength();
   while (offset < len) {
-    const char * p = cset;
-    while (*p != '\0') {
-      if (InternalCompare(offset, 1, p) == EqualTo)
-        return offset;
-      p++;
-    }
+    if (set.Contains(theArray[offset]))
+      return offset;
     offset++;
   }
   return P_MAX_INDEX;
@@ -1704,13 +1935,12 @@ PINDEX PString::FindSpan(const char * cset, PINDEX offset) const
   if (cset == NULL || *cset == '\0')
     return P_MAX_INDEX;
 
+  PStringCharSet set(cset, InternalIsCaseless());
+  const char * theArray = GetPointer();
   PINDEX len = GetLength();
   while (offset < len) {
-    const char * p = cset;
-    while (InternalCompare(offset, 1, p) != EqualTo) {
-      if (*++p == '\0')
-        return offset;
-    }
+    if (!set.Contains(theArray[offset]))
+      return offset;
     offset++;
   }
   return P_MAX_INDEX;
@@ -1782,19 +2012,38 @@ PString & PString::Replace(const PString & target, const PString & subs, PBoolea
     return *this;
 #endif
     
-  MakeUnique();
-
   PINDEX tlen = target.GetLength();
-  PINDEX slen = subs.GetLength();
+  PINDEX pos = Find(target, offset);
+  if (pos == P_MAX_INDEX)
+    return *this;
+
+  if (!all)
+    return Splice(subs, pos, tlen);
+
+  // Locate every match first, so the result is sized and copied only once
+  std::vector<PINDEX> matches;
   do {
-    PINDEX pos = Find(target, offset);
-    if (pos == P_MAX_INDEX)
-      return *this;
-    Splice(subs, pos, tlen);
-    offset = pos + slen;
-  } while (all);
+    matches.push_back(pos);
+  } while ((pos = Find(target, pos + tlen)) != P_MAX_INDEX);
 
-  return *this;
+  PINDEX len = GetLength();
+  PINDEX slen = subs.GetLength();
+  PINDEX count = (PINDEX)matches.size();
+
+  PString result;
+  char * out = result.GetPointerAndSetLength(len - count*tlen + count*slen);
+  const char * in = GetPointer();
+  PINDEX last = 0;
+  for (std::vector<PINDEX>::iterator it = matches.begin(); it != matches.end(); ++it) {
+    memcpy(out, in+last, *it-last);
+    out += *it-last;
+    memcpy(out, subs.GetPointer(), slen);
+    out += slen;
+    last = *it + tlen;
+  }
+  memcpy(out, in+last, len-last);
+
+  return *this = result;
 }
 
 
@@ -2493,6 +2742,334 @@ int PCaselessString::internal_strncmp(const char * s1, const char *s2, size_t n)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+static __inline bool PStringViewIsSpace(char c)
+{
+  // Same as isspace() in the "C" locale
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+
+PStringView PStringView::Mid(PINDEX start, PINDEX len) const
+{
+#if PINDEX_SIGNED
+  if (len <= 0 || start < 0)
+#else
+  if (len == 0)
+#endif
+    return PStringView();
+
+  if (len == P_MAX_INDEX || start+len < start) // If open ended or check for wraparound
+    return operator()(start, P_MAX_INDEX);
+  else
+    return operator()(start, start+len-1);
+}
+
+
+PStringView PStringView::operator()(PINDEX start, PINDEX end) const
+{
+#if PINDEX_SIGNED
+  if (end < 0 || start < 0)
+    return PStringView();
+#endif
+
+  if (end < start || start >= m_length)
+    return PStringView();
+
+  if (end >= m_length)
+    end = m_length-1;
+
+  return PStringView(m_data+start, end - start + 1);
+}
+
+
+PStringView PStringView::LeftTrim() const
+{
+  PINDEX start = 0;
+  while (start < m_length && PStringViewIsSpace(m_data[start]))
+    ++start;
+  return PStringView(m_data+start, m_length-start);
+}
+
+
+PStringView PStringView::RightTrim() const
+{
+  PINDEX end = m_length;
+  while (end > 0 && PStringViewIsSpace(m_data[end-1]))
+    --end;
+  return PStringView(m_data, end);
+}
+
+
+PStringView PStringView::Trim() const
+{
+  return LeftTrim().RightTrim();
+}
+
+
+PINDEX PStringView::Find(char ch, PINDEX offset) const
+{
+#if PINDEX_SIGNED
+  if (offset < 0)
+    return P_MAX_INDEX;
+#endif
+
+  if (offset >= m_length)
+    return P_MAX_INDEX;
+
+  const char * ptr = (const char *)memchr(m_data+offset, ch, m_length-offset);
+  return ptr != NULL ? (PINDEX)(ptr - m_data) : P_MAX_INDEX;
+}
+
+
+PINDEX PStringView::Find(const PStringView & str, PINDEX offset) const
+{
+#if PINDEX_SIGNED
+  if (offset < 0)
+    return P_MAX_INDEX;
+#endif
+
+  if (str.m_length == 0 || str.m_length > m_length)
+    return P_MAX_INDEX;
+
+  PINDEX last = m_length - str.m_length;
+#if defined(__GLIBC__)
+  if (offset > last)
+    return P_MAX_INDEX;
+  // The C library version is vectorised and uses the two way algorithm
+  const char * found = (const char *)memmem(m_data+offset, m_length-offset, str.m_data, str.m_length);
+  return found != NULL ? (PINDEX)(found - m_data) : P_MAX_INDEX;
+#else
+  while (offset <= last) {
+    // Find the first character, then check the rest
+    const char * ptr = (const char *)memchr(m_data+offset, str.m_data[0], last-offset+1);
+    if (ptr == NULL)
+      break;
+    offset = ptr - m_data;
+    if (memcmp(ptr+1, str.m_data+1, str.m_length-1) == 0)
+      return offset;
+    ++offset;
+  }
+
+  return P_MAX_INDEX;
+#endif
+}
+
+
+PINDEX PStringView::FindLast(char ch, PINDEX offset) const
+{
+#if PINDEX_SIGNED
+  if (offset < 0)
+    return P_MAX_INDEX;
+#endif
+
+  if (m_length == 0)
+    return P_MAX_INDEX;
+
+  if (offset >= m_length)
+    offset = m_length-1;
+
+  while (m_data[offset] != ch) {
+    if (offset == 0)
+      return P_MAX_INDEX;
+    --offset;
+  }
+
+  return offset;
+}
+
+
+PINDEX PStringView::FindOneOf(const char * cset, PINDEX offset) const
+{
+#if PINDEX_SIGNED
+  if (offset < 0)
+    return P_MAX_INDEX;
+#endif
+
+  if (cset == NULL || *cset == '\0')
+    return P_MAX_INDEX;
+
+  for (; offset < m_length; ++offset) {
+    if (strchr(cset, m_data[offset]) != NULL && m_data[offset] != '\0')
+      return offset;
+  }
+
+  return P_MAX_INDEX;
+}
+
+
+PINDEX PStringView::FindSpan(const char * cset, PINDEX offset) const
+{
+#if PINDEX_SIGNED
+  if (offset < 0)
+    return P_MAX_INDEX;
+#endif
+
+  if (cset == NULL || *cset == '\0')
+    return P_MAX_INDEX;
+
+  for (; offset < m_length; ++offset) {
+    if (strchr(cset, m_data[offset]) == NULL || m_data[offset] == '\0')
+      return offset;
+  }
+
+  return P_MAX_INDEX;
+}
+
+
+PObject::Comparison PStringView::Compare(const PStringView & other) const
+{
+  int result = memcmp(m_data, other.m_data, PMIN(m_length, other.m_length));
+  if (result == 0)
+    return m_length < other.m_length ? PObject::LessThan
+         : m_length > other.m_length ? PObject::GreaterThan
+         : PObject::EqualTo;
+  return result < 0 ? PObject::LessThan : PObject::GreaterThan;
+}
+
+
+PObject::Comparison PStringView::CompareCaseless(const PStringView & other) const
+{
+  PINDEX len = PMIN(m_length, other.m_length);
+  for (PINDEX i = 0; i < len; ++i) {
+    int c1 = tolower(m_data[i] & 0xff);
+    int c2 = tolower(other.m_data[i] & 0xff);
+    if (c1 != c2)
+      return c1 < c2 ? PObject::LessThan : PObject::GreaterThan;
+  }
+
+  return m_length < other.m_length ? PObject::LessThan
+       : m_length > other.m_length ? PObject::GreaterThan
+       : PObject::EqualTo;
+}
+
+
+bool PStringView::StartsWith(const PStringView & prefix, bool caseless) const
+{
+  if (prefix.m_length > m_length)
+    return false;
+
+  PStringView start(m_data, prefix.m_length);
+  return (caseless ? start.CompareCaseless(prefix) : start.Compare(prefix)) == PObject::EqualTo;
+}
+
+
+/* The conversions copy to a '\0' terminated buffer, so exactly the same
+   semantics as the PString versions are used. Anything too long to be a
+   valid number is materialised. */
+#define PSTRINGVIEW_CONVERSION(type, func, conv) \
+type PStringView::func(unsigned base) const \
+{ \
+  if (m_length >= 64) \
+    return PString(*this).func(base); \
+  PAssert2(base != 1 && base <= 36, "PStringView", PInvalidParameter); \
+  char buffer[64]; \
+  memcpy(buffer, m_data, m_length); \
+  buffer[m_length] = '\0'; \
+  char * dummy; \
+  return conv(buffer, &dummy, base); \
+}
+
+PSTRINGVIEW_CONVERSION(long,     AsInteger,    strtol)
+PSTRINGVIEW_CONVERSION(DWORD,    AsUnsigned,   strtoul)
+PSTRINGVIEW_CONVERSION(int64_t,  AsInteger64,  strtoll)
+PSTRINGVIEW_CONVERSION(uint64_t, AsUnsigned64, strtoull)
+
+
+bool PStringView::Split(const PStringView & delimiter,
+                        PStringView & before,
+                        PStringView & after,
+                        PString::SplitOptions_Bits options) const
+{
+  PINDEX pos = Find(delimiter);
+
+  if (pos != P_MAX_INDEX) {
+    before = Left(pos);
+    if (options&PString::SplitTrimBefore)
+      before = before.Trim();
+    after = Mid(pos + delimiter.GetLength());
+    if (options&PString::SplitTrimAfter)
+      after = after.Trim();
+  }
+  else {
+    if (!(options&(PString::SplitDefaultToBefore|PString::SplitDefaultToAfter)))
+      return false;
+
+    if (options&PString::SplitDefaultToBefore)
+      before = (options&PString::SplitTrimBefore) ? Trim() : *this;
+
+    if (options&PString::SplitDefaultToAfter)
+      after = (options&PString::SplitTrimBefore) ? Trim() : *this;
+  }
+
+  if (before.IsEmpty() && (options&PString::SplitBeforeNonEmpty))
+    return false;
+
+  if (after.IsEmpty() && (options&PString::SplitAfterNonEmpty))
+    return false;
+
+  return true;
+}
+
+
+std::vector<PStringView> PStringView::Tokenise(const char * separators, bool onePerSeparator) const
+{
+  std::vector<PStringView> tokens;
+
+  if (separators == NULL || IsEmpty())  // No tokens
+    return tokens;
+
+  PINDEX p1 = 0;
+  PINDEX p2 = FindOneOf(separators);
+
+  if (p2 == 0) {
+    if (onePerSeparator) { // first character is a token separator
+      tokens.push_back(PStringView());  // make first string in array empty
+      p1 = 1;
+      p2 = FindOneOf(separators, 1);
+    }
+    else {
+      do {
+        p1 = p2 + 1;
+      } while ((p2 = FindOneOf(separators, p1)) == p1);
+    }
+  }
+
+  while (p2 != P_MAX_INDEX) {
+    tokens.push_back(PStringView(m_data+p1, p2-p1));
+
+    // Get next separator. If not one token per separator then continue
+    // around loop to skip over all the consecutive separators.
+    do {
+      p1 = p2 + 1;
+    } while ((p2 = FindOneOf(separators, p1)) == p1 && !onePerSeparator);
+  }
+
+  tokens.push_back(Mid(p1));
+
+  return tokens;
+}
+
+
+std::vector<PStringView> PStringView::Lines() const
+{
+  std::vector<PStringView> lines;
+
+  PINDEX p1 = 0;
+  PINDEX p2;
+  while ((p2 = FindOneOf("\r\n", p1)) != P_MAX_INDEX) {
+    lines.push_back(PStringView(m_data+p1, p2-p1));
+    p1 = p2 + 1;
+    if (m_data[p2] == '\r' && p1 < m_length && m_data[p1] == '\n') // CR LF pair
+      p1++;
+  }
+  if (p1 < m_length)
+    lines.push_back(Mid(p1));
+  return lines;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 PStringStream::Buffer::Buffer(PStringStream & str, PINDEX size)
@@ -3183,11 +3760,40 @@ void PStringToString::ReadFrom(istream & strm)
 
 
 void PStringToString::FromString(const PString & str)
+{
+  FromString(PStringView(str));
+}
+
+
+void PStringToString::FromString(const PStringView & str)
 {
   RemoveAll();
 
-  PStringStream strm(str);
-  strm >> *this;
+  // Same as ReadFrom(), but only the keys and values are materialised
+  PINDEX start = 0;
+  while (start < str.GetLength()) {
+    PINDEX end = str.Find('\n', start);
+    if (end == P_MAX_INDEX)
+      end = str.GetLength();
+
+    PStringView line = str.Mid(start, end - start);
+    start = end + 1;
+
+    if (!line.IsEmpty() && line[line.GetLength()-1] == '\r')
+      line = line.Left(line.GetLength()-1);
+    if (line.IsEmpty())
+      continue;
+
+    PStringView key, value;
+    line.Split("=", key, value, PString::SplitDefaultToBefore);
+
+    PString keyStr(key);
+    PString * ptr = GetAt(keyStr);
+    if (ptr != NULL)
+      *ptr += '\n' + PString(value);
+    else
+      SetAt(keyStr, PString(value));
+  }
 }
 
 
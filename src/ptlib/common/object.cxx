@@ -1529,6 +1529,523 @@ namespace PProfiling
   }
 
 
+  class EscapedHTML
+  {
+    private:
+      const std::string m_str;
+
+    public:
+      EscapedHTML(const std::string & str)
+        : m_str(str)
+      {
+      }
+
+    friend ostream & operator<<(ostream & strm, const EscapedHTML & e)
+    {
+      for (size_t i = 0; i < e.m_str.length(); ++i) {
+        switch (e.m_str[i]) {
+          case '"':
+            strm << "&quot;";
+            break;
+          case '<':
+            strm << "&lt;";
+            break;
+          case '>':
+            strm << "&gt;";
+            break;
+          case '&':
+            strm << "&amp;";
+            break;
+          default:
+            strm << e.m_str[i];
+        }
+      }
+      return strm;
+    }
+  };
+
+
+  /// /////////////////////////////////////////////////////////////////
+
+  static atomic<bool> s_lockProfilingEnabled(getenv("PTLIB_LOCK_PROFILING") != NULL);
+  static atomic<uint64_t> s_lockProfilingStart(GetCycles());
+  static atomic<uint64_t> s_lockProfilingDuration(0);
+  static const uint64_t s_lockContendedCycles = gs_Frequency/1000000; // One microsecond
+
+
+  struct LockLocation
+  {
+    const char * m_file;
+    unsigned     m_line;
+    std::string  m_extra;
+
+    LockLocation(const PDebugLocation & location)
+      : m_file(location.m_file)
+      , m_line(location.m_line)
+      , m_extra(location.m_extra != NULL ? location.m_extra : "")
+    {
+    }
+
+    bool operator<(const LockLocation & other) const
+    {
+      if (m_file != other.m_file)
+        return m_file < other.m_file;
+      if (m_line != other.m_line)
+        return m_line < other.m_line;
+      return m_extra < other.m_extra;
+    }
+
+    std::string GetName() const
+    {
+      std::stringstream strm;
+      PDebugLocation(m_file, m_line, m_extra.empty() ? NULL : m_extra.c_str()).PrintOn(strm);
+      std::string name = strm.str();
+      return name.empty() ? "(uninstrumented)" : name; // Plain Wait() or PWaitAndSignal
+    }
+  };
+
+
+  struct LockHistogramCounters
+  {
+    atomic<uint64_t> m_count[LockHistogram::NumBuckets];
+
+    void Add(uint64_t cycles)
+    {
+      ++m_count[LockHistogram::GetBucket(cycles)];
+    }
+
+    void Get(LockHistogram & histogram) const
+    {
+      for (unsigned i = 0; i < LockHistogram::NumBuckets; ++i)
+        histogram.m_count[i] = m_count[i];
+    }
+
+    void Reset()
+    {
+      for (unsigned i = 0; i < LockHistogram::NumBuckets; ++i)
+        m_count[i] = 0;
+    }
+  };
+
+
+  struct LockStatistics
+  {
+    LockLocation          m_site;
+    atomic<uint64_t>      m_acquisitions;
+    atomic<uint64_t>      m_contended;
+    atomic<uint64_t>      m_waitCycles;
+    atomic<uint64_t>      m_heldCycles;
+    LockHistogramCounters m_waitHistogram;
+    LockHistogramCounters m_heldHistogram;
+
+    // Only touched on contention, so a mutex is fine
+    typedef std::map<LockLocation, LockWaiter> WaiterMap;
+    WaiterMap        m_waiters;
+    PCriticalSection m_waitersMutex;
+
+    LockStatistics(const LockLocation & site)
+      : m_site(site)
+    {
+    }
+
+    void AddWaiter(const PDebugLocation & caller, uint64_t waitCycles)
+    {
+      LockLocation location(caller);
+      PWaitAndSignal lock(m_waitersMutex);
+      LockWaiter & waiter = m_waiters[location];
+      ++waiter.m_count;
+      waiter.m_waitCycles += waitCycles;
+    }
+
+    void Get(LockSite & site)
+    {
+      site.m_acquisitions = m_acquisitions;
+      site.m_contended = m_contended;
+      site.m_waitCycles = m_waitCycles;
+      site.m_heldCycles = m_heldCycles;
+      m_waitHistogram.Get(site.m_waitHistogram);
+      m_heldHistogram.Get(site.m_heldHistogram);
+
+      PWaitAndSignal lock(m_waitersMutex);
+      for (WaiterMap::const_iterator it = m_waiters.begin(); it != m_waiters.end(); ++it) {
+        LockWaiter & waiter = site.m_waiters[it->first.GetName()];
+        waiter.m_count += it->second.m_count;
+        waiter.m_waitCycles += it->second.m_waitCycles;
+      }
+    }
+
+    void Reset()
+    {
+      m_acquisitions = 0;
+      m_contended = 0;
+      m_waitCycles = 0;
+      m_heldCycles = 0;
+      m_waitHistogram.Reset();
+      m_heldHistogram.Reset();
+
+      PWaitAndSignal lock(m_waitersMutex);
+      m_waiters.clear();
+    }
+  };
+
+
+  class LockRegistry
+  {
+    typedef std::map<LockLocation, LockStatistics*> StatisticsMap;
+    StatisticsMap    m_statistics;
+    PCriticalSection m_mutex;
+
+
+  public:
+    ~LockRegistry()
+    {
+      s_lockProfilingEnabled = false;
+      for (StatisticsMap::const_iterator it = m_statistics.begin(); it != m_statistics.end(); ++it)
+        delete it->second;
+    }
+
+
+    LockStatistics * Get(const PDebugLocation & site)
+    {
+      LockLocation location(site);
+      PWaitAndSignal lock(m_mutex);
+      StatisticsMap::iterator it = m_statistics.find(location);
+      if (it == m_statistics.end())
+        it = m_statistics.insert(make_pair(location, new LockStatistics(location))).first;
+      return it->second;
+    }
+
+
+    void Reset()
+    {
+      PWaitAndSignal lock(m_mutex);
+      for (StatisticsMap::const_iterator it = m_statistics.begin(); it != m_statistics.end(); ++it)
+        it->second->Reset();
+    }
+
+
+    void Analyse(LockSiteMap & sites)
+    {
+      PWaitAndSignal lock(m_mutex);
+      for (StatisticsMap::const_iterator it = m_statistics.begin(); it != m_statistics.end(); ++it) {
+        LockSite site;
+        it->second->Get(site);
+        if (site.m_acquisitions > 0)
+          sites[it->first.GetName()].Merge(site);
+      }
+    }
+  };
+
+
+  static LockRegistry & GetLockRegistry()
+  {
+    static LockRegistry s_lockRegistry;
+    return s_lockRegistry;
+  }
+
+
+  LockHistogram::LockHistogram()
+  {
+    memset(m_count, 0, sizeof(m_count));
+  }
+
+
+  unsigned LockHistogram::GetBucket(uint64_t cycles)
+  {
+    unsigned bucket = 0;
+    while (cycles >= 4 && bucket < NumBuckets-1) {
+      cycles >>= 2;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+
+  LockSite::LockSite()
+    : m_acquisitions(0)
+    , m_contended(0)
+    , m_waitCycles(0)
+    , m_heldCycles(0)
+  {
+  }
+
+
+  void LockSite::Merge(const LockSite & other)
+  {
+    m_acquisitions += other.m_acquisitions;
+    m_contended += other.m_contended;
+    m_waitCycles += other.m_waitCycles;
+    m_heldCycles += other.m_heldCycles;
+    for (unsigned i = 0; i < LockHistogram::NumBuckets; ++i) {
+      m_waitHistogram.m_count[i] += other.m_waitHistogram.m_count[i];
+      m_heldHistogram.m_count[i] += other.m_heldHistogram.m_count[i];
+    }
+    for (LockWaiterMap::const_iterator it = other.m_waiters.begin(); it != other.m_waiters.end(); ++it) {
+      LockWaiter & waiter = m_waiters[it->first];
+      waiter.m_count += it->second.m_count;
+      waiter.m_waitCycles += it->second.m_waitCycles;
+    }
+  }
+
+
+  class LockTime
+  {
+      int64_t m_nanoseconds;
+    public:
+      LockTime(uint64_t cycles)
+        : m_nanoseconds(CyclesToNanoseconds(cycles))
+      {
+      }
+
+    friend ostream & operator<<(ostream & strm, const LockTime & t)
+    {
+      std::stringstream str;
+      if (t.m_nanoseconds < 10000)
+        str << t.m_nanoseconds << "ns";
+      else if (t.m_nanoseconds < 10000000)
+        str << t.m_nanoseconds/1000 << "us";
+      else if (t.m_nanoseconds < 10000000000LL)
+        str << t.m_nanoseconds/1000000 << "ms";
+      else
+        str << fixed << setprecision(3) << t.m_nanoseconds/1e9 << 's';
+      return strm << str.str();
+    }
+  };
+
+
+  static uint64_t LockHistogramLimit(unsigned bucket)
+  {
+    return (uint64_t)1 << (2*(bucket+1));
+  }
+
+
+  static float LockPercentage(uint64_t v1, uint64_t v2)
+  {
+    return v2 > 0 ? 100.0f * v1 / v2 : 0.0f;
+  }
+
+
+  typedef std::multimap<uint64_t, LockSiteMap::const_iterator, std::greater<uint64_t> > LockSitesByWait;
+  typedef std::multimap<uint64_t, LockWaiterMap::const_iterator, std::greater<uint64_t> > LockWaitersByWait;
+  static const size_t MaxLockWaitersShown = 5;
+
+
+  static void SortLockSites(const LockSiteMap & sites, LockSitesByWait & sorted)
+  {
+    for (LockSiteMap::const_iterator it = sites.begin(); it != sites.end(); ++it)
+      sorted.insert(make_pair(it->second.m_waitCycles, it));
+  }
+
+
+  static void SortLockWaiters(const LockWaiterMap & waiters, LockWaitersByWait & sorted)
+  {
+    for (LockWaiterMap::const_iterator it = waiters.begin(); it != waiters.end(); ++it)
+      sorted.insert(make_pair(it->second.m_waitCycles, it));
+  }
+
+
+  static void LockHistogramToText(ostream & strm, const char * title, const LockHistogram & histogram)
+  {
+    strm << "         " << title << ':';
+    for (unsigned i = 0; i < LockHistogram::NumBuckets; ++i) {
+      if (histogram.m_count[i] > 0) {
+        if (i < LockHistogram::NumBuckets-1)
+          strm << " <" << LockTime(LockHistogramLimit(i));
+        else
+          strm << " >=" << LockTime(LockHistogramLimit(i-1));
+        strm << '=' << histogram.m_count[i];
+      }
+    }
+    strm << '\n';
+  }
+
+
+  void LockAnalysis::ToText(ostream & strm) const
+  {
+    strm << "Lock profile:"
+            " sites=" << m_sites.size() << ","
+            " time="  << left << fixed << setprecision(3) << CyclesToSeconds(m_durationCycles) << '\n';
+
+    LockSitesByWait sorted;
+    SortLockSites(m_sites, sorted);
+    for (LockSitesByWait::const_iterator it = sorted.begin(); it != sorted.end(); ++it) {
+      const LockSite & site = it->second->second;
+      strm << "   " << it->second->first << '\n'
+           << "      count=" << site.m_acquisitions
+           << " contended=" << site.m_contended
+           << " (" << setprecision(2) << LockPercentage(site.m_contended, site.m_acquisitions) << "%)"
+           << " wait=" << LockTime(site.m_waitCycles)
+           << " avg=" << LockTime(site.m_waitCycles/site.m_acquisitions)
+           << " held=" << LockTime(site.m_heldCycles)
+           << " avg=" << LockTime(site.m_heldCycles/site.m_acquisitions)
+           << '\n';
+      LockHistogramToText(strm, "wait", site.m_waitHistogram);
+      LockHistogramToText(strm, "held", site.m_heldHistogram);
+
+      LockWaitersByWait waiters;
+      SortLockWaiters(site.m_waiters, waiters);
+      size_t count = 0;
+      for (LockWaitersByWait::const_iterator waiter = waiters.begin(); waiter != waiters.end() && count < MaxLockWaitersShown; ++waiter, ++count)
+        strm << "         waiter " << waiter->second->first
+             << " count=" << waiter->second->second.m_count
+             << " wait=" << LockTime(waiter->second->second.m_waitCycles)
+             << '\n';
+    }
+  }
+
+
+  static void LockHistogramToHTML(ostream & strm, const char * title, const LockHistogram & histogram)
+  {
+    strm << "<tr><th align=left>" << title;
+    for (unsigned i = 0; i < LockHistogram::NumBuckets; ++i) {
+      strm << "<td align=center>";
+      if (histogram.m_count[i] > 0)
+        strm << histogram.m_count[i];
+      else
+        strm << "&nbsp;";
+    }
+  }
+
+
+  void LockAnalysis::ToHTML(ostream & strm) const
+  {
+    strm << "<H2>Lock profile</H2>"
+            "<table border=1 cellspacing=1 cellpadding=12>"
+            "<tr>"
+            "<th>Sites<th>Time"
+            "<tr>"
+            "<td align=center>" << m_sites.size()
+         << "<td align=center>" << fixed << setprecision(3) << CyclesToSeconds(m_durationCycles)
+         << "</table>"
+            "<p>"
+            "<table width=\"100%\" border=1 cellspacing=0 cellpadding=8>"
+            "<tr><th align=left>Mutex"
+                "<th width=\"5%\">Count"
+                "<th width=\"5%\">Contended"
+                "<th width=\"5%\" align=right nowrap>Contended %"
+                "<th width=\"5%\" nowrap>Total Wait"
+                "<th width=\"5%\" nowrap>Average Wait"
+                "<th width=\"5%\" nowrap>Total Held"
+                "<th width=\"5%\" nowrap>Average Held";
+
+    LockSitesByWait sorted;
+    SortLockSites(m_sites, sorted);
+    for (LockSitesByWait::const_iterator it = sorted.begin(); it != sorted.end(); ++it) {
+      const LockSite & site = it->second->second;
+      strm << "<tr>"
+              "<td>" << EscapedHTML(it->second->first)
+           << "<td width=\"5%\" align=center>" << site.m_acquisitions
+           << "<td width=\"5%\" align=center>" << site.m_contended
+           << "<td width=\"5%\" align=right>" << setprecision(2) << LockPercentage(site.m_contended, site.m_acquisitions) << '%'
+           << "<td width=\"5%\" align=center nowrap>" << LockTime(site.m_waitCycles)
+           << "<td width=\"5%\" align=center nowrap>" << LockTime(site.m_waitCycles/site.m_acquisitions)
+           << "<td width=\"5%\" align=center nowrap>" << LockTime(site.m_heldCycles)
+           << "<td width=\"5%\" align=center nowrap>" << LockTime(site.m_heldCycles/site.m_acquisitions)
+           << "<tr><td>&nbsp;<td colspan=\"9999\">"
+              "<table border=1 cellspacing=1 cellpadding=4 width=100%>"
+              "<tr><th>&nbsp;";
+      for (unsigned i = 0; i < LockHistogram::NumBuckets-1; ++i)
+        strm << "<th nowrap>&lt;" << LockTime(LockHistogramLimit(i));
+      strm << "<th nowrap>&gt;=" << LockTime(LockHistogramLimit(LockHistogram::NumBuckets-2));
+      LockHistogramToHTML(strm, "Wait", site.m_waitHistogram);
+      LockHistogramToHTML(strm, "Held", site.m_heldHistogram);
+      strm << "</table>";
+
+      if (!site.m_waiters.empty()) {
+        strm << "<tr><td>&nbsp;<td colspan=\"9999\">"
+                "<table border=1 cellspacing=1 cellpadding=4 width=100%>"
+                "<th align=left>Waiter"
+                "<th>Count"
+                "<th>Total Wait";
+        LockWaitersByWait waiters;
+        SortLockWaiters(site.m_waiters, waiters);
+        size_t count = 0;
+        for (LockWaitersByWait::const_iterator waiter = waiters.begin(); waiter != waiters.end() && count < MaxLockWaitersShown; ++waiter, ++count)
+          strm << "<tr>"
+                  "<td>" << EscapedHTML(waiter->second->first)
+               << "<td align=center>" << waiter->second->second.m_count
+               << "<td align=center nowrap>" << LockTime(waiter->second->second.m_waitCycles);
+        strm << "</table>";
+      }
+    }
+    strm << "</table>";
+  }
+
+
+  void EnableLockProfiling(bool enab)
+  {
+    if (s_lockProfilingEnabled.exchange(enab) == enab)
+      return;
+
+    if (enab)
+      s_lockProfilingStart = GetCycles();
+    else
+      s_lockProfilingDuration += GetCycles() - s_lockProfilingStart;
+  }
+
+
+  bool IsLockProfilingEnabled()
+  {
+    return s_lockProfilingEnabled;
+  }
+
+
+  void ResetLockProfiling()
+  {
+    GetLockRegistry().Reset();
+    s_lockProfilingStart = GetCycles();
+    s_lockProfilingDuration = 0;
+  }
+
+
+  void AnalyseLocks(LockAnalysis & analysis)
+  {
+    analysis.m_durationCycles = s_lockProfilingDuration;
+    if (s_lockProfilingEnabled)
+      analysis.m_durationCycles += GetCycles() - s_lockProfilingStart;
+
+    GetLockRegistry().Analyse(analysis.m_sites);
+  }
+
+
+  void AnalyseLocks(ostream & strm, bool html)
+  {
+    LockAnalysis analysis;
+    AnalyseLocks(analysis);
+
+    if (html)
+      analysis.ToHTML(strm);
+    else
+      analysis.ToText(strm);
+  }
+
+
+  LockStatistics * GetLockStatistics(const PDebugLocation & site)
+  {
+    return GetLockRegistry().Get(site);
+  }
+
+
+  void RecordLockAcquired(LockStatistics & stats, uint64_t waitCycles, const PDebugLocation & caller)
+  {
+    ++stats.m_acquisitions;
+    stats.m_waitCycles += waitCycles;
+    stats.m_waitHistogram.Add(waitCycles);
+
+    if (waitCycles > s_lockContendedCycles) {
+      ++stats.m_contended;
+      stats.AddWaiter(caller, waitCycles);
+    }
+  }
+
+
+  void RecordLockReleased(LockStatistics & stats, uint64_t heldCycles)
+  {
+    stats.m_heldCycles += heldCycles;
+    stats.m_heldHistogram.Add(heldCycles);
+  }
+
+
 
 
 #if P_PROFILING
@@ -1812,6 +2329,8 @@ namespace PProfiling
       thrd = thrd->m_link;
       delete del;
     }
+
+    ResetLockProfiling();
   }
 
 
@@ -1953,43 +2472,10 @@ namespace PProfiling
         strm << '\n';
       }
     }
-  }
-
-
-  class EscapedHTML
-  {
-    private:
-      const std::string m_str;
-
-    public:
-      EscapedHTML(const std::string & str)
-        : m_str(str)
-      {
-      }
 
-    friend ostream & operator<<(ostream & strm, const EscapedHTML & e)
-    {
-      for (size_t i = 0; i < e.m_str.length(); ++i) {
-        switch (e.m_str[i]) {
-          case '"':
-            strm << "&quot;";
-            break;
-          case '<':
-            strm << "&lt;";
-            break;
-          case '>':
-            strm << "&gt;";
-            break;
-          case '&':
-            strm << "&amp;";
-            break;
-          default:
-            strm << e.m_str[i];
-        }
-      }
-      return strm;
-    }
-  };
+    if (!m_locks.m_sites.empty())
+      m_locks.ToText(strm);
+  }
 
 
   void Analysis::ToHTML(ostream & strm) const
@@ -2056,6 +2542,9 @@ namespace PProfiling
       }
     }
     strm << "</table>";
+
+    if (!m_locks.m_sites.empty())
+      m_locks.ToHTML(strm);
   }
 
 
@@ -2160,6 +2649,8 @@ namespace PProfiling
 
     for (ThreadByID::iterator thrd = analysis.m_threadByID.begin(); thrd != analysis.m_threadByID.end(); ++thrd)
       analysis.m_threadByUsage.insert(make_pair(Percentage(thrd->second.m_userCPU, thrd->second.m_realTime), thrd->second));
+
+    AnalyseLocks(analysis.m_locks);
   }
 
 
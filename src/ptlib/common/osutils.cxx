@@ -41,13 +41,18 @@
 #include <ptlib/svcproc.h>
 #include <ptlib/pluginmgr.h>
 #include <ptlib/syslog.h>
+#include <ptlib/cpufeatures.h>
 #include <ptclib/random.h>
 #include "../../../version.h"
 #include "../../../revision.h"
 
 #ifdef _WIN32
   #include <ptlib/msos/ptlib/debstrm.h>
-#elif defined(P_MACOSX)
+#else
+  #include <sys/uio.h>
+#endif
+
+#if defined(P_MACOSX)
   #include <mach-o/dyld.h>
   #include <ptlib/videoio.h>
 #endif
@@ -57,6 +62,12 @@
 
 static const char DefaultRollOverPattern[] = "_yyyy_MM_dd_hh_mm";
 
+#ifdef P_THREAD_LOCAL
+  // Cache for PThread::Current(), set when thread starts or is first looked up
+  static P_THREAD_LOCAL PThread * s_currentThread;
+#endif
+
+
 class PExternalThread : public PThread
 {
   PCLASSINFO(PExternalThread, PThread);
@@ -203,6 +214,98 @@ public:
   unsigned         m_lastRotate;
   atomic<PINDEX>   m_maxLength;
 
+  /* Per-thread ring buffer of formatted trace records, for the AsynchronousOutput
+     option. Only the owner thread writes m_head, only the writer thread (or
+     whoever holds the trace mutex) writes m_tail, so no lock is needed. */
+  struct AsyncBuffer
+  {
+    AsyncBuffer(size_t size)
+      : m_data(new char[size])
+      , m_size(size)
+      , m_head(0)
+      , m_tail(0)
+      , m_dropped(0)
+      , m_orphaned(false)
+    { }
+
+    ~AsyncBuffer() { delete [] m_data; }
+
+    size_t GetUsed() const { return m_head - m_tail; }
+
+    // Write the record and optional line terminator, or nothing at all if no room
+    bool Write(const char * data, size_t length, bool newLine)
+    {
+      size_t head = m_head;
+      size_t total = newLine ? length+1 : length;
+      if (m_size - (head - m_tail) < total) {
+        ++m_dropped;
+        return false;
+      }
+
+      size_t offset = head % m_size;
+      size_t chunk = std::min(length, m_size - offset);
+      memcpy(m_data + offset, data, chunk);
+      memcpy(m_data, data + chunk, length - chunk);
+      if (newLine)
+        m_data[(head + length) % m_size] = '\n';
+
+      m_head = head + total;
+      return true;
+    }
+
+    char           * m_data;
+    size_t           m_size;
+    atomic<size_t>   m_head;
+    atomic<size_t>   m_tail;
+    atomic<unsigned> m_dropped;
+    atomic<bool>     m_orphaned;  // Thread has gone, delete when drained
+  };
+
+  // Contiguous run of data in an AsyncBuffer, for gathered output
+  struct AsyncPiece
+  {
+    size_t       m_buffer;
+    const char * m_data;
+    size_t       m_length;
+  };
+
+  // Thread local storage only holds a reference, the writer owns the buffer
+  struct AsyncBufferRef
+  {
+    AsyncBufferRef() : m_buffer(NULL) { }
+    ~AsyncBufferRef() { if (m_buffer != NULL) m_buffer->m_orphaned = true; }
+    AsyncBuffer * m_buffer;
+  };
+  PThreadLocalStorage<AsyncBufferRef> m_asyncStorage;
+
+  typedef std::vector<AsyncBuffer *> AsyncBufferList;
+  AsyncBufferList  m_asyncBuffers;
+  PCriticalSection m_asyncMutex;
+  atomic<PINDEX>   m_asyncBufferSize;
+  PSyncPoint       m_asyncSignal;
+  PThread        * m_asyncThread;
+  atomic<bool>     m_asyncStarted;
+  atomic<bool>     m_asyncStopped;
+  uint64_t         m_asyncDropCount;
+
+  /* Per-thread state for the BinaryFormat option. Sites and class names are
+     interned per thread, using a process wide counter for identifiers, so
+     no lock is needed. Everything is redefined when a new file is started. */
+  struct BinaryState
+  {
+    BinaryState() : m_generation(0) { }
+    unsigned m_generation;
+    typedef std::map<std::pair<const char *, int>, uint32_t> SiteMap;
+    SiteMap m_sites;
+    typedef std::map<const std::type_info *, uint32_t> ClassMap;
+    ClassMap m_classes;
+  };
+  PThreadLocalStorage<BinaryState> m_binaryStorage;
+  atomic<unsigned> m_binaryGeneration;
+  atomic<unsigned> m_binaryNextId;
+  atomic<bool>     m_binaryHeaderNeeded;
+  atomic<bool>     m_binaryStream;      // Only output binary to files
+
 
 #if defined(_WIN32)
   CRITICAL_SECTION mutex;
@@ -237,32 +340,58 @@ PTHREAD_MUTEX_RECURSIVE_NP
   
   struct Context : PObject
   {
-    Context(unsigned level, const char * fileName, int lineNum, const PObject * instance, const char * module)
+    Context(unsigned level, const char * fileName, int lineNum, const PObject * instance, const char * module, bool binary)
       : m_level(level)
-      , m_fileName(fileName)
+      , m_rawFileName(fileName)
       , m_lineNum(lineNum)
       , m_objectAddress(instance)
+      , m_objectType(instance ? &typeid(*instance) : NULL)
       , m_threadAddress(PThread::Current())
-      , m_threadName(m_threadAddress ? m_threadAddress->GetThreadName() : "")
       , m_contextIdentifier(instance ? instance->GetTraceContextIdentifier() : 0)
-      , m_module(module)
+      , m_rawModule(module)
       , m_tick(PTimer::Tick())
       , m_blockIndentLevel(0)
     {
       if (m_contextIdentifier == 0 && m_threadAddress != NULL)
         m_contextIdentifier = m_threadAddress->GetTraceContextIdentifier();
-      if (instance)
-        m_objectClass = instance->GetClassName();
+
+      // Binary output does not need any of the strings formatted now
+      if (!binary) {
+        m_fileName = fileName;
+        if (m_threadAddress != NULL)
+          m_threadName = m_threadAddress->GetThreadName();
+        if (m_objectType != NULL)
+          m_objectClass = PObject::GetClassName(*m_objectType);
+        m_module = module;
+      }
+    }
+
+    // Used when decoding binary output
+    Context()
+      : m_level(0)
+      , m_rawFileName(NULL)
+      , m_lineNum(0)
+      , m_objectAddress(NULL)
+      , m_objectType(NULL)
+      , m_threadAddress(NULL)
+      , m_contextIdentifier(0)
+      , m_rawModule(NULL)
+      , m_dateTime(0, 0)
+      , m_blockIndentLevel(0)
+    {
     }
 
     unsigned      m_level;
+    const char  * m_rawFileName;
     PFilePath     m_fileName;
     int           m_lineNum;
     void  const * m_objectAddress;
+    const std::type_info * m_objectType;
     PString       m_objectClass;
     PThread     * m_threadAddress;
     PString       m_threadName;
     unsigned      m_contextIdentifier;
+    const char  * m_rawModule;
     PString       m_module;
     PTime         m_dateTime;
     PTimeInterval m_tick;
@@ -285,6 +414,15 @@ PTHREAD_MUTEX_RECURSIVE_NP
     , m_rolloverPattern(DefaultRollOverPattern)
     , m_lastRotate(0)
     , m_maxLength(10000)
+    , m_asyncBufferSize(65536)
+    , m_asyncThread(NULL)
+    , m_asyncStarted(false)
+    , m_asyncStopped(false)
+    , m_asyncDropCount(0)
+    , m_binaryGeneration(1)
+    , m_binaryNextId(0)
+    , m_binaryHeaderNeeded(true)
+    , m_binaryStream(false)
   {
     InitMutex();
   }
@@ -322,6 +460,10 @@ PTHREAD_MUTEX_RECURSIVE_NP
 
   ~PTraceInfo()
   {
+    /* Note the async buffers are not deleted, thread local storage for
+       threads still running may yet refer to them. */
+    StopAsyncWriter();
+
     if (m_stream != &cerr && m_stream != &cout)
       delete m_stream;
   }
@@ -345,9 +487,14 @@ PTHREAD_MUTEX_RECURSIVE_NP
 
     Lock();
 
+    // Anything queued was destined for the old stream
+    DrainAsyncBuffers();
+
     if (m_stream != &cerr && m_stream != &cout)
       oldStream = m_stream;
     m_stream = newStream;
+    m_binaryHeaderNeeded = true;
+    m_binaryStream = dynamic_cast<PFile *>(newStream) != NULL;
 
     Unlock();
 
@@ -452,7 +599,7 @@ PTHREAD_MUTEX_RECURSIVE_NP
       if ((m_options & HasFilePermissions) != 0)
         permissions.FromBits((m_options&FilePermissionMask)>>FilePermissionShift);
 
-      PFile * traceOutput = new PTextFile();
+      PFile * traceOutput = (m_options & BinaryFormat) != 0 ? new PFile() : new PTextFile();
       if (traceOutput->Open(fn, PFile::WriteOnly, options, permissions)) {
         traceOutput->SetPosition(0, PFile::End);
         SetStream(traceOutput);
@@ -520,9 +667,27 @@ PTHREAD_MUTEX_RECURSIVE_NP
   void InternalInitialise(unsigned level, const char * filename, const char * rolloverPattern, unsigned options);
   std::ostream & InternalBegin(unsigned level, const char * fileName, int lineNum, const PObject * instance, const char * module);
   std::ostream & InternalEnd(std::ostream & stream);
+  void RotateIfRequired();
+  bool AsyncOutput(const char * data, size_t length, bool newLine);
+  void FormatText(Context & context, ostream & output, unsigned options, const PTimeInterval & startTick) const;
+  void OutputBinary(const Context & context);
+  bool DecodeBinary(istream & input, ostream & output, unsigned options) const;
+  void AsyncWriterMain();
+  void DrainAsyncBuffers();
+  void StopAsyncWriter();
 };
 
 
+#ifdef P_THREAD_LOCAL
+  /* Cache of this threads entries in PTraceInfo::m_asyncStorage & m_binaryStorage,
+     as getting them from PThreadLocalStorage takes a process wide mutex and a map
+     lookup, on every record. Cleared in PProcess::InternalThreadEnded() and
+     ~PThread() as the storage goes with the PThread object. */
+  static P_THREAD_LOCAL PTraceInfo::AsyncBufferRef * s_asyncBufferRef;
+  static P_THREAD_LOCAL PTraceInfo::BinaryState * s_binaryState;
+#endif
+
+
 void PTrace::SetStream(ostream * s)
 {
   PTraceInfo & info = PTraceInfo::Instance();
@@ -564,7 +729,9 @@ static std::string OptionsToString(unsigned options)
        << PlusMinus(options, PTrace::Blocks) << "block "
        << PlusMinus(options, PTrace::AppendToFile) << "append "
        << PlusMinus(options, PTrace::SingleLine) << "single "
-       << PlusMinus(options, PTrace::OutputJSON) << "json ";
+       << PlusMinus(options, PTrace::OutputJSON) << "json "
+       << PlusMinus(options, PTrace::AsynchronousOutput) << "async "
+       << PlusMinus(options, PTrace::BinaryFormat) << "binary ";
 
   switch (options&PTrace::RotateLogMask) {
     case PTrace::RotateDaily :
@@ -675,6 +842,10 @@ static unsigned OptionsFromString(const PCaselessString & optStr, unsigned optio
       operation(options, PTrace::SingleLine);
     else if (optStr.NumCompare("json", P_MAX_INDEX, pos) == PObject::EqualTo)
       operation(options, PTrace::OutputJSON);
+    else if (optStr.NumCompare("async", P_MAX_INDEX, pos) == PObject::EqualTo)
+      operation(options, PTrace::AsynchronousOutput);
+    else if (optStr.NumCompare("binary", P_MAX_INDEX, pos) == PObject::EqualTo)
+      operation(options, PTrace::BinaryFormat);
     else if (optStr.NumCompare("gmt", P_MAX_INDEX, pos) == PObject::EqualTo)
       operation(options, PTrace::GMTTime);
     else if (optStr.NumCompare("utc", P_MAX_INDEX, pos) == PObject::EqualTo)
@@ -804,6 +975,28 @@ PINDEX PTrace::GetMaxLength()
 }
 
 
+void PTrace::SetAsyncBufferSize(PINDEX size)
+{
+  PTraceInfo::Instance().m_asyncBufferSize = std::max(PINDEX(1024), size);
+}
+
+
+PINDEX PTrace::GetAsyncBufferSize()
+{
+  return PTraceInfo::Instance().m_asyncBufferSize;
+}
+
+
+uint64_t PTrace::GetAsyncDropCount()
+{
+  PTraceInfo & info = PTraceInfo::Instance();
+  info.Lock();
+  uint64_t count = info.m_asyncDropCount;
+  info.Unlock();
+  return count;
+}
+
+
 void PTrace::SetOptionsByName(const char * options)
 {
   SetOptions(OptionsFromString(options, GetOptions()));
@@ -875,11 +1068,22 @@ ostream & PTraceInfo::InternalBegin(unsigned level, const char * fileName, int l
   if (contexts == NULL)
     return *GetStream();
 
-  Context * context = new Context(level, fileName, lineNum, instance, module);
+  Context * context = new Context(level, fileName, lineNum, instance, module, HasOption(BinaryFormat));
   contexts->Push(context);
 
-  Lock();
+  // When asynchronous, the writer thread does the rotation
+  if (!HasOption(AsynchronousOutput)) {
+    Lock();
+    RotateIfRequired();
+    Unlock();
+  }
 
+  return context->m_stream;
+}
+
+
+void PTraceInfo::RotateIfRequired()
+{
   if (!m_filename.IsEmpty() && HasOption(RotateLogMask)) {
     unsigned rotateVal = GetRotateVal(m_options);
     if (rotateVal != m_lastRotate || GetStream() == &cerr) {
@@ -887,10 +1091,197 @@ ostream & PTraceInfo::InternalBegin(unsigned level, const char * fileName, int l
       OpenTraceFile(m_filename, true);
     }
   }
+}
 
-  Unlock();
 
-  return context->m_stream;
+bool PTraceInfo::AsyncOutput(const char * data, size_t length, bool newLine)
+{
+  if (m_asyncStopped)
+    return false;
+
+#ifdef P_THREAD_LOCAL
+  AsyncBufferRef * ref = s_asyncBufferRef;
+  if (ref == NULL)
+    s_asyncBufferRef = ref = m_asyncStorage.Get();
+#else
+  AsyncBufferRef * ref = m_asyncStorage.Get();
+#endif
+  if (ref == NULL)
+    return false;
+
+  if (ref->m_buffer == NULL) {
+    ref->m_buffer = new AsyncBuffer(m_asyncBufferSize);
+    m_asyncMutex.Wait();
+    m_asyncBuffers.push_back(ref->m_buffer);
+    m_asyncMutex.Signal();
+
+    /* Set flag first, as creating the thread may itself trace and get back
+       here, the record just sits in the buffer until the thread starts. */
+    if (!m_asyncStarted.exchange(true))
+      m_asyncThread = new PThreadObj<PTraceInfo>(*this, &PTraceInfo::AsyncWriterMain, false, "PTrace Writer");
+  }
+
+  AsyncBuffer & buffer = *ref->m_buffer;
+  if (buffer.Write(data, length, newLine) && buffer.GetUsed() > buffer.m_size/2)
+    m_asyncSignal.Signal(); // Getting full, don't wait for the next interval
+
+  return true;
+}
+
+
+void PTraceInfo::AsyncWriterMain()
+{
+  while (!m_asyncStopped) {
+    m_asyncSignal.Wait(100);
+
+    Lock();
+    RotateIfRequired();
+    DrainAsyncBuffers();
+    Unlock();
+  }
+}
+
+
+void PTraceInfo::DrainAsyncBuffers()
+{
+  // Assumes Lock() already called, which also prevents two threads draining at once
+
+  m_asyncMutex.Wait();
+  AsyncBufferList buffers = m_asyncBuffers;
+  m_asyncMutex.Signal();
+
+  if (buffers.empty())
+    return;
+
+  // Up to two pieces per buffer, as data may wrap around the end of the buffer
+  std::vector<AsyncPiece> pieces;
+  pieces.reserve(buffers.size()*2);
+
+  std::vector<size_t> tails(buffers.size());
+  std::vector<size_t> lengths(buffers.size());
+
+  unsigned dropped = 0;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    AsyncBuffer & buffer = *buffers[i];
+    dropped += buffer.m_dropped.exchange(0);
+
+    size_t tail = tails[i] = buffer.m_tail;
+    size_t length = lengths[i] = buffer.m_head - tail;
+    if (length == 0)
+      continue;
+
+    size_t offset = tail % buffer.m_size;
+    size_t chunk = std::min(length, buffer.m_size - offset);
+    AsyncPiece piece = { i, buffer.m_data + offset, chunk };
+    pieces.push_back(piece);
+    if (chunk < length) {
+      AsyncPiece wrapped = { i, buffer.m_data, length - chunk };
+      pieces.push_back(wrapped);
+    }
+  }
+
+  // Without a stream the data is discarded, so consumed as if written
+  std::vector<size_t> written(lengths);
+
+  if (m_stream != NULL && !pieces.empty()) {
+    int fd = -1;
+#ifndef _WIN32
+    if (m_stream == &cerr)
+      fd = STDERR_FILENO;
+    else if (m_stream == &cout)
+      fd = STDOUT_FILENO;
+    else {
+      PFile * file = dynamic_cast<PFile *>(m_stream);
+      if (file != NULL && file->IsOpen())
+        fd = (int)file->GetHandle();
+    }
+#endif
+
+    if (fd < 0) {
+      for (size_t i = 0; i < pieces.size(); ++i)
+        m_stream->write(pieces[i].m_data, pieces[i].m_length);
+      m_stream->flush();
+    }
+#ifndef _WIN32
+    else {
+      // Anything written directly to the stream, e.g. log header, must go first
+      m_stream->flush();
+
+      std::vector<struct iovec> iov(pieces.size());
+      for (size_t i = 0; i < pieces.size(); ++i) {
+        iov[i].iov_base = const_cast<char *>(pieces[i].m_data);
+        iov[i].iov_len = pieces[i].m_length;
+      }
+
+      // Only what actually got out is removed from the buffers
+      std::fill(written.begin(), written.end(), 0);
+
+      static const size_t MaxVectors = 1024;
+      size_t index = 0;
+      while (index < iov.size()) {
+        ssize_t result = ::writev(fd, &iov[index], std::min(iov.size() - index, MaxVectors));
+        if (result < 0) {
+          if (errno == EINTR)
+            continue;
+          break;
+        }
+
+        size_t count = result;
+        while (count > 0 && index < iov.size()) {
+          size_t chunk = std::min(count, iov[index].iov_len);
+          written[pieces[index].m_buffer] += chunk;
+          count -= chunk;
+          if (chunk < iov[index].iov_len) {
+            iov[index].iov_base = (char *)iov[index].iov_base + chunk;
+            iov[index].iov_len -= chunk;
+          }
+          else
+            ++index;
+        }
+      }
+    }
+#endif
+  }
+
+  for (size_t i = 0; i < buffers.size(); ++i)
+    buffers[i]->m_tail = tails[i] + written[i];
+
+  if (dropped > 0) {
+    m_asyncDropCount += dropped;
+    if (m_stream != NULL && !(HasOption(BinaryFormat) && m_binaryStream))
+      *m_stream << "PTrace: " << dropped << " records dropped, " << m_asyncDropCount << " total, as buffer full" << endl;
+  }
+
+  // Clean up buffers for threads that have exited
+  m_asyncMutex.Wait();
+  for (AsyncBufferList::iterator it = m_asyncBuffers.begin(); it != m_asyncBuffers.end(); ) {
+    AsyncBuffer * buffer = *it;
+    if (buffer->m_orphaned && buffer->GetUsed() == 0) {
+      it = m_asyncBuffers.erase(it);
+      delete buffer;
+    }
+    else
+      ++it;
+  }
+  m_asyncMutex.Signal();
+}
+
+
+void PTraceInfo::StopAsyncWriter()
+{
+  // Any further output is synchronous
+  m_asyncStopped = true;
+
+  if (m_asyncThread != NULL) {
+    m_asyncSignal.Signal();
+    m_asyncThread->WaitForTermination();
+    delete m_asyncThread;
+    m_asyncThread = NULL;
+  }
+
+  Lock();
+  DrainAsyncBuffers();
+  Unlock();
 }
 
 
@@ -911,112 +1302,132 @@ ostream & PTraceInfo::InternalEnd(ostream & paramStream)
 
   paramStream << ends << flush;
 
+  if (HasOption(BinaryFormat) && m_binaryStream && !HasOption(SystemLogStream))
+    OutputBinary(*context);
+  else {
+    PStringStream output;
+    FormatText(*context, output, m_options, m_startTick);
+
+    if (HasOption(SystemLogStream))
+      PSystemLog::OutputToTarget(PSystemLog::LevelFromInt(context->m_level), output);
+    else if (!HasOption(AsynchronousOutput) || !AsyncOutput(output, output.GetLength(), true)) {
+      Lock();
+      *m_stream << output << endl;
+      Unlock();
+    }
+  }
+
+  delete context;
 
-  PStringStream output;
+  return paramStream;
+}
 
-  bool outputJSON = HasOption(OutputJSON);
+
+void PTraceInfo::FormatText(Context & context, ostream & output, unsigned options, const PTimeInterval & startTick) const
+{
+  bool outputJSON = (options & OutputJSON) != 0;
   if (outputJSON)
     output << '{';
 
-  if (outputJSON || HasOption(DateAndTime)) {
+  if (outputJSON || (options & DateAndTime) != 0) {
     // Use "@timestamp" for compatibility with ELK systems
     if (outputJSON)
-      output << "\"@timestamp\":\"" << context->m_dateTime.AsString(PTime::LongISO8601) << "\",";
-    else if (!HasOption(SystemLogStream))
-      output << context->m_dateTime.AsString(PTime::LoggingFormat, HasOption(GMTTime) ? PTime::GMT : PTime::Local) << '\t';
+      output << "\"@timestamp\":\"" << context.m_dateTime.AsString(PTime::LongISO8601) << "\",";
+    else if ((options & SystemLogStream) == 0)
+      output << context.m_dateTime.AsString(PTime::LoggingFormat, (options & GMTTime) != 0 ? PTime::GMT : PTime::Local) << '\t';
   }
 
-  if (HasOption(Timestamp)) {
+  if ((options & Timestamp) != 0) {
     if (outputJSON)
-      output << "\"TimeSinceStart\":" << scientific << (context->m_tick-m_startTick) << ',';
+      output << "\"TimeSinceStart\":" << scientific << (context.m_tick-startTick) << ',';
     else
-      output << setprecision(3) << setw(10) << (context->m_tick-m_startTick) << '\t';
+      output << setprecision(3) << setw(10) << (context.m_tick-startTick) << '\t';
   }
 
-  if (HasOption(TraceLevel)) {
+  if ((options & TraceLevel) != 0) {
     if (outputJSON)
       output << "\"LogLevel\":";
-    output << context->m_level << (outputJSON ? ',' : '\t');
+    output << context.m_level << (outputJSON ? ',' : '\t');
   }
 
-  if (HasOption(Thread)) {
+  if ((options & Thread) != 0) {
 #if P_64BIT && !defined(WIN32) && !defined(P_UNIQUE_THREAD_ID_FMT)
     static const PINDEX ThreadNameWidth = 31;
 #else
     static const PINDEX ThreadNameWidth = 23;
 #endif
     if (outputJSON)
-      output << "\"ThreadName\":" << context->m_threadName.ToLiteral() << ',';
+      output << "\"ThreadName\":" << context.m_threadName.ToLiteral() << ',';
     else
-      output << setw(ThreadNameWidth) << context->m_threadName.Ellipsis(ThreadNameWidth, ThreadNameWidth/2-2) << '\t';
+      output << setw(ThreadNameWidth) << context.m_threadName.Ellipsis(ThreadNameWidth, ThreadNameWidth/2-2) << '\t';
   }
 
-  if (HasOption(ThreadAddress)) {
+  if ((options & ThreadAddress) != 0) {
     if (outputJSON)
-      output << "\"ThreadAddress\":" << context->m_threadAddress << ',';
+      output << "\"ThreadAddress\":" << context.m_threadAddress << ',';
     else
-      output << context->m_threadAddress << '\t';
+      output << context.m_threadAddress << '\t';
   }
 
-  if (HasOption(FileAndLine) && !context->m_fileName.IsEmpty()) {
+  if ((options & FileAndLine) != 0 && !context.m_fileName.IsEmpty()) {
     if (outputJSON)
-      output << "\"FilePath\":" << context->m_fileName.ToLiteral() << ","
-                "\"FileLine\":" << context->m_lineNum << ',';
+      output << "\"FilePath\":" << context.m_fileName.ToLiteral() << ","
+                "\"FileLine\":" << context.m_lineNum << ',';
     else {
       static unsigned const FileWidth = 16;
-      output << setw(FileWidth) << context->m_fileName.GetFileName().Left(FileWidth);
-      if (context->m_lineNum > 0)
-        output << '(' << context->m_lineNum << ')';
+      output << setw(FileWidth) << context.m_fileName.GetFileName().Left(FileWidth);
+      if (context.m_lineNum > 0)
+        output << '(' << context.m_lineNum << ')';
       else
         output << "       ";
       output << '\t';
     }
   }
 
-  if (HasOption(ObjectInstance)) {
+  if ((options & ObjectInstance) != 0) {
     if (outputJSON)
-      output << "\"ObjectClass\":" << context->m_objectClass.ToLiteral() << ","
-                "\"ObjectAddress\":" << context->m_objectAddress << ',';
+      output << "\"ObjectClass\":" << context.m_objectClass.ToLiteral() << ","
+                "\"ObjectAddress\":" << context.m_objectAddress << ',';
     else {
       static unsigned const ObjWidth = 31;
-      if (context->m_objectAddress == NULL)
+      if (context.m_objectAddress == NULL)
         output << setw(ObjWidth/2) << '-' << setw(ObjWidth/2+1) << ' ';
       else {
-        PString addr(PSTRSTRM(hex << (uintptr_t)context->m_objectAddress));
+        PString addr(PSTRSTRM(hex << (uintptr_t)context.m_objectAddress));
         unsigned width = ObjWidth - addr.GetLength() - 1;
-        output << setw(width) << context->m_objectClass.Ellipsis(width) << ':' << addr;
+        output << setw(width) << context.m_objectClass.Ellipsis(width) << ':' << addr;
       }
       output << '\t';
     }
   }
 
-  if (HasOption(ContextIdentifier)) {
+  if ((options & ContextIdentifier) != 0) {
     if (outputJSON)
-      output << "\"ContextIdentifier\":" << context->m_contextIdentifier << ',';
+      output << "\"ContextIdentifier\":" << context.m_contextIdentifier << ',';
     else {
-      if (context->m_contextIdentifier != 0)
-        output << setfill('0') << setw(13) << context->m_contextIdentifier << setfill(' ');
+      if (context.m_contextIdentifier != 0)
+        output << setfill('0') << setw(13) << context.m_contextIdentifier << setfill(' ');
       else
         output << "- - - - - - -";
       output << '\t';
     }
   }
 
-  PString & message = context->m_stream;
-  if (context->m_module.IsEmpty()) {
+  PString & message = context.m_stream;
+  if (context.m_module.IsEmpty()) {
     PINDEX tab = message.Find('\t');
     if (tab != P_MAX_INDEX && tab < 16) {
-      context->m_module = message.Left(tab);
+      context.m_module = message.Left(tab);
       message.Delete(0, tab+1);
     }
   }
 
   if (outputJSON)
-    output << "\"Module\":" << context->m_module.ToLiteral() << ',';
+    output << "\"Module\":" << context.m_module.ToLiteral() << ',';
   else
-    output << left << setw(8) << context->m_module << right << '\t';
+    output << left << setw(8) << context.m_module << right << '\t';
 
-  if (HasOption(SingleLine)) {
+  if ((options & SingleLine) != 0) {
     message.Replace("\\", "\\\\", true);
     message.Replace("\r", "\\r", true);
     message.Replace("\n", "\\n", true);
@@ -1029,21 +1440,379 @@ ostream & PTraceInfo::InternalEnd(ostream & paramStream)
     output << "\"Message\":" << message.ToLiteral() << '}';
   else
     output << message;
+}
 
-  if (HasOption(SystemLogStream))
-    PSystemLog::OutputToTarget(PSystemLog::LevelFromInt(context->m_level), output);
-  else {
+
+/* Binary trace records are a type byte, a 32 bit payload length, then the
+   payload. All values are in host byte order. Message records refer to
+   source file/line, class name and thread name definitions by identifier,
+   these definitions may appear after the message in the file when using the
+   AsynchronousOutput option, so decoding is done in two passes. */
+enum BinaryTraceRecordType
+{
+  BinaryTraceHeader = 1,  // Magic, version, options, start time
+  BinaryTraceSite,        // Identifier, line number, file name
+  BinaryTraceThread,      // Unique thread identifier, thread name
+  BinaryTraceClass,       // Identifier, class name
+  BinaryTraceMessage      // See PTraceInfo::OutputBinary()
+};
+
+static const char BinaryTraceMagic[8] = { 'P', 'T', 'L', 'i', 'b', 'B', 'i', 'n' };
+static const uint32_t BinaryTraceVersion = 1;
+static const size_t BinaryTraceRecordHeaderSize = 1 + sizeof(uint32_t);
+
+
+template <typename T> static void AppendBinaryTrace(std::string & record, T value)
+{
+  record.append((const char *)&value, sizeof(value));
+}
+
+
+template <typename T> static T ExtractBinaryTrace(const char * & ptr)
+{
+  T value;
+  memcpy(&value, ptr, sizeof(value));
+  ptr += sizeof(value);
+  return value;
+}
+
+
+static size_t BeginBinaryTraceRecord(std::string & record, BinaryTraceRecordType type)
+{
+  record += (char)type;
+  size_t pos = record.size();
+  AppendBinaryTrace(record, uint32_t(0));
+  return pos;
+}
+
+
+static void EndBinaryTraceRecord(std::string & record, size_t pos)
+{
+  uint32_t length = (uint32_t)(record.size() - pos - sizeof(uint32_t));
+  memcpy(&record[pos], &length, sizeof(length));
+}
+
+
+void PTraceInfo::OutputBinary(const Context & context)
+{
+  if (m_binaryHeaderNeeded) {
     Lock();
-    *m_stream << output << endl;
+    if (m_binaryHeaderNeeded && m_stream != NULL) {
+      std::string header;
+      size_t pos = BeginBinaryTraceRecord(header, BinaryTraceHeader);
+      header.append(BinaryTraceMagic, sizeof(BinaryTraceMagic));
+      AppendBinaryTrace(header, BinaryTraceVersion);
+      AppendBinaryTrace(header, uint32_t(m_options));
+      AppendBinaryTrace(header, int64_t(PTime().GetTimestamp() - (PTimer::Tick() - m_startTick).GetMicroSeconds()));
+      EndBinaryTraceRecord(header, pos);
+      m_stream->write(header.data(), header.size());
+      m_stream->flush();
+      ++m_binaryGeneration;
+      m_binaryHeaderNeeded = false;
+    }
     Unlock();
   }
 
-  delete context;
+#ifdef P_THREAD_LOCAL
+  BinaryState * state = s_binaryState;
+  if (state == NULL)
+    s_binaryState = state = m_binaryStorage.Get();
+#else
+  BinaryState * state = m_binaryStorage.Get();
+#endif
+  if (state == NULL)
+    return;
 
-  return paramStream;
+  std::string record;
+  record.reserve(100 + context.m_stream.GetLength());
+
+  size_t pos;
+  uint64_t threadId = context.m_threadAddress != NULL ? context.m_threadAddress->GetUniqueIdentifier() : 0;
+
+  unsigned generation = m_binaryGeneration;
+  if (state->m_generation != generation) {
+    state->m_generation = generation;
+    state->m_sites.clear();
+    state->m_classes.clear();
+
+    pos = BeginBinaryTraceRecord(record, BinaryTraceThread);
+    AppendBinaryTrace(record, threadId);
+    if (context.m_threadAddress != NULL) {
+      PString name = context.m_threadAddress->GetThreadName();
+      record.append((const char *)name, name.GetLength());
+    }
+    EndBinaryTraceRecord(record, pos);
+  }
+
+  uint32_t siteId = 0;
+  if (context.m_rawFileName != NULL) {
+    std::pair<const char *, int> key(context.m_rawFileName, context.m_lineNum);
+    BinaryState::SiteMap::iterator it = state->m_sites.find(key);
+    if (it != state->m_sites.end())
+      siteId = it->second;
+    else {
+      state->m_sites[key] = siteId = ++m_binaryNextId;
+      pos = BeginBinaryTraceRecord(record, BinaryTraceSite);
+      AppendBinaryTrace(record, siteId);
+      AppendBinaryTrace(record, int32_t(context.m_lineNum));
+      record.append(context.m_rawFileName);
+      EndBinaryTraceRecord(record, pos);
+    }
+  }
+
+  uint32_t classId = 0;
+  if (context.m_objectType != NULL) {
+    BinaryState::ClassMap::iterator it = state->m_classes.find(context.m_objectType);
+    if (it != state->m_classes.end())
+      classId = it->second;
+    else {
+      state->m_classes[context.m_objectType] = classId = ++m_binaryNextId;
+      pos = BeginBinaryTraceRecord(record, BinaryTraceClass);
+      AppendBinaryTrace(record, classId);
+      record += PObject::GetClassName(*context.m_objectType);
+      EndBinaryTraceRecord(record, pos);
+    }
+  }
+
+  size_t moduleLength = context.m_rawModule != NULL ? std::min(strlen(context.m_rawModule), (size_t)UCHAR_MAX) : 0;
+
+  pos = BeginBinaryTraceRecord(record, BinaryTraceMessage);
+  AppendBinaryTrace(record, uint8_t(context.m_level));
+  AppendBinaryTrace(record, siteId);
+  AppendBinaryTrace(record, classId);
+  AppendBinaryTrace(record, threadId);
+  AppendBinaryTrace(record, uint64_t((uintptr_t)context.m_threadAddress));
+  AppendBinaryTrace(record, uint64_t((uintptr_t)context.m_objectAddress));
+  AppendBinaryTrace(record, uint32_t(context.m_contextIdentifier));
+  AppendBinaryTrace(record, int64_t((context.m_tick - m_startTick).GetMicroSeconds()));
+  AppendBinaryTrace(record, uint8_t(moduleLength));
+  record.append(context.m_rawModule != NULL ? context.m_rawModule : "", moduleLength);
+  record.append((const char *)context.m_stream, std::min(context.m_stream.GetLength(), (PINDEX)m_maxLength));
+  EndBinaryTraceRecord(record, pos);
+
+  if (!HasOption(AsynchronousOutput) || !AsyncOutput(record.data(), record.size(), false)) {
+    Lock();
+    m_stream->write(record.data(), record.size());
+    m_stream->flush();
+    Unlock();
+  }
+}
+
+
+bool PTrace::DecodeBinary(istream & input, ostream & output, unsigned options)
+{
+  return PTraceInfo::Instance().DecodeBinary(input, output, options);
+}
+
+
+/* Reads the binary trace a chunk at a time, so memory used is bounded by the
+   largest record rather than the size of the file. */
+class PBinaryTraceReader
+{
+  public:
+    PBinaryTraceReader(istream & input)
+      : m_input(input)
+      , m_position(0)
+    {
+    }
+
+    // Read another chunk, discarding anything already consumed
+    bool Read()
+    {
+      if (m_position > 0) {
+        m_data.erase(0, m_position);
+        m_position = 0;
+      }
+
+      if (!m_input.good())
+        return false;
+
+      static const size_t ChunkSize = 65536;
+      size_t previous = m_data.size();
+      m_data.resize(previous + ChunkSize);
+      m_input.read(&m_data[previous], ChunkSize);
+      size_t count = (size_t)m_input.gcount();
+      m_data.resize(previous + count);
+      return count > 0;
+    }
+
+    // Make sure there are at least count bytes after the current position
+    bool Need(size_t count)
+    {
+      while (GetAvailable() < count) {
+        if (!Read())
+          return false;
+      }
+      return true;
+    }
+
+    size_t GetAvailable() const { return m_data.size() - m_position; }
+    const char * GetPointer() const { return m_data.data() + m_position; }
+    void Skip(size_t count) { m_position += count; }
+
+    // Returns offset relative to current position
+    size_t Find(const std::string & str, size_t offset) const
+    {
+      size_t pos = m_data.find(str, m_position + offset);
+      return pos != std::string::npos ? pos - m_position : std::string::npos;
+    }
+
+  protected:
+    istream   & m_input;
+    std::string m_data;
+    size_t      m_position;
+};
+
+
+static void OutputBinaryTraceText(ostream & output, PBinaryTraceReader & reader, size_t length, bool & lineOpen)
+{
+  if (length > 0) {
+    output.write(reader.GetPointer(), length);
+    lineOpen = reader.GetPointer()[length-1] != '\n';
+    reader.Skip(length);
+  }
 }
 
 
+bool PTraceInfo::DecodeBinary(istream & input, ostream & output, unsigned options) const
+{
+  std::string magic(BinaryTraceMagic, sizeof(BinaryTraceMagic));
+  PBinaryTraceReader reader(input);
+
+  /* Must find a header near the start, e.g. after the text banner on opening
+     the file, or it is not a binary trace and nothing is output. */
+  static const size_t MaxTextBeforeHeader = 1024*1024;
+  while (reader.Find(magic, BinaryTraceRecordHeaderSize) == std::string::npos) {
+    if (reader.GetAvailable() > MaxTextBeforeHeader || !reader.Read())
+      return false;
+  }
+
+  /* Writer always outputs the site, class & thread records ahead of the first
+     message that uses them, so a single pass is all that is needed. */
+  std::map<uint32_t, std::pair<PString, int> > sites;
+  std::map<uint32_t, PString> classes;
+  std::map<uint64_t, PString> threads;
+
+  unsigned recordedOptions = m_options;
+  PTime startTime(0, 0);
+  bool lineOpen = false;
+
+  for (;;) {
+    // Anything before a header, e.g. the text banner on opening file, is output as is
+    size_t headerPos = reader.Find(magic, BinaryTraceRecordHeaderSize);
+    if (headerPos == std::string::npos) {
+      // Keep enough back so a header split across reads is still found
+      size_t keep = BinaryTraceRecordHeaderSize + magic.size() - 1;
+      if (reader.GetAvailable() > keep)
+        OutputBinaryTraceText(output, reader, reader.GetAvailable() - keep, lineOpen);
+      if (!reader.Read()) {
+        OutputBinaryTraceText(output, reader, reader.GetAvailable(), lineOpen);
+        break;
+      }
+      continue;
+    }
+
+    OutputBinaryTraceText(output, reader, headerPos - BinaryTraceRecordHeaderSize, lineOpen);
+    if (lineOpen) {
+      output << '\n';
+      lineOpen = false;
+    }
+
+    // Now process records until something unexpected
+    while (reader.Need(BinaryTraceRecordHeaderSize)) {
+      const char * ptr = reader.GetPointer();
+      BinaryTraceRecordType type = (BinaryTraceRecordType)*ptr++;
+      uint32_t length = ExtractBinaryTrace<uint32_t>(ptr);
+      if (type < BinaryTraceHeader || type > BinaryTraceMessage)
+        break;
+      if (!reader.Need(BinaryTraceRecordHeaderSize + length)) {
+        reader.Skip(reader.GetAvailable()); // Truncated, e.g. process crashed
+        break;
+      }
+
+      ptr = reader.GetPointer() + BinaryTraceRecordHeaderSize;
+      const char * end = ptr + length;
+      reader.Skip(BinaryTraceRecordHeaderSize + length);
+
+      switch (type) {
+        case BinaryTraceHeader :
+          if (length < sizeof(BinaryTraceMagic) + 2*sizeof(uint32_t) + sizeof(int64_t))
+            break;
+          ptr += sizeof(BinaryTraceMagic);
+          if (ExtractBinaryTrace<uint32_t>(ptr) != BinaryTraceVersion)
+            return false;
+          recordedOptions = ExtractBinaryTrace<uint32_t>(ptr);
+          startTime = PTime(0, ExtractBinaryTrace<int64_t>(ptr));
+          break;
+
+        case BinaryTraceSite :
+          if (length >= 2*sizeof(uint32_t)) {
+            uint32_t id = ExtractBinaryTrace<uint32_t>(ptr);
+            int line = ExtractBinaryTrace<int32_t>(ptr);
+            sites[id] = std::make_pair(PString(ptr, end - ptr), line);
+          }
+          break;
+
+        case BinaryTraceThread :
+          if (length >= sizeof(uint64_t)) {
+            uint64_t id = ExtractBinaryTrace<uint64_t>(ptr);
+            threads[id] = PString(ptr, end - ptr);
+          }
+          break;
+
+        case BinaryTraceClass :
+          if (length >= sizeof(uint32_t)) {
+            uint32_t id = ExtractBinaryTrace<uint32_t>(ptr);
+            classes[id] = PString(ptr, end - ptr);
+          }
+          break;
+
+        case BinaryTraceMessage :
+          if (length >= 1 + 3*sizeof(uint32_t) + 4*sizeof(uint64_t) + 1) {
+            Context context;
+            context.m_level = ExtractBinaryTrace<uint8_t>(ptr);
+
+            std::map<uint32_t, std::pair<PString, int> >::iterator site = sites.find(ExtractBinaryTrace<uint32_t>(ptr));
+            if (site != sites.end()) {
+              context.m_fileName = site->second.first;
+              context.m_lineNum = site->second.second;
+            }
+
+            std::map<uint32_t, PString>::iterator cls = classes.find(ExtractBinaryTrace<uint32_t>(ptr));
+            if (cls != classes.end())
+              context.m_objectClass = cls->second;
+
+            std::map<uint64_t, PString>::iterator thread = threads.find(ExtractBinaryTrace<uint64_t>(ptr));
+            if (thread != threads.end())
+              context.m_threadName = thread->second;
+
+            context.m_threadAddress = (PThread *)(uintptr_t)ExtractBinaryTrace<uint64_t>(ptr);
+            context.m_objectAddress = (const void *)(uintptr_t)ExtractBinaryTrace<uint64_t>(ptr);
+            context.m_contextIdentifier = ExtractBinaryTrace<uint32_t>(ptr);
+            context.m_tick = PTimeInterval::MicroSeconds(ExtractBinaryTrace<int64_t>(ptr));
+            context.m_dateTime = startTime + context.m_tick;
+
+            size_t moduleLength = std::min((size_t)ExtractBinaryTrace<uint8_t>(ptr), (size_t)(end - ptr));
+            context.m_module = PString(ptr, moduleLength);
+            ptr += moduleLength;
+            context.m_stream << PString(ptr, end - ptr);
+
+            PStringStream text;
+            FormatText(context, text, options != UINT_MAX ? options : recordedOptions, 0);
+            output << text << '\n';
+          }
+          break;
+      }
+    }
+  }
+
+  if (lineOpen)
+    output << '\n';
+
+  output.flush();
+  return true;
+}
+
 PTrace::Block::Block(const char * fileName, int lineNum, const char * traceName)
   : file(fileName)
   , line(lineNum)
@@ -1613,6 +2382,7 @@ void PTimer::InternalStart(bool once, int64_t resetTime)
     m_absoluteTime = Tick() + GetResetTime();
     list->m_timersMutex.Wait();
     list->m_timers[m_handle] = this;
+    list->AddExpiry(*this);
     m_running = true;
     list->m_timersMutex.Signal();
 
@@ -1665,19 +2435,84 @@ void PTimer::OnTimeout()
     thread->SetThreadName(m_threadName);
   }
 
-  m_callback(*this, IsRunning());
+  m_callback(*this, IsRunning());
+
+  if (!oldName.IsEmpty())
+    thread->SetThreadName(oldName);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PTimer::List
+
+PTimer::List::List()
+  : m_threadPool(10, 0, "OnTimeout", PThread::NormalPriority, PMaxTimeInterval, 0, false)
+#if PTRACING
+  , m_highWaterMark(0)
+#endif
+{
+}
+
+
+const unsigned PTimer::List::Statistics::LatenessBucketLimits[NumLatenessBuckets-1] = {
+  1, 2, 5, 10, 20, 50, 100, 200, 500, 1000
+};
+
+
+PTimer::List::Statistics::Statistics()
+  : m_timerCount(0)
+  , m_heapSize(0)
+  , m_workQueueDepth(0)
+  , m_expiredCount(0)
+{
+  memset(m_latenessHistogram, 0, sizeof(m_latenessHistogram));
+}
 
-  if (!oldName.IsEmpty())
-    thread->SetThreadName(oldName);
+
+ostream & operator<<(ostream & strm, const PTimer::List::Statistics & stats)
+{
+  strm << "timers=" << stats.m_timerCount
+       << " heap=" << stats.m_heapSize
+       << " queued=" << stats.m_workQueueDepth
+       << " expired=" << stats.m_expiredCount
+       << " max-lateness=" << stats.m_maxLateness
+       << " lateness-ms:";
+  for (PINDEX i = 0; i < PTimer::List::Statistics::NumLatenessBuckets; ++i) {
+    strm << ' ';
+    if (i < PTimer::List::Statistics::NumLatenessBuckets-1)
+      strm << '<' << PTimer::List::Statistics::LatenessBucketLimits[i];
+    else
+      strm << ">=" << PTimer::List::Statistics::LatenessBucketLimits[i-1];
+    strm << '=' << stats.m_latenessHistogram[i];
+  }
+  return strm;
 }
 
 
-///////////////////////////////////////////////////////////////////////////////
-// PTimer::List
+void PTimer::List::GetStatistics(Statistics & stats) const
+{
+  m_timersMutex.Wait();
+  stats = m_statistics;
+  stats.m_timerCount = m_timers.size();
+  stats.m_heapSize = m_expiryHeap.size();
+  m_timersMutex.Signal();
 
-PTimer::List::List()
-  : m_threadPool(10, 0, "OnTimeout")
+  stats.m_workQueueDepth = m_threadPool.GetWorkSize();
+}
+
+
+void PTimer::List::AddExpiry(PTimer & timer)
 {
+  // Assumes m_timersMutex already locked
+  m_expiryHeap.push_back(Expiry(timer.m_absoluteTime, timer.m_handle));
+  std::push_heap(m_expiryHeap.begin(), m_expiryHeap.end());
+
+#if PTRACING
+  if (m_timers.size() > m_highWaterMark) {
+    m_highWaterMark = m_timers.size();
+    PTRACE_IF(4, (m_highWaterMark % 1000) == 0, NULL, PTraceModule(), "Timer: high water mark=" << m_highWaterMark);
+  }
+#endif
 }
 
 
@@ -1736,33 +2571,77 @@ PTimeInterval PTimer::List::Process()
   // Calculate interval before next Process() call
   PTimeInterval nextInterval(0, 1);
 
+  std::vector<Expiry> busy;
+  PINDEX processed = 0;
+
   m_timersMutex.Wait();
 
-  for (TimerMap::iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
+  while (!m_expiryHeap.empty()) {
+    Expiry expiry = m_expiryHeap.front();
+    PTimeInterval delta = expiry.m_time - now;
+    if (delta > 0) {
+      if (nextInterval > delta)
+        nextInterval = delta;
+      break;
+    }
+
+    std::pop_heap(m_expiryHeap.begin(), m_expiryHeap.end());
+    m_expiryHeap.pop_back();
+    ++processed;
+
+    // Discard stale entries for timers that have been stopped or restarted
+    TimerMap::iterator it = m_timers.find(expiry.m_handle);
+    if (it == m_timers.end())
+      continue;
+
     PTimer & timer = *it->second;
-    if (timer.m_running) {
-      PTimeInterval delta = timer.m_absoluteTime - now;
-      if (delta > 0) {
-        if (nextInterval > delta)
-          nextInterval = delta;
-      }
-      else if (timer.m_callbackMutex.Try()) {
-        /* PTimer is stopped and completely removed from the list before it's
-           properties are changed from the external code, making this thread
-           safe without a mutex. */
-        if (timer.m_oneshot)
-          timer.m_running = false;
-        else {
-          timer.m_absoluteTime = now + timer.GetResetTime();
-          if (nextInterval > timer.GetResetTime())
-            nextInterval = timer.GetResetTime();
-        }
-        timer.m_callbackMutex.Signal();
+    if (!timer.m_running || timer.m_absoluteTime != expiry.m_time)
+      continue;
 
-        m_threadPool.AddWork(new Timeout(it->first));
-        PTRACE(6, &timer, "Timer: " << timer << " work added, lateness=" << -delta);
-      }
+    if (!timer.m_callbackMutex.Try()) {
+      busy.push_back(expiry); // Still in previous OnTimeout(), try again next time
+      continue;
+    }
+
+    /* PTimer is stopped and completely removed from the list before it's
+       properties are changed from the external code, making this thread
+       safe without a mutex. */
+    if (timer.m_oneshot)
+      timer.m_running = false;
+    else {
+      timer.m_absoluteTime = now + timer.GetResetTime();
+      AddExpiry(timer);
+      if (nextInterval > timer.GetResetTime())
+        nextInterval = timer.GetResetTime();
+    }
+    timer.m_callbackMutex.Signal();
+
+    m_threadPool.AddWork(new Timeout(it->first));
+    PTRACE(6, &timer, "Timer: " << timer << " work added, lateness=" << -delta);
+
+    ++m_statistics.m_expiredCount;
+    if (m_statistics.m_maxLateness < -delta)
+      m_statistics.m_maxLateness = -delta;
+    int64_t latenessMS = -delta.GetMilliSeconds();
+    PINDEX bucket = 0;
+    while (bucket < Statistics::NumLatenessBuckets-1 && latenessMS >= (int64_t)Statistics::LatenessBucketLimits[bucket])
+      ++bucket;
+    ++m_statistics.m_latenessHistogram[bucket];
+  }
+
+  for (std::vector<Expiry>::iterator it = busy.begin(); it != busy.end(); ++it) {
+    m_expiryHeap.push_back(*it);
+    std::push_heap(m_expiryHeap.begin(), m_expiryHeap.end());
+  }
+
+  // Rebuild heap if too many stale entries from restarted/stopped timers
+  if (m_expiryHeap.size() > m_timers.size()*2 + 100) {
+    m_expiryHeap.clear();
+    for (TimerMap::iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
+      if (it->second->m_running)
+        m_expiryHeap.push_back(Expiry(it->second->m_absoluteTime, it->first));
     }
+    std::make_heap(m_expiryHeap.begin(), m_expiryHeap.end());
   }
 
   m_timersMutex.Signal();
@@ -1770,7 +2649,7 @@ PTimeInterval PTimer::List::Process()
   if (nextInterval < 10)
     nextInterval = 10;
 
-  PTRACE(6, NULL, PTraceModule(), m_timers.size() << " timers processed, next=" << nextInterval);
+  PTRACE(6, NULL, PTraceModule(), processed << " of " << m_timers.size() << " timers processed, next=" << nextInterval);
   return nextInterval;
 }
 
@@ -2527,6 +3406,9 @@ PProcess::PProcess(const char * manuf, const char * name,
   m_version.m_git = NULL;
 
   m_activeThreads[GetThreadId()] = this;
+#ifdef P_THREAD_LOCAL
+  s_currentThread = this;
+#endif
 
 #if PTRACING
   // Do this before PProcessInstance is set to avoid a recursive loop with PTimedMutex
@@ -2733,6 +3615,11 @@ PProcess::~PProcess()
 #endif
   }
 
+#if PTRACING
+  // Everything from here on is output synchronously
+  PTraceInfo::Instance().StopAsyncWriter();
+#endif
+
   // Clean up factories
   PProcessStartupFactory::KeyList_T list = PProcessStartupFactory::GetKeyList();
   for (PProcessStartupFactory::KeyList_T::const_reverse_iterator it = list.rbegin(); it != list.rend(); ++it)
@@ -3296,6 +4183,17 @@ void PProcess::InternalThreadEnded(PThread * thread)
   // Do the log before mutex and thread being removed from m_activeThreads
   PTRACE_IF(5, thread->IsAutoDelete(), thread, "Queuing auto-delete of thread " << *thread);
 
+#ifdef P_THREAD_LOCAL
+  // If called in the context of the thread, it may be deleted any time after this
+  if (s_currentThread == thread) {
+    s_currentThread = NULL;
+#if PTRACING
+    s_asyncBufferRef = NULL;
+    s_binaryState = NULL;
+#endif
+  }
+#endif
+
   PWaitAndSignal mutex(m_threadMutex);
 
   ThreadMap::iterator it = m_activeThreads.find(thread->GetThreadId());
@@ -3343,6 +4241,10 @@ bool PProcess::HostSystemURLHandlerInfo::RegisterTypes(const PString & _types, b
 
 void PThread::InternalThreadMain()
 {
+#ifdef P_THREAD_LOCAL
+  s_currentThread = this;
+#endif
+
   InternalPreMain();
 
   PProcess & process = PProcess::Current();
@@ -3380,11 +4282,23 @@ PThread * PThread::Current()
 
   PProcess & process = PProcess::Current();
 
+#ifdef P_THREAD_LOCAL
+  /* The cached pointer is cleared when the thread ends, but external threads
+     are deleted during shut down without that, so use the map then. */
+  PThread * current = s_currentThread;
+  if (current != NULL && !process.m_shuttingDown)
+    return current;
+#endif
+
   {
     PWaitAndSignal mutex(process.m_threadMutex);
     PProcess::ThreadMap::iterator it = process.m_activeThreads.find(GetCurrentThreadId());
-    if (it != process.m_activeThreads.end() && !it->second->IsTerminated())
+    if (it != process.m_activeThreads.end() && !it->second->IsTerminated()) {
+#ifdef P_THREAD_LOCAL
+      s_currentThread = it->second;
+#endif
       return it->second;
+    }
   }
 
   if (process.m_shuttingDown)
@@ -3395,6 +4309,9 @@ PThread * PThread::Current()
 
   PWaitAndSignal mutex(process.m_threadMutex);
   process.m_externalThreads.push_back(thread);
+#ifdef P_THREAD_LOCAL
+  s_currentThread = thread.get();
+#endif
   return thread.get();
 }
 
@@ -3747,6 +4664,14 @@ PThread::~PThread()
 
   PTRACE(5, "Destroying thread " << this << ' ' << m_threadName << ", id=" << m_threadId);
 
+#if defined(P_THREAD_LOCAL) && PTRACING
+  // Deleting ourselves, anything cached from the thread local storage is about to go
+  if (GetUniqueIdentifier() == GetCurrentUniqueIdentifier()) {
+    s_asyncBufferRef = NULL;
+    s_binaryState = NULL;
+  }
+#endif
+
 #if RELEASE_THREAD_LOCAL_STORAGE
   if (s_ThreadLocalStorageData) s_ThreadLocalStorageData->Destroy(*this);
 #endif
@@ -3875,6 +4800,8 @@ void PMutexExcessiveLockInfo::Construct(unsigned timeout)
 {
   m_excessiveLockActive = false;
   m_startHeldSamplePoint = 0;
+  m_lockStatistics = NULL;
+  m_lockProfiling = true;
 
   if (timeout > 0)
       m_excessiveLockTimeout = timeout;
@@ -3894,6 +4821,8 @@ PMutexExcessiveLockInfo::PMutexExcessiveLockInfo(const PMutexExcessiveLockInfo &
   , m_excessiveLockTimeout(other.m_excessiveLockTimeout)
   , m_excessiveLockActive(false)
   , m_startHeldSamplePoint(0)
+  , m_lockStatistics(NULL)
+  , m_lockProfiling(other.m_lockProfiling)
 {
 }
 
@@ -3942,17 +4871,35 @@ void PMutexExcessiveLockInfo::ExcessiveLockPhantom(const PObject & mutex) const
 }
 
 
-void PMutexExcessiveLockInfo::AcquiredLock(uint64_t, bool, const PDebugLocation &)
+PProfiling::LockStatistics * PMutexExcessiveLockInfo::GetLockStatistics()
+{
+  PProfiling::LockStatistics * stats = m_lockStatistics;
+  if (stats == NULL) {
+    // Several readers may get here at once, but they all get the same pointer
+    stats = PProfiling::GetLockStatistics(m_location);
+    m_lockStatistics = stats;
+  }
+  return stats;
+}
+
+
+void PMutexExcessiveLockInfo::AcquiredLock(uint64_t startWaitCycle, bool, const PDebugLocation & location)
 {
+  if (m_lockProfiling && PProfiling::IsLockProfilingEnabled())
+    PProfiling::RecordLockAcquired(*GetLockStatistics(), PProfiling::GetCycles() - startWaitCycle, location);
 }
 
 
 void PMutexExcessiveLockInfo::ReleasedLock(const PObject & mutex,
-                                           uint64_t PTRACE_PARAM(startHeldSamplePoint),
+                                           uint64_t startHeldSamplePoint,
                                            bool,
                                            const PDebugLocation & PTRACE_PARAM(location))
 {
-  if (m_excessiveLockActive.exchange(false)) {
+  if (m_lockProfiling && PProfiling::IsLockProfilingEnabled())
+    PProfiling::RecordLockReleased(*GetLockStatistics(), PProfiling::GetCycles() - startHeldSamplePoint);
+
+  // Check first, so normal release does not write to a shared cache line
+  if (m_excessiveLockActive && m_excessiveLockActive.exchange(false)) {
 #if PTRACING
     PTime releaseTime;
     PNanoSeconds heldDuration(PProfiling::CyclesToNanoseconds(PProfiling::GetCycles() - startHeldSamplePoint));
@@ -4058,6 +5005,23 @@ void PTimedMutex::Signal()
 }
 
 
+bool PTimedMutex::InstrumentedWait(const PTimeInterval & timeout, const PDebugLocation & location)
+{
+  uint64_t startWaitCycle = PProfiling::GetCycles();
+
+  if (timeout == PMaxTimeInterval) {
+    InternalWait(&location);
+    return true;
+  }
+
+  if (!PlatformWait(timeout))
+    return false;
+
+  InternalWaitComplete(startWaitCycle, &location);
+  return true;
+}
+
+
 void PTimedMutex::InternalWait(const PDebugLocation * location)
 {
   uint64_t startWaitCycle = PProfiling::GetCycles();
@@ -4145,26 +5109,10 @@ bool PTimedMutex::InternalSignal(const PDebugLocation * location)
 
 
 #if PTRACING
-bool PInstrumentedMutex::InstrumentedWait(const PTimeInterval & timeout, const PDebugLocation & location)
-{
-  uint64_t startWaitCycle = PProfiling::GetCycles();
-
-  if (timeout == PMaxTimeInterval) {
-    InternalWait(&location);
-    return true;
-  }
-
-  if (!PlatformWait(timeout))
-    return false;
-
-  InternalWaitComplete(startWaitCycle, &location);
-  return true;
-}
-
-
-void PInstrumentedMutex::AcquiredLock(uint64_t startWaitCycle, bool, const PDebugLocation & location)
+void PInstrumentedMutex::AcquiredLock(uint64_t startWaitCycle, bool readOnly, const PDebugLocation & location)
 {
   m_timeWaitContext.EndMeasurement(this, this, &location, startWaitCycle);
+  PTimedMutex::AcquiredLock(startWaitCycle, readOnly, location);
 }
 
 
@@ -4321,6 +5269,47 @@ PIntCondMutex & PIntCondMutex::operator-=(int dec)
 
 /////////////////////////////////////////////////////////////////////////////
 
+#if P_STD_ATOMIC
+  #define PMemoryBarrier() std::atomic_thread_fence(std::memory_order_seq_cst)
+#elif defined(_WIN32)
+  #define PMemoryBarrier() MemoryBarrier()
+#else
+  #define PMemoryBarrier() __sync_synchronize()
+#endif
+
+static const unsigned ReadWriteNestSlotCount = 512;   // Shared by all threads
+static const unsigned ReadWriteNestsPerThread = 8;    // Distinct mutexes held at once, before using map
+static const unsigned ReadWriteNestSlotProbes = 64;
+static const unsigned ReaderBiasMinimumReads = 100;   // Slow reads without a write, before enabling bias
+static const unsigned ReaderBiasInhibitMultiplier = 9; // As per the BRAVO paper
+
+/* Published biased readers, indexed the same as the nest slots. These are
+   kept separate and dense so a writer can scan them quickly, and as a thread
+   gets ReadWriteNestsPerThread consecutive slots, a thread mostly has a cache
+   line to itself. */
+static PReadWriteMutex * volatile s_readWriteFastReaders[ReadWriteNestSlotCount];
+static atomic<unsigned> s_readWriteNextHome;
+
+struct PReadWriteMutex::NestSlot
+{
+  atomic<PReadWriteMutex *> m_mutex; // Claimed by owning thread with compare/exchange
+  Nest                      m_nest;
+};
+
+struct PReadWriteMutex::ThreadNests
+{
+  struct Entry
+  {
+    PReadWriteMutex * m_mutex;
+    NestSlot        * m_slot;
+  } m_entries[ReadWriteNestsPerThread];
+  unsigned                m_count;
+  unsigned                m_overflow; // Nests in the m_nestedThreads of some mutex
+  unsigned                m_home;     // One based first slot index to try, zero is not set yet
+  PUniqueThreadIdentifier m_uniqueId;
+};
+
+
 PReadWriteMutex::PReadWriteMutex()
   : PMutexExcessiveLockInfo()
 #if P_READ_WRITE_ALGO2
@@ -4339,7 +5328,17 @@ PReadWriteMutex::PReadWriteMutex()
   , m_writerMutex()
   , m_writerCount(0)
 #endif
-{
+  , m_releasingThreads(0)
+  , m_readerBias(false)
+  , m_readerBiasInhibitUntil(0)
+  , m_readsSinceWrite(0)
+{
+#if !P_READ_WRITE_ALGO2
+  // Internal locks keep our location for deadlock reports, but are not profiled separately
+  m_readerMutex.SetLockProfiling(false);
+  m_starvationPreventer.SetLockProfiling(false);
+  m_writerMutex.SetLockProfiling(false);
+#endif
   PMUTEX_CONSTRUCTED();
 }
 
@@ -4361,21 +5360,35 @@ PReadWriteMutex::PReadWriteMutex(const PDebugLocation & location, unsigned timeo
   , m_writerMutex(location, timeout)
   , m_writerCount(0)
 #endif
-{
+  , m_releasingThreads(0)
+  , m_readerBias(false)
+  , m_readerBiasInhibitUntil(0)
+  , m_readsSinceWrite(0)
+{
+#if !P_READ_WRITE_ALGO2
+  // Internal locks keep our location for deadlock reports, but are not profiled separately
+  m_readerMutex.SetLockProfiling(false);
+  m_starvationPreventer.SetLockProfiling(false);
+  m_writerMutex.SetLockProfiling(false);
+#endif
   PMUTEX_CONSTRUCTED();
 }
 
 
 PReadWriteMutex::~PReadWriteMutex()
 {
-  EndNest(); // Destruction while current thread has a lock is OK
+  // Destruction while current thread has a lock is OK
+  Nest * nest = GetNest();
+  if (nest != NULL) {
+    InternalEndFastRead(*nest);
+    EndNest();
+  }
 
   /* There is a small window during destruction where another thread is on the
-     way out of EndRead() or EndWrite() where it checks for nested locks.
-     While the check is protected by mutex, there is a moment between one
-     check and the next where the object is unlocked. This is normally fine,
-     except for if a thread then goes and deletes the object out from under
-     the threads about to do the second check.
+     way out of EndRead() or EndWrite(), after it has released the lock and
+     let this thread in, but before it has finished with the internal
+     semaphores and nesting information. So we wait for those threads to
+     finish with the object before letting it go.
 
      Note if this goes into an endless loop then there is a big problem with
      the user of the PReadWriteMutex, as it must be CONTINUALLY trying to use
@@ -4384,11 +5397,13 @@ PReadWriteMutex::~PReadWriteMutex()
      there so practicality wins out!
    */
   for (;;) {
-    m_nestingMutex.Wait();
-    bool empty = m_nestedThreads.empty();
-    m_nestingMutex.Signal();
-    if (empty)
-      break;
+    if (m_releasingThreads == 0) {
+      m_nestingMutex.Wait();
+      bool empty = m_nestedThreads.empty();
+      m_nestingMutex.Signal();
+      if (empty)
+        break;
+    }
     PThread::Sleep(10);
   }
 
@@ -4400,35 +5415,44 @@ PReadWriteMutex::Nest::Nest()
   : m_readerCount(0)
   , m_writerCount(0)
   , m_waiting(false)
+  , m_fastReader(NULL)
   , m_startHeldCycle(0)
-  , m_uniqueId(PThread::GetCurrentUniqueIdentifier())
+  , m_threadId(PNullThreadIdentifier)
+  , m_uniqueId(0)
 {
 }
 
 
-PReadWriteMutex::Nest::Nest(const Nest & other)
-  : m_readerCount(other.m_readerCount.load())
-  , m_writerCount(other.m_writerCount.load())
-  , m_waiting(other.m_waiting.load())
-  , m_startHeldCycle(other.m_startHeldCycle.load())
-  , m_uniqueId(other.m_uniqueId.load())
+PReadWriteMutex::NestSlot * PReadWriteMutex::GetNestSlots()
 {
+  static NestSlot slots[ReadWriteNestSlotCount];
+  return slots;
 }
 
 
-PReadWriteMutex::Nest & PReadWriteMutex::Nest::operator=(const Nest & other)
+#ifdef P_THREAD_LOCAL
+PReadWriteMutex::ThreadNests & PReadWriteMutex::GetThreadNests()
 {
-  m_readerCount = other.m_readerCount.load();
-  m_writerCount = other.m_writerCount.load();
-  m_waiting = other.m_waiting.load();
-  m_startHeldCycle = other.m_startHeldCycle.load();
-  m_uniqueId = other.m_uniqueId.load();
-  return *this;
+  static P_THREAD_LOCAL ThreadNests threadNests;
+  return threadNests;
 }
+#endif
 
 
 PReadWriteMutex::Nest * PReadWriteMutex::GetNest()
 {
+#ifdef P_THREAD_LOCAL
+  ThreadNests & threadNests = GetThreadNests();
+  for (unsigned i = 0; i < threadNests.m_count; ++i) {
+    if (threadNests.m_entries[i].m_mutex == this)
+      return &threadNests.m_entries[i].m_slot->m_nest;
+  }
+
+  // If this thread has never overflowed, don't need to look at the map
+  if (threadNests.m_overflow == 0)
+    return NULL;
+#endif
+
   PWaitAndSignal mutex(m_nestingMutex);
   NestMap::iterator it = m_nestedThreads.find(PThread::GetCurrentThreadId());
   return it != m_nestedThreads.end() ? &it->second : NULL;
@@ -4437,24 +5461,149 @@ PReadWriteMutex::Nest * PReadWriteMutex::GetNest()
 
 void PReadWriteMutex::EndNest()
 {
+#ifdef P_THREAD_LOCAL
+  ThreadNests & threadNests = GetThreadNests();
+  for (unsigned i = 0; i < threadNests.m_count; ++i) {
+    ThreadNests::Entry & entry = threadNests.m_entries[i];
+    if (entry.m_mutex == this) {
+      entry.m_slot->m_mutex.store(NULL);
+      entry = threadNests.m_entries[--threadNests.m_count];
+      return;
+    }
+  }
+
+  if (threadNests.m_overflow == 0)
+    return;
+#endif
+
   m_nestingMutex.Wait();
-  m_nestedThreads.erase(PThread::GetCurrentThreadId());
+  if (m_nestedThreads.erase(PThread::GetCurrentThreadId()) > 0) {
+#ifdef P_THREAD_LOCAL
+    --threadNests.m_overflow;
+#endif
+  }
   m_nestingMutex.Signal();
 }
 
 
 PReadWriteMutex::Nest & PReadWriteMutex::StartNest()
 {
+  Nest * existing = GetNest();
+  if (existing != NULL)
+    return *existing;
+
+  PThreadIdentifier threadId = PThread::GetCurrentThreadId();
+
+#ifdef P_THREAD_LOCAL
+  ThreadNests & threadNests = GetThreadNests();
+  if (threadNests.m_home == 0) {
+    threadNests.m_home = (s_readWriteNextHome++ * ReadWriteNestsPerThread) % ReadWriteNestSlotCount + 1;
+    threadNests.m_uniqueId = PThread::GetCurrentUniqueIdentifier();
+  }
+
+  if (threadNests.m_count < ReadWriteNestsPerThread) {
+    NestSlot * slots = GetNestSlots();
+    for (unsigned probe = 0; probe < ReadWriteNestSlotProbes; ++probe) {
+      unsigned index = (threadNests.m_home - 1 + probe) % ReadWriteNestSlotCount;
+      NestSlot & slot = slots[index];
+      PReadWriteMutex * expected = NULL;
+      if (slot.m_mutex.compare_exchange_strong(expected, this)) {
+        slot.m_nest = Nest();
+        slot.m_nest.m_fastReader = &s_readWriteFastReaders[index];
+        slot.m_nest.m_threadId = threadId;
+        slot.m_nest.m_uniqueId = threadNests.m_uniqueId;
+
+        ThreadNests::Entry & entry = threadNests.m_entries[threadNests.m_count++];
+        entry.m_mutex = this;
+        entry.m_slot = &slot;
+        return slot.m_nest;
+      }
+    }
+  }
+
+  ++threadNests.m_overflow;
+#endif
+
   PWaitAndSignal mutex(m_nestingMutex);
   // The std::map will create the entry if it doesn't exist
-  return m_nestedThreads[PThread::GetCurrentThreadId()];
+  Nest & nest = m_nestedThreads[threadId];
+  nest.m_threadId = threadId;
+#ifdef P_THREAD_LOCAL
+  nest.m_uniqueId = threadNests.m_uniqueId;
+#else
+  nest.m_uniqueId = PThread::GetCurrentUniqueIdentifier();
+#endif
+  return nest;
 }
 
 
-void PReadWriteMutex::InternalStartRead(const PDebugLocation * location)
+bool PReadWriteMutex::InternalStartFastRead(Nest & nest)
 {
-  uint64_t startWaitCycle = PProfiling::GetCycles();
+  if (!m_readerBias || nest.m_fastReader == NULL)
+    return false;
+
+  /* Publish ourselves and then check the bias again. A writer clears the bias
+     and then checks the published readers, so one of us sees the other. */
+  *nest.m_fastReader = this;
+  PMemoryBarrier();
+  if (m_readerBias)
+    return true;
+
+  *nest.m_fastReader = NULL;
+  return false;
+}
+
+
+bool PReadWriteMutex::InternalEndFastRead(Nest & nest)
+{
+  if (nest.m_fastReader == NULL || *nest.m_fastReader != this)
+    return false;
+
+  PMemoryBarrier(); // Everything done under the read lock is complete
+  *nest.m_fastReader = NULL;
+  return true;
+}
+
+
+void PReadWriteMutex::InternalRevokeReaderBias(Nest & nest)
+{
+  // Have the write lock, so no slow path reader can turn the bias back on
+  if (!m_readerBias)
+    return;
+
+  m_readerBias = false;
+  PMemoryBarrier();
+
+  uint64_t startCycle = PProfiling::GetCycles();
+  PTimeInterval startTick = PTimer::Tick();
+  bool deadlock = false;
+  for (unsigned i = 0; i < ReadWriteNestSlotCount; ++i) {
+    unsigned spin = 0;
+    while (s_readWriteFastReaders[i] == this) {
+      nest.m_waiting = true;
+      if (++spin < 100)
+        PThread::Yield();
+      else
+        PThread::Sleep(1);
+      if (!deadlock && (PTimer::Tick() - startTick).GetMilliSeconds() > m_excessiveLockTimeout) {
+        deadlock = true;
+        InternalDeadlock();
+      }
+    }
+  }
+  nest.m_waiting = false;
+
+  if (deadlock)
+    ExcessiveLockPhantom(*this);
 
+  // Don't turn it back on until some multiple of the time it took to turn it off
+  uint64_t endCycle = PProfiling::GetCycles();
+  m_readerBiasInhibitUntil = endCycle + (endCycle - startCycle)*ReaderBiasInhibitMultiplier;
+}
+
+
+void PReadWriteMutex::InternalStartRead(const PDebugLocation * location)
+{
   // Get the nested thread info structure, create one it it doesn't exist
   Nest & nest = StartNest();
 
@@ -4463,63 +5612,88 @@ void PReadWriteMutex::InternalStartRead(const PDebugLocation * location)
   nest.m_readerCount++;
 
   // If this is the first call to StartRead() and there has not been a
-  // previous call to StartWrite() then actually do the text book read only
-  // lock, otherwise we leave it as just having incremented the reader count.
-  if (nest.m_readerCount == 1 && nest.m_writerCount == 0) {
+  // previous call to StartWrite() then actually do the read only lock,
+  // otherwise we leave it as just having incremented the reader count.
+  if (nest.m_readerCount > 1 || nest.m_writerCount > 0)
+    return;
+
+  uint64_t startWaitCycle = PProfiling::GetCycles();
+
+  if (InternalStartFastRead(nest))
+    nest.m_startHeldCycle = startWaitCycle;
+  else {
+    // Do text book read lock
     InternalStartReadWithNest(nest, location);
-    AcquiredLock(startWaitCycle, true, location);
     nest.m_startHeldCycle = PProfiling::GetCycles();
+
+    /* If reads dominate, and turning off the bias has not been expensive of
+       late, use the fast path. The count is not atomic as it is a heuristic,
+       and the odd lost increment from concurrent readers does not matter. */
+    if (!m_readerBias && ++m_readsSinceWrite > ReaderBiasMinimumReads && nest.m_startHeldCycle > m_readerBiasInhibitUntil)
+      m_readerBias = true;
   }
+
+  AcquiredLock(startWaitCycle, true, location);
 }
 
 
-void PReadWriteMutex::InternalWait(Nest & nest, PSync & sync, const PDebugLocation & location) const
+void PReadWriteMutex::InternalDeadlock() const
 {
-  nest.m_waiting = true;
-
-  if (sync.InstrumentedWait(m_excessiveLockTimeout, location)) {
-    nest.m_waiting = false;
-    return;
-  }
-
   m_excessiveLockActive = true;
 
-  NestMap nestedThreadsToDump;
+  std::vector<Nest> nestsToDump;
+  NestSlot * slots = GetNestSlots();
+  for (unsigned i = 0; i < ReadWriteNestSlotCount; ++i) {
+    if (slots[i].m_mutex.load() == this)
+      nestsToDump.push_back(slots[i].m_nest);
+  }
   {
     PWaitAndSignal mutex(m_nestingMutex);
-    nestedThreadsToDump = m_nestedThreads;
+    for (NestMap::const_iterator it = m_nestedThreads.begin(); it != m_nestedThreads.end(); ++it)
+      nestsToDump.push_back(it->second);
   }
 
 #if PTRACING
-  {
-    ostream & trace = PTRACE_BEGIN(0, "PTLib");
-    trace << "Assertion fail: Possible deadlock in " << *this << " :\n";
-    for (NestMap::const_iterator it = nestedThreadsToDump.begin(); it != nestedThreadsToDump.end(); ++it) {
-      if (it != nestedThreadsToDump.begin())
-        trace << '\n';
-      trace << "  thread-id=" << it->first << " (0x" << std::hex << it->first << std::dec << "),"
-        " unique-id=" << it->second.m_uniqueId << ","
-        " readers=" << it->second.m_readerCount << ","
-        " writers=" << it->second.m_writerCount;
-      if (!it->second.m_waiting)
-        trace << ", LOCKER";
-      switch (PTimedMutex::DeadlockStackWalkMode) {
-      case PTimedMutex::DeadlockStackWalkEnabled:
-        PTrace::WalkStack(trace, it->first, it->second.m_uniqueId);
-        break;
-      case PTimedMutex::DeadlockStackWalkNoSymbols:
-        trace << ", stack: ";
-        PTrace::WalkStack(trace, it->first, it->second.m_uniqueId, true);
-        break;
-      default:
-        break;
-      }
+  ostream & trace = PTRACE_BEGIN(0, "PTLib");
+  trace << "Assertion fail: Possible deadlock in " << *this << " :\n";
+  for (std::vector<Nest>::const_iterator it = nestsToDump.begin(); it != nestsToDump.end(); ++it) {
+    if (it != nestsToDump.begin())
+      trace << '\n';
+    trace << "  thread-id=" << it->m_threadId << " (0x" << std::hex << it->m_threadId << std::dec << "),"
+      " unique-id=" << it->m_uniqueId << ","
+      " readers=" << it->m_readerCount << ","
+      " writers=" << it->m_writerCount;
+    if (!it->m_waiting)
+      trace << ", LOCKER";
+    switch (PTimedMutex::DeadlockStackWalkMode) {
+    case PTimedMutex::DeadlockStackWalkEnabled:
+      PTrace::WalkStack(trace, it->m_threadId, it->m_uniqueId);
+      break;
+    case PTimedMutex::DeadlockStackWalkNoSymbols:
+      trace << ", stack: ";
+      PTrace::WalkStack(trace, it->m_threadId, it->m_uniqueId, true);
+      break;
+    default:
+      break;
     }
-    trace << PTrace::End;
   }
+  trace << PTrace::End;
 #else
   PAssertAlways(PSTRSTRM("Possible deadlock in " << *this));
 #endif
+}
+
+
+void PReadWriteMutex::InternalWait(Nest & nest, PSync & sync, const PDebugLocation & location) const
+{
+  nest.m_waiting = true;
+
+  if (sync.InstrumentedWait(m_excessiveLockTimeout, location)) {
+    nest.m_waiting = false;
+    return;
+  }
+
+  InternalDeadlock();
 
   sync.InstrumentedWait(PMaxTimeInterval, location);
   ExcessiveLockPhantom(*this);
@@ -4551,19 +5725,27 @@ void PReadWriteMutex::InternalEndRead(const PDebugLocation * location)
 
   ReleasedLock(*this, nest->m_startHeldCycle, true, location);
 
+  // The biased read lock does not touch this object after release
+  if (InternalEndFastRead(*nest)) {
+    EndNest();
+    return;
+  }
+
+  ++m_releasingThreads;
+
   // Do text book read lock
   InternalEndReadWithNest(*nest, location);
 
   // At this point all read and write locks are gone for this thread so we can
   // reclaim the memory.
   EndNest();
+
+  --m_releasingThreads;
 }
 
 
 void PReadWriteMutex::InternalStartWrite(const PDebugLocation * location)
 {
-  uint64_t startWaitCycle = PProfiling::GetCycles();
-
   // Get the nested thread info structure, create one it it doesn't exist
   Nest & nest = StartNest();
 
@@ -4576,16 +5758,22 @@ void PReadWriteMutex::InternalStartWrite(const PDebugLocation * location)
   if (nest.m_writerCount > 1)
     return;
 
+  uint64_t startWaitCycle = PProfiling::GetCycles();
+
   // If have a read lock already in this thread then do the "real" unlock code
   // but do not change the lock count, calls to EndRead() will now just
   // decrement the count instead of doing the unlock (its already done!)
-  if (nest.m_readerCount > 0)
+  if (nest.m_readerCount > 0 && !InternalEndFastRead(nest))
     InternalEndReadWithNest(nest, location);
 
   // Note in this gap another thread could grab the write lock
 
   InternalStartWriteWithNest(nest, location);
 
+  // Now have excluded slow path readers, wait for any biased ones
+  m_readsSinceWrite = 0;
+  InternalRevokeReaderBias(nest);
+
   AcquiredLock(startWaitCycle, false, location);
   m_startHeldSamplePoint = PProfiling::GetCycles();
 }
@@ -4614,15 +5802,19 @@ void PReadWriteMutex::InternalEndWrite(const PDebugLocation * location)
 
   ReleasedLock(*this, m_startHeldSamplePoint, false, location);
 
+  ++m_releasingThreads;
+
   InternalEndWriteWithNest(*nest, location);
 
   // Now check to see if there was a read lock present for this thread, if so
   // then reacquire the read lock (not changing the count) otherwise clean up the
   // memory for the nested thread info structure
-  if (nest->m_readerCount > 0)
-    InternalStartReadWithNest(*nest, location);
-  else
+  if (nest->m_readerCount == 0)
     EndNest();
+  else if (!InternalStartFastRead(*nest))
+    InternalStartReadWithNest(*nest, location);
+
+  --m_releasingThreads;
 }
 
 
@@ -4726,6 +5918,8 @@ void PInstrumentedReadWriteMutex::AcquiredLock(uint64_t startWaitCycle, bool rea
     m_timeWaitReadOnlyContext.EndMeasurement(this, this, &location, startWaitCycle);
   else
     m_timeWaitReadWriteContext.EndMeasurement(this, this, &location, startWaitCycle);
+
+  PReadWriteMutex::AcquiredLock(startWaitCycle, readOnly, location);
 }
 
 
@@ -4760,6 +5954,55 @@ PBoolean PCriticalSection::Wait(const PTimeInterval & timeout)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// PCPUFeatures
+
+#if P_CPU_FEATURES_X86 && defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+static unsigned DetectCPUFeatures()
+{
+  unsigned features = 0;
+
+#if P_CPU_FEATURES_X86
+  #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    if ((info[3] & (1 << 26)) != 0)
+      features |= PCPUFeatures::SSE2;
+    if ((info[2] & (1 << 9)) != 0)
+      features |= PCPUFeatures::SSSE3;
+    // Need OSXSAVE and the OS to save the YMM registers, as well as the instructions
+    if (maxLeaf >= 7 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6) {
+      __cpuidex(info, 7, 0);
+      if ((info[1] & (1 << 5)) != 0)
+        features |= PCPUFeatures::AVX2;
+    }
+  #else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+      features |= PCPUFeatures::SSE2;
+    if (__builtin_cpu_supports("ssse3"))
+      features |= PCPUFeatures::SSSE3;
+    if (__builtin_cpu_supports("avx2"))
+      features |= PCPUFeatures::AVX2;
+  #endif
+#endif // P_CPU_FEATURES_X86
+
+  return features;
+}
+
+
+unsigned PCPUFeatures::Get()
+{
+  static const unsigned features = DetectCPUFeatures();
+  return features;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // PIdGenerator
 
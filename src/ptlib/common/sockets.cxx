@@ -46,6 +46,11 @@ extern "C" void inet_ntoa_b(struct in_addr inetAddress, char *pString);
 #include <ConfigurationClass.h>
 #endif
 
+#if P_HAS_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 
 #if !defined(P_MINGW) && !defined(P_CYGWIN)
   #if P_HAS_IPV6 || defined(AI_NUMERICHOST)
@@ -1007,6 +1012,399 @@ PBoolean PSocket::ConvertOSError(P_INT_PTR libcReturnValue, ErrorGroup group)
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// PSocketEventLoop
+
+#if P_HAS_EPOLL
+static uint32_t EventsToEpoll(int events)
+{
+  uint32_t epollEvents = 0;
+  if (events & PSocketEventLoop::ReadEvent)
+    epollEvents |= EPOLLIN;
+  if (events & PSocketEventLoop::WriteEvent)
+    epollEvents |= EPOLLOUT;
+  if (events & PSocketEventLoop::ExceptEvent)
+    epollEvents |= EPOLLPRI;
+  return epollEvents;
+}
+
+
+static int EpollToEvents(uint32_t epollEvents)
+{
+  int events = 0;
+  if (epollEvents & (EPOLLIN | EPOLLHUP))
+    events |= PSocketEventLoop::ReadEvent;
+  if (epollEvents & EPOLLOUT)
+    events |= PSocketEventLoop::WriteEvent;
+  if (epollEvents & (EPOLLPRI | EPOLLERR))
+    events |= PSocketEventLoop::ExceptEvent;
+  return events;
+}
+#endif // P_HAS_EPOLL
+
+
+PSocketEventLoop::PSocketEventLoop()
+#if P_HAS_EPOLL
+  : m_epollHandle(::epoll_create1(EPOLL_CLOEXEC))
+  , m_interruptHandle(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+  , m_unblockHandle(-1)
+#else
+  : m_interruptSocket(new PUDPSocket)
+#endif
+  , m_thread(NULL)
+  , m_running(false)
+{
+#if P_HAS_EPOLL
+  PAssertOS(m_epollHandle >= 0);
+  PAssertOS(m_interruptHandle >= 0);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = m_interruptHandle;
+  PAssertOS(::epoll_ctl(m_epollHandle, EPOLL_CTL_ADD, m_interruptHandle, &ev) == 0);
+#else
+  PAssert(m_interruptSocket->Listen(PIPSocket::Address::GetLoopback()), "Could not open event loop interrupt socket");
+#endif
+}
+
+
+PSocketEventLoop::~PSocketEventLoop()
+{
+  Stop();
+
+#if P_HAS_EPOLL
+  ::close(m_epollHandle);
+  ::close(m_interruptHandle);
+#else
+  delete m_interruptSocket;
+#endif
+}
+
+
+bool PSocketEventLoop::Register(PSocket & socket, int events, const Notifier & notifier)
+{
+  if (!socket.IsOpen()) {
+    PTRACE(2, "Cannot register closed socket " << socket);
+    return false;
+  }
+
+  P_INT_PTR handle = socket.GetHandle();
+
+  PWaitAndSignal lock(m_mutex);
+
+  if (!m_registrations.insert(RegistrationMap::value_type(handle, Registration(socket, events, notifier))).second) {
+    PTRACE(2, "Socket " << socket << " already registered with event loop");
+    return false;
+  }
+
+#if P_HAS_EPOLL
+  struct epoll_event ev;
+  ev.events = EventsToEpoll(events);
+  ev.data.fd = handle;
+  if (::epoll_ctl(m_epollHandle, EPOLL_CTL_ADD, handle, &ev) < 0) {
+    PTRACE(2, "Could not add socket " << socket << " to epoll: " << strerror(errno));
+    m_registrations.erase(handle);
+    return false;
+  }
+#else
+  Interrupt(); // Make waiting thread pick up new socket
+#endif
+
+  PTRACE(5, "Registered socket " << socket << " with event loop, events=0x" << hex << events << dec);
+  return true;
+}
+
+
+bool PSocketEventLoop::Modify(PSocket & socket, int events)
+{
+  PWaitAndSignal lock(m_mutex);
+
+  RegistrationMap::iterator it = m_registrations.find(socket.GetHandle());
+  if (it == m_registrations.end() || &it->second.m_socket != &socket)
+    return false;
+
+  if (it->second.m_events == events)
+    return true;
+
+#if P_HAS_EPOLL
+  struct epoll_event ev;
+  ev.events = EventsToEpoll(events);
+  ev.data.fd = it->first;
+  if (::epoll_ctl(m_epollHandle, EPOLL_CTL_MOD, it->first, &ev) < 0) {
+    PTRACE(2, "Could not modify socket " << socket << " in epoll: " << strerror(errno));
+    return false;
+  }
+#else
+  Interrupt(); // Make waiting thread pick up new events
+#endif
+
+  it->second.m_events = events;
+  return true;
+}
+
+
+bool PSocketEventLoop::Unregister(PSocket & socket)
+{
+  PWaitAndSignal lock(m_mutex);
+
+  // Socket may have been closed since registration, so handle is no longer valid
+  RegistrationMap::iterator it = m_registrations.find(socket.GetHandle());
+  if (it == m_registrations.end() || &it->second.m_socket != &socket) {
+    for (it = m_registrations.begin(); it != m_registrations.end(); ++it) {
+      if (&it->second.m_socket == &socket)
+        break;
+    }
+    if (it == m_registrations.end())
+      return false;
+  }
+
+#if P_HAS_EPOLL
+  // Closed handles are removed automatically, so ignore errors
+  struct epoll_event ev;
+  ::epoll_ctl(m_epollHandle, EPOLL_CTL_DEL, it->first, &ev);
+#endif
+
+  m_registrations.erase(it);
+  PTRACE(5, "Unregistered socket " << socket << " from event loop");
+  return true;
+}
+
+
+bool PSocketEventLoop::IsRegistered(const PSocket & socket) const
+{
+  PWaitAndSignal lock(m_mutex);
+
+  RegistrationMap::const_iterator it = m_registrations.find(socket.GetHandle());
+  if (it != m_registrations.end() && &it->second.m_socket == &socket)
+    return true;
+
+  // Socket may have been closed since registration, so handle is no longer valid
+  for (it = m_registrations.begin(); it != m_registrations.end(); ++it) {
+    if (&it->second.m_socket == &socket)
+      return true;
+  }
+  return false;
+}
+
+
+bool PSocketEventLoop::InternalIsRegistered(P_INT_PTR handle, const PSocket & socket) const
+{
+  PWaitAndSignal lock(m_mutex);
+  RegistrationMap::const_iterator it = m_registrations.find(handle);
+  return it != m_registrations.end() && &it->second.m_socket == &socket;
+}
+
+
+PINDEX PSocketEventLoop::GetSize() const
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_registrations.size();
+}
+
+
+PChannel::Errors PSocketEventLoop::Wait(const PTimeInterval & timeout)
+{
+#if P_HAS_EPOLL
+  PThread * thread = PThread::Current();
+  int unblockHandle = thread != NULL ? thread->PXGetAbortBlockHandle() : -1;
+
+  m_mutex.Wait();
+  if (m_unblockHandle != unblockHandle) {
+    struct epoll_event ev;
+    /* Previous waiting thread may have gone and its handle reused by a
+       registered socket, so only remove it if it is not one of ours. */
+    if (m_unblockHandle >= 0 && m_registrations.find(m_unblockHandle) == m_registrations.end())
+      ::epoll_ctl(m_epollHandle, EPOLL_CTL_DEL, m_unblockHandle, &ev);
+    m_unblockHandle = -1;
+    if (unblockHandle >= 0) {
+      ev.events = EPOLLIN;
+      ev.data.fd = unblockHandle;
+      if (::epoll_ctl(m_epollHandle, EPOLL_CTL_ADD, unblockHandle, &ev) == 0)
+        m_unblockHandle = unblockHandle;
+      else
+        PTRACE(2, "Could not add thread unblock handle to epoll: " << strerror(errno));
+    }
+  }
+  m_mutex.Signal();
+
+  int waitTime;
+  if (timeout == PMaxTimeInterval)
+    waitTime = -1;
+  else {
+    PInt64 ms = timeout.GetMilliSeconds();
+    waitTime = ms > INT_MAX ? INT_MAX : (ms < 0 ? 0 : (int)ms);
+  }
+
+  struct epoll_event events[64];
+  int count;
+  do {
+    PPROFILE_SYSTEM(
+      count = ::epoll_wait(m_epollHandle, events, PARRAYSIZE(events), waitTime);
+    );
+  } while (count < 0 && errno == EINTR);
+
+  if (count < 0) {
+    PTRACE(1, "epoll_wait failed: " << strerror(errno));
+    return errno == EBADF ? PChannel::NotOpen : PChannel::Miscellaneous;
+  }
+
+  if (count == 0)
+    return PChannel::Timeout;
+
+  PChannel::Errors result = PChannel::NoError;
+  ReadyList ready;
+
+  m_mutex.Wait();
+  for (int i = 0; i < count; ++i) {
+    int handle = events[i].data.fd;
+
+    if (handle == m_interruptHandle) {
+      uint64_t dummy;
+      PAssertOS(::read(m_interruptHandle, &dummy, sizeof(dummy)) == sizeof(dummy));
+      result = PChannel::Interrupted;
+      continue;
+    }
+
+    if (handle == unblockHandle) {
+      PTRACE(6, "Event loop unblocked fd=" << unblockHandle);
+      thread->PXClearAbortBlock();
+      result = PChannel::Interrupted;
+      continue;
+    }
+
+    RegistrationMap::iterator it = m_registrations.find(handle);
+    if (it != m_registrations.end())
+      ready.push_back(ReadySocket(handle, it->second.m_socket, EpollToEvents(events[i].events), it->second.m_notifier));
+  }
+  m_mutex.Signal();
+
+  DispatchReady(ready);
+  return result;
+#else // P_HAS_EPOLL
+  PSocket::SelectList read, write, except;
+  m_mutex.Wait();
+  for (RegistrationMap::iterator it = m_registrations.begin(); it != m_registrations.end(); ++it) {
+    if (it->second.m_events & ReadEvent)
+      read += it->second.m_socket;
+    if (it->second.m_events & WriteEvent)
+      write += it->second.m_socket;
+    if (it->second.m_events & ExceptEvent)
+      except += it->second.m_socket;
+  }
+  m_mutex.Signal();
+
+  read += *m_interruptSocket;
+
+  PChannel::Errors result = PSocket::Select(read, write, except, timeout);
+  if (result != PChannel::NoError)
+    return result;
+
+  std::map<PSocket *, int> ready;
+  for (PSocket::SelectList::iterator it = read.begin(); it != read.end(); ++it) {
+    if (&*it == m_interruptSocket) {
+      BYTE dummy[16];
+      m_interruptSocket->Read(dummy, sizeof(dummy));
+      result = PChannel::Interrupted;
+    }
+    else
+      ready[&*it] |= ReadEvent;
+  }
+  for (PSocket::SelectList::iterator it = write.begin(); it != write.end(); ++it)
+    ready[&*it] |= WriteEvent;
+  for (PSocket::SelectList::iterator it = except.begin(); it != except.end(); ++it)
+    ready[&*it] |= ExceptEvent;
+
+  ReadyList readyList;
+  m_mutex.Wait();
+  for (std::map<PSocket *, int>::iterator it = ready.begin(); it != ready.end(); ++it) {
+    // Check is still registered, may have been removed during the select
+    P_INT_PTR handle = it->first->GetHandle();
+    RegistrationMap::iterator reg = m_registrations.find(handle);
+    if (reg != m_registrations.end() && &reg->second.m_socket == it->first)
+      readyList.push_back(ReadySocket(handle, *it->first, it->second, reg->second.m_notifier));
+  }
+  m_mutex.Signal();
+
+  DispatchReady(readyList);
+  return result;
+#endif // P_HAS_EPOLL
+}
+
+
+void PSocketEventLoop::DispatchReady(const ReadyList & ready)
+{
+  /* Notifiers are called without the mutex, so they, or threads they wait
+     on, may Register/Unregister freely. An earlier notifier in this batch
+     may have unregistered a later socket, so check before each call. The
+     handle it was registered with is used, as that is the map key. */
+  for (ReadyList::const_iterator it = ready.begin(); it != ready.end(); ++it) {
+    if (it == ready.begin() || InternalIsRegistered(it->m_handle, *it->m_socket))
+      it->m_notifier(*it->m_socket, it->m_events);
+  }
+}
+
+
+void PSocketEventLoop::Interrupt()
+{
+#if P_HAS_EPOLL
+  static const uint64_t one = 1;
+  PAssertOS(::write(m_interruptHandle, &one, sizeof(one)) == sizeof(one));
+#else
+  PIPSocketAddressAndPort ap;
+  if (m_interruptSocket->GetLocalAddress(ap)) {
+    BYTE dummy = 0;
+    m_interruptSocket->WriteTo(&dummy, 1, ap);
+  }
+#endif
+}
+
+
+bool PSocketEventLoop::Start(const char * threadName)
+{
+  if (m_thread != NULL)
+    return false;
+
+  m_running = true;
+  m_thread = new PThreadObj<PSocketEventLoop>(*this, &PSocketEventLoop::MainLoop, false, threadName);
+  return true;
+}
+
+
+void PSocketEventLoop::Stop()
+{
+  if (m_thread == NULL)
+    return;
+
+  m_running = false;
+  Interrupt();
+  PAssert(m_thread->WaitForTermination(10000), "Socket event loop thread did not terminate promptly");
+  delete m_thread;
+  m_thread = NULL;
+}
+
+
+void PSocketEventLoop::MainLoop()
+{
+  PTRACE(4, "Socket event loop started");
+
+  while (m_running) {
+    PChannel::Errors error = Wait();
+    switch (error) {
+      case PChannel::NoError :
+      case PChannel::Timeout :
+      case PChannel::Interrupted :
+        break;
+
+      default :
+        PTRACE(2, "Socket event loop error: " << PChannel::GetErrorText(error));
+        PThread::Sleep(100); // Prevent CPU spin on persistent error
+    }
+  }
+
+  PTRACE(4, "Socket event loop ended");
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PIPSocket
 
@@ -2401,6 +2799,52 @@ void PTCPSocket::OnOutOfBand(const void *, PINDEX)
 }
 
 
+bool PTCPSocket::WriteFromFile(PFile & file, off_t offset, off_t length)
+{
+  SetLastWriteCount(0);
+
+  if (CheckNotOpen())
+    return false;
+
+  if (!file.IsOpen())
+    return SetErrorValues(NotOpen, EBADF, LastWriteError);
+
+  // Make sure anything already buffered goes first
+  flush();
+
+#if P_HAS_SENDFILE
+  return os_sendfile(file, offset, length);
+#else
+  static const off_t BlockSize = 1024*1024;
+
+  off_t written = 0;
+  while (written < length) {
+    size_t count = (size_t)std::min(length - written, BlockSize);
+    const void * view = file.MapView(offset + written, count);
+    bool ok;
+    if (view != NULL) {
+      ok = Write(view, count);
+      PFile::UnmapView(view, count);
+    }
+    else {
+      // File may have shrunk, stop on a short read rather than loop forever at the end
+      PBYTEArray buffer;
+      ok = file.SetPosition(offset + written) &&
+           file.Read(buffer.GetPointer(count), count) &&
+           Write(buffer, file.GetLastReadCount()) &&
+           (size_t)file.GetLastReadCount() == count;
+    }
+    if (!ok)
+      break;
+    written += GetLastWriteCount();
+  }
+
+  SetLastWriteCount((PINDEX)written);
+  return written >= length;
+#endif
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PIPDatagramSocket
 
@@ -2564,6 +3008,90 @@ bool PIPDatagramSocket::InternalWriteTo(const Slice * slices, size_t sliceCount,
 }
 
 
+PINDEX PIPDatagramSocket::ReadFromMulti(Datagram * datagrams, PINDEX count)
+{
+  SetLastReadCount(0);
+
+  if (count == 0 || CheckNotOpen())
+    return 0;
+
+#if P_HAS_RECVMMSG
+  return os_readmulti(datagrams, count);
+#else
+  return InternalReadFromEach(datagrams, count);
+#endif
+}
+
+
+PINDEX PIPDatagramSocket::InternalReadFromEach(Datagram * datagrams, PINDEX count)
+{
+  // Wait for the first datagram, then only take what is already queued
+  PTimeInterval oldTimeout = GetReadTimeout();
+  PINDEX totalBytes = 0;
+  PINDEX received = 0;
+  while (received < count) {
+    Datagram & datagram = datagrams[received];
+    datagram.m_truncated = false;
+    if (!InternalReadFrom(datagram.m_slices, datagram.m_sliceCount, datagram.m_ipAndPort)) {
+      if (GetErrorCode(LastReadError) != BufferTooSmall)
+        break;
+      datagram.m_truncated = true;
+    }
+    datagram.m_length = GetLastReadCount();
+    totalBytes += datagram.m_length;
+    ++received;
+    SetReadTimeout(0);
+  }
+  SetReadTimeout(oldTimeout);
+
+  // Running out of queued datagrams is not an error
+  if (received > 0 && GetErrorCode(LastReadError) == Timeout)
+    SetErrorValues(NoError, 0, LastReadError);
+
+  SetLastReadCount(totalBytes);
+  return received;
+}
+
+
+PINDEX PIPDatagramSocket::WriteToMulti(Datagram * datagrams, PINDEX count)
+{
+  SetLastWriteCount(0);
+
+  if (count == 0 || CheckNotOpen())
+    return 0;
+
+#if P_HAS_RECVMMSG
+  // Broadcasts need socket options changed, so use the individual writes for them
+  PINDEX i;
+  for (i = 0; i < count; ++i) {
+    const Address & addr = datagrams[i].m_ipAndPort.GetAddress();
+    if (!addr.IsValid() || addr.IsAny() || addr.IsBroadcast() || datagrams[i].m_ipAndPort.GetPort() == 0)
+      break;
+  }
+  if (i >= count)
+    return os_writemulti(datagrams, count);
+#endif
+
+  return InternalWriteToEach(datagrams, count);
+}
+
+
+PINDEX PIPDatagramSocket::InternalWriteToEach(Datagram * datagrams, PINDEX count)
+{
+  PINDEX totalBytes = 0;
+  PINDEX sent;
+  for (sent = 0; sent < count; ++sent) {
+    Datagram & datagram = datagrams[sent];
+    if (!InternalWriteTo(datagram.m_slices, datagram.m_sliceCount, datagram.m_ipAndPort))
+      break;
+    datagram.m_length = GetLastWriteCount();
+    totalBytes += datagram.m_length;
+  }
+  SetLastWriteCount(totalBytes);
+  return sent;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PUDPSocket
 
@@ -2672,6 +3200,15 @@ bool PUDPSocket::InternalReadFrom(Slice * slices, size_t sliceCount, PIPSocketAd
 }
 
 
+PINDEX PUDPSocket::ReadFromMulti(Datagram * datagrams, PINDEX count)
+{
+  PINDEX received = PIPDatagramSocket::ReadFromMulti(datagrams, count);
+  if (received > 0)
+    InternalSetLastReceiveAddress(datagrams[received-1].m_ipAndPort);
+  return received;
+}
+
+
 PBoolean PUDPSocket::Read(void * buf, PINDEX len)
 {
   PIPSocketAddressAndPort dummy;
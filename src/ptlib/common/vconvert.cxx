@@ -102,6 +102,9 @@
   #define PRAGMA_OPTIMISE_DEFAULT()
 #endif
 
+#include <ptlib/cpufeatures.h>
+#define P_COLOUR_CONVERT_X86 P_CPU_FEATURES_X86
+
 
 class PStandardColourConverter : public PColourConverter
 {
@@ -495,6 +498,807 @@ void PColourConverter::RGBtoYUV(unsigned r, unsigned g, unsigned b,
 }
 
 
+typedef int FixedPoint; // Best to be native integer size
+#define ScaleBitShift 12
+static FixedPoint const HalfFixedScaling = 1 << (ScaleBitShift - 1);
+
+#define ROUND(x) ((x) + HalfFixedScaling)
+#define CLAMP(x) (BYTE)(((x) < 0 ? 0 : ((x) >= (255<<ScaleBitShift) ? 255 : ((x)>>ScaleBitShift))))
+
+#define FIX_FROM_FLOAT(x)    ((int) ((x) * (1UL<<ScaleBitShift) + 0.5))
+static FixedPoint const YUVtoR_Coeff  =  FIX_FROM_FLOAT(1.40200);
+static FixedPoint const YUVtoG_Coeff1 = -FIX_FROM_FLOAT(0.34414);
+static FixedPoint const YUVtoG_Coeff2 =  FIX_FROM_FLOAT(0.71414);
+static FixedPoint const YUVtoB_Coeff  =  FIX_FROM_FLOAT(1.77200);
+#undef FIX_FROM_FLOAT
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SIMD kernels for the standard converters
+//
+// A row kernel converts as many pixels as it can from the start of the row,
+// or pair of rows, and returns the count, the plain C++ code then does the
+// remainder. This keeps odd widths and all the scaling/cropping in one place.
+// All kernels are bit exact with the plain C++ code.
+//
+// The kernels are selected once at start up using the CPU features. Another
+// architecture, e.g. ARM NEON, is added with a new set of functions, a new
+// PColourConverterKernels table and an entry in GetCPUAcceleration().
+
+struct PColourConverterKernels
+{
+  PColourConverter::Acceleration m_acceleration;
+
+  unsigned (*m_RGBtoYUV420P)(const BYTE * rgb0, const BYTE * rgb1,
+                             BYTE * y0, BYTE * y1, BYTE * u, BYTE * v,
+                             unsigned width, unsigned rgbIncrement, unsigned redOffset);
+  unsigned (*m_YUV420PtoRGB)(const BYTE * y0, const BYTE * y1, const BYTE * u, const BYTE * v,
+                             BYTE * rgb0, BYTE * rgb1,
+                             unsigned width, unsigned rgbIncrement, unsigned redOffset);
+  unsigned (*m_YUV422toYUV420P)(const BYTE * src0, const BYTE * src1,
+                                BYTE * y0, BYTE * y1, BYTE * u, BYTE * v,
+                                unsigned width, unsigned lumaOffset);
+  unsigned (*m_SwapRedAndBlue)(const BYTE * src, BYTE * dst,
+                               unsigned width, unsigned srcIncrement, unsigned dstIncrement);
+  // Works backwards from the end of the buffers, so can be done in place
+  unsigned (*m_RGB24toRGB32)(const BYTE * srcEnd, BYTE * dstEnd, unsigned pixels);
+  unsigned (*m_RGB32toRGB24)(const BYTE * src, BYTE * dst, unsigned pixels);
+};
+
+
+static unsigned RGBtoYUV420P_Scalar(const BYTE *, const BYTE *, BYTE *, BYTE *, BYTE *, BYTE *, unsigned, unsigned, unsigned)
+{
+  return 0;
+}
+
+static unsigned YUV420PtoRGB_Scalar(const BYTE *, const BYTE *, const BYTE *, const BYTE *, BYTE *, BYTE *, unsigned, unsigned, unsigned)
+{
+  return 0;
+}
+
+static unsigned YUV422toYUV420P_Scalar(const BYTE *, const BYTE *, BYTE *, BYTE *, BYTE *, BYTE *, unsigned, unsigned)
+{
+  return 0;
+}
+
+static unsigned SwapRedAndBlue_Scalar(const BYTE *, BYTE *, unsigned, unsigned, unsigned)
+{
+  return 0;
+}
+
+static unsigned RGB24RGB32_Scalar(const BYTE *, BYTE *, unsigned)
+{
+  return 0;
+}
+
+static PColourConverterKernels const ScalarColourKernels = {
+  PColourConverter::NoAcceleration,
+  RGBtoYUV420P_Scalar,
+  YUV420PtoRGB_Scalar,
+  YUV422toYUV420P_Scalar,
+  SwapRedAndBlue_Scalar,
+  RGB24RGB32_Scalar,
+  RGB24RGB32_Scalar
+};
+
+
+#if P_COLOUR_CONVERT_X86
+
+static __inline uint32_t LoadU32(const BYTE * ptr)
+{
+  uint32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static __inline void StoreU32(BYTE * ptr, uint32_t value)
+{
+  memcpy(ptr, &value, sizeof(value));
+}
+
+// Coefficient pair for _mm_madd_epi16()
+static __inline int MaddPair(int lo, int hi)
+{
+  return (int)(((unsigned)lo & 0xffff) | ((unsigned)hi << 16));
+}
+
+static __inline P_TARGET_SSE2 __m128i Load12_SSE2(const BYTE * ptr)
+{
+  return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)ptr), _mm_cvtsi32_si128((int)LoadU32(ptr+8)));
+}
+
+static __inline P_TARGET_SSE2 void Store12_SSE2(BYTE * ptr, __m128i value)
+{
+  _mm_storel_epi64((__m128i *)ptr, value);
+  StoreU32(ptr+8, (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(value, 8)));
+}
+
+
+/* RGBtoY() etc as 16 bit multiply/adds. Pixels are in 32 bit lanes, and are
+   split into (c0,c1) and (c2,0) 16 bit pairs, where c0/c2 is red or blue
+   depending on redOffset. The divide by 1000 is done in single precision
+   float which is exact, including truncation, for the range of values.
+ */
+struct RGBtoYUVCoeffs_SSE2
+{
+  __m128i m_y01, m_y2, m_u01, m_u2, m_v01, m_v2;
+
+  P_TARGET_SSE2 RGBtoYUVCoeffs_SSE2(unsigned redOffset)
+  {
+    bool red0 = redOffset == 0;
+    m_y01 = _mm_set1_epi32(MaddPair(red0 ?  299 :  114,  587));
+    m_y2  = _mm_set1_epi32(MaddPair(red0 ?  114 :  299,    0));
+    m_u01 = _mm_set1_epi32(MaddPair(red0 ? -147 :  436, -289));
+    m_u2  = _mm_set1_epi32(MaddPair(red0 ?  436 : -147,    0));
+    m_v01 = _mm_set1_epi32(MaddPair(red0 ?  615 : -100, -515));
+    m_v2  = _mm_set1_epi32(MaddPair(red0 ? -100 :  615,    0));
+  }
+};
+
+static __inline P_TARGET_SSE2 void SplitPixels_SSE2(__m128i pixels, __m128i & c01, __m128i & c2)
+{
+  c01 = _mm_or_si128(_mm_and_si128(pixels, _mm_set1_epi32(0xff)),
+                     _mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xff00)), 8));
+  c2 = _mm_and_si128(_mm_srli_epi32(pixels, 16), _mm_set1_epi32(0xff));
+}
+
+static __inline P_TARGET_SSE2 __m128i DivideBy1000_SSE2(__m128i value)
+{
+  return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(1000.0f)));
+}
+
+static __inline P_TARGET_SSE2 __m128i RGBtoY_SSE2(__m128i c01, __m128i c2, __m128i k01, __m128i k2)
+{
+  return DivideBy1000_SSE2(_mm_add_epi32(_mm_madd_epi16(c01, k01), _mm_madd_epi16(c2, k2)));
+}
+
+static __inline P_TARGET_SSE2 __m128i RGBtoUV_SSE2(__m128i c01, __m128i c2, __m128i k01, __m128i k2)
+{
+  __m128i uv = _mm_add_epi32(_mm_madd_epi16(c01, k01), _mm_madd_epi16(c2, k2));
+  __m128i result = _mm_add_epi32(DivideBy1000_SSE2(uv), _mm_set1_epi32(128));
+  // Values over 127000 saturate when packed, but below -127000 must be zero
+  return _mm_andnot_si128(_mm_cmplt_epi32(uv, _mm_set1_epi32(-127000)), result);
+}
+
+// Average of 2x2 blocks, result in even lanes
+static __inline P_TARGET_SSE2 __m128i Average2x2_SSE2(__m128i row0, __m128i row1)
+{
+  __m128i sum = _mm_add_epi16(row0, row1);
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_epi64(sum, 32)), 2);
+}
+
+static __inline P_TARGET_SSE2 __m128i EvenLanes_SSE2(__m128i a, __m128i b)
+{
+  return _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(3,1,2,0)), _mm_shuffle_epi32(b, _MM_SHUFFLE(3,1,2,0)));
+}
+
+// Convert 8x2 pixels, four pixels per register
+static __inline P_TARGET_SSE2 void RGBtoYUV420PBlock_SSE2(__m128i p0a, __m128i p0b, __m128i p1a, __m128i p1b,
+                                                         const RGBtoYUVCoeffs_SSE2 & k,
+                                                         BYTE * y0, BYTE * y1, BYTE * u, BYTE * v)
+{
+  __m128i c01_0a, c2_0a, c01_0b, c2_0b, c01_1a, c2_1a, c01_1b, c2_1b;
+  SplitPixels_SSE2(p0a, c01_0a, c2_0a);
+  SplitPixels_SSE2(p0b, c01_0b, c2_0b);
+  SplitPixels_SSE2(p1a, c01_1a, c2_1a);
+  SplitPixels_SSE2(p1b, c01_1b, c2_1b);
+
+  __m128i y = _mm_packs_epi32(RGBtoY_SSE2(c01_0a, c2_0a, k.m_y01, k.m_y2), RGBtoY_SSE2(c01_0b, c2_0b, k.m_y01, k.m_y2));
+  _mm_storel_epi64((__m128i *)y0, _mm_packus_epi16(y, y));
+  y = _mm_packs_epi32(RGBtoY_SSE2(c01_1a, c2_1a, k.m_y01, k.m_y2), RGBtoY_SSE2(c01_1b, c2_1b, k.m_y01, k.m_y2));
+  _mm_storel_epi64((__m128i *)y1, _mm_packus_epi16(y, y));
+
+  __m128i c01 = EvenLanes_SSE2(Average2x2_SSE2(c01_0a, c01_1a), Average2x2_SSE2(c01_0b, c01_1b));
+  __m128i c2  = EvenLanes_SSE2(Average2x2_SSE2(c2_0a,  c2_1a),  Average2x2_SSE2(c2_0b,  c2_1b));
+  __m128i uv = _mm_packs_epi32(RGBtoUV_SSE2(c01, c2, k.m_u01, k.m_u2), RGBtoUV_SSE2(c01, c2, k.m_v01, k.m_v2));
+  uv = _mm_packus_epi16(uv, uv);
+  StoreU32(u, (uint32_t)_mm_cvtsi128_si32(uv));
+  StoreU32(v, (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(uv, 4)));
+}
+
+static P_TARGET_SSE2 unsigned RGBtoYUV420P_SSE2(const BYTE * rgb0, const BYTE * rgb1,
+                                                BYTE * y0, BYTE * y1, BYTE * u, BYTE * v,
+                                                unsigned width, unsigned rgbIncrement, unsigned redOffset)
+{
+  if (rgbIncrement != 4)
+    return 0;
+
+  RGBtoYUVCoeffs_SSE2 k(redOffset);
+  unsigned x = 0;
+  for (; x + 8 <= width; x += 8) {
+    RGBtoYUV420PBlock_SSE2(_mm_loadu_si128((const __m128i *)rgb0), _mm_loadu_si128((const __m128i *)(rgb0+16)),
+                           _mm_loadu_si128((const __m128i *)rgb1), _mm_loadu_si128((const __m128i *)(rgb1+16)),
+                           k, y0, y1, u, v);
+    rgb0 += 32;
+    rgb1 += 32;
+    y0 += 8;
+    y1 += 8;
+    u += 4;
+    v += 4;
+  }
+  return x;
+}
+
+static P_TARGET_SSSE3 unsigned RGBtoYUV420P_SSSE3(const BYTE * rgb0, const BYTE * rgb1,
+                                                  BYTE * y0, BYTE * y1, BYTE * u, BYTE * v,
+                                                  unsigned width, unsigned rgbIncrement, unsigned redOffset)
+{
+  if (rgbIncrement != 3)
+    return RGBtoYUV420P_SSE2(rgb0, rgb1, y0, y1, u, v, width, rgbIncrement, redOffset);
+
+  // Expand four 24 bit pixels to 32 bit lanes
+  const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+  RGBtoYUVCoeffs_SSE2 k(redOffset);
+  unsigned x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m128i a0 = _mm_loadu_si128((const __m128i *)rgb0);
+    __m128i b0 = _mm_loadl_epi64((const __m128i *)(rgb0+16));
+    __m128i a1 = _mm_loadu_si128((const __m128i *)rgb1);
+    __m128i b1 = _mm_loadl_epi64((const __m128i *)(rgb1+16));
+    RGBtoYUV420PBlock_SSE2(_mm_shuffle_epi8(a0, expand), _mm_shuffle_epi8(_mm_alignr_epi8(b0, a0, 12), expand),
+                           _mm_shuffle_epi8(a1, expand), _mm_shuffle_epi8(_mm_alignr_epi8(b1, a1, 12), expand),
+                           k, y0, y1, u, v);
+    rgb0 += 24;
+    rgb1 += 24;
+    y0 += 8;
+    y1 += 8;
+    u += 4;
+    v += 4;
+  }
+  return x;
+}
+
+
+/* The YUVtoRGB() fixed point arithmetic, (y<<12 + rd)>>12 clamped to 0..255,
+   is the same as y + (rd>>12) saturated, which can be done in 16 bits once
+   the chroma part rd>>12 is calculated in 32 bits.
+ */
+struct YUVtoRGBCoeffs_SSE2
+{
+  __m128i m_r, m_g, m_b, m_round;
+
+  P_TARGET_SSE2 YUVtoRGBCoeffs_SSE2()
+  {
+    m_r = _mm_set1_epi32(MaddPair(YUVtoR_Coeff, HalfFixedScaling));
+    m_g = _mm_set1_epi32(MaddPair(YUVtoG_Coeff1, -YUVtoG_Coeff2));
+    m_b = _mm_set1_epi32(MaddPair(YUVtoB_Coeff, HalfFixedScaling));
+    m_round = _mm_set1_epi32(HalfFixedScaling);
+  }
+};
+
+// Chroma contribution for four U/V samples, each duplicated for two pixels
+static __inline P_TARGET_SSE2 void YUVtoRGBChroma_SSE2(const BYTE * u, const BYTE * v, const YUVtoRGBCoeffs_SSE2 & k,
+                                                      __m128i & rd, __m128i & gd, __m128i & bd)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i offset = _mm_set1_epi16(128);
+  __m128i cb = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)LoadU32(u)), zero), offset);
+  __m128i cr = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)LoadU32(v)), zero), offset);
+
+  rd = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cr, one), k.m_r), ScaleBitShift);
+  gd = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb, cr), k.m_g), k.m_round), ScaleBitShift);
+  bd = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb, one), k.m_b), ScaleBitShift);
+
+  rd = _mm_packs_epi32(rd, rd);
+  gd = _mm_packs_epi32(gd, gd);
+  bd = _mm_packs_epi32(bd, bd);
+  rd = _mm_unpacklo_epi16(rd, rd);
+  gd = _mm_unpacklo_epi16(gd, gd);
+  bd = _mm_unpacklo_epi16(bd, bd);
+}
+
+// Eight 32 bit pixels with zero alpha
+static __inline P_TARGET_SSE2 void YUVtoRGBPixels_SSE2(const BYTE * yPtr, __m128i rd, __m128i gd, __m128i bd,
+                                                      unsigned redOffset, __m128i & pixels0, __m128i & pixels1)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)yPtr), zero);
+  __m128i r = _mm_packus_epi16(_mm_add_epi16(y, rd), zero);
+  __m128i g = _mm_packus_epi16(_mm_add_epi16(y, gd), zero);
+  __m128i b = _mm_packus_epi16(_mm_add_epi16(y, bd), zero);
+  __m128i c01 = _mm_unpacklo_epi8(redOffset == 0 ? r : b, g);
+  __m128i c23 = _mm_unpacklo_epi8(redOffset == 0 ? b : r, zero);
+  pixels0 = _mm_unpacklo_epi16(c01, c23);
+  pixels1 = _mm_unpackhi_epi16(c01, c23);
+}
+
+static P_TARGET_SSE2 unsigned YUV420PtoRGB_SSE2(const BYTE * y0, const BYTE * y1, const BYTE * u, const BYTE * v,
+                                                BYTE * rgb0, BYTE * rgb1,
+                                                unsigned width, unsigned rgbIncrement, unsigned redOffset)
+{
+  if (rgbIncrement != 4)
+    return 0;
+
+  YUVtoRGBCoeffs_SSE2 k;
+  unsigned x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m128i rd, gd, bd, pixels0, pixels1;
+    YUVtoRGBChroma_SSE2(u, v, k, rd, gd, bd);
+    YUVtoRGBPixels_SSE2(y0, rd, gd, bd, redOffset, pixels0, pixels1);
+    _mm_storeu_si128((__m128i *)rgb0, pixels0);
+    _mm_storeu_si128((__m128i *)(rgb0+16), pixels1);
+    YUVtoRGBPixels_SSE2(y1, rd, gd, bd, redOffset, pixels0, pixels1);
+    _mm_storeu_si128((__m128i *)rgb1, pixels0);
+    _mm_storeu_si128((__m128i *)(rgb1+16), pixels1);
+    y0 += 8;
+    y1 += 8;
+    u += 4;
+    v += 4;
+    rgb0 += 32;
+    rgb1 += 32;
+  }
+  return x;
+}
+
+static P_TARGET_SSSE3 unsigned YUV420PtoRGB_SSSE3(const BYTE * y0, const BYTE * y1, const BYTE * u, const BYTE * v,
+                                                  BYTE * rgb0, BYTE * rgb1,
+                                                  unsigned width, unsigned rgbIncrement, unsigned redOffset)
+{
+  if (rgbIncrement != 3)
+    return YUV420PtoRGB_SSE2(y0, y1, u, v, rgb0, rgb1, width, rgbIncrement, redOffset);
+
+  // Compress four 32 bit pixels to 24 bit in the low 12 bytes
+  const __m128i compress = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+  YUVtoRGBCoeffs_SSE2 k;
+  unsigned x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m128i rd, gd, bd, pixels0, pixels1;
+    YUVtoRGBChroma_SSE2(u, v, k, rd, gd, bd);
+    for (int row = 0; row < 2; ++row) {
+      BYTE * rgb = row == 0 ? rgb0 : rgb1;
+      YUVtoRGBPixels_SSE2(row == 0 ? y0 : y1, rd, gd, bd, redOffset, pixels0, pixels1);
+      pixels0 = _mm_shuffle_epi8(pixels0, compress);
+      pixels1 = _mm_shuffle_epi8(pixels1, compress);
+      _mm_storeu_si128((__m128i *)rgb, _mm_or_si128(pixels0, _mm_slli_si128(pixels1, 12)));
+      _mm_storel_epi64((__m128i *)(rgb+16), _mm_srli_si128(pixels1, 4));
+    }
+    y0 += 8;
+    y1 += 8;
+    u += 4;
+    v += 4;
+    rgb0 += 24;
+    rgb1 += 24;
+  }
+  return x;
+}
+
+
+/* Packed YUV 4:2:2 to planar. For YUY2 the luma is in the even bytes, for
+   UYVY the odd bytes. The chroma is taken from the first row only.
+ */
+static P_TARGET_SSE2 unsigned YUV422toYUV420P_SSE2(const BYTE * src0, const BYTE * src1,
+                                                   BYTE * y0, BYTE * y1, BYTE * u, BYTE * v,
+                                                   unsigned width, unsigned lumaOffset)
+{
+  const __m128i mask = _mm_set1_epi16(0xff);
+  const __m128i zero = _mm_setzero_si128();
+
+  unsigned x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)src0);
+    __m128i b = _mm_loadu_si128((const __m128i *)(src0+16));
+    __m128i even = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+    __m128i odd  = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+    __m128i chroma = lumaOffset == 0 ? odd : even;
+    _mm_storeu_si128((__m128i *)y0, lumaOffset == 0 ? even : odd);
+    _mm_storel_epi64((__m128i *)u, _mm_packus_epi16(_mm_and_si128(chroma, mask), zero));
+    _mm_storel_epi64((__m128i *)v, _mm_packus_epi16(_mm_srli_epi16(chroma, 8), zero));
+
+    a = _mm_loadu_si128((const __m128i *)src1);
+    b = _mm_loadu_si128((const __m128i *)(src1+16));
+    if (lumaOffset == 0)
+      _mm_storeu_si128((__m128i *)y1, _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+    else
+      _mm_storeu_si128((__m128i *)y1, _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+
+    src0 += 32;
+    src1 += 32;
+    y0 += 16;
+    y1 += 16;
+    u += 8;
+    v += 8;
+  }
+  return x;
+}
+
+
+/* Only the three colour bytes are written for 32 bit destination pixels,
+   the fourth byte is left as it was in the destination, as per the plain
+   C++ code.
+ */
+static P_TARGET_SSE2 unsigned SwapRedAndBlue_SSE2(const BYTE * src, BYTE * dst,
+                                                  unsigned width, unsigned srcIncrement, unsigned dstIncrement)
+{
+  if (srcIncrement != 4 || dstIncrement != 4)
+    return 0;
+
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  const __m128i green = _mm_set1_epi32(0x0000ff00);
+  const __m128i low = _mm_set1_epi32(0x000000ff);
+
+  unsigned x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+    __m128i swapped = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), low),
+                                                _mm_and_si128(pixels, green)),
+                                   _mm_slli_epi32(_mm_and_si128(pixels, low), 16));
+    __m128i original = _mm_loadu_si128((const __m128i *)dst);
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_and_si128(original, alpha), swapped));
+    src += 16;
+    dst += 16;
+  }
+  return x;
+}
+
+static P_TARGET_SSSE3 unsigned SwapRedAndBlue_SSSE3(const BYTE * src, BYTE * dst,
+                                                    unsigned width, unsigned srcIncrement, unsigned dstIncrement)
+{
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+  unsigned x = 0;
+  if (srcIncrement == 3 && dstIncrement == 3) {
+    /* Five pixels per 16 bytes, the last byte is the first of the next pixel
+       and is passed through unchanged, so we need one more pixel than that. */
+    const __m128i swap = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    for (; x + 6 <= width; x += 5) {
+      _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), swap));
+      src += 15;
+      dst += 15;
+    }
+  }
+  else if (srcIncrement == 3 && dstIncrement == 4) {
+    const __m128i swap = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    for (; x + 4 <= width; x += 4) {
+      __m128i original = _mm_loadu_si128((const __m128i *)dst);
+      _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_and_si128(original, alpha), _mm_shuffle_epi8(Load12_SSE2(src), swap)));
+      src += 12;
+      dst += 16;
+    }
+  }
+  else if (srcIncrement == 4 && dstIncrement == 3) {
+    const __m128i swap = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    for (; x + 4 <= width; x += 4) {
+      Store12_SSE2(dst, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), swap));
+      src += 16;
+      dst += 12;
+    }
+  }
+  else
+    x = SwapRedAndBlue_SSE2(src, dst, width, srcIncrement, dstIncrement);
+
+  return x;
+}
+
+
+static P_TARGET_SSSE3 unsigned RGB24toRGB32_SSSE3(const BYTE * srcEnd, BYTE * dstEnd, unsigned pixels)
+{
+  const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+  unsigned count = 0;
+  for (; count + 4 <= pixels; count += 4) {
+    srcEnd -= 12;
+    dstEnd -= 16;
+    _mm_storeu_si128((__m128i *)dstEnd, _mm_shuffle_epi8(Load12_SSE2(srcEnd), expand));
+  }
+  return count;
+}
+
+static P_TARGET_SSSE3 unsigned RGB32toRGB24_SSSE3(const BYTE * src, BYTE * dst, unsigned pixels)
+{
+  const __m128i compress = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+  unsigned count = 0;
+  for (; count + 4 <= pixels; count += 4) {
+    Store12_SSE2(dst, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), compress));
+    src += 16;
+    dst += 12;
+  }
+  return count;
+}
+
+
+// AVX2 versions do 32 bit pixels, or wider blocks, and leave the rest to SSSE3
+
+static __inline P_TARGET_AVX2 void SplitPixels_AVX2(__m256i pixels, __m256i & c01, __m256i & c2)
+{
+  c01 = _mm256_or_si256(_mm256_and_si256(pixels, _mm256_set1_epi32(0xff)),
+                        _mm256_slli_epi32(_mm256_and_si256(pixels, _mm256_set1_epi32(0xff00)), 8));
+  c2 = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), _mm256_set1_epi32(0xff));
+}
+
+static __inline P_TARGET_AVX2 __m256i DivideBy1000_AVX2(__m256i value)
+{
+  return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(value), _mm256_set1_ps(1000.0f)));
+}
+
+static __inline P_TARGET_AVX2 __m256i RGBtoY_AVX2(__m256i c01, __m256i c2, __m256i k01, __m256i k2)
+{
+  return DivideBy1000_AVX2(_mm256_add_epi32(_mm256_madd_epi16(c01, k01), _mm256_madd_epi16(c2, k2)));
+}
+
+static __inline P_TARGET_AVX2 __m256i RGBtoUV_AVX2(__m256i c01, __m256i c2, __m256i k01, __m256i k2)
+{
+  __m256i uv = _mm256_add_epi32(_mm256_madd_epi16(c01, k01), _mm256_madd_epi16(c2, k2));
+  __m256i result = _mm256_add_epi32(DivideBy1000_AVX2(uv), _mm256_set1_epi32(128));
+  return _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(-127000), uv), result);
+}
+
+static __inline P_TARGET_AVX2 __m256i Average2x2_AVX2(__m256i row0, __m256i row1)
+{
+  __m256i sum = _mm256_add_epi16(row0, row1);
+  return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_srli_epi64(sum, 32)), 2);
+}
+
+static __inline P_TARGET_AVX2 __m256i EvenLanes_AVX2(__m256i a, __m256i b)
+{
+  __m256i even = _mm256_unpacklo_epi64(_mm256_shuffle_epi32(a, _MM_SHUFFLE(3,1,2,0)), _mm256_shuffle_epi32(b, _MM_SHUFFLE(3,1,2,0)));
+  return _mm256_permute4x64_epi64(even, _MM_SHUFFLE(3,1,2,0));
+}
+
+// Pack two sets of eight 32 bit values to sixteen bytes, in order
+static __inline P_TARGET_AVX2 __m128i PackToBytes_AVX2(__m256i a, __m256i b)
+{
+  __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3,1,2,0));
+  return _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+}
+
+static P_TARGET_AVX2 unsigned RGBtoYUV420P_AVX2(const BYTE * rgb0, const BYTE * rgb1,
+                                                BYTE * y0, BYTE * y1, BYTE * u, BYTE * v,
+                                                unsigned width, unsigned rgbIncrement, unsigned redOffset)
+{
+  if (rgbIncrement != 4)
+    return RGBtoYUV420P_SSSE3(rgb0, rgb1, y0, y1, u, v, width, rgbIncrement, redOffset);
+
+  bool red0 = redOffset == 0;
+  const __m256i ky01 = _mm256_set1_epi32(MaddPair(red0 ?  299 :  114,  587));
+  const __m256i ky2  = _mm256_set1_epi32(MaddPair(red0 ?  114 :  299,    0));
+  const __m256i ku01 = _mm256_set1_epi32(MaddPair(red0 ? -147 :  436, -289));
+  const __m256i ku2  = _mm256_set1_epi32(MaddPair(red0 ?  436 : -147,    0));
+  const __m256i kv01 = _mm256_set1_epi32(MaddPair(red0 ?  615 : -100, -515));
+  const __m256i kv2  = _mm256_set1_epi32(MaddPair(red0 ? -100 :  615,    0));
+
+  unsigned x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m256i c01_0a, c2_0a, c01_0b, c2_0b, c01_1a, c2_1a, c01_1b, c2_1b;
+    SplitPixels_AVX2(_mm256_loadu_si256((const __m256i *)rgb0), c01_0a, c2_0a);
+    SplitPixels_AVX2(_mm256_loadu_si256((const __m256i *)(rgb0+32)), c01_0b, c2_0b);
+    SplitPixels_AVX2(_mm256_loadu_si256((const __m256i *)rgb1), c01_1a, c2_1a);
+    SplitPixels_AVX2(_mm256_loadu_si256((const __m256i *)(rgb1+32)), c01_1b, c2_1b);
+
+    _mm_storeu_si128((__m128i *)y0, PackToBytes_AVX2(RGBtoY_AVX2(c01_0a, c2_0a, ky01, ky2), RGBtoY_AVX2(c01_0b, c2_0b, ky01, ky2)));
+    _mm_storeu_si128((__m128i *)y1, PackToBytes_AVX2(RGBtoY_AVX2(c01_1a, c2_1a, ky01, ky2), RGBtoY_AVX2(c01_1b, c2_1b, ky01, ky2)));
+
+    __m256i c01 = EvenLanes_AVX2(Average2x2_AVX2(c01_0a, c01_1a), Average2x2_AVX2(c01_0b, c01_1b));
+    __m256i c2  = EvenLanes_AVX2(Average2x2_AVX2(c2_0a,  c2_1a),  Average2x2_AVX2(c2_0b,  c2_1b));
+    __m128i uv = PackToBytes_AVX2(RGBtoUV_AVX2(c01, c2, ku01, ku2), RGBtoUV_AVX2(c01, c2, kv01, kv2));
+    _mm_storel_epi64((__m128i *)u, uv);
+    _mm_storel_epi64((__m128i *)v, _mm_srli_si128(uv, 8));
+
+    rgb0 += 64;
+    rgb1 += 64;
+    y0 += 16;
+    y1 += 16;
+    u += 8;
+    v += 8;
+  }
+
+  return x + RGBtoYUV420P_SSSE3(rgb0, rgb1, y0, y1, u, v, width - x, rgbIncrement, redOffset);
+}
+
+// Chroma value in 32 bit lane to a 16 bit pair for _mm256_madd_epi16()
+static __inline P_TARGET_AVX2 __m256i MaddLanes_AVX2(__m256i lo, __m256i hi)
+{
+  return _mm256_or_si256(_mm256_and_si256(lo, _mm256_set1_epi32(0xffff)), _mm256_slli_epi32(hi, 16));
+}
+
+static __inline P_TARGET_AVX2 void YUVtoRGBPixels_AVX2(const BYTE * yPtr, __m256i rd, __m256i gd, __m256i bd,
+                                                      unsigned redOffset, BYTE * rgb)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(255);
+  __m256i y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)yPtr));
+  __m256i r = _mm256_min_epi16(_mm256_max_epi16(_mm256_add_epi16(y, rd), zero), max);
+  __m256i g = _mm256_min_epi16(_mm256_max_epi16(_mm256_add_epi16(y, gd), zero), max);
+  __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_add_epi16(y, bd), zero), max);
+  __m256i c01 = _mm256_or_si256(redOffset == 0 ? r : b, _mm256_slli_epi16(g, 8));
+  __m256i c23 = redOffset == 0 ? b : r;
+  __m256i lo = _mm256_unpacklo_epi16(c01, c23);
+  __m256i hi = _mm256_unpackhi_epi16(c01, c23);
+  _mm256_storeu_si256((__m256i *)rgb,      _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i *)(rgb+32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+static P_TARGET_AVX2 unsigned YUV420PtoRGB_AVX2(const BYTE * y0, const BYTE * y1, const BYTE * u, const BYTE * v,
+                                                BYTE * rgb0, BYTE * rgb1,
+                                                unsigned width, unsigned rgbIncrement, unsigned redOffset)
+{
+  if (rgbIncrement != 4)
+    return YUV420PtoRGB_SSSE3(y0, y1, u, v, rgb0, rgb1, width, rgbIncrement, redOffset);
+
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i offset = _mm256_set1_epi32(128);
+  const __m256i kr = _mm256_set1_epi32(MaddPair(YUVtoR_Coeff, HalfFixedScaling));
+  const __m256i kg = _mm256_set1_epi32(MaddPair(YUVtoG_Coeff1, -YUVtoG_Coeff2));
+  const __m256i kb = _mm256_set1_epi32(MaddPair(YUVtoB_Coeff, HalfFixedScaling));
+  const __m256i round = _mm256_set1_epi32(HalfFixedScaling);
+
+  unsigned x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m256i cb = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)u)), offset);
+    __m256i cr = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)v)), offset);
+    __m256i rd = _mm256_srai_epi32(_mm256_madd_epi16(MaddLanes_AVX2(cr, one), kr), ScaleBitShift);
+    __m256i gd = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(MaddLanes_AVX2(cb, cr), kg), round), ScaleBitShift);
+    __m256i bd = _mm256_srai_epi32(_mm256_madd_epi16(MaddLanes_AVX2(cb, one), kb), ScaleBitShift);
+    // Duplicate for two pixels
+    rd = MaddLanes_AVX2(rd, rd);
+    gd = MaddLanes_AVX2(gd, gd);
+    bd = MaddLanes_AVX2(bd, bd);
+
+    YUVtoRGBPixels_AVX2(y0, rd, gd, bd, redOffset, rgb0);
+    YUVtoRGBPixels_AVX2(y1, rd, gd, bd, redOffset, rgb1);
+
+    y0 += 16;
+    y1 += 16;
+    u += 8;
+    v += 8;
+    rgb0 += 64;
+    rgb1 += 64;
+  }
+
+  return x + YUV420PtoRGB_SSSE3(y0, y1, u, v, rgb0, rgb1, width - x, rgbIncrement, redOffset);
+}
+
+static __inline P_TARGET_AVX2 __m256i PackBytes_AVX2(__m256i a, __m256i b)
+{
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3,1,2,0));
+}
+
+static P_TARGET_AVX2 unsigned YUV422toYUV420P_AVX2(const BYTE * src0, const BYTE * src1,
+                                                   BYTE * y0, BYTE * y1, BYTE * u, BYTE * v,
+                                                   unsigned width, unsigned lumaOffset)
+{
+  const __m256i mask = _mm256_set1_epi16(0xff);
+  const __m256i zero = _mm256_setzero_si256();
+
+  unsigned x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)src0);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(src0+32));
+    __m256i even = PackBytes_AVX2(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+    __m256i odd  = PackBytes_AVX2(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+    __m256i chroma = lumaOffset == 0 ? odd : even;
+    _mm256_storeu_si256((__m256i *)y0, lumaOffset == 0 ? even : odd);
+    _mm_storeu_si128((__m128i *)u, _mm256_castsi256_si128(PackBytes_AVX2(_mm256_and_si256(chroma, mask), zero)));
+    _mm_storeu_si128((__m128i *)v, _mm256_castsi256_si128(PackBytes_AVX2(_mm256_srli_epi16(chroma, 8), zero)));
+
+    a = _mm256_loadu_si256((const __m256i *)src1);
+    b = _mm256_loadu_si256((const __m256i *)(src1+32));
+    if (lumaOffset == 0)
+      _mm256_storeu_si256((__m256i *)y1, PackBytes_AVX2(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask)));
+    else
+      _mm256_storeu_si256((__m256i *)y1, PackBytes_AVX2(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)));
+
+    src0 += 64;
+    src1 += 64;
+    y0 += 32;
+    y1 += 32;
+    u += 16;
+    v += 16;
+  }
+
+  return x + YUV422toYUV420P_SSE2(src0, src1, y0, y1, u, v, width - x, lumaOffset);
+}
+
+static P_TARGET_AVX2 unsigned SwapRedAndBlue_AVX2(const BYTE * src, BYTE * dst,
+                                                  unsigned width, unsigned srcIncrement, unsigned dstIncrement)
+{
+  if (srcIncrement != 4 || dstIncrement != 4)
+    return SwapRedAndBlue_SSSE3(src, dst, width, srcIncrement, dstIncrement);
+
+  const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+  const __m256i swap = _mm256_setr_epi8(2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1,
+                                        2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1);
+
+  unsigned x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256i original = _mm256_loadu_si256((const __m256i *)dst);
+    __m256i swapped = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)src), swap);
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(_mm256_and_si256(original, alpha), swapped));
+    src += 32;
+    dst += 32;
+  }
+
+  return x + SwapRedAndBlue_SSSE3(src, dst, width - x, srcIncrement, dstIncrement);
+}
+
+
+static PColourConverterKernels const SSE2ColourKernels = {
+  PColourConverter::SSE2Acceleration,
+  RGBtoYUV420P_SSE2,
+  YUV420PtoRGB_SSE2,
+  YUV422toYUV420P_SSE2,
+  SwapRedAndBlue_SSE2,
+  RGB24RGB32_Scalar,
+  RGB24RGB32_Scalar
+};
+
+static PColourConverterKernels const SSSE3ColourKernels = {
+  PColourConverter::SSSE3Acceleration,
+  RGBtoYUV420P_SSSE3,
+  YUV420PtoRGB_SSSE3,
+  YUV422toYUV420P_SSE2,
+  SwapRedAndBlue_SSSE3,
+  RGB24toRGB32_SSSE3,
+  RGB32toRGB24_SSSE3
+};
+
+static PColourConverterKernels const AVX2ColourKernels = {
+  PColourConverter::AVX2Acceleration,
+  RGBtoYUV420P_AVX2,
+  YUV420PtoRGB_AVX2,
+  YUV422toYUV420P_AVX2,
+  SwapRedAndBlue_AVX2,
+  RGB24toRGB32_SSSE3,
+  RGB32toRGB24_SSSE3
+};
+
+#endif // P_COLOUR_CONVERT_X86
+
+
+static PColourConverter::Acceleration GetCPUAcceleration()
+{
+#if P_COLOUR_CONVERT_X86
+  if (PCPUFeatures::Has(PCPUFeatures::AVX2|PCPUFeatures::SSSE3))
+    return PColourConverter::AVX2Acceleration;
+  if (PCPUFeatures::Has(PCPUFeatures::SSSE3|PCPUFeatures::SSE2))
+    return PColourConverter::SSSE3Acceleration;
+  if (PCPUFeatures::Has(PCPUFeatures::SSE2))
+    return PColourConverter::SSE2Acceleration;
+#endif // P_COLOUR_CONVERT_X86
+
+  return PColourConverter::NoAcceleration;
+}
+
+
+static const PColourConverterKernels * GetColourKernels(PColourConverter::Acceleration level)
+{
+  switch (level) {
+#if P_COLOUR_CONVERT_X86
+    case PColourConverter::AVX2Acceleration :
+      return &AVX2ColourKernels;
+    case PColourConverter::SSSE3Acceleration :
+      return &SSSE3ColourKernels;
+    case PColourConverter::SSE2Acceleration :
+      return &SSE2ColourKernels;
+#endif
+    default :
+      return &ScalarColourKernels;
+  }
+}
+
+
+static PColourConverter::Acceleration const CPUAcceleration = GetCPUAcceleration();
+static const PColourConverterKernels * ColourKernels = GetColourKernels(CPUAcceleration);
+
+
+PColourConverter::Acceleration PColourConverter::SetAcceleration(Acceleration level)
+{
+  ColourKernels = GetColourKernels(std::min(level, CPUAcceleration));
+  PTRACE(4, "PColCnv", "Colour converter acceleration set to " << ColourKernels->m_acceleration);
+  return ColourKernels->m_acceleration;
+}
+
+
+PColourConverter::Acceleration PColourConverter::GetAcceleration()
+{
+  return ColourKernels->m_acceleration;
+}
+
+
+
 class PRasterDutyCycle
 {
   public:
@@ -1304,16 +2108,26 @@ bool PStandardColourConverter::RGBtoYUV420P(const BYTE * srcFrameBuffer,
   if (m_srcFrameWidth == scanLineSizeY && m_srcFrameHeight == planeHeight) {
     int RGBOffset[4] = { 0, (int)rgbIncrement, scanLineSizeRGB, scanLineSizeRGB+(int)rgbIncrement };
     unsigned YUVOffset[4] = { 0, 1, scanLineSizeY, scanLineSizeY + 1 };
+    unsigned pixelIncrement = rgbIncrement;
     scanLineSizeRGB *= 2;
     rgbIncrement *= 2;
     for (unsigned y = 0; y < m_srcFrameHeight; y += 2) {
       const BYTE * pixelPtrRGB = scanLinePtrRGB;
-      for (unsigned x = 0; x < m_srcFrameWidth; x += 2) {
+      unsigned x = ColourKernels->m_RGBtoYUV420P(pixelPtrRGB, pixelPtrRGB + RGBOffset[2],
+                                                 scanLinePtrY, scanLinePtrY + YUVOffset[2],
+                                                 scanLinePtrU, scanLinePtrV,
+                                                 m_srcFrameWidth, pixelIncrement, redOffset);
+      pixelPtrRGB += x*pixelIncrement;
+      scanLinePtrY += x;
+      scanLinePtrU += x/2;
+      scanLinePtrV += x/2;
+      for (; x < m_srcFrameWidth; x += 2) {
         unsigned rSum = 0, gSum = 0, bSum = 0;
         for (unsigned p = 0; p < 4; ++p) {
-          unsigned r = pixelPtrRGB[RGBOffset[p] +  redOffset];
-          unsigned g = pixelPtrRGB[RGBOffset[p] + greenOffset];
-          unsigned b = pixelPtrRGB[RGBOffset[p] +  blueOffset];
+          const BYTE * pixel = pixelPtrRGB + RGBOffset[p];
+          unsigned r = pixel[  redOffset];
+          unsigned g = pixel[greenOffset];
+          unsigned b = pixel[ blueOffset];
           scanLinePtrY[YUVOffset[p]] = RGBtoY(r, g, b);
           rSum += r;
           gSum += g;
@@ -1449,16 +2263,24 @@ void  PStandardColourConverter::YUY2toYUV420PSameSize(const BYTE *yuy2, BYTE *yu
   v = u + npixels/4;
 
   for (h=0; h<m_srcFrameHeight; h+=2) {
+     unsigned done = ColourKernels->m_YUV422toYUV420P(s, s + m_srcFrameWidth*2, y, y + m_srcFrameWidth, u, v, m_srcFrameWidth, 0);
+     s += done*2;
+     y += done;
+     u += done/2;
+     v += done/2;
 
      /* Copy the first line keeping all information */
-     for (x=0; x<m_srcFrameWidth; x+=2) {
+     for (x=done; x<m_srcFrameWidth; x+=2) {
         *y++ = *s++;
         *u++ = *s++;
         *y++ = *s++;
         *v++ = *s++;
      }
+     s += done*2;
+     y += done;
+
      /* Copy the second line discarding u and v information */
-     for (x=0; x<m_srcFrameWidth; x+=2) {
+     for (x=done; x<m_srcFrameWidth; x+=2) {
         *y++ = *s++;
         s++;
         *y++ = *s++;
@@ -1967,20 +2789,6 @@ bool PStandardColourConverter::SBGGR8toRGB(const BYTE * src,
 }
 
 
-typedef int FixedPoint; // Best to be native integer size
-#define ScaleBitShift 12
-static FixedPoint const HalfFixedScaling = 1 << (ScaleBitShift - 1);
-
-#define ROUND(x) ((x) + HalfFixedScaling)
-#define CLAMP(x) (BYTE)(((x) < 0 ? 0 : ((x) >= (255<<ScaleBitShift) ? 255 : ((x)>>ScaleBitShift))))
-
-#define FIX_FROM_FLOAT(x)    ((int) ((x) * (1UL<<ScaleBitShift) + 0.5))
-static FixedPoint const YUVtoR_Coeff  =  FIX_FROM_FLOAT(1.40200);
-static FixedPoint const YUVtoG_Coeff1 = -FIX_FROM_FLOAT(0.34414);
-static FixedPoint const YUVtoG_Coeff2 =  FIX_FROM_FLOAT(0.71414);
-static FixedPoint const YUVtoB_Coeff  =  FIX_FROM_FLOAT(1.77200);
-#undef FIX_FROM_FLOAT
-
 /* 
  * Please note when converting colorspace from YUV to RGB.
  * Not all YUV have the same colorspace. 
@@ -2089,20 +2897,20 @@ bool PStandardColourConverter::YUV420PtoRGB(const BYTE * srcFrameBuffer,
 #endif // P_FFMPEG_SWSCALE
 
   unsigned srcPixpos[4] = { 0, 1, planeWidth, planeWidth + 1 };
-  unsigned dstPixpos[4];
+  int dstPixpos[4];
 
   if (m_verticalFlip) {
-    scanLinePtrRGB -= scanLineSizeRGB; // We do two scan lines at a time
-    dstPixpos[0] = (unsigned)scanLineSizeRGB;
-    dstPixpos[1] =  (unsigned)scanLineSizeRGB+rgbIncrement;
+    scanLinePtrRGB += scanLineSizeRGB; // We do two scan lines at a time
+    dstPixpos[0] = -scanLineSizeRGB;
+    dstPixpos[1] = -scanLineSizeRGB+rgbIncrement;
     dstPixpos[2] = 0;
     dstPixpos[3] = rgbIncrement;
   }
   else {
     dstPixpos[0] = 0;
     dstPixpos[1] = rgbIncrement;
-    dstPixpos[2] = (unsigned)scanLineSizeRGB;
-    dstPixpos[3] = (unsigned)scanLineSizeRGB+rgbIncrement;
+    dstPixpos[2] = scanLineSizeRGB;
+    dstPixpos[3] = scanLineSizeRGB+rgbIncrement;
   }
 
   scanLineSizeRGB *= 2;
@@ -2127,7 +2935,15 @@ bool PStandardColourConverter::YUV420PtoRGB(const BYTE * srcFrameBuffer,
   if (m_srcFrameWidth == m_dstFrameWidth && m_srcFrameHeight == m_dstFrameHeight) {
     for (unsigned y = 0; y < m_srcFrameHeight; y += 2) {
       BYTE * pixelRGB = scanLinePtrRGB;
-      for (unsigned x = 0; x < m_srcFrameWidth; x += 2) {
+      unsigned x = ColourKernels->m_YUV420PtoRGB(scanLinePtrY, scanLinePtrY + planeWidth,
+                                                 scanLinePtrU, scanLinePtrV,
+                                                 pixelRGB + dstPixpos[0], pixelRGB + dstPixpos[2],
+                                                 m_srcFrameWidth, rgbIncrement, redOffset);
+      pixelRGB += x*rgbIncrement;
+      scanLinePtrY += x;
+      scanLinePtrU += x/2;
+      scanLinePtrV += x/2;
+      for (; x < m_srcFrameWidth; x += 2) {
         unsigned pixels = x < m_srcFrameWidth-1 ? 4 : 2;
         YUV420PtoRGB_PIXEL_UV(scanLinePtrU, scanLinePtrV);
         for (unsigned p = 0; p < pixels; p++) {
@@ -2355,7 +3171,11 @@ static void SwapRedAndBlueRow(const BYTE * srcRowPtr,
                               unsigned srcIncrement,
                               unsigned dstIncrement)
 {
-  for (unsigned x = 0; x < width; x++) {
+  unsigned done = ColourKernels->m_SwapRedAndBlue(srcRowPtr, dstRowPtr, width, srcIncrement, dstIncrement);
+  srcRowPtr += done*srcIncrement;
+  dstRowPtr += done*dstIncrement;
+
+  for (unsigned x = done; x < width; x++) {
     BYTE temp = srcRowPtr[0]; // Do it this way in case src and dst are same buffer
     dstRowPtr[0] = srcRowPtr[2];
     dstRowPtr[1] = srcRowPtr[1];
@@ -2475,15 +3295,18 @@ PSTANDARD_COLOUR_CONVERTER(RGB24,RGB32)
   }
 
   // Go from bottom to top so can do in place conversion
-  const BYTE * src = srcFrameBuffer+m_srcFrameBytes-1;
-  BYTE * dst = dstFrameBuffer+m_dstFrameBytes-1;
-
-  for (unsigned x = 0; x < m_srcFrameWidth; x++) {
-    for (unsigned y = 0; y < m_srcFrameHeight; y++) {
-      *dst-- = 0;
-      for (unsigned p = 0; p < 3; p++)
-        *dst-- = *src--;
-    }
+  unsigned pixels = m_srcFrameWidth*m_srcFrameHeight;
+  unsigned done = 0;
+  // If in place and padded scan lines, blocks of pixels would overwrite unread ones
+  if (srcFrameBuffer != dstFrameBuffer || m_dstFrameBytes - m_srcFrameBytes >= (PINDEX)pixels)
+    done = ColourKernels->m_RGB24toRGB32(srcFrameBuffer+m_srcFrameBytes, dstFrameBuffer+m_dstFrameBytes, pixels);
+  const BYTE * src = srcFrameBuffer+m_srcFrameBytes-1-done*3;
+  BYTE * dst = dstFrameBuffer+m_dstFrameBytes-1-done*4;
+
+  for (unsigned x = done; x < pixels; x++) {
+    *dst-- = 0;
+    for (unsigned p = 0; p < 3; p++)
+      *dst-- = *src--;
   }
 
   if (bytesReturned != NULL)
@@ -2499,15 +3322,15 @@ PSTANDARD_COLOUR_CONVERTER(RGB32,RGB24)
     return false;
   }
 
-  const BYTE * src = srcFrameBuffer;
-  BYTE * dst = dstFrameBuffer;
+  unsigned pixels = m_srcFrameWidth*m_srcFrameHeight;
+  unsigned done = ColourKernels->m_RGB32toRGB24(srcFrameBuffer, dstFrameBuffer, pixels);
+  const BYTE * src = srcFrameBuffer+done*4;
+  BYTE * dst = dstFrameBuffer+done*3;
 
-  for (unsigned x = 0; x < m_srcFrameWidth; x++) {
-    for (unsigned y = 0; y < m_srcFrameHeight; y++) {
-      for (unsigned p = 0; p < 3; p++)
-        *dst++ = *src++;
-      src++;
-    }
+  for (unsigned x = done; x < pixels; x++) {
+    for (unsigned p = 0; p < 3; p++)
+      *dst++ = *src++;
+    src++;
   }
 
   if (bytesReturned != NULL)
@@ -2850,16 +3673,24 @@ void  PStandardColourConverter::UYVY422toYUV420PSameSize(const BYTE *uyvy, BYTE
   v = u + npixels/4;
 
   for (h=0; h<m_srcFrameHeight; h+=2) {
+     unsigned done = ColourKernels->m_YUV422toYUV420P(s, s + m_srcFrameWidth*2, y, y + m_srcFrameWidth, u, v, m_srcFrameWidth, 1);
+     s += done*2;
+     y += done;
+     u += done/2;
+     v += done/2;
 
      /* Copy the first line keeping all information */
-     for (x=0; x<m_srcFrameWidth; x+=2) {
+     for (x=done; x<m_srcFrameWidth; x+=2) {
         *u++ = *s++;
         *y++ = *s++;
         *v++ = *s++;
         *y++ = *s++;
      }
+     s += done*2;
+     y += done;
+
      /* Copy the second line discarding u and v information */
-     for (x=0; x<m_srcFrameWidth; x+=2) {
+     for (x=done; x<m_srcFrameWidth; x+=2) {
         s++;
         *y++ = *s++;
         s++;
@@ -622,6 +622,47 @@ PBoolean PFile::SetLength(off_t len)
   return ConvertOSError(_chsize(GetOSHandleAsInt(), len));
 }
 
+
+const void * PFile::MapView(off_t offset, size_t length)
+{
+  if (CheckNotOpen() || length == 0)
+    return NULL;
+
+  // Offset must be on an allocation granularity boundary
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  off_t adjust = offset % info.dwAllocationGranularity;
+  offset -= adjust;
+
+  HANDLE mapping = CreateFileMapping((HANDLE)_get_osfhandle(GetOSHandleAsInt()), NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL) {
+    ConvertOSError(-2);
+    return NULL;
+  }
+
+  // The view keeps the mapping object alive until it is unmapped
+  void * view = MapViewOfFile(mapping, FILE_MAP_READ,
+                              (DWORD)((ULONGLONG)offset >> 32), (DWORD)offset, length + (size_t)adjust);
+  CloseHandle(mapping);
+  if (view == NULL) {
+    ConvertOSError(-2);
+    return NULL;
+  }
+
+  return (const char *)view + adjust;
+}
+
+
+void PFile::UnmapView(const void * view, size_t)
+{
+  if (view == NULL)
+    return;
+
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  UnmapViewOfFile((const char *)view - (ULONG_PTR)view % info.dwAllocationGranularity);
+}
+
 FILE * PFile::FDOpen(const char * mode)
 {
   FILE * h = _fdopen((int)os_handle, mode);
@@ -61,6 +61,7 @@
 #else
 #include <time.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <termios.h>
 #endif
 #include <ctype.h>
@@ -799,6 +800,45 @@ PBoolean PFile::SetLength(off_t len)
 }
 
 
+const void * PFile::MapView(off_t offset, size_t length)
+{
+  if (CheckNotOpen() || length == 0)
+    return NULL;
+
+#ifdef P_VXWORKS
+  return NULL;
+#else
+  // Offset must be on a page boundary
+  static const off_t PageSize = sysconf(_SC_PAGESIZE);
+  off_t adjust = offset % PageSize;
+
+  void * view = ::mmap(NULL, length + adjust, PROT_READ, MAP_SHARED, os_handle, offset - adjust);
+  if (view == MAP_FAILED) {
+    ConvertOSError(-1);
+    return NULL;
+  }
+
+#ifdef MADV_SEQUENTIAL
+  ::madvise(view, length + adjust, MADV_SEQUENTIAL);
+#endif
+  return (const char *)view + adjust;
+#endif
+}
+
+
+void PFile::UnmapView(const void * view, size_t length)
+{
+#ifndef P_VXWORKS
+  if (view == NULL)
+    return;
+
+  static const uintptr_t PageSize = sysconf(_SC_PAGESIZE);
+  uintptr_t adjust = (uintptr_t)view % PageSize;
+  ::munmap((char *)view - adjust, length + adjust);
+#endif
+}
+
+
 bool PFile::Exists(const PFilePath & name)
 { 
 #ifdef P_VXWORKS
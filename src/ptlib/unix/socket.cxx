@@ -99,6 +99,10 @@
 
 #include <ptlib/sockets.h>
 
+#if P_HAS_SENDFILE
+  #include <sys/sendfile.h>
+#endif
+
 #if defined(SIOCGENADDR)
 #define SIO_Get_MAC_Address SIOCGENADDR
 #define  ifr_macaddr         ifr_ifru.ifru_enaddr
@@ -256,7 +260,7 @@ PChannel::Errors PSocket::Select(SelectList & read,
   Errors lastError = NoError;
 #if P_PTHREADS
   PThread * unblockThread = PThread::Current();
-  int unblockPipe = unblockThread->unblockPipe[0];
+  int unblockPipe = unblockThread->PXGetAbortBlockHandle();
 #endif
   SelectList * list[3] = { &read, &write, &except };
   PSocket * firstSocket = NULL;
@@ -311,9 +315,8 @@ PChannel::Errors PSocket::Select(SelectList & read,
 #if P_PTHREADS
     if (pfd[0].revents != 0) {
       PTRACE2(6, NULL, "Select unblocked fd=" << unblockPipe);
-      char ch;
       PPROFILE_SYSTEM(
-        firstSocket->ConvertOSError(::read(unblockPipe, &ch, 1));
+        firstSocket->ConvertOSError(unblockThread->PXClearAbortBlock() ? 0 : -1);
       );
       lastError = Interrupted;
     }
@@ -397,9 +400,8 @@ PChannel::Errors PSocket::Select(SelectList & read,
 #if P_PTHREADS
       if (fds[0].IsPresent(unblockPipe)) {
         PTRACE2(6, NULL, "Select unblocked fd=" << unblockPipe);
-        char ch;
         PPROFILE_SYSTEM(
-          firstSocket->ConvertOSError(::read(unblockPipe, &ch, 1));
+          firstSocket->ConvertOSError(unblockThread->PXClearAbortBlock() ? 0 : -1);
         );
         lastError = Interrupted;
       }
@@ -567,6 +569,143 @@ bool PSocket::os_vwrite(const Slice * slices, size_t sliceCount, int flags, stru
   }
 }
 
+#if P_HAS_RECVMMSG
+
+static const PINDEX MaxMultiMessages = 64;
+
+PINDEX PIPDatagramSocket::os_readmulti(Datagram * datagrams, PINDEX count)
+{
+  if (count > MaxMultiMessages)
+    count = MaxMultiMessages;
+
+  mmsghdr messages[MaxMultiMessages];
+  sockaddr_storage addresses[MaxMultiMessages];
+  memset(messages, 0, count*sizeof(mmsghdr));
+  for (PINDEX i = 0; i < count; ++i) {
+    messages[i].msg_hdr.msg_name    = &addresses[i];
+    messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+    messages[i].msg_hdr.msg_iov     = datagrams[i].m_slices;
+    messages[i].msg_hdr.msg_iovlen  = datagrams[i].m_sliceCount;
+  }
+
+  do {
+    // Socket is non-blocking, so this returns whatever is queued
+    PPROFILE_SYSTEM(
+      int result = ::recvmmsg(os_handle, messages, count, 0, NULL);
+    );
+    if (ConvertOSError(result, LastReadError)) {
+      PINDEX totalBytes = 0;
+      for (int i = 0; i < result; ++i) {
+        Datagram & datagram = datagrams[i];
+        datagram.m_length = messages[i].msg_len;
+        datagram.m_truncated = (messages[i].msg_hdr.msg_flags&MSG_TRUNC) != 0;
+        datagram.m_ipAndPort = PIPSocketAddressAndPort((sockaddr *)&addresses[i], messages[i].msg_hdr.msg_namelen);
+        totalBytes += datagram.m_length;
+      }
+      PTRACE_IF(4, datagrams[0].m_truncated, "Truncated packet read");
+      SetLastReadCount(totalBytes);
+      return result;
+    }
+  } while (GetErrorNumber(LastReadError) == EWOULDBLOCK && PXSetIOBlock(PXReadBlock, readTimeout));
+
+  return 0;
+}
+
+
+PINDEX PIPDatagramSocket::os_writemulti(Datagram * datagrams, PINDEX count)
+{
+  mmsghdr messages[MaxMultiMessages];
+  sockaddr_storage addresses[MaxMultiMessages];
+
+  PINDEX sent = 0;
+  PINDEX totalBytes = 0;
+  unsigned noBufferRetry = 0;
+  bool ok = true;
+  while (ok && sent < count) {
+    PINDEX batch = std::min(count - sent, MaxMultiMessages);
+    memset(messages, 0, batch*sizeof(mmsghdr));
+    for (PINDEX i = 0; i < batch; ++i) {
+      Datagram & datagram = datagrams[sent+i];
+      PIPSocket::sockaddr_wrapper sa(datagram.m_ipAndPort);
+      memcpy(&addresses[i], (sockaddr *)sa, sa.GetSize());
+      messages[i].msg_hdr.msg_name    = &addresses[i];
+      messages[i].msg_hdr.msg_namelen = sa.GetSize();
+      messages[i].msg_hdr.msg_iov     = datagram.m_slices;
+      messages[i].msg_hdr.msg_iovlen  = datagram.m_sliceCount;
+    }
+
+    PINDEX done = 0;
+    while (done < batch) {
+      PPROFILE_SYSTEM(
+        int result = ::sendmmsg(os_handle, &messages[done], batch - done, 0);
+      );
+
+      if (ConvertOSError(result, LastWriteError)) {
+        for (int i = 0; i < result; ++i, ++done) {
+          datagrams[sent+done].m_length = messages[done].msg_len;
+          totalBytes += messages[done].msg_len;
+        }
+        continue;
+      }
+
+      if (GetErrorNumber(LastWriteError) == ENOBUFS &&
+                  NoBufferRetryCount > 0 && ++noBufferRetry <= NoBufferRetryCount) {
+        usleep(100);
+        continue;
+      }
+
+      if (GetErrorNumber(LastWriteError) == EWOULDBLOCK && PXSetIOBlock(PXWriteBlock, writeTimeout))
+        continue;
+
+      ok = false;
+      break;
+    }
+    sent += done;
+  }
+
+  PTRACE_IF(s_NoBufsThrottle, noBufferRetry > 0, "PTLib",
+            "WARNING: No buffer space available for " << noBufferRetry << " retries of socket write" << s_NoBufsThrottle);
+  SetLastWriteCount(totalBytes);
+  return sent;
+}
+
+#endif // P_HAS_RECVMMSG
+
+#if P_HAS_SENDFILE
+
+bool PTCPSocket::os_sendfile(PFile & file, off_t offset, off_t length)
+{
+  off_t position = offset;
+  off_t end = offset + length;
+  while (position < end) {
+    // Limit each call, so large files do not exceed the ssize_t return range
+    size_t count = (size_t)std::min(end - position, (off_t)0x40000000);
+    PPROFILE_SYSTEM(
+      ssize_t result = ::sendfile(os_handle, file.GetHandle(), &position, count);
+    );
+    if (result == 0) {
+      // File was truncated after the length was determined
+      SetErrorValues(ProtocolFailure, EIO, LastWriteError);
+      break;
+    }
+    if (!ConvertOSError(result, LastWriteError)) {
+      switch (GetErrorNumber(LastWriteError)) {
+        case EINTR :
+          continue;
+        case EWOULDBLOCK :
+          if (PXSetIOBlock(PXWriteBlock, writeTimeout))
+            continue;
+      }
+      break;
+    }
+  }
+
+  SetLastWriteCount((PINDEX)(position - offset));
+  return position >= end;
+}
+
+#endif // P_HAS_SENDFILE
+
 #else // P_RECVMSG
 
 bool PSocket::os_vread(Slice * slices, size_t sliceCount, int flags, struct sockaddr * addr, socklen_t * addrlen)
@@ -31,6 +31,10 @@
 #include <pthread.h>
 #include <sys/resource.h>
 
+#if P_HAS_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 #ifdef P_RTEMS
 #define SUSPEND_SIG SIGALRM
 #include <sched.h>
@@ -199,6 +203,20 @@ static pthread_mutex_t MutexInitialiser = PTHREAD_MUTEX_INITIALIZER;
 //  is not paused
 //
 
+static void PX_OpenAbortBlock(int unblockPipe[2])
+{
+#if P_HAS_EVENTFD
+  // Semaphore mode, so each abort is a separate wake up, as with a pipe
+  unblockPipe[0] = unblockPipe[1] = ::eventfd(0, EFD_CLOEXEC | EFD_SEMAPHORE);
+  PAssertOS(unblockPipe[0] >= 0);
+#elif defined(P_RTEMS)
+  PAssertOS(socketpair(AF_INET,SOCK_STREAM,0,unblockPipe) == 0);
+#else
+  PAssertOS(::pipe(unblockPipe) == 0);
+#endif
+}
+
+
 PThread::PThread(bool isProcess)
   : m_type(isProcess ? e_IsProcess : e_IsExternal)
   , m_originalStackSize(0)
@@ -216,11 +234,7 @@ PThread::PThread(bool isProcess)
   , PX_WaitSemMutex(MutexInitialiser)
 #endif
 {
-#ifdef P_RTEMS
-  PAssertOS(socketpair(AF_INET,SOCK_STREAM,0,unblockPipe) == 0);
-#else
-  PAssertOS(::pipe(unblockPipe) == 0);
-#endif
+  PX_OpenAbortBlock(unblockPipe);
 
   if (isProcess)
     return;
@@ -253,11 +267,7 @@ PThread::PThread(PINDEX stackSize,
   , PX_WaitSemMutex(MutexInitialiser)
 #endif
 {
-#ifdef P_RTEMS
-  PAssertOS(socketpair(AF_INET,SOCK_STREAM,0,unblockPipe) == 0);
-#else
-  PAssertOS(::pipe(unblockPipe) == 0);
-#endif
+  PX_OpenAbortBlock(unblockPipe);
   PX_NewHandle("Thread unblock pipe", PMAX(unblockPipe[0], unblockPipe[1]));
 
   // If need to be deleted automatically, make sure thread that does it runs.
@@ -283,7 +293,8 @@ void PThread::InternalDestroy()
 
   // close I/O unblock pipes
   ::close(unblockPipe[0]);
-  ::close(unblockPipe[1]);
+  if (unblockPipe[1] != unblockPipe[0])
+    ::close(unblockPipe[1]);
 
 #ifndef P_HAS_SEMAPHORES
   pthread_mutex_destroy(&PX_WaitSemMutex);
@@ -485,8 +496,7 @@ bool PThread::PX_kill(PThreadIdentifier tid, PUniqueThreadIdentifier uid, int si
 void PThread::PX_Suspended()
 {
   while (PX_suspendCount > 0) {
-    BYTE ch;
-    if (::read(unblockPipe[0], &ch, 1) == 1 || errno != EINTR)
+    if (PXClearAbortBlock() || errno != EINTR)
     return;
 
 #if P_USE_THREAD_CANCEL
@@ -927,9 +937,11 @@ static PUniqueThreadIdentifier GetCurrentUniqueIdentifier()
 
 PUniqueThreadIdentifier PThread::GetCurrentUniqueIdentifier()
 {
-#if (__cplusplus >= 201103L)
+#ifdef P_THREAD_LOCAL
   // Cache the unique ID in TLS to avoid frequent syscalls
-  thread_local PUniqueThreadIdentifier uniqueId = ::GetCurrentUniqueIdentifier();
+  static P_THREAD_LOCAL PUniqueThreadIdentifier uniqueId;
+  if (uniqueId == 0)
+    uniqueId = ::GetCurrentUniqueIdentifier();
   return uniqueId;
 #else
   return ::GetCurrentUniqueIdentifier();
@@ -972,8 +984,7 @@ int PThread::PXBlockOnIO(int handle, int type, const PTimeInterval & timeout)
     retval = ::poll(pfd, PARRAYSIZE(pfd), timeout.GetInterval());
   } while (retval < 0 && errno == EINTR);
 
-  BYTE dummy;
-  if (retval > 0 && pfd[1].revents != 0 && ::read(unblockPipe[0], &dummy, 1) == 1) {
+  if (retval > 0 && pfd[1].revents != 0 && PXClearAbortBlock()) {
     errno = ECANCELED;
     retval = -1;
     PTRACE(6, "PTLib\tUnblocked I/O fd=" << unblockPipe[0]);
@@ -1018,8 +1029,7 @@ int PThread::PXBlockOnIO(int handle, int type, const PTimeInterval & timeout)
     );
   } while (retval < 0 && errno == EINTR);
 
-  BYTE dummy;
-  if (retval > 0 && read_fds.IsPresent(unblockPipe[0]) && ::read(unblockPipe[0], &ch, 1) == 1) {
+  if (retval > 0 && read_fds.IsPresent(unblockPipe[0]) && PXClearAbortBlock()) {
     errno = ECANCELED;
     retval =  -1;
     PTRACE(6, "PTLib\tUnblocked I/O fd=" << unblockPipe[0]);
@@ -1032,12 +1042,29 @@ int PThread::PXBlockOnIO(int handle, int type, const PTimeInterval & timeout)
 
 void PThread::PXAbortBlock() const
 {
+#if P_HAS_EVENTFD
+  static const uint64_t one = 1;
+  PAssertOS(::write(unblockPipe[1], &one, sizeof(one)) == sizeof(one));
+#else
   static BYTE ch = 0;
   PAssertOS(::write(unblockPipe[1], &ch, 1) == 1);
+#endif
   PTRACE(6, "PTLib\tUnblocking I/O fd=" << unblockPipe[0] << " thread=" << GetThreadName());
 }
 
 
+bool PThread::PXClearAbortBlock() const
+{
+#if P_HAS_EVENTFD
+  uint64_t count;
+  return ::read(unblockPipe[0], &count, sizeof(count)) == sizeof(count);
+#else
+  BYTE ch;
+  return ::read(unblockPipe[0], &ch, 1) == 1;
+#endif
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 PSemaphore::~PSemaphore()
@@ -0,0 +1,99 @@
+/*
+ * main.cxx
+ *
+ * Decoder for trace files written with the PTrace::BinaryFormat option.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+
+#include <fstream>
+
+
+class TraceDecode : public PProcess
+{
+  PCLASSINFO(TraceDecode, PProcess)
+
+  public:
+    TraceDecode()
+      : PProcess("PTLib", "TraceDecode", 1, 0, ReleaseCode, 0)
+    {
+    }
+
+    void Main();
+};
+
+
+PCREATE_PROCESS(TraceDecode);
+
+
+void TraceDecode::Main()
+{
+  PArgList & args = GetArguments();
+  args.Parse("O-option:"
+             "o-output:"
+             "h-help.");
+
+  if (args.HasOption('h') || args.GetCount() == 0) {
+    cerr << "usage: " << GetFile().GetTitle() << " [ options ] binary-trace-file\n"
+            "     -O --option     : text layout options, default is as traced,\r"
+            PTRACE_ARGLIST_OPT_HELP "\n"
+            "     -o --output     : text output file, default is stdout\n"
+            "     -h --help       : Get this help message\n"
+         << endl;
+    return;
+  }
+
+#if PTRACING
+  unsigned options = UINT_MAX;
+  if (args.HasOption('O')) {
+    PTrace::SetOptionsByName(args.GetOptionString('O'));
+    options = PTrace::GetOptions();
+  }
+
+  std::ifstream input(args[0], std::ios::in | std::ios::binary);
+  if (!input.is_open()) {
+    cerr << "Could not open \"" << args[0] << '"' << endl;
+    SetTerminationValue(1);
+    return;
+  }
+
+  std::ofstream file;
+  if (args.HasOption('o')) {
+    file.open(args.GetOptionString('o'));
+    if (!file.is_open()) {
+      cerr << "Could not create \"" << args.GetOptionString('o') << '"' << endl;
+      SetTerminationValue(1);
+      return;
+    }
+  }
+
+  if (!PTrace::DecodeBinary(input, file.is_open() ? file : cout, options)) {
+    cerr << '"' << args[0] << "\" is not a binary trace file" << endl;
+    SetTerminationValue(1);
+  }
+#else
+  cerr << "Trace not enabled in library" << endl;
+  SetTerminationValue(1);
+#endif
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////